@@ -100,11 +100,16 @@ void af_init()
 /**************************************************************************/
 /*!
     Return a handle that can be used in the application layer as a single
-    point of reference for all the frames that pass through.
+    point of reference for all the frames that pass through. The invalid
+    handle and the handles that the NWK uses for relayed frames are skipped.
 */
 /**************************************************************************/
 U8 af_handle_get()
 {
+    if ((af_handle == ZIGBEE_INVALID_HANDLE) || (af_handle >= NWK_RELAY_HANDLE_BASE))
+    {
+        af_handle = ZIGBEE_INVALID_HANDLE + 1;
+    }
     return af_handle++;
 }
 
@@ -119,7 +124,7 @@ U8 af_handle_get()
 void af_rx(buffer_t *buf, aps_hdr_t *hdr)
 {
     af_rx_add(buf, hdr);
-    process_post(&af_process, event_af_rx, NULL);
+    process_post_prio(&af_process, event_af_rx, NULL, PROCESS_PRIO_LOW);
 }
 
 /**************************************************************************/
@@ -131,8 +136,9 @@ void af_rx(buffer_t *buf, aps_hdr_t *hdr)
 /**************************************************************************/
 void af_rx_handler()
 {
-    U8 len;
-    mem_ptr_t *rx_mem_ptr, *grp_mem_ptr;
+    U8 i, len, map, ep;
+    mem_ptr_t *rx_mem_ptr;
+    aps_grp_t *grp;
 
     if ((rx_mem_ptr = af_rx_pop()) != NULL)
     {
@@ -141,17 +147,23 @@ void af_rx_handler()
         // doing pointer arithmetic. It won't overflow.
         len = aMaxPHYPacketSize - (RX_ENTRY(rx_mem_ptr)->buf->dptr - RX_ENTRY(rx_mem_ptr)->buf->buf);
 
-        // If we're in group mode, then use the group ID and scan the group table for matches. if a match is found
-        // then send the frame to that endpoint for processing. continue until the end of the group table.
+        // If we're in group mode, then look up the group ID and send the frame to every endpoint whose bit is
+        // set in the group's endpoint bitmap.
         if (RX_ENTRY(rx_mem_ptr)->grp_mode)
         {
-            for (grp_mem_ptr = aps_grp_get_head(); grp_mem_ptr != NULL; grp_mem_ptr = grp_mem_ptr->next)
+            if ((grp = aps_grp_find(RX_ENTRY(rx_mem_ptr)->grp_id)) != NULL)
             {
-                // we need to get the mem pointer for the group id entry first. then we can figure out the group ID
-                if (GROUP_ENTRY(grp_mem_ptr)->id == RX_ENTRY(rx_mem_ptr)->grp_id)
+                for (i=0; i<APS_GRP_EP_MAP_SIZE; i++)
                 {
-                    af_ep_rx(GROUP_ENTRY(grp_mem_ptr)->ep, RX_ENTRY(rx_mem_ptr)->buf, len, RX_ENTRY(rx_mem_ptr)->src_addr,
-                             RX_ENTRY(rx_mem_ptr)->src_ep, RX_ENTRY(rx_mem_ptr)->clust_id);
+                    // take a copy of the bitmap byte. the endpoint may change the group table when it handles the frame.
+                    for (map = grp->ep_map[i], ep = i * 8; map != 0; map >>= 1, ep++)
+                    {
+                        if (map & 1)
+                        {
+                            af_ep_rx(ep, RX_ENTRY(rx_mem_ptr)->buf, len, RX_ENTRY(rx_mem_ptr)->src_addr,
+                                     RX_ENTRY(rx_mem_ptr)->src_ep, RX_ENTRY(rx_mem_ptr)->clust_id);
+                        }
+                    }
                 }
             }
         }
@@ -177,7 +189,7 @@ void af_rx_handler()
 void aps_conf(U8 status, U8 handle)
 {
     af_conf_add(status, handle);
-    process_post(&af_process, event_af_conf, NULL);
+    process_post_prio(&af_process, event_af_conf, NULL, PROCESS_PRIO_LOW);
 }
 
 /**************************************************************************/
@@ -240,7 +252,7 @@ void af_tx(U8 *data, U8 len, U8 src_ep, U16 dest_addr, U8 dest_ep, U16 clust, U1
         memcpy(buf->dptr, data, len);
 
         af_tx_add(buf, src_ep, dest_addr, dest_ep, clust, prof_id, mode, tx_opt, radius, handle);
-        process_post(&af_process, event_af_tx, NULL);
+        process_post_prio(&af_process, event_af_tx, NULL, PROCESS_PRIO_LOW);
     }
     else
     {
@@ -50,7 +50,6 @@
 
 #define CONF_ENTRY(m) ((af_conf_entry_t *)MMEM_PTR(&m->mmem_ptr))         ///< De-reference the mem ptr and cast it as an conf queue entry
 #define CONF_TBL_ENTRY(m) ((af_conf_tbl_entry_t *)MMEM_PTR(&m->mmem_ptr)) ///< De-reference the mem ptr and cast it as an conf table entry
-#define EP_ENTRY(m) ((ep_entry_t *)MMEM_PTR(&m->mmem_ptr))                ///< De-reference the mem ptr and cast it as an ep list entry
 #define RX_ENTRY(m) ((af_rx_entry_t *)MMEM_PTR(&m->mmem_ptr))             ///< De-reference the mem ptr and cast it as an rx queue entry
 #define TX_ENTRY(m) ((af_tx_entry_t *)MMEM_PTR(&m->mmem_ptr))             ///< De-reference the mem ptr and cast it as an tx queue entry
 
@@ -89,17 +88,20 @@ enum AF_MISC_ENUMS
 {
     AF_EP_RANGE_MAX                     = 240,      ///< Max valid endpoint num
     AF_BASE_SIMPLE_DESC_SIZE            = 8,        ///< Size of simple desc without cluster lists
+    AF_MAX_SIMPLE_DESC_SIZE             = 40,       ///< Max size of a simple desc stored in the endpoint table
+    AF_EP_MAP_SIZE                      = (AF_EP_RANGE_MAX / 8) + 1,    ///< Size in bytes of the registered endpoint bitmap
+    AF_EP_SLOT_NONE                     = 0xFF      ///< Endpoint slot index for an unregistered endpoint
 };
 
 /****************************************************************/
 /*!
-    Endpoint structure used to build the endpoint list.
+    Endpoint structure used to build the endpoint table.
 */
 /****************************************************************/
 typedef struct _ep_entry_t
 {
     U8                  ep_num;             ///< Endpoint number of this endpoint
-    mem_ptr_t           *simple_desc;       ///< Simple descriptor for this endpoint
+    U8                  simple_desc[AF_MAX_SIMPLE_DESC_SIZE];   ///< Simple descriptor for this endpoint
     U8                  simple_desc_size;   ///< Size of simple descriptor for this endpoint
     bool                zcl;                ///< True if this endpoint supports the ZCL
     void (*ep_rx)       (U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clust_id);  ///< Rx data callback registered with this endpoint
@@ -148,7 +150,6 @@ typedef struct _af_conf_tbl_entry_t
 {
     U8      handle;                     ///< Handle ID for outbound frame
     U8      src_ep;                     ///< Src endpoint of outbound frame
-    U8      expiry;                     ///< Time remaining before expiration of this entry
 } af_conf_tbl_entry_t;
 
 /****************************************************************/
@@ -184,12 +185,12 @@ U8 af_handle_get();
 // af_ep
 void af_ep_init();
 void af_ep_clear_all();
-void af_ep_add(U8 ep_num, U8 *simple_desc, U8 desc_size, bool zcl,
+U8 af_ep_add(U8 ep_num, U8 *simple_desc, U8 desc_size, bool zcl,
              void (*ep_rx)(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clust_id),
              void (*ep_conf)(U8, U8));
-mem_ptr_t *af_ep_find(U8 ep_num);
-void af_ep_rx(U16 dest_ep, buffer_t *buf, U8 len, U16 src_addr, U8 src_ep, U16 clust_id);
-void af_ep_conf(U16 dest_ep, U8 status, U8 handle);
+ep_entry_t *af_ep_find(U8 ep_num);
+void af_ep_rx(U8 dest_ep, buffer_t *buf, U8 len, U16 src_addr, U8 src_ep, U16 clust_id);
+void af_ep_conf(U8 dest_ep, U8 status, U8 handle);
 U8 af_ep_get_active(U8 *active_list);
 U8 af_ep_find_matches(U16 prof_id, const clust_list_t *in_list, const clust_list_t *out_list, U8 *eps);
 
@@ -216,5 +217,4 @@ void af_conf_tbl_init();
 void af_conf_tbl_add(U8 src_ep, U8 handle);
 void af_conf_tbl_free(mem_ptr_t *mem_ptr);
 mem_ptr_t *af_conf_tbl_find(U8 handle);
-void af_conf_tbl_periodic();
 #endif
@@ -68,8 +68,23 @@ void af_conf_tbl_init()
 
 /**************************************************************************/
 /*!
-    Find a free entry and add it to the confirm table. Also, fill out the
-    default expiration time.
+    This is the slow timer callback for a confirm table entry. If it expires,
+    then the confirm never arrived so we send a confirm with a failure status
+    to the originating endpoint.
+*/
+/**************************************************************************/
+static void af_conf_tbl_expire(void *ptr)
+{
+    mem_ptr_t *mem_ptr = ptr;
+
+    DBG_PRINT_RAW("AF_CONF_TBL TIMEOUT! Src EP: %02X, Handle %02X.\n", CONF_TBL_ENTRY(mem_ptr)->src_ep, CONF_TBL_ENTRY(mem_ptr)->handle);
+    aps_conf(AF_TIMEOUT, CONF_TBL_ENTRY(mem_ptr)->handle);
+}
+
+/**************************************************************************/
+/*!
+    Find a free entry and add it to the confirm table. Also, start the
+    expiration timer.
 */
 /**************************************************************************/
 static mem_ptr_t *af_conf_tbl_alloc()
@@ -78,7 +93,7 @@ static mem_ptr_t *af_conf_tbl_alloc()
 
     if ((mem_ptr = mem_heap_alloc(sizeof(af_conf_tbl_entry_t))) != NULL)
     {
-        CONF_TBL_ENTRY(mem_ptr)->expiry = ZIGBEE_CONFIRM_INTERVAL;
+        slow_tmr_set(&mem_ptr->tmr, ZIGBEE_CONFIRM_INTERVAL, af_conf_tbl_expire, mem_ptr);
         list_add(af_conf_tbl, mem_ptr);
     }
     return mem_ptr;
@@ -134,28 +149,3 @@ void af_conf_tbl_add(U8 src_ep, U8 handle)
         CONF_TBL_ENTRY(mem_ptr)->handle = handle;
     }
 }
-
-/**************************************************************************/
-/*!
-    This function gets called periodically from the slow clock. It is used mainly
-    to expire confirm table entries that are old. If an expiration occurs, it will
-    send a confirm with a failure status to the originating endpoint.
-*/
-/**************************************************************************/
-void af_conf_tbl_periodic()
-{
-    mem_ptr_t *mem_ptr;
-
-    for (mem_ptr = list_head(af_conf_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-    {
-        if (CONF_TBL_ENTRY(mem_ptr)->expiry == 0)
-        {
-            DBG_PRINT_RAW("AF_CONF_TBL TIMEOUT! Src EP: %02X, Handle %02X.\n", CONF_TBL_ENTRY(mem_ptr)->src_ep, CONF_TBL_ENTRY(mem_ptr)->handle);
-            aps_conf(AF_TIMEOUT, CONF_TBL_ENTRY(mem_ptr)->handle);
-        }
-        else
-        {
-            CONF_TBL_ENTRY(mem_ptr)->expiry--;
-        }
-    }
-}
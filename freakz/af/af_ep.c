@@ -40,130 +40,116 @@
 
     This file contains functions for registering, finding, and removing endpoints
     from the Zigbee device. Endpoint registration works by adding the simple descriptor,
-    rx callback, and conf callback to the endpoint list. It also has some
+    rx callback, and conf callback to the endpoint table. It also has some
     helper functions that are used by the ZDO for descriptor processing.
+
+    Endpoints live in a compact table with the simple descriptor stored inline.
+    A 256 entry slot index maps an endpoint number straight to its table entry
+    so RX and confirm dispatch is a single array index. A bitmap of the active
+    endpoints is kept alongside so that the ZDO descriptor requests can walk
+    the endpoints in increasing order without sorting.
 */
 /**************************************************************************/
 #include "freakz.h"
 
 /**************************************************************************/
 /*!
-        List head for the AF endpoint list. This list contains the registered endpoints for this
+        The AF endpoint table. This table contains the registered endpoints for this
         device and holds the simple descriptors, as well as the endpoint callbacks
         for received frames and confirmations.
 */
 /**************************************************************************/
-LIST(ep_list);
+static ep_entry_t ep_tbl[ZIGBEE_MAX_ENDPOINTS];
+static U8 ep_cnt;                       ///< Number of entries used in the endpoint table
+static U8 ep_slot[256];                 ///< Endpoint number to endpoint table index
+static U8 ep_map[AF_EP_MAP_SIZE];       ///< Bitmap of the registered endpoints
 
 /**************************************************************************/
 /*!
-    Initialize the af endpoint list.
+    Initialize the af endpoint table.
 */
 /**************************************************************************/
 void af_ep_init()
 {
-    list_init(ep_list);
-}
-
-/**************************************************************************/
-/*!
-    Allocate a ep_entry structure for registering an endpoint. Add this element
-    to the list.
-*/
-/**************************************************************************/
-static mem_ptr_t *af_ep_alloc()
-{
-    mem_ptr_t *mem_ptr;
-
-    if ((mem_ptr = mem_heap_alloc(sizeof(ep_entry_t))) != NULL)
-    {
-        list_add(ep_list, mem_ptr);
-    }
-    return mem_ptr;
-}
-
-/**************************************************************************/
-/*!
-    Free the specified ep_entry. We need to be careful when we free it though.
-    The simple descriptor has some malloc'd fields that we need to free first.
-    Otherwise we will have a mem leak.
-*/
-/**************************************************************************/
-static void af_ep_free(mem_ptr_t *mem_ptr)
-{
-    if (mem_ptr)
-    {
-        list_remove(ep_list, mem_ptr);
-
-        // careful...order matters here. free the desc pointers first. then the struct.
-        mem_heap_free(EP_ENTRY(mem_ptr)->simple_desc);
-        mem_heap_free(mem_ptr);
-    }
+    af_ep_clear_all();
 }
 
 /**************************************************************************/
 /*!
-    Remove all entries from the endpoint list.
+    Remove all entries from the endpoint table.
 */
 /**************************************************************************/
 void af_ep_clear_all()
 {
-    mem_ptr_t *mem_ptr;
-
-    for (mem_ptr = list_chop(ep_list); mem_ptr != NULL; mem_ptr = list_chop(ep_list))
-    {
-        af_ep_free(mem_ptr);
-    }
+    ep_cnt = 0;
+    memset(ep_tbl, 0, sizeof(ep_tbl));
+    memset(ep_slot, AF_EP_SLOT_NONE, sizeof(ep_slot));
+    memset(ep_map, 0, sizeof(ep_map));
 }
 
 /**************************************************************************/
 /*!
     Register the endpoint with the application framework. To register and endpoint
     requires the simple descriptor and the rx callback function. The rx callback
-    function is so that the af knows where to send any incoming messages.
+    function is so that the af knows where to send any incoming messages. If the
+    endpoint is already registered, its entry will be overwritten.
+
+    Returns AF_SUCCESS if the endpoint was registered, AF_INVALID_EP for a
+    missing descriptor or out of range endpoint, AF_INSUFFICIENT_SPACE if the
+    descriptor won't fit in the entry, or AF_TABLE_FULL if there's no free slot.
 */
 /**************************************************************************/
-void af_ep_add(U8 ep_num, U8 *simple_desc, U8 desc_size, bool zcl,
+U8 af_ep_add(U8 ep_num, U8 *simple_desc, U8 desc_size, bool zcl,
              void (*ep_rx)(U8 *, U8, U16, U8, U16),
              void (*ep_conf)(U8, U8))
 {
-    mem_ptr_t *mem_ptr;
+    U8 slot;
+
+    if (!simple_desc || (ep_num > AF_EP_RANGE_MAX))
+    {
+        DBG_PRINT("AF_EP_ADD: Invalid endpoint %02X.\n", ep_num);
+        return AF_INVALID_EP;
+    }
 
-    if (simple_desc)
+    if (desc_size > AF_MAX_SIMPLE_DESC_SIZE)
     {
-        if ((mem_ptr = af_ep_alloc()) != NULL)
+        DBG_PRINT("AF_EP_ADD: Simple desc for endpoint %02X too large (%d bytes).\n", ep_num, desc_size);
+        return AF_INSUFFICIENT_SPACE;
+    }
+
+    if ((slot = ep_slot[ep_num]) == AF_EP_SLOT_NONE)
+    {
+        if (ep_cnt >= ZIGBEE_MAX_ENDPOINTS)
         {
-            if ((EP_ENTRY(mem_ptr)->simple_desc = mem_heap_alloc(sizeof(desc_size))) != NULL)
-            {
-                EP_ENTRY(mem_ptr)->ep_num = ep_num;
-                EP_ENTRY(mem_ptr)->simple_desc_size = desc_size;
-                EP_ENTRY(mem_ptr)->zcl = zcl;
-                EP_ENTRY(mem_ptr)->ep_rx = ep_rx;
-                EP_ENTRY(mem_ptr)->ep_conf = ep_conf;
-                memcpy(EP_ENTRY(mem_ptr)->simple_desc->mmem_ptr.ptr, simple_desc, desc_size);
-            }
+            DBG_PRINT("AF_EP_ADD: Endpoint table full. Endpoint %02X not added.\n", ep_num);
+            return AF_TABLE_FULL;
         }
+        slot = ep_cnt++;
     }
+
+    ep_tbl[slot].ep_num             = ep_num;
+    ep_tbl[slot].simple_desc_size   = desc_size;
+    ep_tbl[slot].zcl                = zcl;
+    ep_tbl[slot].ep_rx              = ep_rx;
+    ep_tbl[slot].ep_conf            = ep_conf;
+    memcpy(ep_tbl[slot].simple_desc, simple_desc, desc_size);
+
+    ep_slot[ep_num] = slot;
+    ep_map[ep_num / 8] |= (1 << (ep_num % 8));
+    return AF_SUCCESS;
 }
 
 /**************************************************************************/
 /*!
-    Find the ep entry with the specified endpoint number and return the mem pointer
-    to it.
+    Find the ep entry with the specified endpoint number and return a pointer
+    to it. Returns NULL if the endpoint isn't registered.
 */
 /**************************************************************************/
-mem_ptr_t *af_ep_find(U8 ep_num)
+ep_entry_t *af_ep_find(U8 ep_num)
 {
-    mem_ptr_t *mem_ptr;
+    U8 slot = ep_slot[ep_num];
 
-    for (mem_ptr = list_head(ep_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-    {
-        if (EP_ENTRY(mem_ptr)->ep_num == ep_num)
-        {
-            break;
-        }
-    }
-    return (mem_ptr);
+    return (slot == AF_EP_SLOT_NONE) ? NULL : &ep_tbl[slot];
 }
 
 /**************************************************************************/
@@ -171,16 +157,13 @@ mem_ptr_t *af_ep_find(U8 ep_num)
     Send the received data to the specified destination ep's rx callback function.
 */
 /**************************************************************************/
-void af_ep_rx(U16 dest_ep, buffer_t *buf, U8 len, U16 src_addr, U8 src_ep, U16 clust_id)
+void af_ep_rx(U8 dest_ep, buffer_t *buf, U8 len, U16 src_addr, U8 src_ep, U16 clust_id)
 {
-    mem_ptr_t *mem_ptr;
+    ep_entry_t *ep;
 
-    if ((mem_ptr = af_ep_find(dest_ep)) != NULL)
+    if (((ep = af_ep_find(dest_ep)) != NULL) && ep->ep_rx)
     {
-        if (EP_ENTRY(mem_ptr)->ep_rx)
-        {
-            EP_ENTRY(mem_ptr)->ep_rx(buf->dptr, len, src_addr, src_ep, clust_id);
-        }
+        ep->ep_rx(buf->dptr, len, src_addr, src_ep, clust_id);
     }
 }
 
@@ -189,73 +172,62 @@ void af_ep_rx(U16 dest_ep, buffer_t *buf, U8 len, U16 src_addr, U8 src_ep, U16 c
         Send a confirmation to the specified endpoint.
 */
 /**************************************************************************/
-void af_ep_conf(U16 dest_ep, U8 status, U8 handle)
+void af_ep_conf(U8 dest_ep, U8 status, U8 handle)
 {
-    mem_ptr_t *mem_ptr;
+    ep_entry_t *ep;
 
-    if ((mem_ptr = af_ep_find(dest_ep)) != NULL)
+    if (((ep = af_ep_find(dest_ep)) != NULL) && ep->ep_conf)
     {
-        if (EP_ENTRY(mem_ptr)->ep_conf)
-        {
-            EP_ENTRY(mem_ptr)->ep_conf(status, handle);
-        }
+        ep->ep_conf(status, handle);
     }
 }
 
 /**************************************************************************/
 /*!
-    Sort the ep list in increasing order. This function is used by the ZDO
-    for the active ep descriptor and match descriptor.
+    Return the next registered endpoint at or above ep_num by scanning the
+    endpoint bitmap. Returns AF_EP_SLOT_NONE when there are no more endpoints.
 */
 /**************************************************************************/
-static void af_ep_sort(U8 *eps, U8 size)
+static U8 af_ep_next(U16 ep_num)
 {
-        U8 i, j, min, tmp;
+    U8 map;
 
-        for (i=0; i<size; i++)
+    while (ep_num <= AF_EP_RANGE_MAX)
+    {
+        // skip over empty bytes in one go
+        if ((map = (ep_map[ep_num / 8] >> (ep_num % 8))) == 0)
         {
-                // Set the min value to the highest value
-                min = i;
-                for (j=i; j<size; j++)
-                {
-                        if (eps[j] < eps[min])
-                        {
-                                // If we found a new min value, then replace the value at that index
-                                // with the new min value.
-                                tmp = eps[min];
-                                eps[min] = eps[j];
-                                eps[j] = tmp;
-                        }
-                }
+            ep_num = (ep_num | 7) + 1;
+            continue;
         }
+
+        for (; !(map & 1); map >>= 1)
+        {
+            ep_num++;
+        }
+        return (U8)ep_num;
+    }
+    return AF_EP_SLOT_NONE;
 }
 
 /**************************************************************************/
 /*!
     Build the active endpoint list and return it along with the endpoint count.
+    The list is built from the endpoint bitmap so it comes out in increasing order.
 */
 /**************************************************************************/
 U8 af_ep_get_active(U8 *active_list)
 {
-    mem_ptr_t *mem_ptr;
-    U8 max, ep_cnt = 0;
-    U8 eps[ZIGBEE_MAX_ENDPOINTS];
+    U8 ep, cnt = 0;
+    U8 *list = active_list + 1;
 
-    // get all endpoint entries and add them to the active endpoint list
-    for (mem_ptr = list_head(ep_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+    for (ep = af_ep_next(0); ep != AF_EP_SLOT_NONE; ep = af_ep_next(ep + 1))
     {
-        eps[ep_cnt] = EP_ENTRY(mem_ptr)->ep_num;
-        ep_cnt++;
+        *list++ = ep;
+        cnt++;
     }
-
-    // sort the list in increasing order
-    af_ep_sort(eps, ep_cnt);
-
-    // copy the eps list to the incoming list up to the ZIGBEE_MAX_ENDPOINTS limit
-    max = (ep_cnt > ZIGBEE_MAX_ENDPOINTS) ? ZIGBEE_MAX_ENDPOINTS : ep_cnt;
-    *active_list++ = max;
-    memcpy(active_list, eps, max);
-    return max + 1;
+    *active_list = cnt;
+    return cnt + 1;
 }
 
 /**************************************************************************/
@@ -264,25 +236,25 @@ U8 af_ep_get_active(U8 *active_list)
     the match descriptor request handler.
 */
 /**************************************************************************/
-static bool af_ep_match(const mem_ptr_t *mem_ptr, U16 prof_id, const clust_list_t *in_list, const clust_list_t *out_list)
+static bool af_ep_match(const ep_entry_t *ep, U16 prof_id, const clust_list_t *in_list, const clust_list_t *out_list)
 {
     U8 i, j, k;
-    simple_desc_t *desc;
-    clust_list_t *entry_in, *entry_out, *dev_list;
+    const simple_desc_t *desc;
+    const clust_list_t *entry_in, *entry_out, *dev_list;
     const clust_list_t *match_list;
 
     //lint --e{826} Suppress Info 826: Suspicious pointer-to-pointer conversion (area too small)
     // this removes the lint warning for this block only
 
     // if the prof id doesn't match, then disqualify the entry
-    desc = (simple_desc_t *)EP_ENTRY(mem_ptr)->simple_desc->mmem_ptr.ptr;
+    desc = (const simple_desc_t *)ep->simple_desc;
     if (desc->prof_id != prof_id)
     {
         return false;
     }
 
     // add pointers to the input clusters and output clusters
-    entry_in = (clust_list_t *)desc->clust_info;
+    entry_in = (const clust_list_t *)desc->clust_info;
     entry_out = entry_in + 1 + (entry_in->clust_cnt * sizeof(U16));
 
     // compare each member of the clusters with each member of the entry's clusters.
@@ -322,21 +294,20 @@ static bool af_ep_match(const mem_ptr_t *mem_ptr, U16 prof_id, const clust_list_
 /**************************************************************************/
 /*!
     Looks for matching endpoints based on the profile id and the cluster lists.
+    The endpoints are checked in increasing order so the list comes out sorted.
 */
 /**************************************************************************/
 U8 af_ep_find_matches(U16 prof_id, const clust_list_t *in_list, const clust_list_t *out_list, U8 *eps)
 {
-    U8 i = 0;
-    mem_ptr_t *mem_ptr;
+    U8 ep, i = 0;
 
-    for (mem_ptr = list_head(ep_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+    for (ep = af_ep_next(0); ep != AF_EP_SLOT_NONE; ep = af_ep_next(ep + 1))
     {
-        if (af_ep_match(mem_ptr, prof_id, in_list, out_list))
+        if (af_ep_match(af_ep_find(ep), prof_id, in_list, out_list))
         {
-            eps[i] = EP_ENTRY(mem_ptr)->ep_num;
+            eps[i] = ep;
             i++;
         }
     }
-    af_ep_sort(eps, i);
     return i;
 }
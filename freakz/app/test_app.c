@@ -68,6 +68,10 @@ static void test_app_add_grp(U8 argc, char **argv);
 static void test_app_rem_grp(U8 argc, char **argv);
 static void test_app_dump_free_bufs(U8 argc, char **argv);
 static void test_app_led_toggle(U8 argc, char **argv);
+static void test_app_proc_prof(U8 argc, char **argv);
+static void test_app_mto_start(U8 argc, char **argv);
+static void test_app_brc_mode(U8 argc, char **argv);
+static void test_app_repair_mode(U8 argc, char **argv);
 
 /* Main command table for this node */
 static test_app_cmd_t test_app_cmd_tbl[] =
@@ -87,6 +91,10 @@ static test_app_cmd_t test_app_cmd_tbl[] =
 	{"rg",		test_app_rem_grp		},
 	{"ra",		test_zcl_read_attrib		},
 	{"led",		test_app_led_toggle		},
+	{"prof",	test_app_proc_prof		},
+	{"mto",		test_app_mto_start		},
+	{"brc",		test_app_brc_mode		},
+	{"repair",	test_app_repair_mode		},
 	{"wa",		test_zcl_write_attrib		},
 	{"da",		test_zcl_disc_attrib		},
 	{"cr",		test_zcl_config_rpt		},
@@ -290,3 +298,58 @@ static void test_app_led_toggle(U8 argc, char **argv)
 	drvr_toggle_leds();
 }
 
+/*
+ * Scheduler profile. "prof" prints the histograms, "prof raw" prints the
+ * machine readable dump, and "prof clr" starts the counts over.
+ */
+static void test_app_proc_prof(U8 argc, char **argv)
+{
+	if ((argc == 2) && !strcmp(argv[1], "clr")) {
+#if PROCESS_CONF_PROFILE
+		process_profile_reset();
+#endif
+		return;
+	}
+
+	debug_dump_proc_prof((argc == 2) && !strcmp(argv[1], "raw"));
+}
+
+/*
+ * Make this node a concentrator and send out a many-to-one route request.
+ * "mto <secs>" repeats the request every <secs> seconds, "mto 0" sends it once.
+ */
+static void test_app_mto_start(U8 argc, char **argv)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+
+	nib->is_concentrator = true;
+	if (argc == 2)
+		nib->concentrator_disc_time = (U8)strtol(argv[1], NULL, 10);
+	nwk_rte_mesh_mto_start();
+}
+
+/*
+ * Select how this node relays broadcasts. "brc trickle" suppresses relays
+ * that neighbors already sent, "brc std" goes back to passive acks.
+ */
+static void test_app_brc_mode(U8 argc, char **argv)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+
+	if (argc == 2)
+		nib->brc_trickle = !strcmp(argv[1], "trickle");
+	DBG_PRINT("Broadcast relay mode: %s\n", nib->brc_trickle ? "trickle" : "std");
+}
+
+/*
+ * Select what this node does about a broken route. "repair on" rediscovers
+ * the route here, "repair off" only reports it to the originator.
+ */
+static void test_app_repair_mode(U8 argc, char **argv)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+
+	if (argc == 2)
+		nib->local_repair = !strcmp(argv[1], "on");
+	DBG_PRINT("Local route repair: %s\n", nib->local_repair ? "on" : "off");
+}
@@ -60,12 +60,17 @@ static U8 test_data_simple_desc[] = {
 
 void test_data_init()
 {
-	af_ep_add(TEST_DATA_EP,
-		  test_data_simple_desc,
-		  sizeof(test_data_simple_desc),
-		  false,
-		  test_data_rx_handler,
-		  test_data_conf_handler);
+	U8 status;
+
+	status = af_ep_add(TEST_DATA_EP,
+			   test_data_simple_desc,
+			   sizeof(test_data_simple_desc),
+			   false,
+			   test_data_rx_handler,
+			   test_data_conf_handler);
+
+	if (status != AF_SUCCESS)
+		DBG_PRINT("TEST_DATA_INIT: Couldn't register the test data endpoint. Status %02X.\n", status);
 }
 
 void test_data_rx_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clust_id)
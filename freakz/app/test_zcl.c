@@ -60,77 +60,51 @@ static U8 simple_desc[] = {
 	ZCL_ON_OFF_CLUST_ID
 };
 
-/* Basic Cluster */
-static zcl_basic_attrib_list_t basic_attrib_list;
-static zcl_clust_t basic_clust;
+/* Attribute storage for each cluster on this ep */
+static zcl_basic_data_t basic_data;
+static zcl_on_off_data_t on_off_data;
+static zcl_id_data_t id_data;
+static zcl_level_data_t level_data;
 
 /*
- * Initialize the on/off attribute list for the on/off cluster
- * this struct holds the data that the attributes points to
+ * This is where the cluster table is defined. The attribute tables are
+ * generated at compile time by each cluster and the entries need to stay
+ * sorted by cluster id so they can be looked up with a binary search.
  */
-static zcl_on_off_attrib_list_t on_off_attrib_list;
-static zcl_clust_t on_off_clust;
-
-/* ZCL ID Cluster */
-static zcl_id_attrib_list_t id_attrib_list;
-static zcl_clust_t id_clust;
-
-/* ZCL Level Control Cluster */
-static zcl_level_attrib_list_t level_attrib_list;
-static zcl_clust_t level_clust;
-
-/* Initialize the cluster list */
-/* This is where the cluster list is defined */
-static zcl_clust_t *test_zcl_clust_list[] =
+static const zcl_clust_t test_zcl_clust_tbl[] =
 {
-	&basic_clust,
-	&on_off_clust,
-	&id_clust,
-	&level_clust,
-	NULL
+	ZCL_CLUST_ENTRY(TEST_ZCL_EP, ZCL_BASIC_CLUST_ID, zcl_basic_attrib_tbl,
+			&basic_data, zcl_basic_rx_handler, NULL),
+	ZCL_CLUST_ENTRY(TEST_ZCL_EP, ZCL_IDENTIFY_CLUST_ID, zcl_id_attrib_tbl,
+			&id_data, zcl_id_rx_handler, test_zcl_id_action_handler),
+	ZCL_CLUST_ENTRY(TEST_ZCL_EP, ZCL_ON_OFF_CLUST_ID, zcl_on_off_attrib_tbl,
+			&on_off_data, zcl_on_off_rx_handler, test_zcl_on_off_action_handler),
+	ZCL_CLUST_ENTRY(TEST_ZCL_EP, ZCL_LEVEL_CLUST_ID, zcl_level_attrib_tbl,
+			&level_data, zcl_level_rx_handler, test_zcl_level_action_handler)
 };
 
+#define TEST_ZCL_CLUST_CNT (sizeof(test_zcl_clust_tbl)/sizeof(zcl_clust_t))
+
 void test_zcl_init()
 {
-	/* init the clusters with the proper data */
-	zcl_set_clust(&basic_clust,
-		      TEST_ZCL_EP,
-		      ZCL_BASIC_CLUST_ID,
-		      basic_attrib_list.list,
-		      zcl_basic_rx_handler,
-		      NULL);
-	zcl_set_clust(&on_off_clust,
-		      TEST_ZCL_EP,
-		      ZCL_ON_OFF_CLUST_ID,
-		      on_off_attrib_list.list,
-		      zcl_on_off_rx_handler,
-		      test_zcl_on_off_action_handler);
-	zcl_set_clust(&id_clust,
-		      TEST_ZCL_EP,
-		      ZCL_IDENTIFY_CLUST_ID,
-		      id_attrib_list.list,
-		      zcl_id_rx_handler,
-		      test_zcl_id_action_handler);
-	zcl_set_clust(&level_clust,
-		      TEST_ZCL_EP,
-		      ZCL_LEVEL_CLUST_ID,
-		      level_attrib_list.list,
-		      zcl_level_rx_handler,
-		      test_zcl_level_action_handler);
+	U8 status;
 
 	/* init the attributes */
-	zcl_basic_init(&basic_attrib_list);
-	zcl_on_off_init(&on_off_attrib_list);
-	zcl_id_init(&id_attrib_list);
-	zcl_level_init(&level_attrib_list);
+	zcl_basic_init(&basic_data);
+	zcl_on_off_init(&on_off_data);
+	zcl_id_init(&id_data);
+	zcl_level_init(&level_data);
 
 	/* register the endpoint as a ZCL endpoint */
-	af_ep_add(TEST_ZCL_EP,
-		  simple_desc,
-		  sizeof(simple_desc),
-		  true,
-		  test_zcl_rx_handler,
-		  test_zcl_conf_handler);
+	status = af_ep_add(TEST_ZCL_EP,
+			   simple_desc,
+			   sizeof(simple_desc),
+			   true,
+			   test_zcl_rx_handler,
+			   test_zcl_conf_handler);
+
+	if (status != AF_SUCCESS)
+		DBG_PRINT("TEST_ZCL_INIT: Couldn't register the ZCL endpoint. Status %02X.\n", status);
 
 	/* init the leds on the raven usb board */
 	drvr_init_leds();
@@ -138,12 +112,12 @@ void test_zcl_init()
 
 void test_zcl_rx_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clust_id)
 {
-	zcl_clust_t *clust;
+	const zcl_clust_t *clust;
 	zcl_hdr_t hdr;
 	U8 resp_len, resp[ZCL_MAX_PAYLOAD_SIZE];
 
 	resp_len = 0;
-	if ((clust = zcl_find_clust(test_zcl_clust_list, clust_id)) == NULL)
+	if ((clust = zcl_find_clust(test_zcl_clust_tbl, TEST_ZCL_CLUST_CNT, clust_id)) == NULL)
 	{
 		/* non-existent cluster */
 		DBG_PRINT_SIMONLY("TEST_ZCL: Non existent cluster.\n");
@@ -220,7 +194,7 @@ void test_zcl_on_off_action_handler(U8 action, void *data)
 		break;
 	}
 	DBG_PRINT_SIMONLY("ON OFF ACTION HANDLER: Current value of on_off attrib: %02X.\n",
-			  on_off_attrib_list.data.on_off);
+			  on_off_data.on_off);
 	return;
 }
 
@@ -230,7 +204,7 @@ void test_zcl_id_action_handler(U8 action, void *data)
 	{
 	case ZCL_ID_ACTION_ID_ON:
 		DBG_PRINT("ID ACTION HANDLER: IDENTIFY ON. Timeout: %04X.\n",
-			  id_attrib_list.data.id_time);
+			  id_data.id_time);
 		break;
 	case ZCL_ID_ACTION_ID_OFF:
 		DBG_PRINT("ID ACTION HANDLER: IDENTIFY OFF.\n");
@@ -259,16 +233,16 @@ void test_zcl_level_action_handler(U8 action, void *data)
 		 * then switch the on_off attribute
 		 */
 		if (on_off) {
-			on_off_attrib_list.data.on_off = 0;
+			on_off_data.on_off = 0;
 			DBG_PRINT_SIMONLY("LEVEL ACTION HANDLER: ON OFF ATTRIBUTE TURNED OFF.\n");
 		}
 		break;
 	case ZCL_LEVEL_ACTION_REFRESH:
 		DBG_PRINT_SIMONLY("LEVEL ACTION HANDLER: CURRENT LEVEL = %02X.\n",
-				  level_attrib_list.data.curr_level);
-		if (on_off && (on_off_attrib_list.data.on_off == 0))
+				  level_data.curr_level);
+		if (on_off && (on_off_data.on_off == 0))
 		{
-				on_off_attrib_list.data.on_off = 1;
+				on_off_data.on_off = 1;
 				DBG_PRINT("LEVEL ACTION HANDLER: ON OFF ATTRIBUTE TURNED ON.\n");
 		}
 		break;
@@ -330,7 +304,7 @@ void test_zcl_write_attrib(U8 argc, char **argv)
 	U16 dest_addr, clust_id;
 	U8 i, j, len, data_out[TEST_ZCL_MAX_BUF_SZ], tmp_data[TEST_ZCL_MAX_ATTRIBS];
 	zcl_hdr_t hdr;
-	zcl_attrib_t attrib_list[TEST_ZCL_MAX_ATTRIBS];
+	zcl_attrib_val_t attrib_list[TEST_ZCL_MAX_ATTRIBS];
 
 	if (argc < 4)
 	{
@@ -418,7 +392,7 @@ void test_zcl_config_rpt(U8 argc, char **argv)
 	U8 len, data_out[TEST_ZCL_MAX_BUF_SZ];
 	U16 dest_addr, clust_id, attrib_id, timeout;
 	zcl_hdr_t hdr;
-	zcl_clust_t *clust;
+	const zcl_clust_t *clust;
 
 	if (argc < 5)
 	{
@@ -431,7 +405,7 @@ void test_zcl_config_rpt(U8 argc, char **argv)
 	attrib_id   = strtol(argv[3], NULL, 16);
 	timeout     = strtol(argv[4], NULL, 16);
 
-	if ((clust = zcl_find_clust(test_zcl_clust_list, clust_id)) == NULL)
+	if ((clust = zcl_find_clust(test_zcl_clust_tbl, TEST_ZCL_CLUST_CNT, clust_id)) == NULL)
 	{
 		DBG_PRINT_SIMONLY("TEST_ZCL_CONFIG_RPT: Cluster not found.\n");
 		return;
@@ -66,6 +66,8 @@ void aps_init()
 
     aps_retry_init();
     aps_dupe_init();
+    aps_bind_init();
+    aps_grp_init();
 }
 
 /**************************************************************************/
@@ -78,6 +80,108 @@ aps_aib_t *aps_aib_get()
     return &aib;
 }
 
+/**************************************************************************/
+/*!
+    Send an indirect frame to every destination bound to its src endpoint and
+    cluster. The destination set is found with a single binding table lookup.
+    Each destination gets its own copy of the frame since the APS and lower
+    layers build their headers in place and take ownership of the buffer. The
+    original buffer goes to the last destination. Group destinations are sent
+    as a group frame rather than a unicast to each member.
+
+    Every copy is its own APS frame with its own counter, so the retry entries
+    and ACKs of different destinations can't be confused. The copies share the
+    app's handle and their confirms are collected so that the app only gets
+    one confirm for the request.
+*/
+/**************************************************************************/
+static U8 aps_bind_tx(const aps_data_req_t *req, aps_hdr_t *hdr)
+{
+    aps_bind_t *entry;
+    aps_bind_dest_t *dest;
+    aps_bind_conf_t *conf;
+    buffer_t *orig = req->buf;
+    buffer_t *buf;
+    U16 nwk_addr;
+    U8 status = APS_SUCCESS;
+
+    if ((entry = aps_bind_find_dest(req->src_ep, req->clust_id)) == NULL)
+    {
+        // nobody is bound to us. we own the buffer so get rid of it.
+        buf_free(orig);
+        aps_conf(APS_NO_BOUND_DEVICE, req->handle);
+        return APS_NO_BOUND_DEVICE;
+    }
+
+    if ((conf = aps_bind_conf_alloc(req->handle)) == NULL)
+    {
+        buf_free(orig);
+        aps_conf(APS_TABLE_FULL, req->handle);
+        return APS_TABLE_FULL;
+    }
+
+    // hold the confirm until all the copies are out. a copy can confirm before we're done here.
+    conf->pending = 1;
+
+    for (dest = entry->dest; dest != NULL; dest = dest->next)
+    {
+        // get the address from the binding entry. if it's a long address, then curse the stupid person who used a long
+        // address and try and match it up with its corresponding short address
+        if (dest->dest_addr.mode == BIND_GRP_ADDR)
+        {
+            hdr->aps_frm_ctrl.delivery_mode = APS_GROUP;
+            hdr->dest_addr                  = dest->dest_addr.short_addr;
+            hdr->grp_addr                   = dest->dest_addr.short_addr;
+        }
+        else
+        {
+            if (dest->dest_addr.mode == SHORT_ADDR)
+            {
+                nwk_addr = dest->dest_addr.short_addr;
+            }
+            else if ((nwk_addr = nwk_addr_map_get_nwk_addr(dest->dest_addr.long_addr)) == INVALID_NWK_ADDR)
+            {
+                // can't find the matching nwk address to the ieee address. skip this one.
+                status = APS_NO_SHORT_ADDRESS;
+                continue;
+            }
+
+            // the delivery mode will be unicast since we're sending a frame to each individual matching dest in
+            // the binding table
+            hdr->aps_frm_ctrl.delivery_mode = APS_UNICAST;
+            hdr->dest_addr                  = nwk_addr;
+            hdr->dest_ep                    = dest->dest_ep;
+        }
+
+        // the last destination gets the original buffer. everyone else gets a copy.
+        if (dest->next == NULL)
+        {
+            buf = orig;
+            orig = NULL;
+        }
+        else if ((buf = buf_dup(orig)) == NULL)
+        {
+            // out of buffers. the rest of the destinations won't get the frame.
+            status = APS_FAIL;
+            break;
+        }
+
+        hdr->aps_ctr = aib.aps_ctr++;
+        conf->pending++;
+        aps_tx(buf, hdr);
+    }
+
+    // the last destination was skipped or we ran out of buffers so the original buffer is still ours
+    if (orig)
+    {
+        buf_free(orig);
+    }
+
+    // release the hold. if the copies are all done, this sends the app its confirm.
+    aps_tx_conf(status, req->handle);
+    return status;
+}
+
 /**************************************************************************/
 /*!
     Request to send data to the APS layer. This function is called by the
@@ -92,8 +196,6 @@ aps_aib_t *aps_aib_get()
 U8 aps_data_req(const aps_data_req_t *req)
 {
     aps_hdr_t hdr;
-    mem_ptr_t *bnd_mem_ptr;
-    U16 nwk_addr;
     U8 status = APS_SUCCESS;
 
     hdr.aps_frm_ctrl.frm_type   = APS_DATA_FRM;
@@ -112,41 +214,12 @@ U8 aps_data_req(const aps_data_req_t *req)
     switch (req->dest_addr_mode)
     {
     case APS_DEST_ADDR_EP_NONE:
-        // loop through binding table. we need to send frame to each matching entry in table.
-        for (bnd_mem_ptr = aps_bind_get_head(); bnd_mem_ptr != NULL; bnd_mem_ptr = bnd_mem_ptr->next)
-        {
-            // if bind entry matches the src endpoint and cluster, then it's a bind match and we need to send it to the target
-            if ((BIND_ENTRY(bnd_mem_ptr)->src_ep == req->src_ep) && (BIND_ENTRY(bnd_mem_ptr)->clust == req->clust_id))
-            {
-                // the delivery mode will be unicast since we're sending a frame to each individual matching dest in
-                // the binding table
-                hdr.aps_frm_ctrl.delivery_mode = APS_UNICAST;
-                hdr.dest_ep = BIND_ENTRY(bnd_mem_ptr)->dest_ep;
-
-                // get the address from the binding entry. if it's a long address, then curse the stupid person who used a long
-                // address and try and match it up with its corresponding short address
-                if (BIND_ENTRY(bnd_mem_ptr)->dest_addr.mode == SHORT_ADDR)
-                {
-                    hdr.dest_addr = BIND_ENTRY(bnd_mem_ptr)->dest_addr.short_addr;
-                }
-                else
-                {
-                    if ((nwk_addr = nwk_addr_map_get_nwk_addr(BIND_ENTRY(bnd_mem_ptr)->dest_addr.long_addr)) == INVALID_NWK_ADDR)
-                    {
-                        // can't find the matching nwk address to the ieee address. abort for now.
-                        status = APS_NO_SHORT_ADDRESS;
-                        break;
-                    }
-                    hdr.dest_addr = nwk_addr;
-                }
-                aps_tx(req->buf, &hdr);
-            }
-        }
+        status = aps_bind_tx(req, &hdr);
         break;
 
     case APS_GROUP_ADDR_PRESENT:
         hdr.aps_frm_ctrl.delivery_mode  = APS_GROUP;
-        hdr.dest_addr                   = NWK_BROADCAST_RXONIDLE;
+        hdr.dest_addr                   = req->dest_addr.short_addr;
         hdr.grp_addr                    = req->dest_addr.short_addr;
         aps_tx(req->buf, &hdr);
         break;
@@ -161,6 +234,7 @@ U8 aps_data_req(const aps_data_req_t *req)
     case APS_DEST_ADDR_64_EP_PRESENT:
         // fall through
     default:
+        buf_free(req->buf);
         status = APS_NOT_SUPPORTED;
         break;
     }
@@ -200,8 +274,19 @@ void aps_tx(buffer_t *buf, aps_hdr_t *hdr)
     req.nsdu_handle         = hdr->handle;
     req.radius              = hdr->radius;
     req.disc_rte            = hdr->disc_rte;
-    req.nwk_dest_addr_mode  = NWK_TX_UNICAST_BROADCAST; // no multicast support yet
     req.security_enb        = false;
+
+    // group frames go out as NWK multicasts addressed to the group ID
+    if (hdr->aps_frm_ctrl.delivery_mode == APS_GROUP)
+    {
+        req.nwk_dest_addr_mode  = NWK_TX_MCAST_ADDR;
+        req.non_memb_radius     = aib.nonmemb_radius;
+    }
+    else
+    {
+        req.nwk_dest_addr_mode  = NWK_TX_UNICAST_BROADCAST;
+        req.non_memb_radius     = 0;
+    }
     nwk_data_req(&req);
 }
 
@@ -301,7 +386,21 @@ void nwk_data_conf(U8 status, U8 handle)
     }
 
     // send it on up
-    aps_conf(status, handle);
+    aps_tx_conf(status, handle);
+}
+
+/**************************************************************************/
+/*!
+    Send a tx confirm up to the AF. If the handle belongs to an indirect
+    transmission, the confirm is only sent once all of its copies are done.
+*/
+/**************************************************************************/
+void aps_tx_conf(U8 status, U8 handle)
+{
+    if (aps_bind_conf_collect(&status, handle))
+    {
+        aps_conf(status, handle);
+    }
 }
 
 
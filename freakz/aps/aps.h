@@ -50,11 +50,20 @@
 
 #define MAX_GROUP_NAME_SIZE 16          ///< User definable max group name string size
 
+#define APS_BIND_MAX_KEYS   8           ///< Max number of src endpoint/cluster pairs in the binding table
+#define APS_BIND_MAX_DESTS  24          ///< Max number of destinations in the binding table
+#define APS_BIND_HASH_SIZE  8           ///< Number of binding table hash buckets. Must be a power of 2.
+#define APS_BIND_MAX_CONFS  4           ///< Max number of indirect transmissions waiting on confirms from their copies
+
+#define APS_GRP_TBL_SIZE    16          ///< Max number of group IDs in the group table
+#define APS_GRP_HASH_SIZE   16          ///< Number of group table hash buckets. Must be a power of 2.
+#define APS_GRP_EP_MAP_SIZE 31          ///< Size in bytes of the group endpoint bitmap. One bit for each endpoint 0-240.
+#define APS_GRP_EP_MIN      1           ///< Lowest endpoint that can join a group. Endpoint 0 is the ZDO.
+#define APS_GRP_EP_MAX      240         ///< Highest endpoint that can join a group. Endpoints 241-254 are reserved.
+
 #define DUPE_ENTRY(m)       ((aps_dupe_t *)MMEM_PTR(&m->mmem_ptr))      ///< De-reference the mem ptr and cast it as an dupe table entry
 #define APS_RETRY_ENTRY(m)  ((aps_retry_t *)MMEM_PTR(&m->mmem_ptr))     ///< De-reference the mem ptr and cast it as an aps retry entry
-#define BIND_ENTRY(m)       ((aps_bind_t *)MMEM_PTR(&m->mmem_ptr))      ///< De-reference the mem ptr and cast it as a binding entry
 #define GROUP_ID_ENTRY(m)   ((aps_grp_id_t *)MMEM_PTR(&m->mmem_ptr))    ///< De-reference the mem ptr and cast it as a group ID table entry
-#define GROUP_ENTRY(m)      ((aps_grp_t *)MMEM_PTR(&m->mmem_ptr))       ///< De-reference the mem ptr and cast it as a group table entry
 
 /*!
     Enumerated definitions for the APS header
@@ -193,27 +202,67 @@ typedef struct
 
 /**************************************************************************/
 /*!
-    This is a binding table entry and is used to store src/dest addresses
-    and endpoints for bound devices.
+    This is a binding destination and is used to store the dest address
+    and endpoint for a bound device. All destinations bound to the same
+    src endpoint and cluster are chained together off of a single binding
+    table entry.
+*/
+/**************************************************************************/
+typedef struct _aps_bind_dest_t
+{
+    struct _aps_bind_dest_t *next;          ///< Next destination bound to the same src ep and cluster
+    bool                alloc;              ///< Destination is in use
+    address_t           dest_addr;          ///< Dest addr (group, short or long address)
+    U8                  dest_ep;            ///< Dest endpoint - used to identify where to send the frame
+} aps_bind_dest_t;
+
+/**************************************************************************/
+/*!
+    This is a binding table entry. It is keyed on the src endpoint and cluster
+    and holds the set of destinations that frames from that src endpoint and
+    cluster need to be sent to. Entries are hashed on the key so that an
+    indirect transmission only costs a single lookup.
 */
 /**************************************************************************/
 typedef struct _bind_t
 {
+    struct _bind_t      *next;              ///< Next entry in the same hash bucket
+    bool                alloc;              ///< Entry is in use
     U8                  src_ep;             ///< Src endpoint - used to identify destination addresses
     U16                 clust;              ///< Src cluster - used to identify destination addresses
-    address_t           dest_addr;          ///< Dest addr
-    U8                  dest_ep;            ///< Dest endpoint - used to identify where to send the frame
+    U8                  dest_cnt;           ///< Number of destinations bound to this entry
+    aps_bind_dest_t     *dest;              ///< Destination set for this src ep and cluster
 } aps_bind_t;
 
 /**************************************************************************/
 /*!
-        Struct for group table entries.
+    This is a pending confirm for an indirect transmission. Every copy of the
+    frame that goes out to a bound destination reports its confirm to this
+    entry and the app gets a single confirm after the last copy is done.
+*/
+/**************************************************************************/
+typedef struct
+{
+    bool                alloc;              ///< Entry is in use
+    U8                  handle;             ///< App data handle shared by all copies
+    U8                  pending;            ///< Number of copies that haven't confirmed yet
+    U8                  status;             ///< First failure reported by a copy, or APS_SUCCESS
+} aps_bind_conf_t;
+
+/**************************************************************************/
+/*!
+        Struct for group table entries. There is one entry per group ID and
+        the member endpoints are kept in a bitmap so that membership can be
+        checked without walking the table.
 */
 /**************************************************************************/
 typedef struct _aps_grp_t
 {
-    U16 id;             ///< Group ID
-    U8 ep;              ///< Endpoint associated with this Group ID
+    struct _aps_grp_t *next;            ///< Next entry in the same hash bucket
+    bool alloc;                         ///< Entry is in use
+    U16 id;                             ///< Group ID
+    U8 ep_cnt;                          ///< Number of endpoints in this group
+    U8 ep_map[APS_GRP_EP_MAP_SIZE];     ///< Bitmap of endpoints associated with this Group ID
 } aps_grp_t;
 
 /**************************************************************************/
@@ -229,7 +278,6 @@ typedef struct _aps_retry_t
     aps_hdr_t           hdr;        ///< Header of frame to retransmit
     U8                  handle;     ///< Data handle ID
     U8                  retries;    ///< Number of retries left before purging frame
-    U8                  expiry;     ///< Time remaining before this retry entry is retired
 } aps_retry_t;
 
 /**************************************************************************/
@@ -244,7 +292,6 @@ typedef struct _aps_dupe_t
 {
     U16                 src_addr;   ///< Src address of received frame
     U8                  aps_ctr;    ///< APS counter value of received frame
-    U8                  expiry;     ///< Time remaining before this entry is retired
 } aps_dupe_t;
 
 /**************************************************************************/
@@ -274,6 +321,7 @@ void aps_init();
 aps_aib_t *aps_aib_get();
 U8 aps_data_req(const aps_data_req_t *req);
 void nwk_data_conf(U8 status, U8 handle);
+void aps_tx_conf(U8 status, U8 handle);
 void nwk_data_ind(buffer_t *buf, const nwk_hdr_t *nwk_hdr);
 void aps_tx(buffer_t *buf, aps_hdr_t *hdr);
 
@@ -290,28 +338,30 @@ void aps_retry_add(buffer_t *buf, aps_hdr_t *hdr, U8 handle);
 bool aps_retry_handle_exists(U8 handle);
 void aps_retry_ack_handler(const aps_hdr_t *hdr);
 void aps_retry_expire(mem_ptr_t *mem_ptr);
-void aps_retry_periodic();
 
 // aps_bind
 void aps_bind_init();
-mem_ptr_t *aps_bind_find_dest(U8 src_ep, U16 clust);
-mem_ptr_t *aps_bind_get_head();
+aps_bind_t *aps_bind_find_dest(U8 src_ep, U16 clust);
+aps_bind_t *aps_bind_get_entry(U8 index);
 U8 aps_bind_req(U8 src_ep, address_t *dest_addr, U8 dest_ep, U16 clust);
 U8 aps_unbind_req(U8 src_ep, address_t *dest_addr, U8 dest_ep, U16 clust);
+aps_bind_conf_t *aps_bind_conf_alloc(U8 handle);
+bool aps_bind_conf_collect(U8 *status, U8 handle);
 
 // aps_dupe
 void aps_dupe_init();
 void aps_dupe_add(U16 src_addr, U8 aps_ctr);
 bool aps_dupe_reject(U16 src_addr, U8 aps_ctr);
-void aps_dupe_periodic();
 
 // aps group
 void aps_grp_init();
 U8 aps_grp_add(U16 id, U8 ep);
 U8 aps_grp_rem(U16 id, U8 ep);
 void aps_grp_rem_all();
-mem_ptr_t *aps_grp_get_head();
+aps_grp_t *aps_grp_find(U16 id);
+aps_grp_t *aps_grp_get_entry(U8 index);
 bool aps_grp_exists(U16 id);
+bool aps_grp_is_member(U16 id, U8 ep);
 
 #endif // APS_H
 
@@ -40,6 +40,11 @@
 
     This file implements the binding table for the APS layer.
 
+    The table is indexed on the src endpoint and cluster ID. Each entry holds
+    the set of destinations bound to that key, so a frame going out on a bound
+    cluster costs one hash lookup no matter how many bindings exist for other
+    endpoints and clusters.
+
     \note Binding functionality has not been fully implemented and tested yet.
 */
 /**************************************************************************/
@@ -47,7 +52,7 @@
 
 /**************************************************************************/
 /*!
-        List head for the binding table. The binding table allows us to use indirect
+        The binding table. The binding table allows us to use indirect
         addressing at the application layer. The clusters and endpoints don't need to
         have any idea of where they are sending the data to. They just respond to
         requests and the addresses can be looked up in the binding table. The app layer
@@ -55,7 +60,30 @@
         easier...for everyone except me...boo hoo...
 */
 /**************************************************************************/
-LIST(bind_tbl);
+static aps_bind_t bind_tbl[APS_BIND_MAX_KEYS];
+
+/**************************************************************************/
+/*!
+    Pool of binding destinations. Destinations are chained off of the binding
+    table entry that they belong to.
+*/
+/**************************************************************************/
+static aps_bind_dest_t bind_dest_pool[APS_BIND_MAX_DESTS];
+
+/**************************************************************************/
+/*!
+    Hash buckets for the binding table. Each bucket points to a chain of
+    binding table entries whose src endpoint and cluster hash to that bucket.
+*/
+/**************************************************************************/
+static aps_bind_t *bind_hash[APS_BIND_HASH_SIZE];
+
+/**************************************************************************/
+/*!
+    Confirms of indirect transmissions that still have copies in flight.
+*/
+/**************************************************************************/
+static aps_bind_conf_t bind_conf_tbl[APS_BIND_MAX_CONFS];
 
 /**************************************************************************/
 /*!
@@ -64,90 +92,158 @@ LIST(bind_tbl);
 /**************************************************************************/
 void aps_bind_init()
 {
-    list_init(bind_tbl);
+    memset(bind_tbl, 0, sizeof(bind_tbl));
+    memset(bind_dest_pool, 0, sizeof(bind_dest_pool));
+    memset(bind_hash, 0, sizeof(bind_hash));
+    memset(bind_conf_tbl, 0, sizeof(bind_conf_tbl));
 }
 
 /**************************************************************************/
 /*!
-    Allocate a new binding entry memory pointer and add it to the binding table.
+    Hash the src endpoint and cluster into a bucket index.
 */
 /**************************************************************************/
-static mem_ptr_t *aps_bind_alloc()
+static U8 aps_bind_hash(U8 src_ep, U16 clust)
 {
-    mem_ptr_t *mem_ptr;
-
-    if ((mem_ptr= mem_heap_alloc(sizeof(aps_bind_t))) != NULL)
-    {
-        list_add(bind_tbl, mem_ptr);
-    }
-    return mem_ptr;
+    return (src_ep ^ (U8)clust ^ (U8)(clust >> 8)) & (APS_BIND_HASH_SIZE - 1);
 }
 
 /**************************************************************************/
 /*!
-    Free a binding entry from the binding table.
+    Allocate a new binding table entry for the src endpoint and cluster and
+    link it into its hash bucket. Returns NULL if the table is full.
 */
 /**************************************************************************/
-static void aps_bind_free(mem_ptr_t *mem_ptr)
+static aps_bind_t *aps_bind_alloc(U8 src_ep, U16 clust)
 {
-    if (mem_ptr)
+    U8 i, hash;
+
+    for (i=0; i<APS_BIND_MAX_KEYS; i++)
     {
-        list_remove(bind_tbl, mem_ptr);
-        mem_heap_free(mem_ptr);
+        if (!bind_tbl[i].alloc)
+        {
+            hash = aps_bind_hash(src_ep, clust);
+
+            memset(&bind_tbl[i], 0, sizeof(aps_bind_t));
+            bind_tbl[i].alloc   = true;
+            bind_tbl[i].src_ep  = src_ep;
+            bind_tbl[i].clust   = clust;
+            bind_tbl[i].next    = bind_hash[hash];
+            bind_hash[hash]     = &bind_tbl[i];
+            return &bind_tbl[i];
+        }
     }
+    return NULL;
 }
 
 /**************************************************************************/
 /*!
-    Locate a binding entry with the specified src endpoint and cluster ID
-    and return a memory handle to it. Returns NULL if not found.
+    Unlink a binding table entry from its hash bucket and free it. The entry
+    must not have any destinations left.
 */
 /**************************************************************************/
-mem_ptr_t *aps_bind_find_dest(U8 src_ep, U16 clust)
+static void aps_bind_free(aps_bind_t *entry)
 {
-    mem_ptr_t *mem_ptr;
+    aps_bind_t **pp;
 
-    for (mem_ptr = list_head(bind_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+    for (pp = &bind_hash[aps_bind_hash(entry->src_ep, entry->clust)]; *pp != NULL; pp = &(*pp)->next)
     {
-        if ((BIND_ENTRY(mem_ptr)->src_ep == src_ep) && (BIND_ENTRY(mem_ptr)->clust == clust))
+        if (*pp == entry)
         {
+            *pp = entry->next;
             break;
         }
     }
-    return mem_ptr;
+    entry->alloc = false;
 }
 
 /**************************************************************************/
 /*!
-    Locate an entry with an exact match of src ep, clust, dest addr, and dest ep.
-    Return a memory handle only if everything matches.
+    Allocate a destination from the destination pool. Returns NULL if the
+    pool is empty.
 */
 /**************************************************************************/
-static mem_ptr_t *aps_bind_find(U8 src_ep, address_t *dest_addr, U8 dest_ep, U16 clust)
+static aps_bind_dest_t *aps_bind_dest_alloc()
 {
-    mem_ptr_t *mem_ptr;
+    U8 i;
 
-    if ((mem_ptr = aps_bind_find_dest(src_ep, clust)) != NULL)
+    for (i=0; i<APS_BIND_MAX_DESTS; i++)
     {
-        if (BIND_ENTRY(mem_ptr)->dest_addr.mode != dest_addr->mode)
+        if (!bind_dest_pool[i].alloc)
         {
-            // entry does not have the same mode hence its not an exact match
-            return NULL;
+            memset(&bind_dest_pool[i], 0, sizeof(aps_bind_dest_t));
+            bind_dest_pool[i].alloc = true;
+            return &bind_dest_pool[i];
         }
+    }
+    return NULL;
+}
+
+/**************************************************************************/
+/*!
+    Locate the binding table entry with the specified src endpoint and
+    cluster ID. The entry holds every destination bound to them. Returns
+    NULL if not found.
+*/
+/**************************************************************************/
+aps_bind_t *aps_bind_find_dest(U8 src_ep, U16 clust)
+{
+    aps_bind_t *entry;
 
-        if (dest_addr->mode == BIND_GRP_ADDR)
+    for (entry = bind_hash[aps_bind_hash(src_ep, clust)]; entry != NULL; entry = entry->next)
+    {
+        if ((entry->src_ep == src_ep) && (entry->clust == clust))
         {
-            if (BIND_ENTRY(mem_ptr)->dest_addr.short_addr == dest_addr->short_addr)
-            {
-                return mem_ptr;
-            }
+            break;
         }
-        else if (dest_addr->mode == BIND_EXT_ADDR)
+    }
+    return entry;
+}
+
+/**************************************************************************/
+/*!
+    Check if the destination matches the dest addr and endpoint exactly. Group
+    destinations don't have an endpoint so only the group address is compared.
+*/
+/**************************************************************************/
+static bool aps_bind_dest_match(const aps_bind_dest_t *dest, const address_t *dest_addr, U8 dest_ep)
+{
+    if (dest->dest_addr.mode != dest_addr->mode)
+    {
+        // entry does not have the same mode hence its not an exact match
+        return false;
+    }
+
+    switch (dest_addr->mode)
+    {
+    case BIND_GRP_ADDR:
+        return (dest->dest_addr.short_addr == dest_addr->short_addr);
+    case SHORT_ADDR:
+        return ((dest->dest_addr.short_addr == dest_addr->short_addr) && (dest->dest_ep == dest_ep));
+    case BIND_EXT_ADDR:
+        return ((dest->dest_addr.long_addr == dest_addr->long_addr) && (dest->dest_ep == dest_ep));
+    default:
+        return false;
+    }
+}
+
+/**************************************************************************/
+/*!
+    Locate a destination with an exact match of src ep, clust, dest addr, and dest ep.
+    The binding table entry that holds it is returned in entry.
+*/
+/**************************************************************************/
+static aps_bind_dest_t *aps_bind_find(U8 src_ep, const address_t *dest_addr, U8 dest_ep, U16 clust, aps_bind_t **entry)
+{
+    aps_bind_dest_t *dest;
+
+    if ((*entry = aps_bind_find_dest(src_ep, clust)) != NULL)
+    {
+        for (dest = (*entry)->dest; dest != NULL; dest = dest->next)
         {
-            if ((BIND_ENTRY(mem_ptr)->dest_addr.long_addr == dest_addr->long_addr) &&
-                (BIND_ENTRY(mem_ptr)->dest_ep == dest_ep))
+            if (aps_bind_dest_match(dest, dest_addr, dest_ep))
             {
-                return mem_ptr;
+                return dest;
             }
         }
     }
@@ -156,44 +252,64 @@ static mem_ptr_t *aps_bind_find(U8 src_ep, address_t *dest_addr, U8 dest_ep, U16
 
 /**************************************************************************/
 /*!
-    Allocate a free binding entry and add it to the binding table.
+    Add a destination to the binding table. If the src ep and cluster don't
+    have an entry yet, one will be allocated.
 */
 /**************************************************************************/
 static U8 aps_bind_add(U8 src_ep, address_t *dest_addr, U8 dest_ep, U16 clust)
 {
-    mem_ptr_t *mem_ptr;
+    aps_bind_t *entry;
+    aps_bind_dest_t *dest;
+    bool new_entry = false;
 
     // first check for a duplicate binding entry
-    if ((mem_ptr = aps_bind_find(src_ep, dest_addr, dest_ep, clust)) != NULL)
+    if (aps_bind_find(src_ep, dest_addr, dest_ep, clust, &entry) != NULL)
     {
         // we have a duplicate entry. return success. it's already in the table.
         return APS_SUCCESS;
     }
 
     // we don't have a similar entry. allocate a new one.
-    if ((mem_ptr = aps_bind_alloc()) != NULL)
+    if (!entry)
     {
-        BIND_ENTRY(mem_ptr)->src_ep         = src_ep;
-        BIND_ENTRY(mem_ptr)->dest_ep        = dest_ep;
-        BIND_ENTRY(mem_ptr)->clust          = clust;
-        memcpy(&BIND_ENTRY(mem_ptr)->dest_addr, dest_addr, sizeof(address_t));
-        return APS_SUCCESS;
+        if ((entry = aps_bind_alloc(src_ep, clust)) == NULL)
+        {
+            return APS_TABLE_FULL;
+        }
+        new_entry = true;
     }
-    else
+
+    if ((dest = aps_bind_dest_alloc()) == NULL)
     {
-        // wtf...we're out of memory
-        return APS_FAIL;
+        // out of destinations. don't leave an empty entry hanging around.
+        if (new_entry)
+        {
+            aps_bind_free(entry);
+        }
+        return APS_TABLE_FULL;
     }
+
+    memcpy(&dest->dest_addr, dest_addr, sizeof(address_t));
+    dest->dest_ep   = dest_ep;
+    dest->next      = entry->dest;
+    entry->dest     = dest;
+    entry->dest_cnt++;
+    return APS_SUCCESS;
 }
 
 /**************************************************************************/
 /*!
-    Return the list head of the binding table.
+    Return the binding table entry at the specified index or NULL if the
+    slot is unused. This is used to walk the table for debugging.
 */
 /**************************************************************************/
-mem_ptr_t *aps_bind_get_head()
+aps_bind_t *aps_bind_get_entry(U8 index)
 {
-    return list_head(bind_tbl);
+    if ((index < APS_BIND_MAX_KEYS) && bind_tbl[index].alloc)
+    {
+        return &bind_tbl[index];
+    }
+    return NULL;
 }
 
 /**************************************************************************/
@@ -210,18 +326,106 @@ U8 aps_bind_req(U8 src_ep, address_t *dest_addr, U8 dest_ep, U16 clust)
 
 /**************************************************************************/
 /*!
-    Free a binding entry in the binding table. If a device is found, then it will
-    be removed from the table. Otherwise, it will issue an error status.
+    Free a binding destination in the binding table. If a device is found, then it will
+    be removed from the table. Otherwise, it will issue an error status. The
+    binding table entry is freed along with its last destination.
 */
 /**************************************************************************/
 U8 aps_unbind_req(U8 src_ep, address_t *dest_addr, U8 dest_ep, U16 clust)
 {
-    mem_ptr_t *mem_ptr;
+    aps_bind_t *entry;
+    aps_bind_dest_t *dest, **pp;
 
-    if ((mem_ptr = aps_bind_find(src_ep, dest_addr, dest_ep, clust)) != NULL)
+    if ((dest = aps_bind_find(src_ep, dest_addr, dest_ep, clust, &entry)) == NULL)
     {
-        aps_bind_free(mem_ptr);
-        return APS_SUCCESS;
+        return APS_NO_BOUND_DEVICE;
+    }
+
+    for (pp = &entry->dest; *pp != NULL; pp = &(*pp)->next)
+    {
+        if (*pp == dest)
+        {
+            *pp = dest->next;
+            break;
+        }
+    }
+    dest->alloc = false;
+
+    if (--entry->dest_cnt == 0)
+    {
+        aps_bind_free(entry);
+    }
+    return APS_SUCCESS;
+}
+
+/**************************************************************************/
+/*!
+    Allocate a pending confirm for an indirect transmission with the given
+    app handle. An old entry that still holds the same handle has lost one of
+    its confirms, so it gets reused rather than leaked. Returns NULL if the
+    table is full.
+*/
+/**************************************************************************/
+aps_bind_conf_t *aps_bind_conf_alloc(U8 handle)
+{
+    aps_bind_conf_t *conf = NULL;
+    U8 i;
+
+    for (i=0; i<APS_BIND_MAX_CONFS; i++)
+    {
+        if (bind_conf_tbl[i].alloc && (bind_conf_tbl[i].handle == handle))
+        {
+            conf = &bind_conf_tbl[i];
+            break;
+        }
+
+        if (!bind_conf_tbl[i].alloc && !conf)
+        {
+            conf = &bind_conf_tbl[i];
+        }
+    }
+
+    if (conf)
+    {
+        conf->alloc     = true;
+        conf->handle    = handle;
+        conf->pending   = 0;
+        conf->status    = APS_SUCCESS;
+    }
+    return conf;
+}
+
+/**************************************************************************/
+/*!
+    Collect the confirm of one copy of an indirect transmission. Returns false
+    if other copies are still outstanding and the confirm should be held back.
+    Otherwise returns true and the status is updated with the combined status
+    of all the copies. Handles that don't belong to an indirect transmission
+    are passed straight through.
+*/
+/**************************************************************************/
+bool aps_bind_conf_collect(U8 *status, U8 handle)
+{
+    U8 i;
+
+    for (i=0; i<APS_BIND_MAX_CONFS; i++)
+    {
+        if (bind_conf_tbl[i].alloc && (bind_conf_tbl[i].handle == handle))
+        {
+            if (bind_conf_tbl[i].status == APS_SUCCESS)
+            {
+                bind_conf_tbl[i].status = *status;
+            }
+
+            if (bind_conf_tbl[i].pending && --bind_conf_tbl[i].pending)
+            {
+                return false;
+            }
+
+            *status = bind_conf_tbl[i].status;
+            bind_conf_tbl[i].alloc = false;
+            return true;
+        }
     }
-    return APS_NO_BOUND_DEVICE;
+    return true;
 }
@@ -89,6 +89,17 @@ static void aps_dupe_free(mem_ptr_t *mem_ptr)
     }
 }
 
+/**************************************************************************/
+/*!
+    Slow timer callback for a dupe table entry. The entry has expired so
+    remove it from the table.
+*/
+/**************************************************************************/
+static void aps_dupe_expire(void *ptr)
+{
+    aps_dupe_free((mem_ptr_t *)ptr);
+}
+
 /**************************************************************************/
 /*!
     Allocate and add an entry to the dupe table and fill in the fields
@@ -104,7 +115,7 @@ void aps_dupe_add(U16 src_addr, U8 aps_ctr)
     {
         DUPE_ENTRY(mem_ptr)->src_addr = src_addr;
         DUPE_ENTRY(mem_ptr)->aps_ctr = aps_ctr;
-        DUPE_ENTRY(mem_ptr)->expiry = DUPE_REJECT_TIMEOUT;
+        slow_tmr_set(&mem_ptr->tmr, DUPE_REJECT_TIMEOUT, aps_dupe_expire, mem_ptr);
     }
 }
 
@@ -128,27 +139,3 @@ bool aps_dupe_reject(U16 src_addr, U8 aps_ctr)
     }
     return false;
 }
-
-/**************************************************************************/
-/*!
-    This function gets called every second and decrements the timeout value of
-    any entries in the duplicate rejection table. If the entry has a timeout of
-    zero, then it will be removed from the table.
-*/
-/**************************************************************************/
-void aps_dupe_periodic()
-{
-    mem_ptr_t *mem_ptr;
-
-    for (mem_ptr = list_head(dupe_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-    {
-        if (DUPE_ENTRY(mem_ptr)->expiry == 0)
-        {
-            aps_dupe_free(mem_ptr);
-        }
-        else
-        {
-            DUPE_ENTRY(mem_ptr)->expiry--;
-        }
-    }
-}
@@ -50,11 +50,16 @@
         Also, the group table is required by the home automation profile and many
         of the basic clusters.
 
+        Group IDs are hashed into a small table. Each entry holds a bitmap of the
+        endpoints in that group so that membership checks are constant time and
+        group frames can be delivered by walking the set bits.
+
 */
 /**************************************************************************/
 #include "freakz.h"
 
-LIST(grp_tbl);          ///< List head for the group table.
+static aps_grp_t grp_tbl[APS_GRP_TBL_SIZE];         ///< The group table.
+static aps_grp_t *grp_hash[APS_GRP_HASH_SIZE];      ///< Hash buckets for the group table.
 
 /**************************************************************************/
 /*!
@@ -63,109 +68,143 @@ LIST(grp_tbl);          ///< List head for the group table.
 /**************************************************************************/
 void aps_grp_init()
 {
-    list_init(grp_tbl);
+    memset(grp_tbl, 0, sizeof(grp_tbl));
+    memset(grp_hash, 0, sizeof(grp_hash));
 }
 
 /**************************************************************************/
 /*!
-    Alloc a group structure element from the memory heap and add it to the
-        group table. This function will also return a pointer to the memory handle.
+    Hash the group ID into a bucket index.
 */
 /**************************************************************************/
-static mem_ptr_t *aps_grp_alloc()
+static U8 aps_grp_hash(U16 id)
 {
-    mem_ptr_t *mem_ptr = NULL;
+    return ((U8)id ^ (U8)(id >> 8)) & (APS_GRP_HASH_SIZE - 1);
+}
 
-    if ((mem_ptr = mem_heap_alloc(sizeof(aps_grp_t))) != NULL)
+/**************************************************************************/
+/*!
+    Alloc a group entry for the group ID from the group table and link it into
+        its hash bucket. Returns NULL if the table is full.
+*/
+/**************************************************************************/
+static aps_grp_t *aps_grp_alloc(U16 id)
+{
+    U8 i, hash;
+
+    for (i=0; i<APS_GRP_TBL_SIZE; i++)
     {
-        list_add(grp_tbl, mem_ptr);
+        if (!grp_tbl[i].alloc)
+        {
+            hash = aps_grp_hash(id);
+
+            memset(&grp_tbl[i], 0, sizeof(aps_grp_t));
+            grp_tbl[i].alloc    = true;
+            grp_tbl[i].id       = id;
+            grp_tbl[i].next     = grp_hash[hash];
+            grp_hash[hash]      = &grp_tbl[i];
+            return &grp_tbl[i];
+        }
     }
-    return mem_ptr;
+    return NULL;
 }
 
 /**************************************************************************/
 /*!
-    Free the memory pointer that holds the group entry.
+    Unlink the group entry from its hash bucket and free it.
 */
 /**************************************************************************/
-static void aps_grp_free(mem_ptr_t *mem_ptr)
+static void aps_grp_free(aps_grp_t *grp)
 {
-    if (mem_ptr)
+    aps_grp_t **pp;
+
+    for (pp = &grp_hash[aps_grp_hash(grp->id)]; *pp != NULL; pp = &(*pp)->next)
     {
-        list_remove(grp_tbl, mem_ptr);
-        mem_heap_free(mem_ptr);
+        if (*pp == grp)
+        {
+            *pp = grp->next;
+            break;
+        }
     }
+    grp->alloc = false;
 }
 
 /**************************************************************************/
 /*!
-    Find an entry that has a matching id and endpoint and return the mem ptr.
-    If it doesn't exist, return a NULL pointer.
+    Find the entry for the group ID and return it. If it doesn't exist,
+    return a NULL pointer.
 */
 /**************************************************************************/
-static mem_ptr_t *aps_grp_find_entry(U16 id, U8 ep)
+aps_grp_t *aps_grp_find(U16 id)
 {
-    mem_ptr_t *mem_ptr;
+    aps_grp_t *grp;
 
-    for (mem_ptr = list_head(grp_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+    for (grp = grp_hash[aps_grp_hash(id)]; grp != NULL; grp = grp->next)
     {
-        // if the id and the endpoints match, then we found the entry we're looking for
-        if ((GROUP_ENTRY(mem_ptr)->id == id) && (GROUP_ENTRY(mem_ptr)->ep == ep))
+        if (grp->id == id)
         {
             break;
         }
     }
-    return mem_ptr;
+    return grp;
 }
 
 /**************************************************************************/
 /*!
-    Add a group table entry with the specified group ID and endpoint. If it
-    already exists, then exit with a APS_SUCCESS status. If it doesn't exist,
-    then create a new entry and fill it out.
+    Add the endpoint to the group with the specified group ID. If it
+    already exists, then exit with a APS_SUCCESS status. If the group doesn't
+    exist, then create a new entry for it.
 */
 /**************************************************************************/
 U8 aps_grp_add(U16 id, U8 ep)
 {
-    mem_ptr_t *mem_ptr;
+    aps_grp_t *grp;
 
-    // check if this entry exists already
-    if ((aps_grp_find_entry(id, ep)) != NULL)
+    if ((ep < APS_GRP_EP_MIN) || (ep > APS_GRP_EP_MAX))
     {
-        // this entry already exists
-        return APS_SUCCESS;
+        return APS_INVALID_PARAMETER;
     }
 
-    // alloc a new entry and fill it out
-    if ((mem_ptr = aps_grp_alloc()) != NULL)
+    if ((grp = aps_grp_find(id)) == NULL)
     {
-        GROUP_ENTRY(mem_ptr)->id = id;
-        GROUP_ENTRY(mem_ptr)->ep = ep;
-        return APS_SUCCESS;
+        if ((grp = aps_grp_alloc(id)) == NULL)
+        {
+            // we ran out of group table entries.
+            return APS_TABLE_FULL;
+        }
     }
-    else
+
+    // check if this endpoint is in the group already
+    if (!(grp->ep_map[ep / 8] & (1 << (ep % 8))))
     {
-        // we ran out of heap memory.
-        return APS_FAIL;
+        grp->ep_map[ep / 8] |= (1 << (ep % 8));
+        grp->ep_cnt++;
     }
+    return APS_SUCCESS;
 }
 
 /**************************************************************************/
 /*!
-        Remove an entry from the group based on its id and its endpoint.
+        Remove an endpoint from the group. The group entry is freed when its
+        last endpoint is removed.
 */
 /**************************************************************************/
 U8 aps_grp_rem(U16 id, U8 ep)
 {
-    mem_ptr_t *mem_ptr;
+    aps_grp_t *grp;
 
-    // find the id mem ptr
-    if ((mem_ptr = aps_grp_find_entry(id, ep)) != NULL)
+    if (!aps_grp_is_member(id, ep))
     {
-        aps_grp_free(mem_ptr);
-        return APS_SUCCESS;
+        return APS_INVALID_GROUP;
     }
-    return APS_INVALID_GROUP;
+
+    grp = aps_grp_find(id);
+    grp->ep_map[ep / 8] &= ~(1 << (ep % 8));
+    if (--grp->ep_cnt == 0)
+    {
+        aps_grp_free(grp);
+    }
+    return APS_SUCCESS;
 }
 
 /**************************************************************************/
@@ -175,12 +214,7 @@ U8 aps_grp_rem(U16 id, U8 ep)
 /**************************************************************************/
 void aps_grp_rem_all()
 {
-    mem_ptr_t *mem_ptr;
-
-    for (mem_ptr = list_chop(grp_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-    {
-        aps_grp_free(mem_ptr);
-    }
+    aps_grp_init();
 }
 
 /**************************************************************************/
@@ -190,25 +224,36 @@ void aps_grp_rem_all()
 /**************************************************************************/
 bool aps_grp_exists(U16 id)
 {
-    mem_ptr_t *mem_ptr;
+    return (aps_grp_find(id) != NULL);
+}
+
+/**************************************************************************/
+/*!
+    Check to see if the endpoint is a member of the group
+*/
+/**************************************************************************/
+bool aps_grp_is_member(U16 id, U8 ep)
+{
+    aps_grp_t *grp;
 
-    for (mem_ptr = list_head(grp_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+    if ((ep < APS_GRP_EP_MIN) || (ep > APS_GRP_EP_MAX) || ((grp = aps_grp_find(id)) == NULL))
     {
-        if (GROUP_ENTRY(mem_ptr)->id == id)
-        {
-            return true;
-        }
+        return false;
     }
-    return false;
+    return (grp->ep_map[ep / 8] & (1 << (ep % 8))) != 0;
 }
 
 /**************************************************************************/
 /*!
-    Return the list head for the group table.
+    Return the group table entry at the specified index or NULL if the slot
+    is unused. This is used to walk the whole table.
 */
 /**************************************************************************/
-mem_ptr_t *aps_grp_get_head()
+aps_grp_t *aps_grp_get_entry(U8 index)
 {
-    return list_head(grp_tbl);
+    if ((index < APS_GRP_TBL_SIZE) && grp_tbl[index].alloc)
+    {
+        return &grp_tbl[index];
+    }
+    return NULL;
 }
-
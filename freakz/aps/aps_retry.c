@@ -83,7 +83,6 @@ static mem_ptr_t *aps_retry_alloc()
     if ((mem_ptr = mem_heap_alloc(sizeof(aps_retry_t))) != NULL)
     {
         APS_RETRY_ENTRY(mem_ptr)->retries = APS_MAX_FRAME_RETRIES;
-        APS_RETRY_ENTRY(mem_ptr)->expiry = APS_ACK_WAIT_DURATION;
     }
     return mem_ptr;
 }
@@ -143,8 +142,9 @@ void aps_retry_add(buffer_t *buf, aps_hdr_t *hdr, U8 handle)
 /**************************************************************************/
 /*!
     Check the incoming ACK header for a match in the queue. A match is indexed
-    by the APS counter value, cluster ID, and the source endpoint. If a match
-    is found, remove that entry from the retry queue and send a data confirm.
+    by the APS counter value, cluster ID, the source endpoint and the source
+    address. If a match is found, remove that entry from the retry queue and
+    send a data confirm.
 */
 /**************************************************************************/
 void aps_retry_ack_handler(const aps_hdr_t *hdr)
@@ -155,10 +155,12 @@ void aps_retry_ack_handler(const aps_hdr_t *hdr)
     {
         if ((APS_RETRY_ENTRY(mem_ptr)->hdr.aps_ctr     == hdr->aps_ctr)    &&
             (APS_RETRY_ENTRY(mem_ptr)->hdr.clust_id    == hdr->clust_id)   &&
-            (APS_RETRY_ENTRY(mem_ptr)->hdr.dest_ep     == hdr->src_ep))
+            (APS_RETRY_ENTRY(mem_ptr)->hdr.dest_ep     == hdr->src_ep)     &&
+            (APS_RETRY_ENTRY(mem_ptr)->hdr.dest_addr   == hdr->src_addr))
         {
+            aps_tx_conf(APS_SUCCESS, APS_RETRY_ENTRY(mem_ptr)->handle);
             aps_retry_free(mem_ptr);
-            aps_conf(APS_SUCCESS, APS_RETRY_ENTRY(mem_ptr)->handle);
+            break;
         }
     }
 }
@@ -189,40 +191,13 @@ void aps_retry_expire(mem_ptr_t *mem_ptr)
         APS_RETRY_ENTRY(mem_ptr)->retries--;
         if (APS_RETRY_ENTRY(mem_ptr)->retries > 0)
         {
-            APS_RETRY_ENTRY(mem_ptr)->expiry = APS_ACK_WAIT_DURATION;
             aps_tx(APS_RETRY_ENTRY(mem_ptr)->buf, &APS_RETRY_ENTRY(mem_ptr)->hdr);
         }
         else
         {
             // we've used up all the retries. retire the entry.
-            aps_conf(APS_NO_ACK, APS_RETRY_ENTRY(mem_ptr)->handle);
+            aps_tx_conf(APS_NO_ACK, APS_RETRY_ENTRY(mem_ptr)->handle);
             aps_retry_free(mem_ptr);
         }
     }
 }
-
-/**************************************************************************/
-/*!
-    This is a periodic function that gets called approximately once per second
-    by the slow clock. Its only purpose is to check for expired retry entries
-    and to decrement the expiry for each of the entries.
-*/
-/**************************************************************************/
-void aps_retry_periodic()
-{
-    mem_ptr_t *mem_ptr;
-
-    for (mem_ptr = list_head(aps_retry); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-    {
-        // go through the retry list and check for expired entries. if any
-        // are expired, then process them. otherwise, decrement the expiry.
-        if (APS_RETRY_ENTRY(mem_ptr)->expiry == 0)
-        {
-            aps_retry_expire(mem_ptr);
-        }
-        else
-        {
-            APS_RETRY_ENTRY(mem_ptr)->expiry--;
-        }
-    }
-}
@@ -64,13 +64,28 @@
 //0x2AF8 - add one second to the actual
 // value to reflect uncertainty in the timer
 #define NWK_RTE_DISC_TIME           0x7D0       ///< Time allowed for route discovery before operation is ended
+#define NWK_MAX_RTE_DISC_ENTRIES    0x10        ///< Max route discoveries that a node can track at once
+#define NWK_RTE_DISC_HASH_SIZE      0x08        ///< Number of discovery table hash buckets. Must be a power of 2.
 #define NWK_BRC_JITTER              0x40        ///< Max value of broadcast jitter
 #define NWK_PASSIVE_ACK_TIMEOUT     1000        ///< Timeout value for passive acks during broadcast
 #define NWK_MAX_BRC_RETRIES         0x03        ///< Number of broadcast retries
+#define NWK_BRC_TRICKLE_IMIN        (CLOCK_SECOND >> 3) ///< Shortest trickle interval for broadcast relays
+#define NWK_BRC_TRICKLE_IMAX        0x02        ///< Number of times the trickle interval can double
+#define NWK_BRC_TRICKLE_K           0x01        ///< Relays heard in an interval before ours is suppressed
 #define NWK_RREQ_RETRIES            0x03        ///< Number of route request retries
 #define NWK_RREQ_RETRY_INTERVAL     0xFE        ///< Time in between route request retries
 #define NWK_MIN_RREQ_JITTER         0x01        ///< Min time of rreq jitter
 #define NWK_MAX_RREQ_JITTER         0x40        ///< Max time of rreq jitter
+#define NWK_RREQ_TOKEN_BUCKET       0x06        ///< Max burst of route requests a node will send
+#define NWK_RREQ_TOKEN_INTERVAL     0xFA        ///< Time to earn one route request token back
+#define NWK_MAX_SRC_RTE_RELAYS      0x08        ///< Max relays in a route record or source route
+#define NWK_MAX_TREE_DEPTH          0x0F        ///< Deepest tree that the cskip table can describe
+#define NWK_MAX_LINK_STATUS_ENTRIES 0x08        ///< Max neighbors listed in one link status frame
+#define NWK_LINK_STATUS_PERIOD      0x0F        ///< Seconds between link status broadcasts
+#define NWK_LINK_STATUS_JITTER      0x80        ///< Max jitter added to the link status period
+#define NWK_ROUTER_AGE_LIMIT        0x03        ///< Missed link status periods before a router neighbor goes stale
+#define NWK_LINK_FAIL_THRESH        0x02        ///< Unacked frames in a row (after MAC retries) before a next hop is treated as broken
+#define NWK_RELAY_HANDLE_BASE       0xF0        ///< Handles from here up belong to frames that the NWK relays. The AF doesn't hand them out.
 
 // 802.15.4 MAC Defined constants
 // Tick value is 1 msec so all time values are converted to units of msec
@@ -98,6 +113,7 @@
 #define aMacMaxFrameRetries         3   ///< Number of frame retries before we fail the transmission
 #define aMaxCsmaBackoffs            5   ///< Max number of CSMA backoffs before we fail the transmission
 #define aMinBE                      3   ///< Minimum backoff exponent for calculating CSMA backoff time
+#define aMaxBE                      5   ///< Maximum backoff exponent for calculating CSMA backoff time
 
 // 802.15.4 PHY Defined constants
 #define aMaxPHYPacketSize           127 ///< Actual size of 802.15.4 frame
@@ -129,7 +145,13 @@
 #define ZIGBEE_PASSIVE_ACK_TIMEOUT  CLOCK_SECOND ///< Passive ack timeout ~ 1 sec
 #define ZIGBEE_DEVICE_TYPE          NWK_ROUTER  ///< Default device type
 #define ZIGBEE_BRC_EXPIRY           3           ///< Time in seconds before you expire a broadcast entry
+#define ZIGBEE_BRC_TRICKLE          false       ///< Relay broadcasts with trickle suppression instead of passive acks
+#define ZIGBEE_LOCAL_REPAIR         true        ///< Rediscover a broken route at the router upstream of the break
+#define ZIGBEE_JOIN_DEPTH_WEIGHT    0x20        ///< Parent selection score lost for each level of network depth
+#define ZIGBEE_JOIN_CAP_BONUS       0x10        ///< Parent selection score for a parent with room for both routers and end devices
 #define ZIGBEE_DEFAULT_RADIUS       6       ///< Radius value for frames
+#define ZIGBEE_CONCENTRATOR_RADIUS  (ZIGBEE_MAX_DEPTH << 1) ///< Radius of many-to-one route requests
+#define ZIGBEE_CONCENTRATOR_DISC_TIME 0     ///< Seconds between many-to-one route requests. 0 sends them only on request.
 #define ZIGBEE_POLL_INTERVAL        8       ///< Polling interval
 #define ZIGBEE_CONFIRM_INTERVAL     5       ///< Confirmation timeout
 #define ZIGBEE_INVALID_HANDLE       0       ///< Invalid handle value
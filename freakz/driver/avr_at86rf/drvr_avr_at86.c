@@ -773,7 +773,13 @@ static void pollhandler()
 	uint8_t status;
 
 	if (dcb.data_rx) {
-		process_post(&mac_process, event_mac_rx, NULL);
+		/*
+		 * rx goes in the high priority lane. if the queue is full,
+		 * poll the mac process instead. it handles a poll the same
+		 * way as an rx event.
+		 */
+		if (process_post_prio(&mac_process, event_mac_rx, NULL, PROCESS_PRIO_HIGH) != PROCESS_ERR_OK)
+			process_poll(&mac_process);
 		dcb.data_rx = false;
 	} else if (dcb.status_avail) {
 		switch (dcb.status)
@@ -791,7 +797,7 @@ static void pollhandler()
 			status = MAC_UNSPECIFIED_FAILURE;
 			break;
 		}
-		process_post(&mac_process, event_drvr_conf, &dcb);
+		process_post_prio(&mac_process, event_drvr_conf, &dcb, PROCESS_PRIO_HIGH);
 		dcb.status_avail = false;
 	}
 
@@ -55,6 +55,7 @@
 #include "at86rf230_registermap.h"
 
 extern process_event_t event_mac_rx;
+extern process_event_t event_mac_scan;
 
 PROCESS(mac_process, "MAC Process");
 
@@ -191,157 +192,181 @@ void mac_out(buffer_t *buf, bool ack_req, U8 dsn, U8 handle)
 }
 
 /*
- * Handle the rx events from the mac process. If the driver receives a valid frame,
- * it will send an event to the mac
- * process. The mac process will then call the event handler which retrieves
- * the frame from the rx queue and parses it. Once parsed, it will be handled
- * according to the frame type. If its a command frame, it gets sent to the
- * command handler, a data frame gets sent to the next higher layer, etc...
+ * Handle a received frame. The frame gets parsed and then handled according
+ * to the frame type. If its a command frame, it gets sent to the command
+ * handler, a data frame gets sent to the next higher layer, etc...
  */
-static void mac_eventhandler(process_event_t event)
+static void mac_rx_handler(buffer_t *buf)
 {
-	buffer_t *buf;
 	mac_hdr_t hdr;
 	mac_cmd_t cmd;
 	//*buf_out;
 	//bool frm_pend;
+	bool poll_again = false;
 	mac_pcb_t *pcb = mac_pcb_get();
 	mac_pib_t *pib = mac_pib_get();
 
-	if (event == event_mac_rx)
+	DBG_PRINT_RAW("\n<INCOMING>");
+
+	/* decode the packet */
+	mac_parse_hdr(buf, &hdr);
+	debug_dump_mac_hdr(&hdr);
+
+	/*
+	 * NOTE: Using AUTO-ACK so this portion of the ACK
+	 * generation is not needed check if an ack is needed.
+	 * if so, then generate an ack and queue it for
+	 * transmission. the frm pending bit will be set for
+	 * any frame coming from an address that has an indirect
+	 * frame for it. this is against the spec, but it will
+	 * speed up the ack transmission.
+	 *
+	 * NOTE: the ack response section may change due to the
+	 * tight ack timing requirements.
+	 */
+#if 0
+	if (hdr.mac_frm_ctrl.ack_req)
 	{
-		DBG_PRINT("MAC_EVENTHANDLER: Rx event occurred.\n");
-
-		if ((buf = mac_queue_buf_pop()) != NULL)
+		BUF_ALLOC(buf_out, TX);
+		DBG_PRINT("MAC: ACK Required.\n");
+		frm_pend = mac_indir_frm_pend(&hdr.src_addr);
+		mac_gen_ack(buf_out, frm_pend, hdr.dsn);
+		mac_out(buf_out, false, hdr.dsn, 0);
+	}
+#endif
+	/*
+	 * process accordingly. if a scan is in progress, all
+	 * frames except for beacon frames will be discarded.
+	 */
+	switch(hdr.mac_frm_ctrl.frame_type)
+	{
+	case MAC_COMMAND:
+		if (pcb->mac_state != MLME_SCAN)
 		{
-			DBG_PRINT_RAW("\n<INCOMING>");
-
-			/* decode the packet */
-			mac_parse_hdr(buf, &hdr);
-			debug_dump_mac_hdr(&hdr);
-
 			/*
-			 * NOTE: Using AUTO-ACK so this portion of the ACK
-			 * generation is not needed check if an ack is needed.
-			 * if so, then generate an ack and queue it for
-			 * transmission. the frm pending bit will be set for
-			 * any frame coming from an address that has an indirect
-			 * frame for it. this is against the spec, but it will
-			 * speed up the ack transmission.
-			 *
-			 * NOTE: the ack response section may change due to the
-			 * tight ack timing requirements.
+			 * need to handle the case that this is
+			 * an indirect transfer, which means that
+			 * we need to stop the poll timer and
+			 * send a status to the poll confirm.
 			 */
-#if 0
-			if (hdr.mac_frm_ctrl.ack_req)
+			if ((pcb->mac_state == MLME_DATA_REQ) &&
+			    (hdr.src_addr.mode == SHORT_ADDR) &&
+			    (hdr.src_addr.short_addr ==
+				pib->coord_addr.short_addr))
 			{
-				BUF_ALLOC(buf_out, TX);
-				DBG_PRINT("MAC: ACK Required.\n");
-				frm_pend = mac_indir_frm_pend(&hdr.src_addr);
-				mac_gen_ack(buf_out, frm_pend, hdr.dsn);
-				mac_out(buf_out, false, hdr.dsn, 0);
+				ctimer_stop(&pcb->mlme_tmr);
+				mac_poll_conf(MAC_SUCCESS);
 			}
+
+			mac_parse_cmd(buf, &cmd);
+			mac_cmd_handler(&cmd, &hdr);
+		}
+		buf_free(buf);
+		break;
+	case MAC_BEACON:
+		/* discard the beacon if we're not doing a scan */
+		if (pcb->mac_state == MLME_SCAN) {
+			mac_parse_beacon(buf, &hdr);
+			mac_beacon_notify_ind(buf,
+				mac_scan_descr_find_addr(&hdr.src_addr));
+		}
+		buf_free(buf);
+		break;
+	case MAC_ACK:
+#if 0
+		mac_retry_ack_handler(hdr.dsn);
+
+		/*
+		 * we need to do some special ops depending
+		 * on the state we're in if we get an ACK.
+		 */
+		if (pcb->mac_state == MLME_ASSOC_REQ)
+		{
+			if (pcb->assoc_req_dsn == hdr.dsn)
+				ctimer_set(&pcb->mlme_tmr,
+					   pib->resp_wait_time,
+					   mac_poll_req,
+					   NULL);
+		} else if (pcb->mac_state == MLME_DATA_REQ) {
+			if (hdr.mac_frm_ctrl.frame_pending)
+				ctimer_set(&pcb->mlme_tmr,
+					   aMacMaxFrameTotalWaitTime,
+					   mac_poll_timeout,
+					   NULL);
+		}
 #endif
+		buf_free(buf);
+		break;
+	case MAC_DATA:
+		if (pcb->mac_state != MLME_SCAN)
+		{
 			/*
-			 * process accordingly. if a scan is in progress, all
-			 * frames except for beacon frames will be discarded.
+			 * need to handle the case that this
+			 * is an indirect transfer, which means
+			 * that we need to stop the poll timer
+			 * and send a status to the poll confirm
 			 */
-			switch(hdr.mac_frm_ctrl.frame_type)
+			if ((pcb->mac_state == MLME_DATA_REQ) &&
+			(hdr.src_addr.mode == SHORT_ADDR) &&
+			(hdr.src_addr.short_addr == pib->coord_addr.short_addr))
 			{
-			case MAC_COMMAND:
-				if (pcb->mac_state != MLME_SCAN)
-				{
-					/*
-					 * need to handle the case that this is
-					 * an indirect transfer, which means that
-					 * we need to stop the poll timer and
-					 * send a status to the poll confirm.
-					 */
-					if ((pcb->mac_state == MLME_DATA_REQ) &&
-					    (hdr.src_addr.mode == SHORT_ADDR) &&
-					    (hdr.src_addr.short_addr ==
-						pib->coord_addr.short_addr))
-					{
-						ctimer_stop(&pcb->mlme_tmr);
-						mac_poll_conf(MAC_SUCCESS);
-					}
-
-					mac_parse_cmd(buf, &cmd);
-					mac_cmd_handler(&cmd, &hdr);
-				}
-				buf_free(buf);
-				break;
-			case MAC_BEACON:
-				/* discard the beacon if we're not doing a scan */
-				if (pcb->mac_state == MLME_SCAN) {
-					mac_parse_beacon(buf, &hdr);
-					mac_beacon_notify_ind(buf,
-						mac_scan_descr_find_addr(&hdr.src_addr));
-				}
-				buf_free(buf);
-				break;
-			case MAC_ACK:
-#if 0
-				mac_retry_ack_handler(hdr.dsn);
+				ctimer_stop(&pcb->mlme_tmr);
+				mac_poll_conf(MAC_SUCCESS);
 
 				/*
-				 * we need to do some special ops depending
-				 * on the state we're in if we get an ACK.
+				 * the parent has more frames queued for
+				 * us. poll again right away to drain them
+				 * in this wake cycle.
 				 */
-				if (pcb->mac_state == MLME_ASSOC_REQ)
-				{
-					if (pcb->assoc_req_dsn == hdr.dsn)
-						ctimer_set(&pcb->mlme_tmr,
-							   pib->resp_wait_time,
-							   mac_poll_req,
-							   NULL);
-				} else if (pcb->mac_state == MLME_DATA_REQ) {
-					if (hdr.mac_frm_ctrl.frame_pending)
-						ctimer_set(&pcb->mlme_tmr,
-							   aMacMaxFrameTotalWaitTime,
-							   mac_poll_timeout,
-							   NULL);
-				}
-#endif
-				buf_free(buf);
-				break;
-			case MAC_DATA:
-				if (pcb->mac_state != MLME_SCAN)
-				{
-					/*
-					 * need to handle the case that this
-					 * is an indirect transfer, which means
-					 * that we need to stop the poll timer
-					 * and send a status to the poll confirm
-					 */
-					if ((pcb->mac_state == MLME_DATA_REQ) &&
-					(hdr.src_addr.mode == SHORT_ADDR) &&
-					(hdr.src_addr.short_addr == pib->coord_addr.short_addr))
-					{
-						ctimer_stop(&pcb->mlme_tmr);
-						mac_poll_conf(MAC_SUCCESS);
-					}
-					mac_data_ind(buf, &hdr);
-				} else {
-					buf_free(buf);
-				}
-				break;
-			default:
-				/* TODO: Add a statistic here to capture an error'd rx */
-				break;
+				poll_again = hdr.mac_frm_ctrl.frame_pending;
 			}
+			mac_data_ind(buf, &hdr);
+
+			if (poll_again)
+				mac_poll_req();
+		} else {
+			buf_free(buf);
 		}
+		break;
+	default:
+		/* TODO: Add a statistic here to capture an error'd rx */
+		break;
+	}
+}
+
+/*
+ * Handle the rx events from the mac process. If the driver receives a valid frame,
+ * it will send an event to the mac
+ * process. The mac process will then call the event handler which drains
+ * frames from the rx queue and handles them. At most MAC_RX_BUDGET frames
+ * are handled per event so that the other processes don't get starved
+ * during an rx burst.
+ */
+static void mac_eventhandler(process_event_t event)
+{
+	buffer_t *buf;
+	U8 i;
+
+	if ((event == event_mac_rx) || (event == PROCESS_EVENT_POLL))
+	{
+		DBG_PRINT("MAC_EVENTHANDLER: Rx event occurred.\n");
+
+		for (i = 0; (i < MAC_RX_BUDGET) && ((buf = mac_queue_buf_pop()) != NULL); i++)
+			mac_rx_handler(buf);
 
 		/*
-		 * there's a possibility that more than one frame is in the
-		 * buffer if they came in before this function gets executed.
-		 * So process until the queue is empty.
+		 * if the budget ran out before the queue was empty, post
+		 * another event to handle the rest. if the event queue
+		 * is full, poll ourselves instead of waiting for a free slot.
 		 */
 		if (!mac_queue_is_empty())
 		{
-			while (process_post(&mac_process, event_mac_rx, NULL) != PROCESS_ERR_OK)
-				;
+			if (process_post_prio(&mac_process, event_mac_rx, NULL, PROCESS_PRIO_HIGH) != PROCESS_ERR_OK)
+				process_poll(&mac_process);
 		}
+	} else if (event == event_mac_scan) {
+		/* move the energy scan on to the next channel */
+		mac_scan_energy_next();
 	}
 }
 
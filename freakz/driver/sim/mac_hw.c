@@ -46,6 +46,7 @@
 #include "freakz.h"
 
 extern process_event_t event_mac_rx;
+extern process_event_t event_mac_scan;
 
 /* Main process for MAC in simulator */
 PROCESS(mac_process, "MAC Process");
@@ -99,64 +100,55 @@ void mac_tx_handler(buffer_t *buf, address_t *addr, bool indir, bool ack_req, U8
 }
 
 /*
- * This is the function that does the actual transmission of the
- * frame. It sends the data to the driver which will then send it
- * over the air. If the channel is busy, then it will back off for
- * a random delay and then retry the transfer. If it exceeds the
- * maximum backoffs, it will abort the transmission and send a data
- * confirm with a failure status. After transmission, if no ack is
- * needed, then a data confirm will immediately get issued to the
- * next higher layer that requested the transmission. If an ack is
- * required, the data confirm won't be sent until a proper ack is received.
+ * Transmit queue. Frames wait here while the CSMA backoff runs for the
+ * frame at the head of the queue. The backoff is run off of a callback
+ * timer so the rest of the stack keeps running while we wait for the
+ * channel.
  */
-void mac_out(buffer_t *buf, bool ack_req, U8 dsn, U8 handle)
+static mac_tx_t tx_queue[MAC_TX_QUEUE_SIZE];
+static U8 tx_head;
+static U8 tx_cnt;
+
+/* CSMA state for the frame at the head of the queue */
+static U8 csma_nb;
+static U8 csma_be;
+static struct ctimer csma_tmr;
+
+static void mac_csma_attempt(void *ptr);
+
+/*
+ * Send the frame to the driver. If there's no ack request, then we're
+ * finished and the data confirm goes out right away. Otherwise, the ack
+ * wait gets started in the retry queue and the data confirm won't be sent
+ * until a proper ack is received.
+ */
+static void mac_out_frm(buffer_t *buf, bool ack_req, U8 dsn, U8 handle)
 {
-	U8 i;
-	U16 csma_time;
-	mac_pib_t *pib = mac_pib_get();
 	mac_pcb_t *pcb = mac_pcb_get();
 
-	for (i = 0; i < aMaxCsmaBackoffs; i++)
-	{
-		/* check if the channel is clear */
-		if (drvr_get_cca())
-		{
-			/* send the frame if the CCA clears */
-			drvr_tx(buf);
+	drvr_tx(buf);
 
-			/* collect a transmission stat here */
-			pcb->total_xmit++;
+	/* collect a transmission stat here */
+	pcb->total_xmit++;
 
-			/*
-			 * if there's no ack request,
-			 * then we're finished. free the buf.
-			 */
-			if (!ack_req) {
-				mac_data_conf(MAC_SUCCESS, handle);
-				buf_free(buf);
-			}
-			return;
-		} else {
-			/*
-			 * channel busy. do a busy wait and try again.
-			 * Shift left of signed quantity (int) due to
-			 * left shift of constant "1". its okay.
-			 */
-			csma_time = drvr_get_rand() % (U16)((1 << pib->min_be) - 1);
-			busy_wait(csma_time);
-		}
+	if (ack_req) {
+		mac_retry_sent(dsn);
+	} else {
+		mac_data_conf(MAC_SUCCESS, handle);
+		buf_free(buf);
 	}
+}
 
-	/*
-	 * exceeded max csma backoffs. clean up and send a
-	 * confirm with a fail message.
-	 */
-	if (ack_req)
-	{
-		/*
-		 * if the ack request is set, then we need to
-		 * check the retry queue and remove the entry.
-		 */
+/*
+ * Fail the transmission and send a confirm with the failure status. If the
+ * ack request is set, the buffer belongs to the retry queue so we remove
+ * the retry entry which will free it.
+ */
+static void mac_out_fail(buffer_t *buf, bool ack_req, U8 dsn, U8 handle, U8 status)
+{
+	mac_pcb_t *pcb = mac_pcb_get();
+
+	if (ack_req) {
 		mac_retry_rem(dsn);
 
 		/* collect a transmit fail stat here */
@@ -164,156 +156,288 @@ void mac_out(buffer_t *buf, bool ack_req, U8 dsn, U8 handle)
 	} else
 		buf_free(buf);
 
-	mac_data_conf(MAC_CHANNEL_ACCESS_FAILURE, handle);
+	mac_data_conf(status, handle);
 }
 
 /*
- * Handle the rx events from the mac process. If the driver
- * receives a valid frame, it will send an event to the mac
- * process. The mac process will then call the event handler
- * which retrieves the frame from the rx queue and parses it.
- * Once parsed, it will be handled according to the frame type.
- * If its a command frame, it gets sent to the command handler,
- * a data frame gets sent to the next higher layer, etc...
+ * Wait a random number of backoff periods in the range of 0 to 2^BE - 1
+ * and then try the channel again.
  */
-static void mac_eventhandler(process_event_t event)
+static void mac_csma_backoff()
+{
+	U16 periods = drvr_get_rand() % (U16)(1 << csma_be);
+
+	ctimer_set(&csma_tmr, periods * aUnitBackoffPeriod, mac_csma_attempt, NULL);
+}
+
+/* Start the CSMA algorithm for the frame at the head of the queue */
+static void mac_csma_start()
+{
+	mac_pib_t *pib = mac_pib_get();
+
+	csma_nb = 0;
+	csma_be = pib->min_be;
+	mac_csma_backoff();
+}
+
+/* Remove the head of the queue and start on the next frame if there is one */
+static void mac_csma_next()
+{
+	tx_head = (tx_head + 1) % MAC_TX_QUEUE_SIZE;
+	if (--tx_cnt)
+		mac_csma_start();
+}
+
+/*
+ * The backoff for the frame at the head of the queue is finished. Check
+ * if the channel is clear and send the frame if it is. If the channel is
+ * busy, then increase the backoff exponent and back off again. If it
+ * exceeds the maximum backoffs, it will abort the transmission and send a
+ * data confirm with a failure status.
+ */
+static void mac_csma_attempt(void *ptr)
 {
-	buffer_t *buf, *buf_out;
+	mac_tx_t *tx = &tx_queue[tx_head];
+	mac_pib_t *pib = mac_pib_get();
+
+	/*
+	 * if the frame needs an ack, its buffer belongs to the retry queue.
+	 * if the retry entry is gone, then the frame was acked or retired
+	 * while it was waiting here and there's nothing left to send.
+	 */
+	if (tx->ack_req && !mac_retry_pending(tx->dsn)) {
+		mac_csma_next();
+		return;
+	}
+
+	/* send the frame if the CCA clears */
+	if (drvr_get_cca()) {
+		mac_out_frm(tx->buf, tx->ack_req, tx->dsn, tx->handle);
+		mac_csma_next();
+		return;
+	}
+
+	/*
+	 * exceeded max csma backoffs. clean up and send a
+	 * confirm with a fail message.
+	 */
+	if (++csma_nb > pib->max_csma_backoffs) {
+		mac_out_fail(tx->buf, tx->ack_req, tx->dsn, tx->handle, MAC_CHANNEL_ACCESS_FAILURE);
+		mac_csma_next();
+		return;
+	}
+
+	/* channel busy. increase the backoff exponent and try again. */
+	if (csma_be < pib->max_be)
+		csma_be++;
+	mac_csma_backoff();
+}
+
+/*
+ * This is the function that queues the frame for transmission. The frame
+ * goes into the transmit queue and the CSMA backoff gets started if the
+ * queue was idle. A frame that needs an ack may get queued again by the
+ * retry queue while it's still waiting for the channel. In that case, it
+ * just keeps its place in the queue.
+ */
+void mac_out(buffer_t *buf, bool ack_req, U8 dsn, U8 handle)
+{
+	U8 i;
+	mac_tx_t *tx;
+
+	for (i = 0; i < tx_cnt; i++) {
+		tx = &tx_queue[(tx_head + i) % MAC_TX_QUEUE_SIZE];
+		if (ack_req && tx->ack_req && (tx->dsn == dsn) && (tx->buf == buf))
+			return;
+	}
+
+	if (tx_cnt >= MAC_TX_QUEUE_SIZE) {
+		mac_out_fail(buf, ack_req, dsn, handle, MAC_TRANSACTION_OVERFLOW);
+		return;
+	}
+
+	tx = &tx_queue[(tx_head + tx_cnt) % MAC_TX_QUEUE_SIZE];
+	tx->buf		= buf;
+	tx->ack_req	= ack_req;
+	tx->dsn		= dsn;
+	tx->handle	= handle;
+
+	if (tx_cnt++ == 0)
+		mac_csma_start();
+}
+
+/*
+ * Handle a received frame. The frame gets parsed and then handled
+ * according to the frame type. If its a command frame, it gets sent
+ * to the command handler, a data frame gets sent to the next higher
+ * layer, etc...
+ */
+static void mac_rx_handler(buffer_t *buf)
+{
+	buffer_t *buf_out;
 	mac_hdr_t hdr;
 	mac_cmd_t cmd;
-	bool frm_pend;
+	bool frm_pend, poll_again = false;
 	mac_pcb_t *pcb = mac_pcb_get();
 	mac_pib_t *pib = mac_pib_get();
 
-	if (event == event_mac_rx)
-	{
-		DBG_PRINT("MAC_EVENTHANDLER: Rx event occurred.\n");
+	DBG_PRINT_RAW("\n<INCOMING>");
+	debug_dump_buf(buf->dptr, buf->len);
 
-		buf = mac_queue_buf_pop();
-		if (buf) {
-			DBG_PRINT_RAW("\n<INCOMING>");
-			debug_dump_buf(buf->dptr, buf->len);
+	/* decode the packet */
+	mac_parse_hdr(buf, &hdr);
+	debug_dump_mac_hdr(&hdr);
+
+	/*
+	 * check if an ack is needed. if so, then generate
+	 * an ack and queue it for transmission. the frm
+	 * pending bit will be set for any frame coming from
+	 * an address that has an indirect frame for it. this
+	 * is against the spec, but it will speed up the ack
+	 * transmission.
+	 * NOTE: the ack response section may change due to the
+	 * tight ack timing requirements.
+	 */
+	if (hdr.mac_frm_ctrl.ack_req)
+	{
+		BUF_ALLOC(buf_out, TX);
+		DBG_PRINT("MAC: ACK Required.\n");
+		frm_pend = mac_indir_frm_pend(&hdr.src_addr);
+		mac_gen_ack(buf_out, frm_pend, hdr.dsn);
 
-			/* decode the packet */
-			mac_parse_hdr(buf, &hdr);
-			debug_dump_mac_hdr(&hdr);
+		/* acks go out right away without any csma */
+		mac_out_frm(buf_out, false, hdr.dsn, 0);
+	}
 
+	/*
+	 * process accordingly. if a scan is in progress,
+	 * all frames except for beacon frames will be
+	 * discarded.
+	 */
+	switch(hdr.mac_frm_ctrl.frame_type)
+	{
+	case MAC_COMMAND:
+		if (pcb->mac_state != MLME_SCAN)
+		{
 			/*
-			 * check if an ack is needed. if so, then generate
-			 * an ack and queue it for transmission. the frm
-			 * pending bit will be set for any frame coming from
-			 * an address that has an indirect frame for it. this
-			 * is against the spec, but it will speed up the ack
-			 * transmission.
-			 * NOTE: the ack response section may change due to the
-			 * tight ack timing requirements.
+			 * need to handle the case that this is an indirect
+			 * transfer, which means that we need to stop the
+			 * poll timer and send a status to the poll confirm.
 			 */
-			if (hdr.mac_frm_ctrl.ack_req)
+			if ((pcb->mac_state == MLME_DATA_REQ) &&
+			(hdr.src_addr.mode == SHORT_ADDR) &&
+			(hdr.src_addr.short_addr == pib->coord_addr.short_addr))
 			{
-				BUF_ALLOC(buf_out, TX);
-				DBG_PRINT("MAC: ACK Required.\n");
-				frm_pend = mac_indir_frm_pend(&hdr.src_addr);
-				mac_gen_ack(buf_out, frm_pend, hdr.dsn);
-				mac_out(buf_out, false, hdr.dsn, 0);
+				ctimer_stop(&pcb->mlme_tmr);
+				mac_poll_conf(MAC_SUCCESS);
 			}
 
+			mac_parse_cmd(buf, &cmd);
+			mac_cmd_handler(&cmd, &hdr);
+		}
+		buf_free(buf);
+		break;
+	case MAC_BEACON:
+		/* discard the beacon if we're not doing a scan */
+		if (pcb->mac_state == MLME_SCAN)
+		{
+			mac_parse_beacon(buf, &hdr);
+			mac_beacon_notify_ind(buf, mac_scan_descr_find_addr(&hdr.src_addr));
+		}
+		buf_free(buf);
+		break;
+	case MAC_ACK:
+		mac_retry_ack_handler(hdr.dsn);
+
+		/*
+		 * we need to do some special ops depending on the
+		 * state we're in if we get an ACK.
+		 */
+		if (pcb->mac_state == MLME_ASSOC_REQ)
+		{
+			if (pcb->assoc_req_dsn == hdr.dsn)
+				ctimer_set(&pcb->mlme_tmr,
+					   pib->resp_wait_time,
+					   mac_poll_req,
+					   NULL);
+		} else if (pcb->mac_state == MLME_DATA_REQ) {
+			if (hdr.mac_frm_ctrl.frame_pending)
+				ctimer_set(&pcb->mlme_tmr,
+					   aMacMaxFrameTotalWaitTime,
+					   mac_poll_timeout,
+					   NULL);
+		}
+		buf_free(buf);
+		break;
+	case MAC_DATA:
+		if (pcb->mac_state != MLME_SCAN)
+		{
 			/*
-			 * process accordingly. if a scan is in progress,
-			 * all frames except for beacon frames will be
-			 * discarded.
+			 * need to handle the case that this is an indirect
+			 * transfer, which means that we need to stop the poll
+			 * timer and send a status to the poll confirm.
 			 */
-			switch(hdr.mac_frm_ctrl.frame_type)
+			if ((pcb->mac_state == MLME_DATA_REQ)  &&
+				(hdr.src_addr.mode == SHORT_ADDR) &&
+				(hdr.src_addr.short_addr == pib->coord_addr.short_addr))
 			{
-			case MAC_COMMAND:
-				if (pcb->mac_state != MLME_SCAN)
-				{
-					/*
-					 * need to handle the case that this is an indirect
-					 * transfer, which means that we need to stop the
-					 * poll timer and send a status to the poll confirm.
-					 */
-					if ((pcb->mac_state == MLME_DATA_REQ) &&
-					(hdr.src_addr.mode == SHORT_ADDR) &&
-					(hdr.src_addr.short_addr == pib->coord_addr.short_addr))
-					{
-						ctimer_stop(&pcb->mlme_tmr);
-						mac_poll_conf(MAC_SUCCESS);
-					}
-
-					mac_parse_cmd(buf, &cmd);
-					mac_cmd_handler(&cmd, &hdr);
-				}
-				buf_free(buf);
-				break;
-			case MAC_BEACON:
-				/* discard the beacon if we're not doing a scan */
-				if (pcb->mac_state == MLME_SCAN)
-				{
-					mac_parse_beacon(buf, &hdr);
-					mac_beacon_notify_ind(buf, mac_scan_descr_find_addr(&hdr.src_addr));
-				}
-				buf_free(buf);
-				break;
-			case MAC_ACK:
-				mac_retry_ack_handler(hdr.dsn);
+				ctimer_stop(&pcb->mlme_tmr);
+				mac_poll_conf(MAC_SUCCESS);
 
 				/*
-				 * we need to do some special ops depending on the
-				 * state we're in if we get an ACK.
+				 * the parent has more frames queued for
+				 * us. poll again right away to drain them
+				 * in this wake cycle.
 				 */
-				if (pcb->mac_state == MLME_ASSOC_REQ)
-				{
-					if (pcb->assoc_req_dsn == hdr.dsn)
-						ctimer_set(&pcb->mlme_tmr,
-							   pib->resp_wait_time,
-							   mac_poll_req,
-							   NULL);
-				} else if (pcb->mac_state == MLME_DATA_REQ) {
-					if (hdr.mac_frm_ctrl.frame_pending)
-						ctimer_set(&pcb->mlme_tmr,
-							   aMacMaxFrameTotalWaitTime,
-							   mac_poll_timeout,
-							   NULL);
-				}
-				buf_free(buf);
-				break;
-			case MAC_DATA:
-				if (pcb->mac_state != MLME_SCAN)
-				{
-					/*
-					 * need to handle the case that this is an indirect
-					 * transfer, which means that we need to stop the poll
-					 * timer and send a status to the poll confirm.
-					 */
-					if ((pcb->mac_state == MLME_DATA_REQ)  &&
-						(hdr.src_addr.mode == SHORT_ADDR) &&
-						(hdr.src_addr.short_addr == pib->coord_addr.short_addr))
-					{
-						ctimer_stop(&pcb->mlme_tmr);
-						mac_poll_conf(MAC_SUCCESS);
-					}
-
-					mac_data_ind(buf, &hdr);
-				} else
-					buf_free(buf);
-				break;
-			default:
-				/* TODO: Add a statistic here to capture an error'd rx */
-			break;
+				poll_again = hdr.mac_frm_ctrl.frame_pending;
 			}
-		}
+
+			mac_data_ind(buf, &hdr);
+
+			if (poll_again)
+				mac_poll_req();
+		} else
+			buf_free(buf);
+		break;
+	default:
+		/* TODO: Add a statistic here to capture an error'd rx */
+	break;
+	}
+}
+
+/*
+ * Handle the rx events from the mac process. If the driver
+ * receives a valid frame, it will send an event to the mac
+ * process. The mac process will then call the event handler
+ * which drains frames from the rx queue and handles them. At most
+ * MAC_RX_BUDGET frames are handled per event so that the other
+ * processes don't get starved during an rx burst.
+ */
+static void mac_eventhandler(process_event_t event)
+{
+	buffer_t *buf;
+	U8 i;
+
+	if ((event == event_mac_rx) || (event == PROCESS_EVENT_POLL))
+	{
+		DBG_PRINT("MAC_EVENTHANDLER: Rx event occurred.\n");
+
+		for (i = 0; (i < MAC_RX_BUDGET) && ((buf = mac_queue_buf_pop()) != NULL); i++)
+			mac_rx_handler(buf);
+
 		/*
-		 * there's a possibility that more than one frame is in the
-		 * buffer. if they came in before this function gets executed.
-		 * So process until the queue is empty.
+		 * if the budget ran out before the queue was empty, post
+		 * another event to handle the rest. if the event queue
+		 * is full, poll ourselves instead of waiting for a free slot.
 		 */
 		if (!mac_queue_is_empty())
 		{
-			while (process_post(&mac_process, event_mac_rx, NULL) != PROCESS_ERR_OK)
-			{
-				;
-			}
+			if (process_post_prio(&mac_process, event_mac_rx, NULL, PROCESS_PRIO_HIGH) != PROCESS_ERR_OK)
+				process_poll(&mac_process);
 		}
+	} else if (event == event_mac_scan) {
+		/* move the energy scan on to the next channel */
+		mac_scan_energy_next();
 	}
 }
 
@@ -52,12 +52,48 @@ PROCESS(drvr_process, "Test Driver Process");
 
 extern process_event_t event_mac_rx;
 
-static U8 rx_buf[SIM_DRVR_MAX_BUF_SIZE]; /* Receive buffer for incoming frames */
 static U8 tx_buf[SIM_DRVR_MAX_BUF_SIZE]; /* Tx buffer for outgoing frames */
-static U8 rx_len;                        /* Received frame length */
 static U8 tx_len;                        /* Transmitted frame length */
 static U8 channel;                       /* Current channel we are using */
 
+static sim_ring_t rx_ring;               /* Frames from the data_in thread */
+static struct ctimer drain_tmr;          /* Retries the rx drain when short on buffers */
+
+/*
+ * Producer side of a sim ring. Copy the data into the next slot. False if
+ * the ring is full.
+ */
+bool sim_ring_put(sim_ring_t *ring, const U8 *data, U8 len)
+{
+	unsigned tail = ring->tail;
+
+	if ((tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) == SIM_DRVR_RING_SIZE)
+		return false;
+
+	memcpy(ring->data[tail % SIM_DRVR_RING_SIZE], data, len);
+	ring->len[tail % SIM_DRVR_RING_SIZE] = len;
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/* Consumer side. Return the oldest slot or NULL if the ring is empty. */
+U8 *sim_ring_peek(sim_ring_t *ring, U8 *len)
+{
+	unsigned head = ring->head;
+
+	if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	*len = ring->len[head % SIM_DRVR_RING_SIZE];
+	return ring->data[head % SIM_DRVR_RING_SIZE];
+}
+
+/* Consumer side. Give the oldest slot back to the producer. */
+void sim_ring_release(sim_ring_t *ring)
+{
+	__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
 /*
  * Init the simulated driver. We need to initialize the variables,
  * start the driver process, and also seed the random number generator.
@@ -66,7 +102,6 @@ void drvr_init()
 {
 	struct timeval tv;
 
-	rx_len = 0;
 	tx_len = 0;
 
 	process_start(&drvr_process, NULL);
@@ -167,13 +202,16 @@ U8 drvr_get_ed()
 }
 
 /*
- * Write into the rx buffer. This will be used by the sim interface to
- * simulate data arriving into the rx buffer.
+ * Write into the rx ring. This will be used by the sim interface to
+ * simulate data arriving into the rx buffer. It's called from the sim
+ * input thread and returns false if the ring is full.
  */
-void drvr_write_rx_buf(U8 *buf, U8 len)
+bool drvr_write_rx_buf(U8 *buf, U8 len)
 {
-	rx_len = len - 2;
-	memcpy(rx_buf, buf + 1, rx_len);
+	if ((len < 2) || ((len - 2) > SIM_DRVR_MAX_BUF_SIZE))
+		return true;
+
+	return sim_ring_put(&rx_ring, buf + 1, len - 2);
 }
 
 /*
@@ -245,46 +283,89 @@ static bool drvr_check_addr(buffer_t *buf)
 	return false;
 }
 
-/* This is the receive interrupt service routine for the sim driver */
+/*
+ * This is the receive interrupt service routine for the sim driver. The sim
+ * data input thread calls it after it puts a frame in the rx ring. It's
+ * safe to call from another thread since all it does is poll the driver
+ * process. The rings get drained from there.
+ */
 void drvr_rx_isr()
+{
+	process_poll(&drvr_process);
+}
+
+/* Poll the driver process again to pick up the rest of the rx ring */
+static void drvr_rx_retry(void *ptr)
+{
+	process_poll(&drvr_process);
+}
+
+/*
+ * Move the frames from the rx ring into the MAC rx queue. Enough buffers are
+ * left free for the stack to handle what's already queued. If we run short,
+ * the rest of the ring waits a tick. Polling ourselves right away would keep
+ * the scheduler busy and starve the timers that free up the buffers.
+ */
+static void drvr_rx_drain()
 {
 	buffer_t *buf;
+	U8 *data, len;
+	bool rcvd = false;
 
-	if (rx_len > aMaxPHYPacketSize)
+	while ((data = sim_ring_peek(&rx_ring, &len)) != NULL)
 	{
+		if ((MAX_BUF_POOL_SIZE - buf_get_cnt()) < SIM_DRVR_MIN_FREE_BUFS)
+		{
+			ctimer_set(&drain_tmr, 1, drvr_rx_retry, NULL);
+			break;
+		}
+
+		if (len > aMaxPHYPacketSize)
+		{
+			/*
+			 * don't need to worry about buffer overflow attacks in
+			 * the sim, but hey.. why not add a check just in case I
+			 * try to hack myself.
+			 */
+			sim_ring_release(&rx_ring);
+			continue;
+		}
+
+		BUF_ALLOC(buf, RX);
+
 		/*
-		 * don't need to worry about buffer overflow attacks in
-		 * the sim, but hey.. why not add a check just in case I
-		 * try to hack myself.
+		 * copy data into the buffer starting from the back. it will be easier
+		 * to forward in case we're not the final destination.
 		 */
-		return;
+		buf->dptr = &buf->buf[aMaxPHYPacketSize - len];
+		buf->len = len;
+		buf->lqi = SIM_DRVR_LQI;
+
+		/* void *memcpy(void *dest, const void *src, size_t n) */
+		memcpy(buf->dptr, data, len);
+		sim_ring_release(&rx_ring);
+
+		if (drvr_check_addr(buf)) {
+			DBG_PRINT("TEST_DRIVER: Rx Intterupt Received.\n");
+			mac_queue_buf_insert(buf);
+			rcvd = true;
+		} else
+			buf_free(buf);
 	}
 
-	BUF_ALLOC(buf, RX);
-
 	/*
-	 * copy data into the buffer starting from the back. it will be easier
-	 * to forward in case we're not the final destination.
+	 * rx goes in the high priority lane. if the queue is full,
+	 * poll the mac process instead. it handles a poll the same
+	 * way as an rx event.
 	 */
-	buf->dptr = &buf->buf[aMaxPHYPacketSize - rx_len];
-	buf->len = rx_len;
-
-	/* void *memcpy(void *dest, const void *src, size_t n) */
-	memcpy(buf->dptr, rx_buf, rx_len);
-
-	if (drvr_check_addr(buf)) {
-		DBG_PRINT("TEST_DRIVER: Rx Intterupt Received.\n");
-		mac_queue_buf_insert(buf);
-
-		rx_len = 0;
-		process_poll(&drvr_process);
-	} else
-		buf_free(buf);
+	if (rcvd && (process_post_prio(&mac_process, event_mac_rx, NULL, PROCESS_PRIO_HIGH) != PROCESS_ERR_OK))
+		process_poll(&mac_process);
 }
 
 /*
- * This is the process thread that will handle the receive event. It will
- * just post an event to the mac process when a receive event occurs.s
+ * This is the process thread that will handle the receive event. The
+ * sim data input thread polls it when it has handed over frames, and
+ * it drains the rx ring on the main thread.
  */
 PROCESS_THREAD(drvr_process, ev, data)
 {
@@ -292,7 +373,7 @@ PROCESS_THREAD(drvr_process, ev, data)
 
 	while (1) {
 		PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
-		process_post(&mac_process, event_mac_rx, NULL);
+		drvr_rx_drain();
 	}
 
 	PROCESS_END();
@@ -54,14 +54,35 @@
 */
 enum SIM_DRVR_ENUMS
 {
-	SIM_DRVR_MAX_BUF_SIZE = 128  ///< Max buf size for the test bufs
+	SIM_DRVR_MAX_BUF_SIZE = 128, ///< Max buf size for the test bufs
+	SIM_DRVR_RING_SIZE = 32,     ///< Number of slots in a sim ring
+	SIM_DRVR_MIN_FREE_BUFS = 3,  ///< Bufs kept free for the stack while draining rx
+	SIM_DRVR_LQI = 0xFF          ///< LQI of every received frame. The sim links are perfect.
 };
 
 
+/*!
+    Single producer, single consumer ring. The sim input threads are the
+    producers and a process on the main loop is the consumer. The producer
+    only writes the tail and the consumer only writes the head, so no lock
+    is needed. The slot contents are published with a release store on the
+    index and picked up with an acquire load on the other side.
+*/
+typedef struct
+{
+	U8		data[SIM_DRVR_RING_SIZE][SIM_DRVR_MAX_BUF_SIZE];
+	U8		len[SIM_DRVR_RING_SIZE];
+	unsigned	head;
+	unsigned	tail;
+} sim_ring_t;
+
 PROCESS_NAME(drvr_process);     ///< Main process for simulation driver
+bool sim_ring_put(sim_ring_t *ring, const U8 *data, U8 len);
+U8 *sim_ring_peek(sim_ring_t *ring, U8 *len);
+void sim_ring_release(sim_ring_t *ring);
 void drvr_init();
 void drvr_rx_isr();
-void drvr_write_rx_buf(U8 *buf, U8 len);
+bool drvr_write_rx_buf(U8 *buf, U8 len);
 U8 drvr_read_tx_buf(U8 *buf);
 bool drvr_get_cca();
 U8 drvr_set_channel(U8 channel);
@@ -100,6 +100,9 @@
 /* MAC rx event */
 process_event_t event_mac_rx;
 
+/* MAC energy scan channel event */
+process_event_t event_mac_scan;
+
 /* Application Framework tx event */
 process_event_t event_af_tx;
 
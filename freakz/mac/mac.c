@@ -71,6 +71,7 @@ void mac_init()
 	 */
 	process_start(&mac_process, NULL);
 	event_mac_rx = process_alloc_event();
+	event_mac_scan = process_alloc_event();
 
 	/* init the pcb */
 	memset(&pcb, 0, sizeof(mac_pcb_t));
@@ -87,6 +88,7 @@ void mac_init()
 	pib.assoc_permit		= true;
 	pib.max_csma_backoffs		= 3;
 	pib.min_be			= 3;
+	pib.max_be			= aMaxBE;
 	pib.dsn				= (U8)drvr_get_rand();
 
 #if (TEST_SIM == 1)
@@ -190,6 +192,13 @@ void mac_cmd_handler(mac_cmd_t *cmd, mac_hdr_t *hdr)
 		if ((pcb.mac_state == MLME_DATA_REQ) || (pcb.mac_state == MLME_ASSOC_REQ))
 			pcb.mac_state = MLME_IDLE;
 
+		/* the response is in so stop waiting for it */
+		if (pcb.assoc_poll)
+		{
+			ctimer_stop(&pcb.mlme_tmr);
+			pcb.assoc_poll = false;
+		}
+
 		mac_assoc_conf(cmd->assoc_resp.short_addr, cmd->assoc_resp.assoc_status);
 		break;
 	case MAC_DATA_REQ:
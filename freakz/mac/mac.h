@@ -50,6 +50,29 @@
 
 /* Calculate amount of time to perform a scan */
 #define MAC_SCAN_TIME(duration) (((aBaseSuperframeDuration << duration) + aBaseSuperframeDuration) >> 6)
+/* Max number of rx frames that the mac process handles per event */
+#define MAC_RX_BUDGET		4
+/* Time between energy detect samples during an energy scan */
+#define MAC_ED_SAMPLE_INTERVAL	1
+
+/*
+ * Indirect queue sizes. Every child can have a queue at the same time since
+ * the table is sized from the NIB child capacity. Both can be overridden from
+ * the build. A frame that doesn't fit, either because its child's queue is
+ * full or because no queue is free, is dropped and the next higher layer
+ * gets a comm status indication with MAC_TRANSACTION_OVERFLOW.
+ */
+/* Number of children that can have indirect frames queued at the same time */
+#ifndef MAC_INDIR_MAX_CHILDREN
+#define MAC_INDIR_MAX_CHILDREN	ZIGBEE_MAX_CHILDREN
+#endif
+/* Max number of indirect frames that can be queued for a single child */
+#ifndef MAC_INDIR_MAX_DEPTH
+#define MAC_INDIR_MAX_DEPTH	3
+#endif
+
+/* Number of frames that can wait for CSMA. Can't have more than the buffers. */
+#define MAC_TX_QUEUE_SIZE	MAX_BUF_POOL_SIZE
 
 /*
  * this define is just used to make the code more comprehensible.
@@ -57,7 +80,6 @@
  * place.
  */
 
-#define INDIR_ENTRY(m) ((mac_indir_t *)MMEM_PTR(&m->mmem_ptr))
 #define RETRY_ENTRY(m) ((mac_retry_t *)MMEM_PTR(&m->mmem_ptr))
 #define SCAN_ENTRY(m)  ((pan_descr_t *)MMEM_PTR(&m->mmem_ptr))
 
@@ -261,6 +283,7 @@ typedef enum
  * coord_addr: Address of parent this device is joined to
  * dsn: Current data sequence number
  * min_be: Minimum backoff interval exponent (interval ~ 2^min_be)
+ * max_be: Maximum backoff interval exponent
  * max_csma_backoffs: Max number of CSMA backoffs before the tx is failed
  * pan_id: PAN ID that this device is joined to
  * rx_on_when_idle: Receiver is always on
@@ -278,6 +301,7 @@ typedef struct
 	address_t   coord_addr;
 	U8          dsn;
 	U8          min_be;
+	U8          max_be;
 	U8          max_csma_backoffs;
 	U16         pan_id;
 	bool        rx_on_when_idle;
@@ -527,7 +551,8 @@ typedef struct
  * dsn: Data sequence number of data
  * retries: Number of retries remaining
  * handle: Data handle identifier for confirmation
- * expiry: Time to expiration of this entry
+ * armed: Frame is on the air and waiting for its ack
+ * deadline: Time when the ack wait for this entry runs out
  */
 typedef struct _mac_retry_t
 {
@@ -535,9 +560,27 @@ typedef struct _mac_retry_t
 	U8		dsn;
 	U8		retries;
 	U8		handle;
-	U8		expiry;
+	bool		armed;
+	clock_time_t	deadline;
 } mac_retry_t;
 
+/*
+ * This struct is used for the MAC transmit queue. Frames wait in the
+ * queue while the CSMA backoff runs for the frame at the head.
+ *
+ * buf: Data buffer to be transmitted
+ * ack_req: ACK required for this transmission
+ * dsn: Data sequence number
+ * handle: Data handle identifier for confirmation
+ */
+typedef struct _mac_tx_t
+{
+	buffer_t	*buf;
+	bool		ack_req;
+	U8		dsn;
+	U8		handle;
+} mac_tx_t;
+
 /*
  * This struct is used for the MAC indirect queue. Frames are buffered
  * in this struct until a sleeping node wakes up and polls this device
@@ -546,20 +589,36 @@ typedef struct _mac_retry_t
  * buf: Data buffer to be transmitted
  * dsn: Data sequence number
  * ack_req: ACK required for this transmission
- * addr: Destination address of this frame
  * handle: Data handle identifier for confirmation
- * expiry: Time to expiration of this entry
+ * tmr: Slow timer that expires this entry
  */
 typedef struct _mac_indir_t
 {
 	buffer_t	*buf;
 	U8		dsn;
 	bool		ack_req;
-	address_t	addr;
 	U8		handle;
-	U8		expiry;
+	slow_tmr_t	tmr;
 } mac_indir_t;
 
+/*
+ * Indirect queue for a single child. Frames for the child are kept in a
+ * small FIFO ring so that they go out in the order they were queued. The
+ * queue is free when it has no frames in it.
+ *
+ * addr: Address of the child that the frames are queued for
+ * head: Index of the oldest frame in the ring
+ * cnt: Number of frames in the ring
+ * frm: Frame ring
+ */
+typedef struct _mac_indir_queue_t
+{
+	address_t	addr;
+	U8		head;
+	U8		cnt;
+	mac_indir_t	frm[MAC_INDIR_MAX_DEPTH];
+} mac_indir_queue_t;
+
 /*
  * This is the MAC protocol control block. It holds variables that
  * are used throughout the MAC layer.
@@ -567,7 +626,8 @@ typedef struct _mac_indir_t
  * mac_state: Current state
  * mlme_tmr: Callback timer shared by MAC managment functions
  * parent_addr: Address of parent this device is requesting to join
- * assoc_req_dsn: DSN of association request
+ * assoc_req_dsn: DSN of association request, or of the poll that picks up its response
+ * assoc_poll: The poll in flight is picking up our association response
  * original_pan_id: Original PAN ID before channel scan
  * curr_scan_channel: Current channel being scanned
  * channel_mask: Channel mask for this scan
@@ -576,6 +636,9 @@ typedef struct _mac_indir_t
  * scan_type: ype of scan to be performed
  * coor_realign_rcvd: Coordinator alignment received for orphan scan
  * energy_list: Energy list to store values from energy scan
+ * ed_tmr: Callback timer that paces the energy detect samples
+ * ed_dwell: Measurement time for the current channel in the energy scan
+ * ed_orig_channel: Channel to go back to when the energy scan finishes
  * total_xmit: Total number of transmissions attempted
  * total_fail: Total number of transmissions failed
  */
@@ -587,6 +650,7 @@ typedef struct
 	/* association */
 	address_t	parent_addr;
 	U8		assoc_req_dsn;
+	bool		assoc_poll;
 
 	/* channel scanning */
 	U16		original_pan_id;
@@ -597,6 +661,9 @@ typedef struct
 	U8		scan_type;
 	bool		coor_realign_rcvd;
 	U8		energy_list[MAC_MAX_CHANNELS];
+	struct ctimer	ed_tmr;
+	struct timer	ed_dwell;
+	U8		ed_orig_channel;
 
 	/* statistics */
 	U16		total_xmit;
@@ -631,8 +698,9 @@ void mac_retry_init();
 void mac_retry_clear();
 void mac_retry_add(buffer_t *buf, U8 dsn, U8 handle);
 void mac_retry_rem(U8 dsn);
+bool mac_retry_pending(U8 dsn);
 void mac_retry_ack_handler(U8 dsn);
-void mac_retry_periodic(void *ptr);
+void mac_retry_sent(U8 dsn);
 void mac_retry_stop_tmr();
 
 // mac_gen
@@ -655,24 +723,25 @@ void mac_indir_add(buffer_t *buf, address_t *addr, bool ack_req, U8 dsn, U8 hand
 void mac_indir_data_req_handler(const address_t *addr);
 bool mac_indir_frm_pend(const address_t *addr);
 void mac_indir_clear();
-void mac_indir_periodic();
 
 // mac_scan
 void mac_scan_init();
-void mac_scan_descr_add(address_t *src_addr, U16 src_pan_id, U8 channel, U16 superframe_spec);
+void mac_scan_descr_add(address_t *src_addr, U16 src_pan_id, U8 channel, U16 superframe_spec, U8 lqi);
 void mac_scan_descr_free(mem_ptr_t *mem_ptr);
 mem_ptr_t *mac_scan_descr_get_head();
 void mac_scan_descr_clear();
 mem_ptr_t *mac_scan_descr_find_pan(U16 pan_id);
 mem_ptr_t *mac_scan_descr_find_addr(address_t *addr);
 U8 *mac_scan_get_energy_list();
-void mac_scan_energy();
+U8 mac_scan_energy(U32 channel_mask, U8 duration);
+void mac_scan_energy_next();
 void mac_scan(void *ptr);
 U8 mac_scan_get_entry_cnt();
 
 // mac_assoc
 void mac_assoc_req(mac_assoc_req_t *args);
 void mac_assoc_resp(mac_assoc_resp_t *args);
+void mac_assoc_fail(U8 status);
 void mac_orphan_resp(U64 orphan_addr, U16 short_addr);
 
 // mac_poll
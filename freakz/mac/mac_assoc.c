@@ -83,6 +83,22 @@ void mac_assoc_req(mac_assoc_req_t *args_in)
 	mac_tx_handler(buf, &hdr.dest_addr, false, true, hdr.dsn, ZIGBEE_INVALID_HANDLE);
 }
 
+/*
+ * The association never completed. Either the request or the poll for the
+ * response wasn't acked, or the response never showed up. Clean up and send
+ * the association confirm with the failure so that the next higher layer can
+ * try another parent.
+ */
+void mac_assoc_fail(U8 status)
+{
+	mac_pcb_t *pcb = mac_pcb_get();
+
+	ctimer_stop(&pcb->mlme_tmr);
+	pcb->assoc_poll = false;
+	pcb->mac_state  = MLME_IDLE;
+	mac_assoc_conf(INVALID_NWK_ADDR, status);
+}
+
 /*
  * An association response frame is an indirect frame that is generated
  * in response to an association request. If the association request was successful,
@@ -48,162 +48,221 @@
 #include "freakz.h"
 
 /*
- * List head for the indirect transfer list. The indirect transfer list
- * contains all of the frames that are buffered for the sleepy end device
- * children.
+ * Indirect queue table. Each child that has frames buffered for it gets
+ * its own FIFO so that a data request only has to look at that child's
+ * frames and the frame pending state can be worked out per child.
  */
-LIST(indir_list);
+static mac_indir_queue_t indir_tbl[MAC_INDIR_MAX_CHILDREN];
 
-/* Init the list used to implement the indirect queue */
+/* Total number of frames buffered across all of the child queues */
+static U8 indir_cnt;
+
+/*
+ * Init the table used to implement the indirect queues. Any expiration
+ * timers still running from before get stopped so they don't get wiped out
+ * while they're linked into the slow clock.
+ */
 void mac_indir_init()
 {
-	list_init(indir_list);
+	U8 i, j;
+
+	for (i = 0; i < MAC_INDIR_MAX_CHILDREN; i++)
+		for (j = 0; j < MAC_INDIR_MAX_DEPTH; j++)
+			slow_tmr_stop(&indir_tbl[i].frm[j].tmr);
+
+	memset(indir_tbl, 0, sizeof(indir_tbl));
+	indir_cnt = 0;
+}
+
+/* Compare two addresses. Both the mode and the address need to match. */
+static bool mac_indir_addr_match(const address_t *a, const address_t *b)
+{
+	if (a->mode != b->mode)
+		return false;
+
+	if (a->mode == LONG_ADDR)
+		return (a->long_addr == b->long_addr);
+
+	return (a->short_addr == b->short_addr);
 }
 
 /*
- * Allocate an indirect entry from the indirect struct pool. If no free entry
- * exists, then return NULL.
+ * Find the indirect queue for the specified address. The address structure
+ * is a union that can be used to specify either a short address or an
+ * extended address. Only queues that have frames in them are checked.
  */
-static mem_ptr_t *mac_indir_alloc()
+static mac_indir_queue_t *mac_indir_find(const address_t *addr)
 {
-	nwk_nib_t *nib = nwk_nib_get();
-	mem_ptr_t *mem_ptr;
+	U8 i;
 
-	mem_ptr = mem_heap_alloc(sizeof(mac_indir_t));
-	if (mem_ptr) {
-		INDIR_ENTRY(mem_ptr)->expiry = nib->traxn_persist_time;
-		list_add(indir_list, mem_ptr);
+	for (i = 0; i < MAC_INDIR_MAX_CHILDREN; i++)
+	{
+		if (indir_tbl[i].cnt && mac_indir_addr_match(&indir_tbl[i].addr, addr))
+			return &indir_tbl[i];
 	}
-	return mem_ptr;
+	return NULL;
 }
 
 /*
- * Free an indirect entry back into the indirect pool. This consists of two
- * operations, which is to set the alloc value to false and to remove it
- * from the indirect list (queue).
+ * Allocate an indirect queue for the specified address. If no free queue
+ * exists, then return NULL.
  */
-static void mac_indir_free(mem_ptr_t *mem_ptr)
+static mac_indir_queue_t *mac_indir_alloc(const address_t *addr)
 {
-	if (mem_ptr) {
-		list_remove(indir_list, mem_ptr);
-		mem_heap_free(mem_ptr);
+	U8 i;
+
+	for (i = 0; i < MAC_INDIR_MAX_CHILDREN; i++)
+	{
+		if (indir_tbl[i].cnt == 0) {
+			memcpy(&indir_tbl[i].addr, addr, sizeof(address_t));
+			indir_tbl[i].head = 0;
+			return &indir_tbl[i];
+		}
 	}
+	return NULL;
 }
 
 /*
- * Clear the indirect queue of all entries. This is usually only done on
+ * Remove the oldest frame from the child's queue. The queue is freed once
+ * its last frame is gone. When no frames are left for any child, the frame
+ * pending bit in the hardware gets cleared.
+ */
+static void mac_indir_pop(mac_indir_queue_t *queue)
+{
+	slow_tmr_stop(&queue->frm[queue->head].tmr);
+	queue->head = (queue->head + 1) % MAC_INDIR_MAX_DEPTH;
+	queue->cnt--;
+
+	if (--indir_cnt == 0)
+		drvr_set_frm_pend(false);
+}
+
+/*
+ * Clear the indirect queues of all entries. This is usually only done on
  * startup.
  */
 void mac_indir_clear()
 {
-	mem_ptr_t *mem_ptr;
+	U8 i;
+	mac_indir_queue_t *queue;
 
-	for (mem_ptr = list_chop(indir_list); mem_ptr != NULL; mem_ptr = list_chop(indir_list))
+	for (i = 0; i < MAC_INDIR_MAX_CHILDREN; i++)
 	{
-		buf_free(INDIR_ENTRY(mem_ptr)->buf);
-		mac_indir_free(mem_ptr);
+		queue = &indir_tbl[i];
+		while (queue->cnt)
+		{
+			slow_tmr_stop(&queue->frm[queue->head].tmr);
+			buf_free(queue->frm[queue->head].buf);
+			queue->head = (queue->head + 1) % MAC_INDIR_MAX_DEPTH;
+			queue->cnt--;
+		}
 	}
+	indir_cnt = 0;
+	drvr_set_frm_pend(false);
 }
 
 /*
- * Find a frame with the specified address in the indirect queue. The address
- * structure is a union that can be used to specify either a short address or
- * an extended address.
+ * Slow timer callback for an indirect entry. The entry has timed out so it
+ * will be removed from the queue and a comm status indication will be sent
+ * to the next higher layer stating that the indirect transmission failed.
+ * All entries get the same persistence time so the frames expire in queue
+ * order. Frames that expire on the same tick may have their callbacks made
+ * in any order though, so the queue is drained from the head for as long as
+ * the head's timer has fired.
  */
-static mem_ptr_t *mac_indir_find(const address_t *addr)
+static void mac_indir_expire(void *ptr)
 {
-	mem_ptr_t *mem_ptr;
+	mac_indir_queue_t *queue = ptr;
+	mac_indir_t *entry;
+	address_t addr;
+	mac_pib_t *pib = mac_pib_get();
 
-	for (mem_ptr = list_head(indir_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	memcpy(&addr, &queue->addr, sizeof(address_t));
+	while (queue->cnt && !slow_tmr_active(&queue->frm[queue->head].tmr))
 	{
-		if (((addr->mode == LONG_ADDR)  &&
-			(addr->long_addr == INDIR_ENTRY(mem_ptr)->addr.long_addr)) ||
-		   ((addr->mode == SHORT_ADDR) &&
-			(addr->short_addr == INDIR_ENTRY(mem_ptr)->addr.short_addr)))
-		{
-			break;
-		}
+		entry = &queue->frm[queue->head];
+		buf_free(entry->buf);
+		mac_indir_pop(queue);
+		mac_comm_status_ind(pib->pan_id,
+				    addr,
+				    MAC_TRANSACTION_EXPIRED,
+				    entry->handle);
 	}
-	return mem_ptr;
 }
 
-/* Add an indirect entry to the indirect list and fill in the info. */
+/*
+ * Add a frame to the tail of the child's indirect queue and fill in the
+ * info. If the child's queue is full or there are no free queues, the frame
+ * is dropped and the next higher layer is told with a comm status indication.
+ */
 void mac_indir_add(buffer_t *buf, address_t *addr, bool ack_req, U8 dsn, U8 handle)
 {
-	mem_ptr_t *mem_ptr;
+	mac_indir_queue_t *queue;
+	mac_indir_t *entry;
+	nwk_nib_t *nib = nwk_nib_get();
+	mac_pib_t *pib = mac_pib_get();
 
-	if ((mem_ptr = mac_indir_alloc()) != NULL)
-	{
-		memcpy(&INDIR_ENTRY(mem_ptr)->addr, addr, sizeof(address_t));
-		INDIR_ENTRY(mem_ptr)->buf	= buf;
-		INDIR_ENTRY(mem_ptr)->dsn	= dsn;
-		INDIR_ENTRY(mem_ptr)->handle	= handle;
-		INDIR_ENTRY(mem_ptr)->ack_req	= ack_req;
-		drvr_set_frm_pend(true);
+	if ((queue = mac_indir_find(addr)) == NULL)
+		queue = mac_indir_alloc(addr);
+
+	if ((queue == NULL) || (queue->cnt >= MAC_INDIR_MAX_DEPTH)) {
+		DBG_PRINT("MAC_INDIR: Indirect queue full. Dropping frame.\n");
+		buf_free(buf);
+		mac_comm_status_ind(pib->pan_id, *addr, MAC_TRANSACTION_OVERFLOW, handle);
+		return;
 	}
+
+	entry = &queue->frm[(queue->head + queue->cnt) % MAC_INDIR_MAX_DEPTH];
+	entry->buf	= buf;
+	entry->dsn	= dsn;
+	entry->handle	= handle;
+	entry->ack_req	= ack_req;
+	slow_tmr_set(&entry->tmr, nib->traxn_persist_time, mac_indir_expire, queue);
+	queue->cnt++;
+
+	indir_cnt++;
+	drvr_set_frm_pend(true);
 }
 
 /*
  * When a data request comes in, this function will handle the data request.
- * It checks the indirect list to see if there are any buffers pending for the
- * requesting node. If a buffer is found, then it will send the buffer out and
- * free the indirect list entry.
+ * It checks the requesting node's indirect queue and sends out the oldest
+ * frame. If there are more frames queued behind it, the frame pending bit
+ * is set in the outgoing frame so that the child will poll again right away
+ * and can drain its queue in a single wake cycle.
 */
 void mac_indir_data_req_handler(const address_t *addr)
 {
-	mem_ptr_t *mem_ptr;
+	mac_indir_queue_t *queue;
+	mac_indir_t entry;
 	mac_pib_t *pib = mac_pib_get();
 
-	mem_ptr = mac_indir_find(addr);
-	if (mem_ptr)
-	{
-		mac_tx_handler(INDIR_ENTRY(mem_ptr)->buf,
-			       NULL,
-			       false,
-			       INDIR_ENTRY(mem_ptr)->ack_req,
-			       INDIR_ENTRY(mem_ptr)->dsn,
-			       INDIR_ENTRY(mem_ptr)->handle);
-		mac_comm_status_ind(pib->pan_id,
-				    INDIR_ENTRY(mem_ptr)->addr,
-				    MAC_SUCCESS,
-				    INDIR_ENTRY(mem_ptr)->handle);
-		mac_indir_free(mem_ptr);
-	}
+	if ((queue = mac_indir_find(addr)) == NULL)
+		return;
+
+	memcpy(&entry, &queue->frm[queue->head], sizeof(mac_indir_t));
+	/* dptr is at the length byte. the pending bit is in the fcf low byte behind it */
+	if (queue->cnt > 1)
+		entry.buf->dptr[1] |= MAC_PENDING_FRAME_MASK;
+	mac_indir_pop(queue);
+
+	mac_tx_handler(entry.buf,
+		       NULL,
+		       false,
+		       entry.ack_req,
+		       entry.dsn,
+		       entry.handle);
+	mac_comm_status_ind(pib->pan_id,
+			    *addr,
+			    MAC_SUCCESS,
+			    entry.handle);
 }
 
 /*
- * Check the indirect list to see if a frame is pending. If not, then return
- * false.
+ * Check the child's indirect queue to see if a frame is pending. If not,
+ * then return false.
  */
 bool mac_indir_frm_pend(const address_t *addr)
 {
 	return (mac_indir_find(addr) != NULL);
 }
-
-/*
- * The periodic function is called by the slow clock once per second and
- * will decrement the expiry of each indirect entry in the queue. If the
- * expiry goes to zero, then that entry has timed out and will be removed
- * from the queue. A comm status indication will also be sent to the next
- * higher layer stating that the indirect transmission failed.
- */
-void mac_indir_periodic()
-{
-	mem_ptr_t *mem_ptr;
-	mac_pib_t *pib = mac_pib_get();
-
-	for (mem_ptr = list_head(indir_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-	{
-		if (INDIR_ENTRY(mem_ptr)->expiry == 0)
-		{
-			buf_free(INDIR_ENTRY(mem_ptr)->buf);
-			mac_indir_free(mem_ptr);
-			mac_comm_status_ind(pib->pan_id,
-					    INDIR_ENTRY(mem_ptr)->addr,
-					    MAC_TRANSACTION_EXPIRED,
-					    INDIR_ENTRY(mem_ptr)->handle);
-		} else {
-			INDIR_ENTRY(mem_ptr)->expiry--;
-		}
-	}
-}
@@ -166,7 +166,7 @@ void mac_parse_beacon(buffer_t *buf, mac_hdr_t *hdr)
 	 */
 	superframe_spec = *(U16 *)buf->dptr;
 	buf->dptr += sizeof(U16);
-	mac_scan_descr_add(&hdr->src_addr, hdr->src_pan_id, pib->curr_channel, superframe_spec);
+	mac_scan_descr_add(&hdr->src_addr, hdr->src_pan_id, pib->curr_channel, superframe_spec, buf->lqi);
 
 	/*
 	 * check to see if there are any GTS descriptors.
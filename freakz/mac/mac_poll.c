@@ -76,12 +76,29 @@ void mac_poll_req()
 		 */
 		src_addr.mode               = LONG_ADDR;
 		src_addr.long_addr          = pib->ext_addr;
+		pcb->assoc_poll             = true;
 	} else {
 		/* this is a standard data request. Use our network address */
 		hdr.src_addr.mode           = SHORT_ADDR;
 		hdr.src_addr.short_addr     = pib->short_addr;
+		pcb->assoc_poll             = false;
 	}
 	mac_gen_cmd_header(buf, &hdr, true, &src_addr, &pcb->parent_addr);
+
+	/*
+	 * the association fails if its response doesn't come back. the
+	 * timer covers the retries of the poll and the wait for the data.
+	 * if the parent acks with data pending, the wait gets restarted.
+	 */
+	if (pcb->assoc_poll)
+	{
+		pcb->assoc_req_dsn = hdr.dsn;
+		ctimer_set(&pcb->mlme_tmr,
+			   aMacMaxFrameTotalWaitTime + (pib->ack_wait_duration * (aMacMaxFrameRetries + 1)),
+			   mac_poll_timeout,
+			   NULL);
+	}
+
 	mac_tx_handler(buf, &hdr.dest_addr, false, true, hdr.dsn, ZIGBEE_INVALID_HANDLE);
 	pcb->mac_state = MLME_DATA_REQ;
 }
@@ -94,12 +111,20 @@ void mac_poll_req()
  * is data, the data request timer starts and we wait for the data
  * to come in. If no data ever comes, then this function will get
  * called and we send a confirmation to the next higher layer informing
- * it of the failure.
+ * it of the failure. If the poll was for our association response, then
+ * the association failed instead.
  */
 void mac_poll_timeout()
 {
 	mac_pcb_t *pcb = mac_pcb_get();
 
+	if (pcb->assoc_poll)
+	{
+		DBG_PRINT("MAC_POLL_TIMEOUT: No association response.\n");
+		mac_assoc_fail(MAC_NO_DATA);
+		return;
+	}
+
 	mac_poll_conf(MAC_NO_DATA);
 	DBG_PRINT("MAC_POLL_TIMEOUT: Data request timed out.\n");
 	pcb->mac_state = MLME_IDLE;
@@ -47,19 +47,21 @@
 #include "freakz.h"
 
 /*
- * List head for the MAC rx queue. When an inbound frame arrives, it will
- * get put in this queue. An indication to the MAC process is then sent
- * and the MAC will pull out the frame from the queue and begin processing it.
+ * Head and tail of the MAC rx queue. When an inbound frame arrives, it will
+ * get put at the tail of this queue. An indication to the MAC process is then
+ * sent and the MAC will pull out the frames from the head and begin processing
+ * them. The frames are linked through their buffer's next pointer so that
+ * both insert and pop are constant time.
  */
-
-LIST(mac_rx_queue);
+static buffer_t *rx_head;
+static buffer_t *rx_tail;
 
 /*
- * Initialize the list (queue).
+ * Initialize the queue.
  */
 void mac_queue_init()
 {
-	list_init(mac_rx_queue);
+	rx_head = rx_tail = NULL;
 }
 
 /*
@@ -68,7 +70,12 @@ void mac_queue_init()
 void mac_queue_buf_insert(buffer_t *buf)
 {
 	if (buf) {
-		list_add(mac_rx_queue, buf);
+		buf->next = NULL;
+		if (rx_tail)
+			rx_tail->next = buf;
+		else
+			rx_head = buf;
+		rx_tail = buf;
 		debug_dump_buf(buf->dptr, buf->len);
 	}
 }
@@ -80,9 +87,12 @@ buffer_t *mac_queue_buf_pop()
 {
 	buffer_t *tmp;
 
-	tmp = list_head(mac_rx_queue);
+	tmp = rx_head;
 	if (tmp) {
-		list_remove(mac_rx_queue, tmp);
+		rx_head = tmp->next;
+		if (!rx_head)
+			rx_tail = NULL;
+		tmp->next = NULL;
 	}
 	return tmp;
 }
@@ -90,7 +100,7 @@ buffer_t *mac_queue_buf_pop()
 /* Return a pointer to the queue head */
 buffer_t *mac_queue_get_head()
 {
-	return list_head(mac_rx_queue);
+	return rx_head;
 }
 
 /*
@@ -99,16 +109,16 @@ buffer_t *mac_queue_get_head()
  */
 bool mac_queue_is_empty()
 {
-	return (list_head(mac_rx_queue) == NULL);
+	return (rx_head == NULL);
 }
 
 /* Remove all entries from the queue. */
 void mac_queue_clear()
 {
-	buffer_t *buf = list_chop(mac_rx_queue);
+	buffer_t *buf = mac_queue_buf_pop();
 
 	while(buf) {
 		buf_free(buf);
-		buf = list_chop(mac_rx_queue);
+		buf = mac_queue_buf_pop();
 	}
 }
@@ -76,6 +76,7 @@ void mac_reset_req(bool set_default_pib)
 		pib->assoc_permit           = true;
 		pib->max_csma_backoffs      = 3;
 		pib->min_be                 = 3;
+		pib->max_be                 = aMaxBE;
 		pib->dsn                    = (U8)drvr_get_rand();
 
 #if (TEST_SIM)
@@ -56,21 +56,53 @@
  */
 LIST(mac_retry_list);
 
-/* Callback timer for the retry timeout */
+/*
+ * Callback timer for the retry timeout. It's only running while a frame is
+ * waiting for its ack and it's always set to the earliest deadline in the list.
+ */
 static struct ctimer mac_retry_tmr;
 
-/* Timeout value that triggers the callback */
-#define MAC_RETRY_TMR_INCREMENT 100
+/* Check if the deadline of the entry has been reached. Safe across clock wrap. */
+#define MAC_RETRY_DUE(entry, now) \
+	((clock_time_t)((now) - (entry)->deadline) < ((clock_time_t)-1) / 2)
 
-/*
- * Init the retry list (queue) and start the periodic timer. The timer is
- * always running and on each timeout will check the queue and decrement
- * the expiry in any entries in the queue.
- */
+static void mac_retry_expire(void *ptr);
+
+/* Init the retry list (queue). The timer is armed when a frame goes out. */
 void mac_retry_init()
 {
 	list_init(mac_retry_list);
-	ctimer_set(&mac_retry_tmr, MAC_RETRY_TMR_INCREMENT, mac_retry_periodic, NULL);
+	ctimer_stop(&mac_retry_tmr);
+}
+
+/*
+ * Set the retry timer to the earliest deadline of the entries that are
+ * waiting for an ack. If nothing is waiting, then stop the timer.
+ */
+static void mac_retry_arm()
+{
+	mem_ptr_t *mem_ptr;
+	mac_retry_t *entry, *first = NULL;
+	clock_time_t now = clock_time();
+
+	for (mem_ptr = list_head(mac_retry_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	{
+		entry = RETRY_ENTRY(mem_ptr);
+		if (!entry->armed)
+			continue;
+
+		if (!first || (clock_time_t)(entry->deadline - first->deadline) > ((clock_time_t)-1) / 2)
+			first = entry;
+	}
+
+	if (!first) {
+		ctimer_stop(&mac_retry_tmr);
+		return;
+	}
+
+	ctimer_set(&mac_retry_tmr,
+		   MAC_RETRY_DUE(first, now) ? 0 : first->deadline - now,
+		   mac_retry_expire, NULL);
 }
 
 /*
@@ -84,7 +116,7 @@ static mem_ptr_t *mac_retry_alloc()
 	mem_ptr = mem_heap_alloc(sizeof(mac_retry_t));
 	if (mem_ptr) {
 		RETRY_ENTRY(mem_ptr)->retries = aMacMaxFrameRetries;
-		RETRY_ENTRY(mem_ptr)->expiry = aMacAckWaitDuration;
+		RETRY_ENTRY(mem_ptr)->armed = false;
 		list_add(mac_retry_list, mem_ptr);
 	}
 	return mem_ptr;
@@ -92,13 +124,19 @@ static mem_ptr_t *mac_retry_alloc()
 
 /*
  * Remove the retry mem ptr from the list and free the buf. Then free the managed
- * memory.
+ * memory. If the entry was waiting for an ack, the retry timer gets moved
+ * to the next deadline.
  */
 static void mac_retry_free(mem_ptr_t *mem_ptr)
 {
+	bool armed = RETRY_ENTRY(mem_ptr)->armed;
+
 	list_remove(mac_retry_list, mem_ptr);
 	buf_free(RETRY_ENTRY(mem_ptr)->buf);
 	mem_heap_free(mem_ptr);
+
+	if (armed)
+		mac_retry_arm();
 }
 
 /* Clear all retry memory pointers from the retry list */
@@ -161,60 +199,89 @@ void mac_retry_ack_handler(U8 dsn)
 /* Remove the retry entry with the specified dsn from the retry list */
 void mac_retry_rem(U8 dsn)
 {
-	mac_retry_free(mac_retry_find(dsn));
+	mem_ptr_t *mem_ptr;
+
+	if ((mem_ptr = mac_retry_find(dsn)) != NULL)
+		mac_retry_free(mem_ptr);
+}
+
+/*
+ * Check if the frame with the specified dsn is still waiting for its ack.
+ * Once the entry is gone, its buffer has been freed.
+ */
+bool mac_retry_pending(U8 dsn)
+{
+	return (mac_retry_find(dsn) != NULL);
 }
 
 /*
- * The periodic timer decrements the expiry for each entry in the retry queue
- * at a specified interval. When the expiry reaches zero, then this function is
- * called. If the number of retries is still below the maximum, the frame will
- * be re-sent. If the maximum number of retries has been reached, the entry
- * will be freed and a data confirm will be sent to the next higher layer with
- * a status of NO ACK.
+ * The frame with the specified dsn has just gone out on the air. Start the
+ * ack wait for its retry entry. The deadline is set here instead of when the
+ * entry is added because the frame may have to wait for the channel first.
  */
-static void mac_retry_expire(mem_ptr_t *mem_ptr)
+void mac_retry_sent(U8 dsn)
 {
-	RETRY_ENTRY(mem_ptr)->retries--;
+	mem_ptr_t *mem_ptr;
+	mac_pib_t *pib = mac_pib_get();
 
-	if (RETRY_ENTRY(mem_ptr)->retries > 0)
+	if ((mem_ptr = mac_retry_find(dsn)) != NULL)
 	{
-		RETRY_ENTRY(mem_ptr)->expiry = aMacAckWaitDuration;
-		mac_out(RETRY_ENTRY(mem_ptr)->buf,
-				    true,
-				    RETRY_ENTRY(mem_ptr)->dsn,
-				    RETRY_ENTRY(mem_ptr)->handle);
-	} else {
-		mac_data_conf(MAC_NO_ACK, RETRY_ENTRY(mem_ptr)->handle);
-		mac_retry_free(mem_ptr);
+		RETRY_ENTRY(mem_ptr)->armed = true;
+		RETRY_ENTRY(mem_ptr)->deadline = clock_time() + pib->ack_wait_duration;
+		mac_retry_arm();
 	}
 }
 
 /*
- * This is a function that gets called periodically. Its main purpose is to
- * check for expired retry entries and to decrement the expiration times
- * for each of the entries. If an entry is expired, it will be retried or
- * retired based on how many retries are still left for that entry.
+ * The retry timer calls this function when the earliest deadline is reached.
+ * Each entry whose ack wait has run out is handled here. If the number of
+ * retries is still above zero, the frame will be re-sent. If the maximum
+ * number of retries has been reached, the entry will be freed and a data
+ * confirm will be sent to the next higher layer with a status of NO ACK.
+ * If the frame was our association request or the poll for its response,
+ * then the association failed and the next higher layer gets an
+ * association confirm instead so that it can try another parent.
  */
-void mac_retry_periodic(void *ptr)
+static void mac_retry_expire(void *ptr)
 {
-	mem_ptr_t *mem_ptr;
+	mem_ptr_t *mem_ptr, *next;
+	mac_pcb_t *pcb = mac_pcb_get();
+	clock_time_t now = clock_time();
+	U8 dsn, handle;
 
-	for (mem_ptr = list_head(mac_retry_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	for (mem_ptr = list_head(mac_retry_list); mem_ptr != NULL; mem_ptr = next)
 	{
-		/*
-		 * go through the retry list and check for expired entries. if any
-		 * are expired, then process them. otherwise, decrement the expiry.
-		 */
-		if (RETRY_ENTRY(mem_ptr)->expiry == 0) {
-			mac_retry_expire(mem_ptr);
+		next = mem_ptr->next;
+		if (!RETRY_ENTRY(mem_ptr)->armed || !MAC_RETRY_DUE(RETRY_ENTRY(mem_ptr), now))
+			continue;
+
+		RETRY_ENTRY(mem_ptr)->armed = false;
+		RETRY_ENTRY(mem_ptr)->retries--;
+
+		if (RETRY_ENTRY(mem_ptr)->retries > 0)
+		{
+			mac_out(RETRY_ENTRY(mem_ptr)->buf,
+				true,
+				RETRY_ENTRY(mem_ptr)->dsn,
+				RETRY_ENTRY(mem_ptr)->handle);
 		} else {
-			RETRY_ENTRY(mem_ptr)->expiry--;
+			dsn = RETRY_ENTRY(mem_ptr)->dsn;
+			handle = RETRY_ENTRY(mem_ptr)->handle;
+			mac_retry_free(mem_ptr);
+
+			if (((pcb->mac_state == MLME_ASSOC_REQ) || pcb->assoc_poll) &&
+			    (pcb->assoc_req_dsn == dsn))
+			{
+				mac_assoc_fail(MAC_NO_ACK);
+			} else {
+				mac_data_conf(MAC_NO_ACK, handle);
+			}
 		}
 	}
-	ctimer_set(&mac_retry_tmr, MAC_RETRY_TMR_INCREMENT, mac_retry_periodic, NULL);
+	mac_retry_arm();
 }
 
-/* This function just stops the periodic callback timer */
+/* This function just stops the retry callback timer */
 void mac_retry_stop_tmr()
 {
 	ctimer_stop(&mac_retry_tmr);
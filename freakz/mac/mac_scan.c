@@ -59,10 +59,13 @@
  */
 LIST(scan_list);
 
-/* Init the scan descriptor list */
+/* Init the scan descriptor list and stop any energy scan in progress */
 void mac_scan_init()
 {
+	mac_pcb_t *pcb = mac_pcb_get();
+
 	list_init(scan_list);
+	ctimer_stop(&pcb->ed_tmr);
 }
 
 /*
@@ -81,7 +84,7 @@ static mem_ptr_t *mac_scan_alloc()
 }
 
 /* Insert a scan descriptor into the list */
-void mac_scan_descr_add(address_t *src_addr, U16 src_pan_id, U8 channel, U16 superframe_spec)
+void mac_scan_descr_add(address_t *src_addr, U16 src_pan_id, U8 channel, U16 superframe_spec, U8 lqi)
 {
 	mem_ptr_t *mem_ptr;
 
@@ -91,6 +94,7 @@ void mac_scan_descr_add(address_t *src_addr, U16 src_pan_id, U8 channel, U16 sup
 		SCAN_ENTRY(mem_ptr)->superfrm_spec  = superframe_spec;
 		SCAN_ENTRY(mem_ptr)->coord_pan_id   = src_pan_id;
 		SCAN_ENTRY(mem_ptr)->channel        = channel;
+		SCAN_ENTRY(mem_ptr)->link_quality   = lqi;
 	}
 }
 
@@ -175,78 +179,120 @@ U8 *mac_scan_get_energy_list()
 	return pcb->energy_list;
 }
 
+/*
+ * Energy detect sample callback. This gets called by the ed timer every
+ * MAC_ED_SAMPLE_INTERVAL while a channel is being measured. It keeps the
+ * max value that we get. When the measurement time for the channel is up,
+ * an event is posted to the mac process to move on to the next channel.
+ * If the event can't be posted, we just keep sampling and try again on
+ * the next sample.
+ */
+static void mac_scan_ed_sample(void *ptr)
+{
+	U8 curr_ed, i;
+	mac_pcb_t *pcb = mac_pcb_get();
+
+	i = pcb->curr_scan_channel - MAC_PHY_CHANNEL_OFFSET;
+	curr_ed = drvr_get_ed();
+	if (curr_ed > pcb->energy_list[i])
+		pcb->energy_list[i] = curr_ed;
+
+	if (!timer_expired(&pcb->ed_dwell) ||
+	    (process_post(&mac_process, event_mac_scan, NULL) != PROCESS_ERR_OK))
+		ctimer_reset(&pcb->ed_tmr);
+}
+
 /*
  * This is the energy scan function. The channel mask is stored in the MAC
- * protocol control block. The scan function will step through each channel,
- * and if its in the channel mask, then it will take energy measurements on
- * the channel.
- * The energy measurements are taken for a specified interval, which is counted
- * by a timer. The maximum value of the energy measurements is kept. The energy
- * scan measurements are blocking functions, meaning that we stay in this
- * function until all channels are scanned.
+ * protocol control block. The scan will step through each channel, and if its
+ * in the channel mask, then it will take energy measurements on the channel.
+ * The energy measurements are taken for a specified interval and the max
+ * value of the measurements is kept.
+ *
+ * The scan doesn't block. This function just sets up the scan and starts
+ * on the first channel. Each channel is then sampled by the ed timer and
+ * the scan moves on to the next channel through the mac process. The scan
+ * confirm is sent once all channels are scanned, so the rest of the stack
+ * keeps running in the meantime.
+ *
+ * Only one scan can run at a time. If another scan is already running, the
+ * request is turned away with MAC_SCAN_IN_PROGRESS and no scan confirm will
+ * be sent for it. The channel mask and duration are only taken once the scan
+ * is accepted so that the running scan is left alone.
  */
-void mac_scan_energy()
+U8 mac_scan_energy(U32 channel_mask, U8 duration)
 {
-	U8 i, curr_ed;
-	mac_scan_conf_t scan_conf;
 	mac_pcb_t *pcb = mac_pcb_get();
+	mac_pib_t *pib = mac_pib_get();
+
+	if (pcb->mac_state == MLME_SCAN)
+		return MAC_SCAN_IN_PROGRESS;
+
+	pcb->channel_mask	= channel_mask;
+	pcb->duration		= duration;
 
 	/* reset the energy list */
 	memset(pcb->energy_list, 0, sizeof(pcb->energy_list));
 
 	/*
-	 * Check all the channels for the ED scan. First see if its in our
-	 * allowed channels list. If it is, then set a timer, set the
-	 * channel, and then poll the RSSI until the timer expires. Keep
-	 * the max value that we get.
+	 * inform everyone that we are currently scanning and save the
+	 * channel so we can go back to it once the scan is finished.
+	 * the curr scan channel gets incremented before its used so
+	 * start one below the first channel.
 	 */
-	for (i = 0; i < MAC_MAX_CHANNELS; i++)
+	pcb->mac_state		= MLME_SCAN;
+	pcb->ed_orig_channel	= pib->curr_channel;
+	pcb->curr_scan_channel	= MAC_PHY_CHANNEL_OFFSET - 1;
+	mac_scan_energy_next();
+	return MAC_SUCCESS;
+}
+
+/*
+ * Move the energy scan on to the next channel in the channel mask. This is
+ * called from the mac process. If there are no channels left, then the
+ * original channel is restored and the scan confirm is sent.
+ */
+void mac_scan_energy_next()
+{
+	mac_scan_conf_t scan_conf;
+	mac_pcb_t *pcb = mac_pcb_get();
+
+	/* find the next channel that is in the channel mask */
+	for (pcb->curr_scan_channel++;
+	     pcb->curr_scan_channel < (MAC_PHY_CHANNEL_OFFSET + MAC_MAX_CHANNELS);
+	     pcb->curr_scan_channel++)
+	{
+		/*
+		 * this is done on purpose to shift the bitmask to
+		 * the corresponding channel in the channel mask
+		 */
+		if (pcb->channel_mask & (1UL << pcb->curr_scan_channel))
+			break;
+	}
+
+	if (pcb->curr_scan_channel < (MAC_PHY_CHANNEL_OFFSET + MAC_MAX_CHANNELS))
 	{
+		/* set the channel to the current scan channel */
+		mac_set_channel(pcb->curr_scan_channel);
+
 		/*
-		 * check to see if we found a set bit in the channel mask, and
-		 * also that the bit is between 11 and 26
+		 * enable transceiver in receive mode so we can get
+		 * ED measurements
 		 */
-		pcb->curr_scan_channel = i + MAC_PHY_CHANNEL_OFFSET;
+		mac_rx_enb(true, false);
 
 		/*
-		 * this is done on purpose to shift the bitmask to
-		 * the corresponding channel in the channel mask
+		 * start sampling. the ed timer keeps sampling until
+		 * the scan time for this channel is up.
 		 */
-		if (pcb->channel_mask & (1 << pcb->curr_scan_channel))
-		{
-			/* inform everyone that we are currently scanning */
-			pcb->mac_state = MLME_SCAN;
-
-			/* set the channel to the current scan channel */
-			mac_set_channel(pcb->curr_scan_channel);
-
-			/*
-			 * enable transceiver in receive mode so we can get
-			 * ED measurements
-			 */
-			mac_rx_enb(true, false);
-
-			/*
-			 * set the timer so that we know when to stop
-			 * the energy scan
-			 */
-			timer_set(&pcb->mlme_tmr.etimer.timer, MAC_SCAN_TIME(pcb->duration));
-
-			/*
-			 * poll the etimer in a busy wait as we constantly get
-			 * the rssi values. keep the max value that we find.
-			 */
-			while (!timer_expired(&pcb->mlme_tmr.etimer.timer))
-			{
-				curr_ed = drvr_get_ed();
-				if (curr_ed > pcb->energy_list[i])
-					pcb->energy_list[i] = curr_ed;
-			}
-
-			pcb->mac_state = MLME_IDLE;
-		}
+		timer_set(&pcb->ed_dwell, MAC_SCAN_TIME(pcb->duration));
+		ctimer_set(&pcb->ed_tmr, MAC_ED_SAMPLE_INTERVAL, mac_scan_ed_sample, NULL);
+		return;
 	}
 
+	pcb->mac_state = MLME_IDLE;
+	mac_set_channel(pcb->ed_orig_channel);
+
 	/* send scan confirm for energy detect */
 	scan_conf.scan_type	= MAC_ENERGY_SCAN;
 	scan_conf.energy_list	= pcb->energy_list;
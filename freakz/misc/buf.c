@@ -87,6 +87,26 @@ buffer_t *buf_get(U8 tx_rx)
 	return NULL;
 }
 
+/*
+ * Allocate a new buffer and copy the contents of the given buffer into it,
+ * including the data pointer position. Used when the same frame needs to be
+ * handed to more than one owner. Returns NULL if there are no free buffers.
+ */
+buffer_t *buf_dup(const buffer_t *buf)
+{
+	buffer_t *dup;
+
+	if ((dup = buf_get(TX)) == NULL)
+		return NULL;
+
+	memcpy(dup->buf, buf->buf, sizeof(dup->buf));
+	dup->dptr = dup->buf + (buf->dptr - buf->buf);
+	dup->len = buf->len;
+	dup->lqi = buf->lqi;
+
+	return dup;
+}
+
 /* Free a buffer that has been allocated */
 void buf_free(buffer_t *buf)
 {
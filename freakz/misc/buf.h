@@ -88,5 +88,6 @@ typedef struct _buffer_t
 void   buf_init();
 buffer_t *buf_get(U8 tx_rx);
 void buf_free(buffer_t *buf);
+buffer_t *buf_dup(const buffer_t *buf);
 U8 buf_get_cnt();
 #endif // BUF_H
@@ -173,16 +173,13 @@ void debug_dump_nwk_hdr(const nwk_hdr_t *hdr)
 
 	if (hdr->nwk_frm_ctrl.src_rte)
 	{
-		U8 i, relay_cnt, *tmp;
+		U8 i;
 
-		tmp = hdr->src_rte_subfrm;
-		relay_cnt = *tmp;
-		DBG_PRINT("DUMP_NWK_HDR: SRC RTE CNT   = %02X.\n", *tmp++);
-		DBG_PRINT("DUMP_NWK_HDR: SRC RTE INDX  = %02X.\n", *tmp++);
+		DBG_PRINT("DUMP_NWK_HDR: SRC RTE CNT   = %02X.\n", hdr->relay_cnt);
+		DBG_PRINT("DUMP_NWK_HDR: SRC RTE INDX  = %02X.\n", hdr->relay_idx);
 
-		relay_cnt = *hdr->src_rte_subfrm;
-		for (i = 0; i < relay_cnt; i++)
-			DBG_PRINT("DUMP_NWK_HDR: SRC RTE LIST %d = %04X.\n", i, *(U16 *)(tmp + (i<<1)));
+		for (i = 0; i < hdr->relay_cnt; i++)
+			DBG_PRINT("DUMP_NWK_HDR: SRC RTE LIST %d = %04X.\n", i, hdr->relay_list[i]);
 	}
 #endif
 }
@@ -286,6 +283,35 @@ void debug_dump_nwk_cmd(nwk_cmd_t *cmd)
 		DBG_PRINT("DUMP_NWK_CMD: REM CHILDREN   = %s.\n",
 			  (cmd->leave.cmd_opts & (1 << NWK_LEAVE_REM_CHILDREN_OFFSET)) ? "TRUE" : "FALSE");
 		break;
+	case NWK_CMD_NWK_STATUS:
+		DBG_PRINT("DUMP_NWK_CMD: CMD FRAME ID   = NETWORK STATUS.\n");
+		DBG_PRINT("DUMP_NWK_CMD: STATUS CODE    = %02X.\n", cmd->status.status_code);
+		DBG_PRINT("DUMP_NWK_CMD: DESTINATION    = %04X.\n", cmd->status.dest_addr);
+		break;
+	case NWK_CMD_RTE_REC:
+	{
+		U8 i;
+
+		DBG_PRINT("DUMP_NWK_CMD: CMD FRAME ID   = ROUTE RECORD.\n");
+		DBG_PRINT("DUMP_NWK_CMD: RELAY CNT      = %02X.\n", cmd->rte_rec.relay_cnt);
+		for (i = 0; i < cmd->rte_rec.relay_cnt; i++)
+			DBG_PRINT("DUMP_NWK_CMD: RELAY %d        = %04X.\n", i, cmd->rte_rec.relay_list[i]);
+		break;
+	}
+	case NWK_CMD_LINK_STATUS:
+	{
+		U8 i, cnt = cmd->link_status.cmd_opts & NWK_LINK_STATUS_CNT_MASK;
+
+		DBG_PRINT("DUMP_NWK_CMD: CMD FRAME ID   = LINK STATUS.\n");
+		DBG_PRINT("DUMP_NWK_CMD: CMD OPTIONS    = %02X.\n", cmd->link_status.cmd_opts);
+		for (i = 0; (i < cnt) && (i < NWK_MAX_LINK_STATUS_ENTRIES); i++)
+			DBG_PRINT("DUMP_NWK_CMD: LINK %04X      = IN %d OUT %d.\n",
+				  cmd->link_status.nbor_addr[i],
+				  cmd->link_status.link_status[i] & NWK_LINK_STATUS_IN_COST_MASK,
+				  (cmd->link_status.link_status[i] >> NWK_LINK_STATUS_OUT_COST_OFFSET) &
+				  NWK_LINK_STATUS_IN_COST_MASK);
+		break;
+	}
 	}
 #endif
 }
@@ -438,6 +464,16 @@ void debug_dump_nbor_tbl()
 			  i, NBOR_ENTRY(mem_ptr)->transmit_fail);
 		DBG_PRINT("NBOR ENTRY %02X: LQI           = %02X.\n",
 			  i, NBOR_ENTRY(mem_ptr)->lqi);
+		DBG_PRINT("NBOR ENTRY %02X: ETX           = %02X.\n",
+			  i, NBOR_ENTRY(mem_ptr)->etx);
+		DBG_PRINT("NBOR ENTRY %02X: IN COST       = %02X.\n",
+			  i, nwk_neighbor_tbl_get_in_cost(mem_ptr));
+		DBG_PRINT("NBOR ENTRY %02X: OUT COST      = %02X.\n",
+			  i, NBOR_ENTRY(mem_ptr)->out_cost);
+		DBG_PRINT("NBOR ENTRY %02X: LINK COST     = %02X.\n",
+			  i, nwk_neighbor_tbl_get_link_cost(NBOR_ENTRY(mem_ptr)->nwk_addr, 0));
+		DBG_PRINT("NBOR ENTRY %02X: AGE           = %02X.\n",
+			  i, NBOR_ENTRY(mem_ptr)->age);
 		DBG_PRINT("\n");
 		i++;
 	}
@@ -506,12 +542,30 @@ void debug_dump_rte_tbl()
 
 	for (mem_ptr = nwk_rte_tbl_get_head(); mem_ptr != NULL; mem_ptr = mem_ptr->next)
 	{
-		DBG_PRINT("RTE ENTRY %02X: DEST ADDR      = %04X.\n",
-			  i, RTE_ENTRY(mem_ptr)->dest_addr);
+		DBG_PRINT("RTE ENTRY %02X: DEST ADDR      = %04X%s.\n",
+			  i, RTE_ENTRY(mem_ptr)->dest_addr, RTE_ENTRY(mem_ptr)->grp_id ? " (GROUP)" : "");
 		DBG_PRINT("RTE ENTRY %02X: NEXT HOP       = %04X.\n",
 			  i, RTE_ENTRY(mem_ptr)->next_hop);
 		DBG_PRINT("RTE ENTRY %02X: STATUS         = %s.\n",
 			  i, debug_dump_nwk_status(RTE_ENTRY(mem_ptr)->status));
+		if (RTE_ENTRY(mem_ptr)->many_to_one)
+			DBG_PRINT("RTE ENTRY %02X: MANY TO ONE    = %s.\n",
+				  i, RTE_ENTRY(mem_ptr)->rte_rec_req ? "RTE REC PENDING" : "TRUE");
+		i++;
+	}
+
+	i = 0;
+	for (mem_ptr = nwk_rte_src_get_head(); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	{
+		U8 j;
+
+		DBG_PRINT("SRC RTE %02X: DEST ADDR        = %04X.\n",
+			  i, SRC_RTE_ENTRY(mem_ptr)->dest_addr);
+		DBG_PRINT("SRC RTE %02X: RELAY CNT        = %02X.\n",
+			  i, SRC_RTE_ENTRY(mem_ptr)->relay_cnt);
+		for (j = 0; j < SRC_RTE_ENTRY(mem_ptr)->relay_cnt; j++)
+			DBG_PRINT("SRC RTE %02X: RELAY %d          = %04X.\n",
+				  i, j, SRC_RTE_ENTRY(mem_ptr)->relay_list[j]);
 		i++;
 	}
 #endif
@@ -521,29 +575,36 @@ void debug_dump_rte_tbl()
 void debug_dump_bnd_tbl()
 {
 #if (DEBUG_APS == 1)
-	U8 i = 0;
-	mem_ptr_t *mem_ptr;
+	U8 i, j = 0;
+	aps_bind_t *entry;
+	aps_bind_dest_t *dest;
 
-	for (mem_ptr = aps_bind_get_head(); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	for (i = 0; i < APS_BIND_MAX_KEYS; i++)
 	{
-		DBG_PRINT("BIND ENTRY %02X: SRC EP        = %02X.\n",
-			  i, BIND_ENTRY(mem_ptr)->src_ep);
-		DBG_PRINT("BIND ENTRY %02X: CLUST ID      = %04X.\n",
-			  i, BIND_ENTRY(mem_ptr)->clust);
-		DBG_PRINT("BIND ENTRY %02X: DEST ADDR MDE = %s.\n",
-			  i, (BIND_ENTRY(mem_ptr)->dest_addr.mode == SHORT_ADDR) ?
-			  "SHORT ADDR" : "LONG ADDR");
-		if (BIND_ENTRY(mem_ptr)->dest_addr.mode == SHORT_ADDR) {
-			DBG_PRINT("BIND ENTRY %02X: DEST ADDR     = %04X.\n",
-				  i, BIND_ENTRY(mem_ptr)->dest_addr.short_addr);
-		} else {
-			DBG_PRINT("BIND_ENTRY %02X: DEST_ADDR     = %016lu.\n",
-				  i, BIND_ENTRY(mem_ptr)->dest_addr.long_addr);
-		}
+		if ((entry = aps_bind_get_entry(i)) == NULL)
+			continue;
 
-		DBG_PRINT("BIND ENTRY %02X: DEST EP       = %02X.\n",
-			  i, BIND_ENTRY(mem_ptr)->dest_ep);
-		i++;
+		for (dest = entry->dest; dest != NULL; dest = dest->next)
+		{
+			DBG_PRINT("BIND ENTRY %02X: SRC EP        = %02X.\n",
+				  j, entry->src_ep);
+			DBG_PRINT("BIND ENTRY %02X: CLUST ID      = %04X.\n",
+				  j, entry->clust);
+			DBG_PRINT("BIND ENTRY %02X: DEST ADDR MDE = %s.\n",
+				  j, (dest->dest_addr.mode == SHORT_ADDR) ? "SHORT ADDR" :
+				  (dest->dest_addr.mode == BIND_GRP_ADDR) ? "GROUP ADDR" : "LONG ADDR");
+			if (dest->dest_addr.mode == LONG_ADDR) {
+				DBG_PRINT("BIND_ENTRY %02X: DEST_ADDR     = %016lu.\n",
+					  j, dest->dest_addr.long_addr);
+			} else {
+				DBG_PRINT("BIND ENTRY %02X: DEST ADDR     = %04X.\n",
+					  j, dest->dest_addr.short_addr);
+			}
+
+			DBG_PRINT("BIND ENTRY %02X: DEST EP       = %02X.\n",
+				  j, dest->dest_ep);
+			j++;
+		}
 	}
 #endif
 }
@@ -552,17 +613,103 @@ void debug_dump_bnd_tbl()
 void debug_dump_grp_tbl()
 {
 #if (DEBUG_APS == 1)
-	U8 i = 0;
-	mem_ptr_t *mem_ptr;
+	U8 i, ep, j = 0;
+	aps_grp_t *grp;
 
-	for (mem_ptr = aps_grp_get_head(); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	for (i = 0; i < APS_GRP_TBL_SIZE; i++)
 	{
-		DBG_PRINT("GROUP ENTRY %02X: GRP ID       = %04X.\n",
-			  i, GROUP_ENTRY(mem_ptr)->id);
-		DBG_PRINT("GROUP ENTRY %02X: EP           = %02X.\n",
-			  i, GROUP_ENTRY(mem_ptr)->ep);
-		i++;
+		if ((grp = aps_grp_get_entry(i)) == NULL)
+			continue;
+
+		for (ep = 0; ep < (APS_GRP_EP_MAP_SIZE * 8); ep++)
+		{
+			if (!(grp->ep_map[ep / 8] & (1 << (ep % 8))))
+				continue;
+
+			DBG_PRINT("GROUP ENTRY %02X: GRP ID       = %04X.\n",
+				  j, grp->id);
+			DBG_PRINT("GROUP ENTRY %02X: EP           = %02X.\n",
+				  j, ep);
+			j++;
+		}
+	}
+#endif
+}
+
+#if PROCESS_CONF_PROFILE
+/* Print the non-empty buckets of a profile histogram on one line */
+static void debug_dump_proc_hist(const char *label, const unsigned long *hist)
+{
+	U8 i;
+
+	DBG_PRINT("PROC_PROF:   %s:", label);
+	for (i=0; i<PROCESS_PROFILE_BUCKETS; i++)
+	{
+		if (hist[i])
+			DBG_PRINT_RAW(" %s%lu=%lu", (i == PROCESS_PROFILE_BUCKETS - 1) ? ">=" : "<",
+				      (i == PROCESS_PROFILE_BUCKETS - 1) ? 1UL << (i - 1) : 1UL << i,
+				      hist[i]);
+	}
+	DBG_PRINT_RAW("\n");
+}
+
+/* Print the histogram buckets separated by semicolons */
+static void debug_dump_proc_hist_raw(const unsigned long *hist)
+{
+	U8 i;
+
+	for (i=0; i<PROCESS_PROFILE_BUCKETS; i++)
+		DBG_PRINT_RAW("%s%lu", i ? ";" : "", hist[i]);
+}
+#endif
+
+/*
+ * Print the scheduler profile of each process. The normal dump shows the
+ * averages and histograms in microseconds. Processes with dispatches over
+ * PROCESS_CONF_PROFILE_SLOW get flagged. The raw dump is one comma separated
+ * line per process, with the histogram buckets separated by semicolons.
+ */
+void debug_dump_proc_prof(bool raw)
+{
+#if PROCESS_CONF_PROFILE
+	struct process *p;
+	struct process_profile *prof;
+
+	if (raw)
+		DBG_PRINT_RAW("PROF,name,dispatches,slow,run_total,run_max,wait_total,wait_max,run_hist,wait_hist\n");
+
+	for (p = PROCESS_LIST(); p != NULL; p = p->next)
+	{
+		prof = &p->prof;
+		if (raw)
+		{
+			DBG_PRINT_RAW("PROF,%s,%lu,%lu,%llu,%lu,%llu,%lu,",
+				      PROCESS_NAME_STRING(p), prof->dispatches, prof->slow,
+				      prof->run_total, prof->run_max,
+				      prof->wait_total, prof->wait_max);
+			debug_dump_proc_hist_raw(prof->run_hist);
+			DBG_PRINT_RAW(",");
+			debug_dump_proc_hist_raw(prof->wait_hist);
+			DBG_PRINT_RAW("\n");
+			continue;
+		}
+
+		DBG_PRINT("PROC_PROF: %s%s\n", PROCESS_NAME_STRING(p),
+			  prof->slow ? " <-- SLOW" : "");
+		DBG_PRINT("PROC_PROF:   DISPATCHES = %lu, SLOW = %lu.\n",
+			  prof->dispatches, prof->slow);
+		if (!prof->dispatches)
+			continue;
+
+		DBG_PRINT("PROC_PROF:   RUN  AVG = %llu us, MAX = %lu us.\n",
+			  prof->run_total / prof->dispatches, prof->run_max);
+		DBG_PRINT("PROC_PROF:   WAIT AVG = %llu us, MAX = %lu us.\n",
+			  prof->wait_total / prof->dispatches, prof->wait_max);
+		debug_dump_proc_hist("RUN  us", prof->run_hist);
+		debug_dump_proc_hist("WAIT us", prof->wait_hist);
 	}
+#else
+	DBG_PRINT("PROC_PROF: Profiling is disabled.\n");
 #endif
 }
 
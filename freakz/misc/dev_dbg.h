@@ -111,6 +111,7 @@ void debug_dump_nbor_tbl();
 void debug_dump_rte_tbl();
 void debug_dump_bnd_tbl();
 void debug_dump_grp_tbl();
+void debug_dump_proc_prof(bool raw);
 void debug_dump_simple_desc(U8 *desc);
 void debug_dump_clust_list(clust_list_t *clust_list);
 void debug_dump_zdo_request(zdo_req_t *req);
@@ -105,10 +105,14 @@ mem_ptr_t *mem_heap_alloc(U8 size)
 	return NULL;
 }
 
-/* Free the managed memory and then de-allocated the memory pointer */
+/*
+ * Free the managed memory and then de-allocated the memory pointer. Any
+ * timer that was running on the entry gets stopped with it.
+ */
 void mem_heap_free(mem_ptr_t *mem_ptr)
 {
 	if (mem_ptr) {
+		slow_tmr_stop(&mem_ptr->tmr);
 		mmem_free(&mem_ptr->mmem_ptr);
 		mem_ptr->alloc = false;
 	}
@@ -42,6 +42,7 @@
 #define MEM_HEAP_H
 
 #include "mmem.h"
+#include "slow_clock.h"
 
 #define MAX_MEM_PTR_POOL 30             ///< Define the number of mem pointers here
 
@@ -49,12 +50,15 @@
  * Memory pointer structure - This is the structure that will go into all
  * the tables and lists, and is a generic handle to the underlying memory.
  * You will need to access this structure via the pre-defined handle names.
+ * The slow timer lives in the handle rather than the memory block since the
+ * handle doesn't move when the heap gets compacted.
  */
 typedef struct _mem_ptr_t
 {
 	struct _mem_ptr_t *next;
 	bool alloc;
 	struct mmem mmem_ptr;
+	slow_tmr_t tmr;
 } mem_ptr_t;
 
 void mem_heap_init();
@@ -44,20 +44,6 @@
 
 #include "freakz.h"
 
-/* Just your ol' everyday software timer used for a busy wait */
-static struct timer tmr;
-
-/*
- * Perform a busy wait. This wait hogs the CPU while waiting so it shouldn't
- * be used for long periods or too often. The argument is in milliseconds.
- */
-void busy_wait(U16 msec)
-{
-	timer_set(&tmr, msec);
-	while (!timer_expired(&tmr))
-		;
-}
-
 #if (TEST_SIM == 1)
 /*
  * This function is a compile option only if in simulator mode. It adds a
@@ -44,8 +44,6 @@
 #ifndef MISC_H
 #define MISC_H
 
-void busy_wait(U16 msec);
-
 #if (TEST_SIM == 1)
 void format_cmd_str(U8 *msg);
 #endif // TEST_SIM
@@ -38,60 +38,159 @@
     \ingroup misc
     \brief Slow 1 second clock
 
-    The purpose of these functions is to create a slow clock to be used
-    by the tables that require periodic but slow checking.
+    The slow clock drives all of the table timeouts in the stack. Each table
+    entry that needs to expire arms a slow timer when it's created and stops
+    it when it's freed. The timers are kept in a hashed timer wheel with one
+    slot per second so the work done on each tick only depends on how many
+    timers land in the current slot, not on the size of the tables.
 */
 #include "freakz.h"
-#include "zcl_id.h"
 
 /* Callback timer for the slow clock. This is the main timer that drives it */
 static struct ctimer slow_clk;
 
 /*
- * These are the callbacks for the slow clock to call every second. The
- * slow clock is used because it saves space from having a dedicated timer
- * for each of these functions. Instead, it's just a free running 1 second timer
- * that will call each of these functions every second. Since it is only
- * used for slow operations, it won't affect performance to call all these
- * functions every second.
+ * Timer wheel. Each slot holds a list of the timers that expire when the
+ * wheel position comes around to it. Timers further out than one turn of
+ * the wheel have their rounds count decremented each time their slot is
+ * passed over.
  */
-static void (*timeouts[])(void) =
+static slow_tmr_t *wheel[SLOW_CLOCK_WHEEL_SIZE];
+
+/* Timers that expired on the current tick and are waiting for their callbacks */
+static slow_tmr_t *fire_list;
+
+/* Current position of the wheel */
+static U8 wheel_pos;
+
+/* Number of timers that are armed */
+static U16 tmr_cnt;
+
+/* Flag to indicate that the 1 second tick is running */
+static bool running;
+
+/* Link a timer into the head of a list */
+static void slow_tmr_link(slow_tmr_t **list, slow_tmr_t *tmr)
+{
+	tmr->list = list;
+	tmr->prev = NULL;
+	tmr->next = *list;
+	if (*list)
+		(*list)->prev = tmr;
+	*list = tmr;
+}
+
+/* Unlink a timer from whatever list it's in */
+static void slow_tmr_unlink(slow_tmr_t *tmr)
 {
-	af_conf_tbl_periodic,
-	aps_dupe_periodic,
-	aps_retry_periodic,
-	nwk_brc_periodic,
-	nwk_pend_periodic,
-	nwk_rte_disc_periodic,
-	mac_indir_periodic,
-	zdo_nwk_mgr_periodic,
-	zcl_rpt_periodic,
-	zcl_id_tmr_periodic,
-	NULL
-};
-
-/* Initialize the slow clock */
+	if (tmr->prev)
+		tmr->prev->next = tmr->next;
+	else
+		*tmr->list = tmr->next;
+
+	if (tmr->next)
+		tmr->next->prev = tmr->prev;
+
+	tmr->list = NULL;
+	tmr->next = tmr->prev = NULL;
+}
+
+/* Start the 1 second tick if it's not already running */
+static void slow_clock_start()
+{
+	if (!running) {
+		running = true;
+		ctimer_set(&slow_clk, CLOCK_SECOND, slow_clock_periodic, NULL);
+	}
+}
+
+/*
+ * Initialize the slow clock. The tick only runs while there are timers
+ * armed so we just need to restart it if anyone is waiting.
+ */
 void slow_clock_init()
 {
-	slow_clock_periodic(NULL);
+	running = false;
+	if (tmr_cnt)
+		slow_clock_start();
 }
 
 /* Turn off the slow clock */
 void slow_clock_stop()
 {
 	ctimer_stop(&slow_clk);
+	running = false;
+}
+
+/*
+ * Arm a slow timer to call the callback after the specified number of
+ * seconds. The resolution is one slow clock tick so a timeout of zero gets
+ * rounded up to the next tick. If the timer is already armed, it will be
+ * re-armed with the new timeout.
+ */
+void slow_tmr_set(slow_tmr_t *tmr, U16 secs, void (*callback)(void *), void *ptr)
+{
+	if (slow_tmr_active(tmr))
+		slow_tmr_unlink(tmr);
+	else
+		tmr_cnt++;
+
+	if (secs == 0)
+		secs = 1;
+
+	tmr->callback	= callback;
+	tmr->ptr	= ptr;
+	tmr->rounds	= (secs - 1) >> SLOW_CLOCK_WHEEL_BITS;
+	slow_tmr_link(&wheel[(wheel_pos + secs) & SLOW_CLOCK_WHEEL_MASK], tmr);
+	slow_clock_start();
+}
+
+/* Stop a slow timer. It's okay to call this on a timer that isn't armed. */
+void slow_tmr_stop(slow_tmr_t *tmr)
+{
+	if (slow_tmr_active(tmr)) {
+		slow_tmr_unlink(tmr);
+		tmr_cnt--;
+	}
+}
+
+/* Check if the slow timer is armed */
+bool slow_tmr_active(const slow_tmr_t *tmr)
+{
+	return (tmr->list != NULL);
 }
 
 /*
- * This function gets called every second and will handle the timeouts for
- * all functions that require a slow clock.
+ * This function gets called every second while there are timers armed. It
+ * advances the wheel by one slot and collects the timers in that slot that
+ * are on their last round. The callbacks are only made after the slot has
+ * been walked since they are allowed to set and stop other timers, including
+ * the ones in the fire list which is why each timer stays linked until its
+ * callback is made.
  */
 void slow_clock_periodic(void *ptr)
 {
-	U8 i;
+	slow_tmr_t *tmr, *next;
+
+	running = false;
+	wheel_pos = (wheel_pos + 1) & SLOW_CLOCK_WHEEL_MASK;
+
+	for (tmr = wheel[wheel_pos]; tmr != NULL; tmr = next) {
+		next = tmr->next;
+		if (tmr->rounds) {
+			tmr->rounds--;
+		} else {
+			slow_tmr_unlink(tmr);
+			slow_tmr_link(&fire_list, tmr);
+		}
+	}
 
-	for (i=0; timeouts[i] != NULL; i++)
-		timeouts[i]();
+	while ((tmr = fire_list) != NULL) {
+		slow_tmr_unlink(tmr);
+		tmr_cnt--;
+		tmr->callback(tmr->ptr);
+	}
 
-	ctimer_set(&slow_clk, CLOCK_SECOND, slow_clock_periodic, NULL);
+	if (tmr_cnt)
+		slow_clock_start();
 }
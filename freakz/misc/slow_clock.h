@@ -44,11 +44,44 @@
 #ifndef SLOW_CLOCK_H
 #define SLOW_CLOCK_H
 
-#include "freakz.h"
+#include "types.h"
+
+/* Number of slots in the timer wheel. Must be a power of 2. */
+#define SLOW_CLOCK_WHEEL_BITS	5
+#define SLOW_CLOCK_WHEEL_SIZE	(1 << SLOW_CLOCK_WHEEL_BITS)
+#define SLOW_CLOCK_WHEEL_MASK	(SLOW_CLOCK_WHEEL_SIZE - 1)
+
+/* Convert clock ticks to slow clock seconds, rounding up */
+#define SLOW_CLOCK_SECS(ticks)	(((ticks) + CLOCK_SECOND - 1) / CLOCK_SECOND)
+
+/*
+ * Slow timer. These get linked into the slot of the timer wheel that
+ * they expire in. If the timeout is longer than one turn of the wheel,
+ * then rounds holds the number of extra turns left to go. A timer
+ * that is not linked into any list is inactive.
+ *
+ * next, prev: Links to the other timers in the same slot
+ * list: Head of the list that the timer is linked into
+ * rounds: Number of full turns of the wheel left before expiring
+ * callback: Function to call on expiration
+ * ptr: Argument for the callback
+ */
+typedef struct _slow_tmr_t
+{
+	struct _slow_tmr_t	*next;
+	struct _slow_tmr_t	*prev;
+	struct _slow_tmr_t	**list;
+	U16			rounds;
+	void			(*callback)(void *ptr);
+	void			*ptr;
+} slow_tmr_t;
 
 void slow_clock_init();
 void slow_clock_stop();
 void slow_clock_periodic(void *ptr);
+void slow_tmr_set(slow_tmr_t *tmr, U16 secs, void (*callback)(void *), void *ptr);
+void slow_tmr_stop(slow_tmr_t *tmr);
+bool slow_tmr_active(const slow_tmr_t *tmr);
 
 #endif
 
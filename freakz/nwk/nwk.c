@@ -79,6 +79,9 @@ static nwk_pcb_t pcb;
 /* NWK information base instantiation */
 static nwk_nib_t nib;
 
+/* Last handle given to a relayed frame */
+static U8 relay_handle;
+
 /*
  * Init the NWK protocol control block, the NWK capability info, set the
  * NWK info base to default values, and init the rest of the components
@@ -110,7 +113,7 @@ void nwk_init()
 	nib.capability_info         = nwk_gen_capab_info(&info);
 	nib.seq_num                 = (U8)drvr_get_rand();
 	nib.rreq_id                 = (U8)drvr_get_rand();
-	nib.report_const_cost       = true;
+	nib.report_const_cost       = false;
 	nib.traxn_persist_time      = 10;
 	nib.short_addr              = 0xFFFF;
 	nib.stack_profile           = ZIGBEE_STACK_PROFILE;
@@ -121,12 +124,20 @@ void nwk_init()
 	nib.ed_cap                  = nib.max_children - nib.max_routers;
 	nib.dev_type                = ZIGBEE_DEVICE_TYPE;
 	nib.joined                  = false;
+	nib.is_concentrator         = false;
+	nib.concentrator_radius     = ZIGBEE_CONCENTRATOR_RADIUS;
+	nib.concentrator_disc_time  = ZIGBEE_CONCENTRATOR_DISC_TIME;
+	nib.link_status_period      = NWK_LINK_STATUS_PERIOD;
+	nib.router_age_limit        = NWK_ROUTER_AGE_LIMIT;
+	nib.brc_trickle             = ZIGBEE_BRC_TRICKLE;
+	nib.local_repair            = ZIGBEE_LOCAL_REPAIR;
 
 	nwk_rte_mesh_init();
 	nwk_rte_tree_init();
 	nwk_neighbor_tbl_init();
 	nwk_rte_disc_tbl_init();
 	nwk_rte_tbl_init();
+	nwk_rte_src_init();
 	nwk_pend_init();
 	nwk_brc_init();
 	nwk_addr_map_init();
@@ -144,6 +155,17 @@ nwk_nib_t *nwk_nib_get()
 	return &nib;
 }
 
+/*
+ * Return the next handle for a relayed frame. These come out of the range
+ * from NWK_RELAY_HANDLE_BASE up which the AF never hands out.
+ */
+static U8 nwk_relay_handle_get()
+{
+	if (++relay_handle < NWK_RELAY_HANDLE_BASE)
+		relay_handle = NWK_RELAY_HANDLE_BASE;
+	return relay_handle;
+}
+
 /*
  * This is the nwk data request service that receives an APS frame
  * and slaps on a NWK header. If the frame is meant to be broadcasted,
@@ -165,6 +187,13 @@ void nwk_data_req(const nwk_data_req_t *req)
 	nwk_hdr.radius                      = req->radius;
 	nwk_hdr.handle                      = req->nsdu_handle;
 
+	/* multicast frames have their own rules for how far they spread */
+	if (req->nwk_dest_addr_mode == NWK_TX_MCAST_ADDR)
+	{
+		nwk_mcast_data_req(req->buf, &nwk_hdr, req->non_memb_radius);
+		return;
+	}
+
 	/*
 	 * if this is a brc frame that we're originating,
 	 * we need to add it to the brc table.
@@ -176,8 +205,8 @@ void nwk_data_req(const nwk_data_req_t *req)
 		 * brc transmission procedure
 		 */
 		nwk_hdr.nwk_frm_ctrl.disc_route = false;
-		if (nwk_brc_start(req->buf, &nwk_hdr) != NWK_SUCCESS)
-			return;
+		nwk_brc_start(req->buf, &nwk_hdr);
+		return;
 	}
 
 	/* send it to the fwd function for processing and possible routing */
@@ -196,9 +225,7 @@ static void nwk_tx(buffer_t *buf, nwk_hdr_t *hdr, bool indirect)
 
 	/* finish filling out the nwk hdr and generate it */
 	hdr->nwk_frm_ctrl.protocol_ver          = ZIGBEE_PROTOCOL_VERSION;
-	hdr->nwk_frm_ctrl.mcast_flag            = false;        // multicast not supported
 	hdr->nwk_frm_ctrl.security              = false;
-	hdr->nwk_frm_ctrl.src_rte               = false;
 	hdr->nwk_frm_ctrl.dest_ieee_addr_flag   = false;
 	hdr->nwk_frm_ctrl.src_ieee_addr_flag    = false;
 
@@ -221,6 +248,10 @@ static void nwk_tx(buffer_t *buf, nwk_hdr_t *hdr, bool indirect)
 	req.tx_options = (req.dest_addr.short_addr != 0xFFFF) ? MAC_ACK_REQUEST : 0x0;
 	req.tx_options |= indirect ? MAC_INDIRECT_TRANS : 0x0;
 
+	/* direct unicasts feed the ETX of the link when the confirm comes back */
+	if (req.tx_options == MAC_ACK_REQUEST)
+		nwk_neighbor_tbl_tx_track(req.dest_addr.short_addr, req.msdu_handle, hdr);
+
 	/* kick it to the curb! */
 	mac_data_req(&req);
 }
@@ -230,11 +261,14 @@ static void nwk_tx(buffer_t *buf, nwk_hdr_t *hdr, bool indirect)
  * either the data request or the data indication functions (if the dest address
  * is not for this node). It will look at the dest address and determine
  * how this frame should be transmitted. The forwarding choices are:
- * 1) broadcast
- * 2) neighbor table   (the dest is a neighbor of ours)
- * 3) routing table    (the route path exists)
- * 4) route discovery  (the route path does not exist but mesh routing is okay)
- * 5) tree             (none of the above and the route discovery flag is disabled)
+ * 1) broadcast        (also member mode multicast)
+ * 2) multicast        (non-member mode. unicast towards a member of the group)
+ * 3) source route     (we're a relay in the frame's source route)
+ * 4) neighbor table   (the dest is a neighbor of ours)
+ * 5) source route     (we're a concentrator with a route record for the dest)
+ * 6) routing table    (the route path exists)
+ * 7) route discovery  (the route path does not exist but mesh routing is okay)
+ * 8) tree             (none of the above and the route discovery flag is disabled)
  */
 void nwk_fwd(buffer_t *buf, nwk_hdr_t *hdr_in)
 {
@@ -245,12 +279,21 @@ void nwk_fwd(buffer_t *buf, nwk_hdr_t *hdr_in)
 	address_t dest_addr;
 	mem_ptr_t *nbor_mem_ptr;
 
+	/*
+	 * a frame that we relay gets a handle of our own so that its
+	 * MAC confirm doesn't get mixed up with one of the app's frames.
+	 */
+	if (hdr_in->src_addr != nib.short_addr)
+		hdr_in->handle = nwk_relay_handle_get();
+
 	hdr_out.mac_hdr         = &mac_hdr_out;
 	dest_addr.mode          = SHORT_ADDR;
 	dest_addr.short_addr    = hdr_in->dest_addr;
 
 	/* is it a broadcast? */
-	if ((hdr_in->dest_addr & NWK_BROADCAST_MASK) == 0xFFF0)
+	if (((hdr_in->dest_addr & NWK_BROADCAST_MASK) == 0xFFF0) ||
+	    (hdr_in->nwk_frm_ctrl.mcast_flag &&
+	     (NWK_MCAST_MODE(hdr_in->mcast_ctrl) == NWK_MCAST_MEMBER_MODE)))
 	{
 		/*
 		 * the buffer data ptr (dptr) is pointing to the nwk
@@ -269,6 +312,50 @@ void nwk_fwd(buffer_t *buf, nwk_hdr_t *hdr_in)
 		 */
 		hdr_out.mac_hdr->dest_addr.short_addr       = MAC_BROADCAST_ADDR;
 		hdr_out.src_addr                            = hdr_in->src_addr;
+	} else if (hdr_in->nwk_frm_ctrl.mcast_flag) {
+		/*
+		 * a non-member sent this multicast. the dest is a group ID so
+		 * the neighbor table and tree don't apply. send it along the
+		 * route to the closest member we know of, or go look for one.
+		 */
+		if ((next_hop = nwk_rte_tbl_get_next_hop(hdr_in->dest_addr, true)) == INVALID_NWK_ADDR)
+		{
+			if (hdr_in->nwk_frm_ctrl.disc_route && (nib.dev_type != NWK_END_DEVICE))
+			{
+				nwk_pend_add_new(buf, hdr_in);
+				nwk_rte_mesh_disc_start(hdr_in->dest_addr, true);
+				return;
+			}
+
+			/*
+			 * no way to find a member. broadcast it in member
+			 * mode instead and let the non-member radius keep
+			 * it from spreading too far.
+			 */
+			hdr_in->mcast_ctrl = (hdr_in->mcast_ctrl & ~NWK_MCAST_MODE_MASK) | NWK_MCAST_MEMBER_MODE;
+			next_hop = MAC_BROADCAST_ADDR;
+		}
+
+		/* its okay since we're subtracting a value from a constant */
+		buf->len = aMaxPHYPacketSize - (buf->dptr - buf->buf);
+
+		hdr_out.mac_hdr->dest_addr.short_addr       = next_hop;
+		hdr_out.src_addr                            = hdr_in->src_addr;
+	} else if (hdr_in->nwk_frm_ctrl.src_rte) {
+		/* we're a relay in the source route. follow the relay list. */
+		if ((next_hop = nwk_rte_src_next_relay(hdr_in)) == INVALID_NWK_ADDR)
+		{
+			pcb.failed_transfer++;
+			nwk_status_rte_fail(hdr_in, NWK_STATUS_SRC_RTE_FAIL);
+			buf_free(buf);
+			return;
+		}
+
+		/* its okay since we're subtracting a value from a constant */
+		buf->len = aMaxPHYPacketSize - (buf->dptr - buf->buf);
+
+		hdr_out.mac_hdr->dest_addr.short_addr       = next_hop;
+		hdr_out.src_addr                            = hdr_in->src_addr;
 	} else if ((nbor_mem_ptr = nwk_neighbor_tbl_get_entry(&dest_addr)) != NULL) {
 		/* is the dest in our neighbor table? */
 
@@ -290,9 +377,26 @@ void nwk_fwd(buffer_t *buf, nwk_hdr_t *hdr_in)
 		/* set the mac dest addr to the neighbor address */
 		hdr_out.mac_hdr->dest_addr.short_addr       = hdr_in->dest_addr;
 		hdr_out.src_addr                            = hdr_in->src_addr;
-	} else if ((next_hop = nwk_rte_tbl_get_next_hop(hdr_in->dest_addr)) != INVALID_NWK_ADDR) {
+	} else if ((hdr_in->src_addr == nib.short_addr) && nwk_rte_src_set_hdr(hdr_in, &next_hop)) {
+		/*
+		 * we're a concentrator and got a route record from the dest.
+		 * the relay list is in the nwk hdr now. send it to the first relay.
+		 */
+		buf->len = aMaxPHYPacketSize - (buf->dptr - buf->buf);
+
+		hdr_out.mac_hdr->dest_addr.short_addr       = next_hop;
+		hdr_out.src_addr                            = hdr_in->src_addr;
+	} else if ((next_hop = nwk_rte_tbl_get_next_hop(hdr_in->dest_addr, false)) != INVALID_NWK_ADDR) {
 		/* is the dest in our routing table? */
 
+		/*
+		 * if this is a many-to-one route to a concentrator that wants
+		 * a route record, then the route record needs to go out first.
+		 */
+		if ((hdr_in->src_addr == nib.short_addr) &&
+		    (hdr_in->nwk_frm_ctrl.frame_type == NWK_DATA_FRM))
+			nwk_rte_src_send_rec(hdr_in->dest_addr);
+
 		/*
 		 * it's in the routing table. forward it. the buffer dptr
 		 * is pointing to the nwk payload now. calc the length of
@@ -318,7 +422,7 @@ void nwk_fwd(buffer_t *buf, nwk_hdr_t *hdr_in)
 		 * can buffer it and initiate route discovery.
 		 */
 		nwk_pend_add_new(buf, hdr_in);
-		nwk_rte_mesh_disc_start(hdr_in->dest_addr);
+		nwk_rte_mesh_disc_start(hdr_in->dest_addr, false);
 		return;
 	} else {
 		/* if all else fails, route it along the tree */
@@ -331,10 +435,11 @@ void nwk_fwd(buffer_t *buf, nwk_hdr_t *hdr_in)
 		if ((next_hop = nwk_rte_tree_calc_next_hop(hdr_in->dest_addr)) == INVALID_NWK_ADDR)
 		{
 			/*
-			 * tree routing failed for some reason.
-			 * collect the stat and go on with life.
+			 * tree routing failed for some reason. collect
+			 * the stat and let the originator know.
 			 */
 			pcb.failed_tree_rte++;
+			nwk_status_rte_fail(hdr_in, NWK_STATUS_NO_ROUTE_AVAIL);
 			buf_free(buf);
 			DBG_PRINT("NWK: No such neighbor exists.\n");
 			return;
@@ -364,6 +469,15 @@ void nwk_fwd(buffer_t *buf, nwk_hdr_t *hdr_in)
 	hdr_out.radius                              = hdr_in->radius;
 	hdr_out.dest_addr                           = hdr_in->dest_addr;
 	hdr_out.handle                              = hdr_in->handle;
+	hdr_out.nwk_frm_ctrl.mcast_flag             = hdr_in->nwk_frm_ctrl.mcast_flag;
+	hdr_out.mcast_ctrl                          = hdr_in->mcast_ctrl;
+	hdr_out.nwk_frm_ctrl.src_rte                = hdr_in->nwk_frm_ctrl.src_rte;
+	if (hdr_out.nwk_frm_ctrl.src_rte)
+	{
+		hdr_out.relay_cnt = hdr_in->relay_cnt;
+		hdr_out.relay_idx = hdr_in->relay_idx;
+		memcpy(hdr_out.relay_list, hdr_in->relay_list, hdr_in->relay_cnt * sizeof(U16));
+	}
 	hdr_out.mac_hdr->src_addr.mode              = SHORT_ADDR;
 	hdr_out.mac_hdr->dest_addr.mode             = SHORT_ADDR;
 	hdr_out.mac_hdr->src_addr.short_addr        = nib.short_addr;
@@ -390,14 +504,20 @@ void mac_data_ind(buffer_t *buf, mac_hdr_t *mac_hdr)
 	 * then parse the frame for the nwk hdr
 	 */
 	hdr.mac_hdr = mac_hdr;
+	hdr.lqi     = buf->lqi;
 	nwk_parse_hdr(buf, &hdr);
 	debug_dump_nwk_hdr(&hdr);
 
+	/* update the link estimate for the neighbor that sent this */
+	if (mac_hdr->src_addr.mode == SHORT_ADDR)
+		nwk_neighbor_tbl_rx_lqi(mac_hdr->src_addr.short_addr, buf->lqi);
+
 	/*
 	 * if it's a broadcast and the device type doesn't
 	 * match our device, then discard it.
 	 */
-	if ((hdr.dest_addr & NWK_BROADCAST_MASK) == NWK_BROADCAST_MASK)
+	if (!hdr.nwk_frm_ctrl.mcast_flag &&
+	    ((hdr.dest_addr & NWK_BROADCAST_MASK) == NWK_BROADCAST_MASK))
 	{
 		if (!nwk_brc_check_dev_match(hdr.dest_addr)) {
 			buf_free(buf);
@@ -407,6 +527,16 @@ void mac_data_ind(buffer_t *buf, mac_hdr_t *mac_hdr)
 
 	switch(hdr.nwk_frm_ctrl.frame_type) {
 	case NWK_DATA_FRM:
+		/*
+		 * the dest of a multicast frame is a group ID. it has its
+		 * own rules for delivery and relaying.
+		 */
+		if (hdr.nwk_frm_ctrl.mcast_flag)
+		{
+			nwk_mcast_rx(buf, &hdr);
+			break;
+		}
+
 		/* How we handle this depends on the destination address */
 		if (hdr.dest_addr == nib.short_addr)
 		{
@@ -458,24 +588,26 @@ void mac_data_ind(buffer_t *buf, mac_hdr_t *mac_hdr)
 			nwk_brc_add_new_sender(hdr.src_addr, hdr.seq_num);
 
 			/*
-			 * now check if its a new brc. if its not,
-			 * then just discard the frame.
+			 * now check if its a new brc. if its not, then
+			 * just discard the frame. hearing someone else
+			 * relay it may let us skip our own relay.
 			 */
 			if (hdr.seq_num == pcb.brc_seq) {
+				nwk_brc_heard_relay();
 				buf_free(buf);
 				return;
 			}
 
 			/*
 			 * looks like its a new brc. initiate the brc params
-			 * and start the brc transmission procedure.
+			 * and start the brc transmission procedure. the
+			 * brc_start function takes care of sending it out.
 			 *
 			 * note: the header src address gets changed inside
 			 * the brc_start function.
 			 */
-			if (nwk_brc_start(buf, &hdr) != NWK_SUCCESS) {
-				return;
-			}
+			nwk_brc_start(buf, &hdr);
+			break;
 		}
 
 		/* we're not the destination. forward it to the dest address */
@@ -501,9 +633,18 @@ void mac_data_ind(buffer_t *buf, mac_hdr_t *mac_hdr)
 		case NWK_CMD_RTE_REP:
 			nwk_rte_mesh_rrep_handler(&hdr, &cmd);
 			break;
+		case NWK_CMD_NWK_STATUS:
+			nwk_status_handler(&hdr, &cmd);
+			break;
 		case NWK_CMD_LEAVE:
 			nwk_leave_handler(&hdr, &cmd);
 			break;
+		case NWK_CMD_RTE_REC:
+			nwk_rte_src_rec_handler(&hdr, &cmd);
+			break;
+		case NWK_CMD_LINK_STATUS:
+			nwk_link_status_handler(&hdr, &cmd);
+			break;
 		default:
 			break;
 		}
@@ -515,10 +656,14 @@ void mac_data_ind(buffer_t *buf, mac_hdr_t *mac_hdr)
 
 /*
  * Handle the data confirmation from the MAC layer and sends it to the
- * application layer.
+ * application layer. Confirms for frames that we relayed stop here since
+ * nobody above us is waiting for them.
  */
 void mac_data_conf(U8 status, U8 handle)
 {
+	nwk_neighbor_tbl_tx_conf(handle, status);
+	if (handle >= NWK_RELAY_HANDLE_BASE)
+		return;
 	nwk_data_conf(status, handle);
 }
 
@@ -533,5 +678,7 @@ void mac_poll_conf(U8 status)
  */
 void mac_comm_status_ind(U16 pan_id, address_t dest_addr, U8 status, U8 handle)
 {
-    nwk_data_conf(status, handle);
+	if (handle >= NWK_RELAY_HANDLE_BASE)
+		return;
+	nwk_data_conf(status, handle);
 }
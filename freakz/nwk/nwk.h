@@ -47,6 +47,7 @@
 
 #include "types.h"
 #include "mac.h"
+#include "trickle-timer.h"
 
 #define NWK_PEND_TIMEOUT                    3   ///< Pending entry timeout value
 
@@ -56,9 +57,15 @@
 #define BRC_ENTRY(m)		((nwk_brc_t *)MMEM_PTR(&m->mmem_ptr))
 #define NBOR_ENTRY(m)		((nbor_tbl_entry_t *)MMEM_PTR(&m->mmem_ptr))
 #define PEND_ENTRY(m)		((nwk_pend_t *)MMEM_PTR(&m->mmem_ptr))
-#define DISC_ENTRY(m)		((disc_entry_t *)MMEM_PTR(&m->mmem_ptr))
 #define RTE_ENTRY(m)		((rte_entry_t *)MMEM_PTR(&m->mmem_ptr))
 #define RREQ_ENTRY(m)		((rreq_t *)MMEM_PTR(&m->mmem_ptr))
+#define SRC_RTE_ENTRY(m)	((src_rte_entry_t *)MMEM_PTR(&m->mmem_ptr))
+
+// multicast control field accessors
+#define NWK_MCAST_MODE(c)		((c) & NWK_MCAST_MODE_MASK)
+#define NWK_MCAST_RADIUS(c)		(((c) >> NWK_MCAST_RADIUS_OFFSET) & NWK_MCAST_RADIUS_MASK)
+#define NWK_MCAST_MAX_RADIUS(c)	(((c) >> NWK_MCAST_MAX_RADIUS_OFFSET) & NWK_MCAST_RADIUS_MASK)
+#define NWK_MCAST_CTRL(mode, r, max)	((mode) | ((r) << NWK_MCAST_RADIUS_OFFSET) | ((max) << NWK_MCAST_MAX_RADIUS_OFFSET))
 
 /****************************************************************/
 /*!
@@ -169,6 +176,37 @@ enum NWK_CMD_FRM_ENUMS
     NWK_CAPAB_SECURITY_MASK         = (1 << NWK_CAPAB_SECURITY_OFFSET),     ///< Capability info - security enabled field
     NWK_CAPAB_ALLOC_ADDR_MASK       = (1 << NWK_CAPAB_ALLOC_ADDR_OFFSET),   ///< Capability info - address allocation type field
 
+    // route request options
+    NWK_RREQ_MTO_OFFSET             = 3,
+    NWK_RREQ_MTO_MASK               = (3 << NWK_RREQ_MTO_OFFSET),   ///< Route request options - many-to-one field
+    NWK_RREQ_MTO_REC_TBL            = (1 << NWK_RREQ_MTO_OFFSET),   ///< Many-to-one from a concentrator with a route record table
+    NWK_RREQ_MTO_NO_REC_TBL         = (2 << NWK_RREQ_MTO_OFFSET),   ///< Many-to-one from a concentrator without a route record table
+    NWK_RREQ_MCAST                  = (1 << 6),                     ///< Route request options - dest is a multicast group ID
+
+    // route reply options
+    NWK_RREP_MCAST                  = (1 << 6),                     ///< Route reply options - responder is a multicast group ID
+
+    // multicast control fields
+    NWK_MCAST_MODE_MASK             = 0x03,     ///< Multicast control - multicast mode field
+    NWK_MCAST_NON_MEMBER_MODE       = 0x00,     ///< Multicast mode - from a non-member, unicast towards the group
+    NWK_MCAST_MEMBER_MODE           = 0x01,     ///< Multicast mode - broadcast among the group members
+    NWK_MCAST_RADIUS_OFFSET         = 2,        ///< Multicast control - non-member radius offset
+    NWK_MCAST_MAX_RADIUS_OFFSET     = 5,        ///< Multicast control - max non-member radius offset
+    NWK_MCAST_RADIUS_MASK           = 0x07,     ///< Multicast control - mask for either radius field
+
+    // network status codes
+    NWK_STATUS_NO_ROUTE_AVAIL       = 0x00,     ///< Network status - no route to the dest could be found
+    NWK_STATUS_TREE_LINK_FAIL       = 0x01,     ///< Network status - the link to a parent or child failed
+    NWK_STATUS_NON_TREE_LINK_FAIL   = 0x02,     ///< Network status - the link to a mesh next hop failed
+    NWK_STATUS_SRC_RTE_FAIL         = 0x0B,     ///< Network status - a relay in the source route is unreachable
+
+    // link status fields
+    NWK_LINK_STATUS_CNT_MASK        = 0x1F,     ///< Link status options - entry count field
+    NWK_LINK_STATUS_FIRST_FRM       = (1 << 5), ///< Link status options - first frame of the list
+    NWK_LINK_STATUS_LAST_FRM        = (1 << 6), ///< Link status options - last frame of the list
+    NWK_LINK_STATUS_IN_COST_MASK    = 0x07,     ///< Link status entry - incoming cost field
+    NWK_LINK_STATUS_OUT_COST_OFFSET = 4,        ///< Link status entry - outgoing cost offset
+
     // network leave fields
     NWK_LEAVE_REJOIN_OFFSET         = 5,
     NWK_LEAVE_REQUEST_OFFSET        = 6,
@@ -245,7 +283,14 @@ enum NWK_MISC_ENUMS
 	NWK_NON_MEMB_RADIUS_INFIN       = 0x7,   ///< Constant for infinite nonmember radius
 
 	/* default static path cost */
-	NWK_STATIC_PATH_COST            = 0x7,   ///< Constant for path cost. \todo This needs to be changed.
+	NWK_STATIC_PATH_COST            = 0x7,   ///< Link cost used when report_const_cost is set or the link is unknown
+
+	/* link cost estimation */
+	NWK_MAX_LINK_COST               = 0x7,   ///< Highest cost of a single link
+	NWK_ETX_ONE                     = 0x8,   ///< ETX fixed point scale. One transmission per delivery.
+	NWK_ETX_FAIL                    = 0x20,  ///< ETX sample for a frame that never got acked
+	NWK_LINK_EWMA_SHIFT             = 0x2,   ///< Each new sample counts for 1/4 of the link estimate
+	NWK_LINK_TX_SLOTS               = 0x8,   ///< Unicasts that can be tracked for their ETX sample
 
 	/* network broadcast values */
 	NWK_BROADCAST_ALL               = 0xFFFF, /* For all devices */
@@ -298,7 +343,10 @@ typedef struct
     U64             src_ieee_addr;      ///< Src IEEE address - if src ieee addr flag set
     U8              mcast_ctrl;         ///< Multicast control field
     U8              handle;             ///< Data handle identifier
-    U8              *src_rte_subfrm;    ///< Source route subframe - holds source route hop addresses
+    U8              relay_cnt;          ///< Source route - number of relays
+    U8              relay_idx;          ///< Source route - index of the next relay
+    U16             relay_list[NWK_MAX_SRC_RTE_RELAYS]; ///< Source route - relays, closest to the dest first
+    U8              lqi;                ///< LQI of the incoming frame
 } nwk_hdr_t;
 
 /*******************************************************************/
@@ -338,6 +386,45 @@ typedef struct
     U8 cmd_opts;    ///< Leave command options
 } nwk_cmd_leave_t;
 
+/*******************************************************************/
+/*!
+    Data struct to hold the route record command frame args. The relay
+    list gets built up as the frame travels to the concentrator. The
+    relay closest to the originator is first.
+*/
+/*******************************************************************/
+typedef struct
+{
+    U8  relay_cnt;                              ///< Number of relays in the list
+    U16 relay_list[NWK_MAX_SRC_RTE_RELAYS];     ///< Relays the route record passed through
+} nwk_cmd_rte_rec_t;
+
+/*******************************************************************/
+/*!
+    Data struct to hold the link status command frame args. Each entry
+    is a router neighbor with the incoming and outgoing costs of its
+    link packed into one byte. The entries are sorted by address.
+*/
+/*******************************************************************/
+typedef struct
+{
+    U8  cmd_opts;                                   ///< Entry count and first/last frame flags
+    U16 nbor_addr[NWK_MAX_LINK_STATUS_ENTRIES];     ///< Addresses of the router neighbors
+    U8  link_status[NWK_MAX_LINK_STATUS_ENTRIES];   ///< Incoming and outgoing costs of each link
+} nwk_cmd_link_status_t;
+
+/*******************************************************************/
+/*!
+    Data struct to hold the network status command frame args. It's sent
+    back to the originator of a frame that couldn't be routed.
+*/
+/*******************************************************************/
+typedef struct
+{
+    U8  status_code;    ///< Reason the route failed
+    U16 dest_addr;      ///< Destination of the frame that couldn't be routed
+} nwk_cmd_status_t;
+
 /*******************************************************************/
 /*!
     Data struct to hold the rejoin request command frame args.
@@ -373,7 +460,10 @@ typedef struct
     {
         nwk_cmd_rreq_t          rreq;           ///< Route request cmd frame
         nwk_cmd_rrep_t          rrep;           ///< Route reply cmd frame
+        nwk_cmd_status_t        status;         ///< Network status cmd frame
         nwk_cmd_leave_t         leave;          ///< Network leave cmd frame
+        nwk_cmd_rte_rec_t       rte_rec;        ///< Route record cmd frame
+        nwk_cmd_link_status_t   link_status;    ///< Link status cmd frame
         nwk_cmd_rejoin_req_t    rejoin_req;     ///< Network rejoin request cmd frame
         nwk_cmd_rejoin_resp_t   rejoin_resp;    ///< Network rejoin response cmd frame
     };
@@ -392,6 +482,7 @@ typedef struct _rreq_t
     U16             originator; ///< Originator of the rreq
     nwk_cmd_t       cmd;        ///< CMD data for the rreq
     U16             expiry;     ///< Expiration of the route request
+    bool            jitter;     ///< Resend is waiting for the broadcast jitter to run out
 } rreq_t;
 
 /*******************************************************************/
@@ -406,8 +497,26 @@ typedef struct _rte_tbl_entry_t
     U16     dest_addr;              ///< Dest address of the route
     U8      status;                 ///< Indicator of the health of the route
     U16     next_hop;               ///< Next hop towards the destination
+    bool    many_to_one;            ///< Route to a concentrator set up by a many-to-one route request
+    bool    rte_rec_req;            ///< Send a route record before the next data frame to the concentrator
+    bool    grp_id;                 ///< Dest is a multicast group ID instead of a network address
 } rte_entry_t;
 
+/*******************************************************************/
+/*!
+    Source route table entry. A concentrator keeps one for each device
+    that sent it a route record. The relays are listed with the one
+    closest to the destination first, the same as the source route
+    subframe in the NWK header.
+*/
+/*******************************************************************/
+typedef struct _src_rte_entry_t
+{
+    U16     dest_addr;                          ///< Device the source route leads to
+    U8      relay_cnt;                          ///< Number of relays in the list
+    U16     relay_list[NWK_MAX_SRC_RTE_RELAYS]; ///< Relays on the way to the device
+} src_rte_entry_t;
+
 /*******************************************************************/
 /*!
     Route discovery table entry. The discovery table is used to keep
@@ -416,13 +525,17 @@ typedef struct _rte_tbl_entry_t
 /*******************************************************************/
 typedef struct _rte_disc_tbl_entry_t
 {
+    struct _rte_disc_tbl_entry_t *next; ///< Next entry in the same hash bucket
+    bool    alloc;                      ///< Entry is in use
+    struct ctimer tmr;                  ///< Expiry timer for this entry
+    clock_time_t expiry;                ///< Clock time that the entry expires at
     U8      rreq_id;                    ///< Route request ID that this entry is tracking
     U16     src_addr;                   ///< Src addr of route request
     U16     sender_addr;                ///< Address of previous hop node that relayed this route request
     U16     dest_addr;                  ///< Dest addr of this route request
+    bool    grp_id;                     ///< Dest addr is a multicast group ID
     U8      fwd_cost;                   ///< Forward path cost of this route from source to this node
     U8      resid_cost;                 ///< Reverse path cost of this route from dest to this node
-    U16     expiry;                     ///< Amount of time left before this entry expires
 } disc_entry_t;
 
 /*******************************************************************/
@@ -445,7 +558,10 @@ typedef struct _nbor_tbl_entry_t
     bool    permit_join;        ///< Whether the neighbor is allowing joins
     bool    pot_parent;         ///< Whether the neighbor is a potential parent
     U8      transmit_fail;      ///< Number of failed transmissions to this neighbor
-    U8      lqi;                ///< Link quality indicator value - can be used to determine path cost
+    U8      lqi;                ///< Smoothed link quality indicator of frames from this neighbor
+    U8      etx;                ///< Smoothed transmissions per delivery to this neighbor in NWK_ETX_ONE units
+    U8      out_cost;           ///< Cost of the link to the neighbor from its last link status. 0 if unknown.
+    U8      age;                ///< Link status periods since the last link status from this router
 } nbor_tbl_entry_t;
 
 /*******************************************************************/
@@ -477,6 +593,13 @@ typedef struct _nwk_nib_t
     U8                  nwk_scan_attempts;      ///< Number of scan attempts
     U16                 time_betw_scans;        ///< Time between scan attempts
     U16                 nwk_mngr;               ///< Address of this network's network manager
+    bool                is_concentrator;        ///< Send many-to-one route requests and keep source routes
+    U8                  concentrator_radius;    ///< Radius of the many-to-one route requests
+    U8                  concentrator_disc_time; ///< Seconds between many-to-one route requests. 0 for only on request.
+    U8                  link_status_period;     ///< Seconds between link status broadcasts
+    U8                  router_age_limit;       ///< Missed link statuses before a router neighbor goes stale
+    bool                brc_trickle;            ///< Relay broadcasts with trickle suppression instead of passive acks
+    bool                local_repair;           ///< Rediscover broken routes here instead of only reporting them
 } nwk_nib_t;
 
 /*******************************************************************/
@@ -545,7 +668,7 @@ typedef struct _nwk_pend_t
     U8                  radius;     ///< Max number of hops
     U8                  seq;        ///< Sequence number
     U8                  handle;     ///< Data handle for this frame
-    U8                  expiry;     ///< Time remaining before expiration for this entry
+    U8                  mcast_ctrl; ///< Multicast control field if this is a multicast frame
     buffer_t            *buf;       ///< Frame to be transmitted
 } nwk_pend_t;
 
@@ -561,7 +684,6 @@ typedef struct _nwk_brc_t
 {
     U16                 nwk_addr;   ///< Network address of received broadcast frame
     U8                  seq_id;     ///< Sequence ID of received broadcast frame
-    U8                  expiry;     ///< Time remaining before expiring this entry
 } nwk_brc_t;
 
 /*******************************************************************/
@@ -593,6 +715,7 @@ typedef struct _nwk_pcb_t
     nwk_hdr_t       brc_nwk_hdr;        ///< Broadcast frame network header
     buffer_t        *brc_curr_frm;      ///< Keep broadcast frame here for retransmission until retries are finished
     struct ctimer   brc_tmr;            ///< Callback timer for broadcast
+    struct trickle_timer brc_trickle;   ///< Trickle timer for broadcast relays when trickle mode is on
 
     // nwk discovery
     U32             channel_mask;       ///< Channel mask for network scan
@@ -609,8 +732,18 @@ typedef struct _nwk_pcb_t
     // statistics (not implemented yet)
     U16 drop_data_frm;                  ///< Number of dropped data frames
     U16 drop_brc_frm;                   ///< Number of dropped broadcast frames
+    U16 drop_mcast_frm;                 ///< Number of multicast frames that ran out of non-member radius
+    U16 brc_suppressed;                 ///< Number of broadcast relays suppressed by trickle
     U16 drop_rreq_frm;                  ///< Number of dropped route request frames
+    U16 rreq_coalesced;                 ///< Number of route discoveries joined to one already in flight
+    U16 rreq_rate_limited;              ///< Number of route request sends held back by the token bucket
     U16 drop_rrep_frm;                  ///< Number of dropped route reply frames
+    U16 disc_evicted;                   ///< Number of discovery entries pushed out by a full table
+    U16 drop_rte_rec_frm;               ///< Number of dropped route record frames
+    U16 stale_nbor;                     ///< Number of router neighbors that stopped sending link status
+    U16 link_fail;                      ///< Number of unicasts that a next hop failed to ack past the threshold
+    U16 local_repair;                   ///< Number of route discoveries started to repair a broken link
+    U16 nwk_status_tx;                  ///< Number of network status frames sent to report a route error
     U16 failed_transfer;                ///< Number of failed transfers
     U16 failed_tree_rte;                ///< Number of failed tree routes
     U16 failed_alloc;                   ///< Number of failed buffer allocations
@@ -644,10 +777,11 @@ U8 nwk_gen_capab_info(const nwk_capab_info_t *info);
 
 // nwk_rte (routing table)
 void nwk_rte_tbl_init();
-mem_ptr_t *nwk_rte_tbl_find(U16 dest_addr);
-void nwk_rte_tbl_add_new(U16 dest_addr, U8 status);
+mem_ptr_t *nwk_rte_tbl_find(U16 dest_addr, bool grp_id);
+void nwk_rte_tbl_add_new(U16 dest_addr, bool grp_id, U8 status);
+void nwk_rte_tbl_invalidate_next_hop(U16 next_hop);
 void nwk_rte_tbl_free(mem_ptr_t *mem_ptr);
-U16 nwk_rte_tbl_get_next_hop(U16 dest_addr);
+U16 nwk_rte_tbl_get_next_hop(U16 dest_addr, bool grp_id);
 bool nwk_rte_tbl_rte_exists(U16 dest_addr);
 void nwk_rte_tbl_rem(U16 addr);
 void nwk_rte_tbl_clear();
@@ -655,23 +789,53 @@ mem_ptr_t *nwk_rte_tbl_get_head();
 
 // nwk_rte_disc (discovery table)
 void nwk_rte_disc_tbl_init();
-void nwk_rte_disc_free(mem_ptr_t *mem_ptr);
+void nwk_rte_disc_free(disc_entry_t *entry);
 void nwk_rte_disc_clear();
-mem_ptr_t *nwk_rte_disc_find(U8 rreq_id, U16 src_addr);
-void nwk_rte_disc_add_new(U8 rreq_id, U16 src_addr, U16 sender_addr, U16 dest_addr, U8 cost);
-void nwk_rte_disc_periodic();
+disc_entry_t *nwk_rte_disc_find(U8 rreq_id, U16 src_addr);
+void nwk_rte_disc_add_new(U8 rreq_id, U16 src_addr, U16 sender_addr, U16 dest_addr, bool grp_id, U8 cost);
+void nwk_rte_disc_refresh(disc_entry_t *entry);
 
 // nwk_rte_mesh (mesh routing)
 void nwk_rte_mesh_init();
 void nwk_rte_mesh_rreq_handler(const nwk_hdr_t *hdr_in, nwk_cmd_t *cmd_in);
 void nwk_rte_mesh_rrep_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in);
-void nwk_rte_mesh_disc_start(U16 dest_addr);
+void nwk_rte_mesh_disc_start(U16 dest_addr, bool mcast);
 void nwk_rte_mesh_resend_rreq(mem_ptr_t *mem_ptr);
 void nwk_rte_mesh_periodic(void *ptr);
 void nwk_rte_mesh_stop_tmr();
+void nwk_rte_mesh_mto_start();
+
+// nwk_rte_src (many-to-one and source routing)
+void nwk_rte_src_init();
+void nwk_rte_src_clear();
+mem_ptr_t *nwk_rte_src_get_head();
+mem_ptr_t *nwk_rte_src_find(U16 dest_addr);
+void nwk_rte_src_send_rec(U16 concentrator);
+void nwk_rte_src_rec_handler(const nwk_hdr_t *hdr_in, nwk_cmd_t *cmd_in);
+bool nwk_rte_src_set_hdr(nwk_hdr_t *hdr, U16 *next_hop);
+U16 nwk_rte_src_next_relay(nwk_hdr_t *hdr);
+void nwk_rte_src_rem_next_hop(U16 next_hop);
+void nwk_rte_src_rem(U16 dest_addr);
+
+// nwk_link_status (link status exchange)
+void nwk_link_status_start();
+void nwk_link_status_periodic(void *ptr);
+void nwk_link_status_stop_tmr();
+void nwk_link_status_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in);
+
+// nwk_status (route errors and repair)
+void nwk_status_rte_fail(const nwk_hdr_t *hdr, U8 status_code);
+void nwk_status_link_fail(U16 next_hop, U16 src_addr, U16 dest_addr);
+void nwk_status_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in);
+
+// nwk_mcast (multicast)
+bool nwk_mcast_is_member(U16 grp_id);
+void nwk_mcast_data_req(buffer_t *buf, nwk_hdr_t *hdr, U8 non_memb_radius);
+void nwk_mcast_rx(buffer_t *buf, nwk_hdr_t *hdr);
 
 // nwk_rte_tree (tree routing)
 void nwk_rte_tree_init();
+void nwk_rte_tree_calc_cskip_tbl();
 U16 nwk_rte_tree_calc_next_hop(U16 dest);
 U16 nwk_rte_tree_calc_cskip(U8 depth);
 U16 nwk_rte_tree_calc_rtr_addr(U16 cskip, U8 num);
@@ -683,7 +847,6 @@ void nwk_pend_add_new(buffer_t *buf, nwk_hdr_t *hdr);
 void nwk_pend_free(mem_ptr_t *mem_ptr);
 void nwk_pend_send_pending();
 void nwk_pend_clear();
-void nwk_pend_periodic();
 
 // nwk_neighbor_tbl (neighbor table)
 void nwk_neighbor_tbl_init();
@@ -695,6 +858,13 @@ U16 nwk_neighbor_tbl_get_parent();
 bool nwk_neighbor_tbl_addr_exists(address_t *addr);
 mem_ptr_t *nwk_neighbor_tbl_get_entry(address_t *addr);
 U8 nwk_neighbor_get_cnt();
+void nwk_neighbor_tbl_rx_lqi(U16 addr, U8 lqi);
+void nwk_neighbor_tbl_tx_track(U16 addr, U8 handle, const nwk_hdr_t *hdr);
+void nwk_neighbor_tbl_tx_conf(U8 handle, U8 status);
+U8 nwk_neighbor_tbl_get_link_cost(U16 addr, U8 rx_lqi);
+U8 nwk_neighbor_tbl_get_in_cost(const mem_ptr_t *mem_ptr);
+void nwk_neighbor_tbl_link_status(U16 addr, U8 lqi, bool covered, U8 out_cost);
+void nwk_neighbor_tbl_age();
 
 // nwk_brc (broadcast table)
 void nwk_brc_init();
@@ -703,7 +873,8 @@ bool nwk_brc_check_dev_match(U16 dest_addr);
 void nwk_brc_add_new_sender(const U16 src_addr, const U8 seq_num);
 U8 nwk_brc_start(buffer_t *buf, nwk_hdr_t *hdr);
 void nwk_brc_expire(void *ptr);
-void nwk_brc_periodic();
+void nwk_brc_heard_relay();
+void nwk_brc_stop_tmr();
 
 // nwk discovery
 void nwk_disc_req(U32 channel_mask, U8 duration);
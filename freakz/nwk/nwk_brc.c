@@ -56,6 +56,12 @@
     the software will stop transmitting when we have received a broadcast from
     all of our neighbors.
 
+    If trickle mode is enabled in the NIB, the relay is handed to a trickle
+    timer instead. Each node sends the frame at a random point in each
+    trickle interval, but only if it heard fewer than NWK_BRC_TRICKLE_K
+    neighbors relay it during that interval. In dense networks, most of
+    the relays are suppressed this way.
+
     Broadcasts need to be treated with a lot of care in Zigbee because there is
     the potential for them to spiral out of control and crash all the nodes
     on the network.
@@ -75,6 +81,8 @@
  */
 LIST(brc_list);
 
+static void nwk_brc_trickle_fire(void *ptr, U8 suppress);
+
 /*
  * Initialize the broadcast table. We will use this to implement our passive
  * ack system.
@@ -93,7 +101,7 @@ static mem_ptr_t *nwk_brc_alloc()
 	mem_ptr_t *mem_ptr;
 
 	mem_ptr = mem_heap_alloc(sizeof(nwk_brc_t));
-	if (!mem_ptr) {
+	if (mem_ptr) {
 		list_add(brc_list, mem_ptr);
 	}
 	return mem_ptr;
@@ -108,6 +116,15 @@ static void nwk_brc_free(mem_ptr_t *mem_ptr)
 	}
 }
 
+/*
+ * Slow timer callback for a broadcast table entry. When the entry expires,
+ * it will be freed.
+ */
+static void nwk_brc_entry_expire(void *ptr)
+{
+	nwk_brc_free((mem_ptr_t *)ptr);
+}
+
 /* Remove all entries from the broadcast table */
 void nwk_brc_clear()
 {
@@ -170,8 +187,8 @@ void nwk_brc_add_new_sender(const U16 src_addr, const U8 seq_num)
 		if ((mem_ptr = nwk_brc_alloc()) != NULL)
 		{
 			BRC_ENTRY(mem_ptr)->nwk_addr   = src_addr;
-			BRC_ENTRY(mem_ptr)->expiry     = (U8)ZIGBEE_BRC_EXPIRY;
 			BRC_ENTRY(mem_ptr)->seq_id     = seq_num;
+			slow_tmr_set(&mem_ptr->tmr, ZIGBEE_BRC_EXPIRY, nwk_brc_entry_expire, mem_ptr);
 		}
 	}
 }
@@ -179,8 +196,10 @@ void nwk_brc_add_new_sender(const U16 src_addr, const U8 seq_num)
 /*
  * Start a broadcast transmission. We need to check if one is
  * currently in progress. If not, then set the flags to indicate
- * that a broadcast is in progress, and setup the callback timer
- * to expire the broadcast after the spec'd time interval.
+ * that a broadcast is in progress, send the frame out, and setup
+ * the callback timer to expire the broadcast after the spec'd time
+ * interval. In trickle mode, the trickle timer sends the frame
+ * instead. Either way, the buffer belongs to this function.
  */
 U8 nwk_brc_start(buffer_t *buf, nwk_hdr_t *hdr)
 {
@@ -193,11 +212,13 @@ U8 nwk_brc_start(buffer_t *buf, nwk_hdr_t *hdr)
 	 * if the brc is in the table, then drop it.
 	 * otherwise, check for other error conditions
 	 * as well that would cause us to drop the broadcast.
+	 * member mode multicasts go out as broadcasts too, but
+	 * their dest is a group ID rather than a device type.
 	 */
 	if (!pcb->brc_accept_new	||
 	    pcb->brc_active		||
 	    (hdr->radius == 0)	||
-	    !nwk_brc_check_dev_match(hdr->dest_addr))
+	    (!hdr->nwk_frm_ctrl.mcast_flag && !nwk_brc_check_dev_match(hdr->dest_addr)))
 	{
 		buf_free(buf);
 		return NWK_NOT_PERMITTED;
@@ -227,6 +248,21 @@ U8 nwk_brc_start(buffer_t *buf, nwk_hdr_t *hdr)
 	hdr->src_addr        = nib->short_addr;
 	memcpy(&pcb->brc_nwk_hdr, hdr, sizeof(nwk_hdr_t));
 
+	if (nib->brc_trickle)
+	{
+		/*
+		 * we keep a copy of the frame in brc_curr_frm. the
+		 * trickle timer will send copies of that if none of our
+		 * neighbors beat us to it, so we don't need the original.
+		 */
+		buf_free(buf);
+		trickle_timer_config(&pcb->brc_trickle, NWK_BRC_TRICKLE_IMIN, NWK_BRC_TRICKLE_IMAX, NWK_BRC_TRICKLE_K);
+		trickle_timer_set(&pcb->brc_trickle, nwk_brc_trickle_fire, NULL);
+		trickle_timer_reset_event(&pcb->brc_trickle);
+		return NWK_SUCCESS;
+	}
+
+	nwk_fwd(buf, hdr);
 	ctimer_set(&pcb->brc_tmr, NWK_PASSIVE_ACK_TIMEOUT, nwk_brc_expire, NULL);
 	return NWK_SUCCESS;
 }
@@ -314,6 +350,57 @@ static bool nwk_brc_check_all_relayed(U16 addr, U8 seq_id)
 	return true;
 }
 
+/*
+ * Send out a copy of the broadcast frame we're holding. The original
+ * stays in brc_curr_frm in case we need to send it again.
+ */
+static void nwk_brc_tx()
+{
+	buffer_t *buf;
+	nwk_pcb_t *pcb = nwk_pcb_get();
+	U8 index, len;
+
+	/*
+	 * copy the buffer, adjust the dptr of the new
+	 * frame, and send out the brc
+	 */
+	BUF_ALLOC(buf, TX);
+
+	/* calculate the length of the frame contents */
+	len = aMaxPHYPacketSize - (pcb->brc_curr_frm->dptr - pcb->brc_curr_frm->buf);
+
+	/*
+	 * save off the original index of the alloc'd frame.
+	 * we'll need to restore it after the memcpy.
+	 */
+	index = buf->index;
+	memcpy(buf, pcb->brc_curr_frm, sizeof(buffer_t));
+	buf->index = index;
+
+	/*
+	 * move the buf data pointer to the correct position in
+	 * the buffer and add the len field
+	 */
+	buf->dptr = buf->buf + (pcb->brc_curr_frm->dptr - pcb->brc_curr_frm->buf);
+	buf->len = len;
+
+	nwk_fwd(buf, &pcb->brc_nwk_hdr);
+}
+
+/*
+ * Re-send the broadcast frame. This gets called from the brc timer once the
+ * jitter has run out. After the frame goes out, the brc timer is set up to
+ * check the passive acks again.
+ */
+static void nwk_brc_resend(void *ptr)
+{
+	nwk_pcb_t *pcb = nwk_pcb_get();
+
+	DBG_PRINT("NWK_BRC: Resending Broadcast. Retry #%02d.\n", pcb->brc_retries);
+	nwk_brc_tx();
+	ctimer_set(&pcb->brc_tmr, NWK_PASSIVE_ACK_TIMEOUT, nwk_brc_expire, NULL);
+}
+
 /*
  * This is used in the brc timer callback function. When the broadcast
  * expires, this function is called and will check to see if all neighbors have
@@ -322,9 +409,7 @@ static bool nwk_brc_check_all_relayed(U16 addr, U8 seq_id)
 void nwk_brc_expire(void *ptr)
 {
 	bool all_relayed = false;
-	buffer_t *buf;
 	nwk_pcb_t *pcb = nwk_pcb_get();
-	U8 index;
 
 	pcb->brc_retries++;
 
@@ -337,42 +422,13 @@ void nwk_brc_expire(void *ptr)
 		all_relayed = nwk_brc_check_all_relayed(pcb->brc_nwk_hdr.dest_addr, pcb->brc_seq);
 		if (!all_relayed)
 		{
-			U8 len;
-
 			/*
 			 * we need to do re-broadcast the frame since
 			 * not all neighbors forwarded it. First jitter
-			 * the send according to the spec.
-			 */
-			busy_wait(drvr_get_rand() % NWK_BRC_JITTER);
-
-			/*
-			 * copy the buffer, adjust the dptr of the new
-			 * frame, and resend out the brc
+			 * the send according to the spec. the brc timer
+			 * will send it once the jitter runs out.
 			 */
-			DBG_PRINT("NWK_BRC: Resending Broadcast. Retry #%02d.\n", pcb->brc_retries);
-			BUF_ALLOC(buf, TX);
-
-			/* calculate the length of the frame contents */
-			len = aMaxPHYPacketSize - (pcb->brc_curr_frm->dptr - pcb->brc_curr_frm->buf);
-
-			/*
-			 * save off the original index of the alloc'd frame.
-			 * we'll need to restore it after the memcpy.
-			 */
-			index = buf->index;
-			memcpy(buf, pcb->brc_curr_frm, sizeof(buffer_t));
-			buf->index = index;
-
-			/*
-			 * move the buf data pointer to the correct position in
-			 * the buffer and add the len field
-			 */
-			buf->dptr = buf->buf + (pcb->brc_curr_frm->dptr - pcb->brc_curr_frm->buf);
-			buf->len = len;
-
-			nwk_fwd(buf, &pcb->brc_nwk_hdr);
-			ctimer_set(&pcb->brc_tmr, NWK_PASSIVE_ACK_TIMEOUT, nwk_brc_expire, NULL);
+			ctimer_set(&pcb->brc_tmr, drvr_get_rand() % NWK_BRC_JITTER, nwk_brc_resend, NULL);
 			return;
 		}
 	}
@@ -387,21 +443,63 @@ void nwk_brc_expire(void *ptr)
 }
 
 /*
- * This is a periodic function that checks for expiring entries. It is
- * triggered by the slow clock and is called approximately once per second.
- * When called, it will check the broadcast table and decrement the expiry
- * in each of the entries. When the expiry reaches zero, the broadcast table
- * entry will be freed.
+ * Trickle timer callback for the broadcast. It gets called once per trickle
+ * interval at a random point in the interval. If enough neighbors relayed
+ * the broadcast already, the trickle timer tells us to suppress our own
+ * relay. After NWK_MAX_BRC_RETRIES intervals, or once every neighbor has
+ * relayed it, the broadcast is finished.
  */
-void nwk_brc_periodic()
+static void nwk_brc_trickle_fire(void *ptr, U8 suppress)
 {
-	mem_ptr_t *mem_ptr;
+	nwk_pcb_t *pcb = nwk_pcb_get();
+
+	if (suppress == TRICKLE_TIMER_TX_OK)
+	{
+		DBG_PRINT("NWK_BRC: Trickle relay. Interval #%02d.\n", pcb->brc_retries);
+		nwk_brc_tx();
+	}
+	else
+	{
+		pcb->brc_suppressed++;
+	}
+
+	if ((++pcb->brc_retries < NWK_MAX_BRC_RETRIES) &&
+	    !nwk_brc_check_all_relayed(pcb->brc_nwk_hdr.dest_addr, pcb->brc_seq))
+	{
+		return;
+	}
+
+	trickle_timer_stop(&pcb->brc_trickle);
+	buf_free(pcb->brc_curr_frm);
+	nwk_brc_cleanup();
+	DBG_PRINT("NWK_BRC: Trickle broadcast is finished.\n");
+}
+
+/*
+ * We heard a neighbor relay the broadcast we're currently holding. In trickle
+ * mode, this counts towards suppressing our own relay for this interval.
+ */
+void nwk_brc_heard_relay()
+{
+	nwk_pcb_t *pcb = nwk_pcb_get();
+
+	if (pcb->brc_active && trickle_timer_is_running(&pcb->brc_trickle))
+	{
+		trickle_timer_consistency(&pcb->brc_trickle);
+	}
+}
+
+/* Stop any broadcast that is in progress and release its frame */
+void nwk_brc_stop_tmr()
+{
+	nwk_pcb_t *pcb = nwk_pcb_get();
+
+	ctimer_stop(&pcb->brc_tmr);
+	trickle_timer_stop(&pcb->brc_trickle);
 
-	for (mem_ptr = list_head(brc_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	if (pcb->brc_active)
 	{
-		if (BRC_ENTRY(mem_ptr)->expiry == 0)
-			nwk_brc_free(mem_ptr);
-		else
-			BRC_ENTRY(mem_ptr)->expiry--;
+		buf_free(pcb->brc_curr_frm);
+		nwk_brc_cleanup();
 	}
 }
@@ -83,6 +83,14 @@ void nwk_disc_req(U32 channel_mask, U8 duration)
 void mac_scan_conf(const mac_scan_conf_t *args)
 {
 	nwk_pcb_t *pcb = nwk_pcb_get();
+	mac_pcb_t *mac_pcb = mac_pcb_get();
+
+	/*
+	 * a scan that the mac turned away doesn't belong to the
+	 * operation that's running so leave the current state alone.
+	 */
+	if (args->status == MAC_SCAN_IN_PROGRESS)
+		return;
 
 	if (args->scan_type == MAC_ENERGY_SCAN) {
 		/*
@@ -91,6 +99,26 @@ void mac_scan_conf(const mac_scan_conf_t *args)
 		 */
 		pcb->energy_list = (args->status == MAC_SUCCESS) ?
 					args->energy_list : NULL;
+
+		if (pcb->nlme_state == NLME_NWK_FORMATION) {
+			/*
+			 * the energy scan for the nwk formation is finished.
+			 * clear the pan descriptor list and do the active scan.
+			 * we can't pick a channel without the energy list so
+			 * the formation fails if the energy scan didn't work.
+			 */
+			if (args->status != MAC_SUCCESS) {
+				pcb->nlme_state = NLME_IDLE;
+				nwk_form_conf(NWK_STARTUP_FAILURE);
+				return;
+			}
+			mac_pcb->scan_type = MAC_ACTIVE_SCAN;
+			mac_scan_descr_clear();
+			mac_scan(NULL);
+		} else {
+			/* the energy scan was requested by the ZDO */
+			nwk_ed_scan_conf(args->status, pcb->energy_list);
+		}
 	} else if (args->scan_type == MAC_ACTIVE_SCAN) {
 		/*
 		 * after the active scan, then we should be done with
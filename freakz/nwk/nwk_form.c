@@ -58,7 +58,6 @@
 void nwk_form_req(U32 channel_mask, U8 scan_duration)
 {
 	nwk_pcb_t *nwk_pcb = nwk_pcb_get();
-	mac_pcb_t *mac_pcb = mac_pcb_get();
 	nwk_nib_t *nib = nwk_nib_get();
 
 	if (nib->joined) {
@@ -66,22 +65,25 @@ void nwk_form_req(U32 channel_mask, U8 scan_duration)
 		return;
 	}
 
-	/* we need to fill out the parameters inside the mac and nwk pcb */
-	mac_pcb->channel_mask   = nwk_pcb->channel_mask = channel_mask;
-	mac_pcb->duration       = nwk_pcb->duration     = scan_duration;
-	mac_pcb->scan_type      = MAC_ACTIVE_SCAN;
+	/*
+	 * the mac gets the channel mask and duration from the energy
+	 * scan once it accepts it. the active scan uses the same ones.
+	 */
+	nwk_pcb->channel_mask   = channel_mask;
+	nwk_pcb->duration       = scan_duration;
 	nwk_pcb->nlme_state     = NLME_NWK_FORMATION;
 
 	/*
 	 * start off the nwk formation by doing an energy scan.
-	 * the energy scan uses a busy wait so we don't need to
-	 * break out of the thread.
+	 * the active scan gets started from the scan confirm
+	 * once the energy scan is finished. if the mac is busy
+	 * with another scan, we can't form the nwk right now.
 	 */
-	mac_scan_energy();
-
-	/* clear the pan descriptor list and do the active scan. */
-	mac_scan_descr_clear();
-	mac_scan(NULL);
+	if (mac_scan_energy(channel_mask, scan_duration) != MAC_SUCCESS)
+	{
+		nwk_pcb->nlme_state = NLME_IDLE;
+		nwk_form_conf(NWK_STARTUP_FAILURE);
+	}
 }
 
 /*
@@ -203,10 +205,14 @@ void nwk_form_select_channel()
 	nib->ext_pan_ID     = (nib->ext_pan_ID == 0) ? pib->ext_addr : nib->ext_pan_ID;
 	nib->depth          = 0;
 	nib->dev_type       = NWK_COORDINATOR;
-	nib->cskip          = nwk_rte_tree_calc_cskip(nib->depth);
+	nwk_rte_tree_calc_cskip_tbl();
 
 	req.channel         = channel + MAC_PHY_CHANNEL_OFFSET;
 	req.pan_id          = pan_id;
 	mac_start_req(&req);
+
+	/* a concentrator sets up the routes to itself as soon as the network is up */
+	nwk_rte_mesh_mto_start();
+	nwk_link_status_start();
 	nwk_form_conf(NWK_SUCCESS);
 }
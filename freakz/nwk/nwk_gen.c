@@ -87,6 +87,7 @@ U16 nwk_gen_frm_ctrl(const nwk_hdr_t *hdr)
  * - Destination IEEE address  (optional)
  * - Source IEEE address       (optional)
  * - Multicast
+ * - Source route subframe      (optional)
  */
 void nwk_gen_header(buffer_t *buf, nwk_hdr_t *hdr)
 {
@@ -103,6 +104,7 @@ void nwk_gen_header(buffer_t *buf, nwk_hdr_t *hdr)
 	nhdr_size += (hdr->nwk_frm_ctrl.dest_ieee_addr_flag) ? 8 : 0;
 	nhdr_size += (hdr->nwk_frm_ctrl.src_ieee_addr_flag) ? 8 : 0;
 	nhdr_size += (hdr->nwk_frm_ctrl.mcast_flag) ? 1 : 0;
+	nhdr_size += (hdr->nwk_frm_ctrl.src_rte) ? (2 + (hdr->relay_cnt * sizeof(U16))) : 0;
 
 	/* fill in the length and adjust the data pointer */
 	buf->dptr -= nhdr_size;
@@ -131,6 +133,20 @@ void nwk_gen_header(buffer_t *buf, nwk_hdr_t *hdr)
 		buf->dptr += sizeof(U64);
 	}
 
+	if (hdr->nwk_frm_ctrl.mcast_flag)
+		*buf->dptr++ = hdr->mcast_ctrl;
+
+	if (hdr->nwk_frm_ctrl.src_rte) {
+		U8 i;
+
+		*buf->dptr++ = hdr->relay_cnt;
+		*buf->dptr++ = hdr->relay_idx;
+		for (i = 0; i < hdr->relay_cnt; i++) {
+			*(U16 *)buf->dptr = hdr->relay_list[i];
+			buf->dptr += sizeof(U16);
+		}
+	}
+
 	/* roll back the dptr to the beginning of the header */
 	buf->dptr -= nhdr_size;
 }
@@ -162,12 +178,20 @@ void nwk_gen_cmd(buffer_t *buf, const nwk_cmd_t *cmd)
 		NWK_CMD_SIZE_NWK_UPDATE
 	};
 
+	U8 size = cmd_size[cmd->cmd_frm_id];
+
+	/* the route record and link status have variable length lists */
+	if (cmd->cmd_frm_id == NWK_CMD_RTE_REC)
+		size += cmd->rte_rec.relay_cnt * sizeof(U16);
+	else if (cmd->cmd_frm_id == NWK_CMD_LINK_STATUS)
+		size += (cmd->link_status.cmd_opts & NWK_LINK_STATUS_CNT_MASK) * (sizeof(U16) + 1);
+
 	/*
 	 * Move the data pointer back and increment the
 	 * length count of the buffer by "size" bytes
 	 */
-	buf->dptr -= cmd_size[cmd->cmd_frm_id];
-	buf->len += cmd_size[cmd->cmd_frm_id];
+	buf->dptr -= size;
+	buf->len += size;
 
 	/* Add the command ID */
 	*buf->dptr++ = cmd->cmd_frm_id;
@@ -191,15 +215,43 @@ void nwk_gen_cmd(buffer_t *buf, const nwk_cmd_t *cmd)
 		buf->dptr += sizeof(U16);
 		*buf->dptr++        = cmd->rrep.path_cost;
 		break;
+	case NWK_CMD_NWK_STATUS:
+		*buf->dptr++        = cmd->status.status_code;
+		*(U16 *)buf->dptr   = cmd->status.dest_addr;
+		buf->dptr += sizeof(U16);
+		break;
 	case NWK_CMD_LEAVE:
 		*buf->dptr++        = cmd->leave.cmd_opts;
 		break;
+	case NWK_CMD_RTE_REC:
+	{
+		U8 i;
+
+		*buf->dptr++        = cmd->rte_rec.relay_cnt;
+		for (i = 0; i < cmd->rte_rec.relay_cnt; i++) {
+			*(U16 *)buf->dptr = cmd->rte_rec.relay_list[i];
+			buf->dptr += sizeof(U16);
+		}
+		break;
+	}
+	case NWK_CMD_LINK_STATUS:
+	{
+		U8 i;
+
+		*buf->dptr++        = cmd->link_status.cmd_opts;
+		for (i = 0; i < (cmd->link_status.cmd_opts & NWK_LINK_STATUS_CNT_MASK); i++) {
+			*(U16 *)buf->dptr = cmd->link_status.nbor_addr[i];
+			buf->dptr += sizeof(U16);
+			*buf->dptr++      = cmd->link_status.link_status[i];
+		}
+		break;
+	}
 	default:
 		break;
 	}
 
 	/* roll back the dptr to the beginning of the command payload */
-	buf->dptr -= cmd_size[cmd->cmd_frm_id];
+	buf->dptr -= size;
 }
 
 /*
@@ -128,7 +128,7 @@ void mac_assoc_conf(U16 addr, U8 mac_status)
 		nib->short_addr         = addr;
 		nib->ext_pan_ID         = NBOR_ENTRY(nbor_mem_ptr)->ext_pan_id;
 		nib->depth              = NBOR_ENTRY(nbor_mem_ptr)->depth + 1;
-		nib->cskip              = nwk_rte_tree_calc_cskip(nib->depth);
+		nwk_rte_tree_calc_cskip_tbl();
 
 		/*
 		 * don't forget to set the short address
@@ -137,6 +137,9 @@ void mac_assoc_conf(U16 addr, U8 mac_status)
 		mac_set_short_addr(addr);
 		status = NWK_SUCCESS;
 
+		/* routers start telling their neighbors about their links */
+		nwk_link_status_start();
+
 		nwk_join_conf(status,
 			      addr,
 			      nib->ext_pan_ID,
@@ -0,0 +1,205 @@
+/*******************************************************************
+    Copyright (C) 2009 FreakLabs
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+    4. This software is subject to the additional restrictions placed on the
+       Zigbee Specification's Terms of Use.
+
+    THIS SOFTWARE IS PROVIDED BY THE THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+
+    Originally written by Christopher Wang aka Akiba.
+    Please post support questions to the FreakLabs forum.
+
+*******************************************************************/
+/*!
+    \file nwk_link_status.c
+    \ingroup nwk
+    \brief NWK link status
+
+    This file implements the link status exchange between routers. Every
+    link status period, each router broadcasts the list of its router
+    neighbors to its one hop neighborhood along with the incoming cost
+    it measured for each link. The neighbors take their outgoing cost
+    from the entry that lists them. Routers that stop sending link
+    statuses get aged out of the neighbor table and the routes through
+    them get invalidated before any frame gets sent to them.
+*/
+#include "freakz.h"
+
+/* Callback timer for the link status period */
+static struct ctimer link_status_tmr;
+
+/*
+ * Find the router neighbor with the lowest address that is greater than or
+ * equal to the specified address. The link status list needs to be sorted
+ * by address and the table isn't, so this is how we walk it in order.
+ */
+static mem_ptr_t *nwk_link_status_next(U32 addr)
+{
+	mac_pib_t *pib = mac_pib_get();
+	nwk_nib_t *nib = nwk_nib_get();
+	mem_ptr_t *mem_ptr, *min = NULL;
+
+	for (mem_ptr = nwk_neighbor_tbl_get_head(); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	{
+		if ((NBOR_ENTRY(mem_ptr)->device_type == NWK_END_DEVICE) ||
+		    (NBOR_ENTRY(mem_ptr)->pan_id != pib->pan_id) ||
+		    (NBOR_ENTRY(mem_ptr)->nwk_addr == INVALID_NWK_ADDR) ||
+		    (NBOR_ENTRY(mem_ptr)->age > nib->router_age_limit) ||
+		    (NBOR_ENTRY(mem_ptr)->nwk_addr < addr))
+			continue;
+
+		if (!min || (NBOR_ENTRY(mem_ptr)->nwk_addr < NBOR_ENTRY(min)->nwk_addr))
+			min = mem_ptr;
+	}
+	return min;
+}
+
+/*
+ * Generate and broadcast the link status frames. The router neighbors are
+ * split up over as many frames as it takes. If we don't have any, then a
+ * single empty frame still goes out so that the neighbors know we're alive.
+ */
+static void nwk_link_status_send()
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	nwk_hdr_t hdr;
+	nwk_cmd_t cmd;
+	buffer_t *buf;
+	mem_ptr_t *mem_ptr;
+	U32 addr = 0;
+	U8 cnt, opts = NWK_LINK_STATUS_FIRST_FRM;
+
+	mem_ptr = nwk_link_status_next(addr);
+	do
+	{
+		for (cnt = 0; mem_ptr && (cnt < NWK_MAX_LINK_STATUS_ENTRIES); cnt++)
+		{
+			cmd.link_status.nbor_addr[cnt]   = NBOR_ENTRY(mem_ptr)->nwk_addr;
+			cmd.link_status.link_status[cnt] =
+				(nwk_neighbor_tbl_get_in_cost(mem_ptr) & NWK_LINK_STATUS_IN_COST_MASK) |
+				((NBOR_ENTRY(mem_ptr)->out_cost & NWK_LINK_STATUS_IN_COST_MASK)
+				 << NWK_LINK_STATUS_OUT_COST_OFFSET);
+
+			addr = (U32)NBOR_ENTRY(mem_ptr)->nwk_addr + 1;
+			mem_ptr = nwk_link_status_next(addr);
+		}
+
+		opts |= (mem_ptr == NULL) ? NWK_LINK_STATUS_LAST_FRM : 0;
+		cmd.cmd_frm_id          = NWK_CMD_LINK_STATUS;
+		cmd.link_status.cmd_opts = opts | cnt;
+		opts = 0;
+
+		/* link statuses only go one hop */
+		memset(&hdr, 0, sizeof(nwk_hdr_t));
+		hdr.nwk_frm_ctrl.frame_type = NWK_CMD_FRM;
+		hdr.nwk_frm_ctrl.disc_route = false;
+		hdr.src_addr                = nib->short_addr;
+		hdr.dest_addr               = NWK_BROADCAST_ROUTERS_COORD;
+		hdr.radius                  = 1;
+		hdr.seq_num                 = nib->seq_num++;
+
+		BUF_ALLOC(buf, TX);
+		nwk_gen_cmd(buf, &cmd);
+		nwk_fwd(buf, &hdr);
+	} while (mem_ptr);
+}
+
+/*
+ * Start the link status exchange. Only routers and the coordinator take
+ * part. The first link status goes out right away so the neighbors can
+ * find us.
+ */
+void nwk_link_status_start()
+{
+	nwk_nib_t *nib = nwk_nib_get();
+
+	if (nib->dev_type == NWK_END_DEVICE)
+		return;
+
+	ctimer_set(&link_status_tmr, drvr_get_rand() % NWK_LINK_STATUS_JITTER,
+		   nwk_link_status_periodic, NULL);
+}
+
+/*
+ * This is the periodic function for the link status exchange. It ages the
+ * router neighbors and then sends out our link status. The period gets a
+ * bit of jitter so that neighboring routers don't stay in lock step.
+ */
+void nwk_link_status_periodic(void *ptr)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+
+	nwk_neighbor_tbl_age();
+	nwk_link_status_send();
+	ctimer_set(&link_status_tmr,
+		   (nib->link_status_period * CLOCK_SECOND) + (drvr_get_rand() % NWK_LINK_STATUS_JITTER),
+		   nwk_link_status_periodic,
+		   NULL);
+}
+
+/* Stop the link status timer */
+void nwk_link_status_stop_tmr()
+{
+	ctimer_stop(&link_status_tmr);
+}
+
+/*
+ * Handle an incoming link status. It has to come straight from the router
+ * that generated it. Look for our address in the list to get the cost that
+ * the neighbor sees for frames from us. If the list is split over several
+ * frames, only the frame whose address range covers us can tell us that
+ * we're missing from it.
+ */
+void nwk_link_status_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	U8 i, cnt, out_cost = 0;
+	bool covered;
+
+	if ((nib->dev_type == NWK_END_DEVICE) ||
+	    (hdr_in->mac_hdr->src_addr.mode != SHORT_ADDR) ||
+	    (hdr_in->mac_hdr->src_addr.short_addr != hdr_in->src_addr))
+		return;
+
+	cnt = cmd_in->link_status.cmd_opts & NWK_LINK_STATUS_CNT_MASK;
+	if (cnt > NWK_MAX_LINK_STATUS_ENTRIES)
+		cnt = NWK_MAX_LINK_STATUS_ENTRIES;
+
+	covered = ((cmd_in->link_status.cmd_opts & NWK_LINK_STATUS_FIRST_FRM) ||
+		   (cnt && (nib->short_addr >= cmd_in->link_status.nbor_addr[0]))) &&
+		  ((cmd_in->link_status.cmd_opts & NWK_LINK_STATUS_LAST_FRM) ||
+		   (cnt && (nib->short_addr <= cmd_in->link_status.nbor_addr[cnt - 1])));
+
+	for (i = 0; i < cnt; i++)
+	{
+		if (cmd_in->link_status.nbor_addr[i] == nib->short_addr)
+		{
+			out_cost = cmd_in->link_status.link_status[i] & NWK_LINK_STATUS_IN_COST_MASK;
+			break;
+		}
+	}
+	nwk_neighbor_tbl_link_status(hdr_in->src_addr, hdr_in->lqi, covered, out_cost);
+}
@@ -0,0 +1,175 @@
+/*******************************************************************
+    Copyright (C) 2009 FreakLabs
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+    4. This software is subject to the additional restrictions placed on the
+       Zigbee Specification's Terms of Use.
+
+    THIS SOFTWARE IS PROVIDED BY THE THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+
+    Originally written by Christopher Wang aka Akiba.
+    Please post support questions to the FreakLabs forum.
+
+*******************************************************************/
+/*!
+    \file nwk_mcast.c
+    \ingroup nwk
+    \brief NWK multicast
+
+    This file implements NWK layer multicast for group traffic. Instead of
+    flooding the whole network, a group frame only spreads as far as the
+    group itself:
+    - A member of the group sends the frame in member mode. It goes out
+    as a broadcast and every member that hears it delivers it and relays it.
+    - Non-members relay member mode frames too, but only for up to
+    MaxNonmemberRadius hops away from the last member. This is how the
+    frame gets across gaps between members.
+    - A non-member sends the frame in non-member mode. It gets unicast
+    along a route to the closest member, which is found with a multicast
+    route discovery. The first member to receive it switches it to member
+    mode and broadcasts it from there.
+*/
+/**************************************************************************/
+#include "freakz.h"
+
+/*
+ * Check if this device is a member of the group. The NIB's group ID table
+ * is the APS group table in this stack, so we're a member if any of our
+ * endpoints are.
+ */
+bool nwk_mcast_is_member(U16 grp_id)
+{
+	return aps_grp_exists(grp_id);
+}
+
+/*
+ * Send out a multicast frame that we're originating. The header has been
+ * filled out by the data request already. If we're a member of the group,
+ * the frame goes out as a member mode broadcast. Otherwise, it goes towards
+ * the closest member in non-member mode.
+ */
+void nwk_mcast_data_req(buffer_t *buf, nwk_hdr_t *hdr, U8 non_memb_radius)
+{
+	U8 radius;
+
+	radius = (non_memb_radius > NWK_NON_MEMB_RADIUS_INFIN) ? NWK_NON_MEMB_RADIUS_INFIN : non_memb_radius;
+	hdr->nwk_frm_ctrl.mcast_flag = true;
+
+	if (nwk_mcast_is_member(hdr->dest_addr))
+	{
+		hdr->mcast_ctrl = NWK_MCAST_CTRL(NWK_MCAST_MEMBER_MODE, radius, radius);
+		hdr->nwk_frm_ctrl.disc_route = false;
+		nwk_brc_start(buf, hdr);
+		return;
+	}
+
+	hdr->mcast_ctrl = NWK_MCAST_CTRL(NWK_MCAST_NON_MEMBER_MODE, radius, radius);
+	nwk_fwd(buf, hdr);
+}
+
+/*
+ * Handle an incoming multicast data frame. Members get a copy of it. Then
+ * we decide if it needs to go further.
+ */
+void nwk_mcast_rx(buffer_t *buf, nwk_hdr_t *hdr)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	nwk_pcb_t *pcb = nwk_pcb_get();
+	buffer_t *buf_in;
+	bool member;
+	U8 radius, max_radius;
+
+	member      = nwk_mcast_is_member(hdr->dest_addr);
+	radius      = NWK_MCAST_RADIUS(hdr->mcast_ctrl);
+	max_radius  = NWK_MCAST_MAX_RADIUS(hdr->mcast_ctrl);
+
+	if (NWK_MCAST_MODE(hdr->mcast_ctrl) == NWK_MCAST_MEMBER_MODE)
+	{
+		/*
+		 * member mode frames are broadcasts. record the sender
+		 * for the passive acks and drop the ones we've already
+		 * seen.
+		 */
+		nwk_brc_add_new_sender(hdr->src_addr, hdr->seq_num);
+		if (hdr->seq_num == pcb->brc_seq)
+		{
+			nwk_brc_heard_relay();
+			buf_free(buf);
+			return;
+		}
+	}
+	else if (!member)
+	{
+		/* we're just a hop on the way to the group. keep routing it. */
+		if (hdr->radius == 0)
+		{
+			buf_free(buf);
+			return;
+		}
+		hdr->radius--;
+		nwk_fwd(buf, hdr);
+		return;
+	}
+
+	if (member)
+	{
+		/*
+		 * send a copy up and relay the frame in member mode. the
+		 * non-member radius starts over from here.
+		 */
+		if ((buf_in = buf_dup(buf)) != NULL)
+		{
+			nwk_data_ind(buf_in, hdr);
+		}
+		radius = max_radius;
+	}
+	else
+	{
+		/* non-members only pass it on for a limited number of hops */
+		if (radius == 0)
+		{
+			pcb->drop_mcast_frm++;
+			buf_free(buf);
+			return;
+		}
+
+		if (radius != NWK_NON_MEMB_RADIUS_INFIN)
+		{
+			radius--;
+		}
+	}
+
+	/* end devices don't relay. also check if the frame has any hops left. */
+	if ((nib->dev_type == NWK_END_DEVICE) || (hdr->radius == 0))
+	{
+		buf_free(buf);
+		return;
+	}
+
+	hdr->radius--;
+	hdr->mcast_ctrl = NWK_MCAST_CTRL(NWK_MCAST_MEMBER_MODE, radius, max_radius);
+	hdr->nwk_frm_ctrl.disc_route = false;
+	nwk_brc_start(buf, hdr);
+}
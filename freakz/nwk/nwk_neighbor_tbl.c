@@ -52,10 +52,29 @@
  */
 LIST(nbor_tbl);
 
+/*
+ * Unicasts that are waiting for their MAC confirm. The confirm only carries
+ * the handle so we need to remember which neighbor the frame went to in order
+ * to credit the ack, or the lack of one, to the right link. The NWK src and
+ * dest of the frame are kept too so that a broken link can be reported to
+ * whoever was using it.
+ */
+static struct
+{
+	bool	used;
+	U8	handle;
+	U16	addr;
+	U16	src_addr;
+	U16	dest_addr;
+} link_tx[NWK_LINK_TX_SLOTS];
+static U8 link_tx_next;
+
 /* Init the neighbor table */
 void nwk_neighbor_tbl_init()
 {
 	list_init(nbor_tbl);
+	memset(link_tx, 0, sizeof(link_tx));
+	link_tx_next = 0;
 }
 
 /*
@@ -135,8 +154,15 @@ void nwk_neighbor_tbl_add(nbor_tbl_entry_t *entry)
 		{
 			/*
 			 * it's a dupe. use this entry and
-			 * update it with all new info
+			 * update it with all new info. the link
+			 * estimate was built from traffic so keep
+			 * it.
 			 */
+			entry->lqi		= NBOR_ENTRY(mem_ptr)->lqi;
+			entry->etx		= NBOR_ENTRY(mem_ptr)->etx;
+			entry->transmit_fail	= NBOR_ENTRY(mem_ptr)->transmit_fail;
+			entry->out_cost		= NBOR_ENTRY(mem_ptr)->out_cost;
+			entry->age		= NBOR_ENTRY(mem_ptr)->age;
 			memcpy(NBOR_ENTRY(mem_ptr), entry, sizeof(nbor_tbl_entry_t));
 			return;
 		}
@@ -146,7 +172,12 @@ void nwk_neighbor_tbl_add(nbor_tbl_entry_t *entry)
 		 * a mem block and copy the info
 		 */
 		if ((mem_ptr = nwk_neighbor_tbl_alloc()) != NULL)
+		{
 			memcpy(NBOR_ENTRY(mem_ptr), entry, sizeof(nbor_tbl_entry_t));
+
+			/* no traffic yet. start out assuming a clean link. */
+			NBOR_ENTRY(mem_ptr)->etx = NWK_ETX_ONE;
+		}
 	}
 }
 
@@ -214,3 +245,254 @@ U8 nwk_neighbor_get_cnt()
 	}
 	return i;
 }
+
+/* Move the smoothed value a fraction of the way towards the new sample */
+static U8 nwk_neighbor_tbl_ewma(U8 avg, U8 sample)
+{
+	return (U8)((((U16)avg << NWK_LINK_EWMA_SHIFT) - avg + sample) >> NWK_LINK_EWMA_SHIFT);
+}
+
+/*
+ * A frame came in from the neighbor. Fold its LQI into the neighbor's link
+ * estimate. The first frame sets the estimate outright.
+ */
+void nwk_neighbor_tbl_rx_lqi(U16 addr, U8 lqi)
+{
+	mem_ptr_t *mem_ptr;
+	address_t nbor_addr;
+
+	nbor_addr.mode		= SHORT_ADDR;
+	nbor_addr.short_addr	= addr;
+
+	if ((mem_ptr = nwk_neighbor_tbl_get_entry(&nbor_addr)) == NULL)
+		return;
+
+	NBOR_ENTRY(mem_ptr)->lqi = NBOR_ENTRY(mem_ptr)->lqi ?
+				   nwk_neighbor_tbl_ewma(NBOR_ENTRY(mem_ptr)->lqi, lqi) : lqi;
+}
+
+/*
+ * Remember that an acked unicast with the given handle went out to the
+ * neighbor. If all the slots are taken, the oldest one gets reused. Only
+ * data frames keep their src address since a route error about a command
+ * frame isn't reported to anyone.
+ */
+void nwk_neighbor_tbl_tx_track(U16 addr, U8 handle, const nwk_hdr_t *hdr)
+{
+	link_tx[link_tx_next].used	= true;
+	link_tx[link_tx_next].handle	= handle;
+	link_tx[link_tx_next].addr	= addr;
+	link_tx[link_tx_next].src_addr	= (hdr->nwk_frm_ctrl.frame_type == NWK_DATA_FRM) ?
+					  hdr->src_addr : INVALID_NWK_ADDR;
+	link_tx[link_tx_next].dest_addr	= hdr->dest_addr;
+	link_tx_next = (link_tx_next + 1) % NWK_LINK_TX_SLOTS;
+}
+
+/*
+ * The MAC confirm for a tracked unicast came in. An ack counts as one
+ * transmission and no ack counts as NWK_ETX_FAIL in the neighbor's ETX.
+ * Other failures, like a busy channel, say nothing about the link itself.
+ * If more than one frame has the handle, the oldest one gets the confirm.
+ * Once the neighbor misses NWK_LINK_FAIL_THRESH acks in a row, the link
+ * is treated as broken.
+ */
+void nwk_neighbor_tbl_tx_conf(U8 handle, U8 status)
+{
+	U8 i, slot;
+	mem_ptr_t *mem_ptr;
+	address_t nbor_addr;
+
+	for (i=0; i<NWK_LINK_TX_SLOTS; i++)
+	{
+		slot = (link_tx_next + i) % NWK_LINK_TX_SLOTS;
+		if (link_tx[slot].used && (link_tx[slot].handle == handle))
+			break;
+	}
+
+	if (i == NWK_LINK_TX_SLOTS)
+		return;
+
+	link_tx[slot].used	= false;
+	nbor_addr.mode		= SHORT_ADDR;
+	nbor_addr.short_addr	= link_tx[slot].addr;
+
+	if ((mem_ptr = nwk_neighbor_tbl_get_entry(&nbor_addr)) == NULL)
+		return;
+
+	if (status == MAC_SUCCESS)
+	{
+		NBOR_ENTRY(mem_ptr)->etx = nwk_neighbor_tbl_ewma(NBOR_ENTRY(mem_ptr)->etx, NWK_ETX_ONE);
+		NBOR_ENTRY(mem_ptr)->transmit_fail = 0;
+	} else if (status == MAC_NO_ACK) {
+		NBOR_ENTRY(mem_ptr)->etx = nwk_neighbor_tbl_ewma(NBOR_ENTRY(mem_ptr)->etx, NWK_ETX_FAIL);
+		if (NBOR_ENTRY(mem_ptr)->transmit_fail < 0xFF)
+			NBOR_ENTRY(mem_ptr)->transmit_fail++;
+
+		/*
+		 * the neighbor entry stays. its ETX already took the hit so
+		 * the link costs more in route discovery, and the aging drops
+		 * it if it really went away.
+		 */
+		if (NBOR_ENTRY(mem_ptr)->transmit_fail >= NWK_LINK_FAIL_THRESH)
+			nwk_status_link_fail(link_tx[slot].addr, link_tx[slot].src_addr, link_tx[slot].dest_addr);
+	}
+}
+
+/*
+ * The LQI gives the delivery probability p = lqi/255 and the spec's link cost
+ * of 1/p^4, rounded and capped at NWK_MAX_LINK_COST. Working that out needs
+ * more than 32 bits so the breakpoints are precomputed instead. Entry n is
+ * the lowest LQI that still gets a cost of n + 1.
+ */
+static const U8 lqi_cost_tbl[NWK_MAX_LINK_COST - 1] = {231, 203, 187, 176, 167, 160};
+
+static U8 nwk_neighbor_tbl_lqi_cost(U8 lqi)
+{
+	U8 cost;
+
+	for (cost = 1; cost < NWK_MAX_LINK_COST; cost++)
+	{
+		if (lqi >= lqi_cost_tbl[cost - 1])
+			return cost;
+	}
+	return NWK_MAX_LINK_COST;
+}
+
+/*
+ * Return the incoming cost of the link, which is what we measure on the
+ * frames that the neighbor sends us. This is the cost that goes into our
+ * link status for the neighbor.
+ */
+U8 nwk_neighbor_tbl_get_in_cost(const mem_ptr_t *mem_ptr)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+
+	if (nib->report_const_cost || !NBOR_ENTRY(mem_ptr)->lqi)
+		return NWK_STATIC_PATH_COST;
+	return nwk_neighbor_tbl_lqi_cost(NBOR_ENTRY(mem_ptr)->lqi);
+}
+
+/*
+ * Return the cost of the link to the neighbor, from 1 to NWK_MAX_LINK_COST.
+ * The smoothed LQI gives one cost and the ETX, the average number of
+ * transmissions it takes to get a frame across, gives another. If the
+ * neighbor's link status told us its side of the link, that's a third. The
+ * link gets the worst of them. If the neighbor isn't in the table, the cost
+ * comes from rx_lqi, the LQI of a frame just received from it, if there is
+ * one. If the NIB says to report constant costs or we know nothing about the
+ * link, the static path cost is used.
+ */
+U8 nwk_neighbor_tbl_get_link_cost(U16 addr, U8 rx_lqi)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	mem_ptr_t *mem_ptr;
+	address_t nbor_addr;
+	U8 lqi_cost, etx_cost;
+
+	nbor_addr.mode		= SHORT_ADDR;
+	nbor_addr.short_addr	= addr;
+
+	if (nib->report_const_cost)
+		return NWK_STATIC_PATH_COST;
+
+	if (((mem_ptr = nwk_neighbor_tbl_get_entry(&nbor_addr)) == NULL) ||
+	    !NBOR_ENTRY(mem_ptr)->lqi)
+		return rx_lqi ? nwk_neighbor_tbl_lqi_cost(rx_lqi) : NWK_STATIC_PATH_COST;
+
+	lqi_cost = nwk_neighbor_tbl_lqi_cost(NBOR_ENTRY(mem_ptr)->lqi);
+	etx_cost = (NBOR_ENTRY(mem_ptr)->etx + (NWK_ETX_ONE >> 1)) / NWK_ETX_ONE;
+
+	if (etx_cost > lqi_cost)
+		lqi_cost = etx_cost;
+	if (NBOR_ENTRY(mem_ptr)->out_cost > lqi_cost)
+		lqi_cost = NBOR_ENTRY(mem_ptr)->out_cost;
+	if (lqi_cost > NWK_MAX_LINK_COST)
+		lqi_cost = NWK_MAX_LINK_COST;
+	return lqi_cost ? lqi_cost : 1;
+}
+
+/*
+ * A link status came in from a router neighbor. out_cost is the cost that the
+ * neighbor measured for frames from us, or 0 if it didn't list us at all. If
+ * the frame doesn't cover our address, then it only refreshes the age. A
+ * router we didn't know about gets added to the table since it's obviously in
+ * range. If it stopped listing us, the link only works one way and routes
+ * through it get invalidated.
+ */
+void nwk_neighbor_tbl_link_status(U16 addr, U8 lqi, bool covered, U8 out_cost)
+{
+	mac_pib_t *pib = mac_pib_get();
+	mem_ptr_t *mem_ptr;
+	address_t nbor_addr;
+
+	nbor_addr.mode		= SHORT_ADDR;
+	nbor_addr.short_addr	= addr;
+
+	if ((mem_ptr = nwk_neighbor_tbl_get_entry(&nbor_addr)) == NULL)
+	{
+		nbor_tbl_entry_t entry;
+
+		memset(&entry, 0, sizeof(nbor_tbl_entry_t));
+		entry.ext_addr		= INVALID_EXT_ADDR;
+		entry.nwk_addr		= addr;
+		entry.pan_id		= pib->pan_id;
+		entry.device_type	= NWK_ROUTER;
+		entry.rx_on_when_idle	= true;
+		entry.relationship	= NWK_NONE;
+		entry.channel		= pib->curr_channel;
+		entry.lqi		= lqi;
+		nwk_neighbor_tbl_add(&entry);
+
+		if ((mem_ptr = nwk_neighbor_tbl_get_entry(&nbor_addr)) == NULL)
+			return;
+	}
+
+	NBOR_ENTRY(mem_ptr)->age = 0;
+	if (!covered)
+		return;
+
+	if (NBOR_ENTRY(mem_ptr)->out_cost && !out_cost)
+	{
+		nwk_rte_tbl_invalidate_next_hop(addr);
+		nwk_rte_src_rem_next_hop(addr);
+	}
+	NBOR_ENTRY(mem_ptr)->out_cost = out_cost;
+}
+
+/*
+ * Age the router neighbors. This gets called once every link status period.
+ * A router that misses more than the NIB's router age limit of link statuses
+ * has gone stale. Routes through it get invalidated right away instead of
+ * waiting for MAC retries to fail on the next frame. Stale parents and
+ * children stay in the table since tree routing needs them, but lose their
+ * outgoing cost. Everyone else gets evicted.
+ */
+void nwk_neighbor_tbl_age()
+{
+	nwk_pcb_t *pcb = nwk_pcb_get();
+	nwk_nib_t *nib = nwk_nib_get();
+	mem_ptr_t *mem_ptr, *next;
+
+	for (mem_ptr = list_head(nbor_tbl); mem_ptr != NULL; mem_ptr = next)
+	{
+		next = mem_ptr->next;
+
+		if (NBOR_ENTRY(mem_ptr)->device_type == NWK_END_DEVICE)
+			continue;
+
+		if (NBOR_ENTRY(mem_ptr)->age < 0xFF)
+			NBOR_ENTRY(mem_ptr)->age++;
+
+		if (NBOR_ENTRY(mem_ptr)->age != (nib->router_age_limit + 1))
+			continue;
+
+		pcb->stale_nbor++;
+		NBOR_ENTRY(mem_ptr)->out_cost = 0;
+		nwk_rte_tbl_invalidate_next_hop(NBOR_ENTRY(mem_ptr)->nwk_addr);
+		nwk_rte_src_rem_next_hop(NBOR_ENTRY(mem_ptr)->nwk_addr);
+
+		if ((NBOR_ENTRY(mem_ptr)->relationship != NWK_PARENT) &&
+		    (NBOR_ENTRY(mem_ptr)->relationship != NWK_CHILD))
+			nwk_neighbor_tbl_free(mem_ptr);
+	}
+}
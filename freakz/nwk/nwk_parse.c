@@ -88,17 +88,24 @@ void nwk_parse_hdr(buffer_t *buf, nwk_hdr_t *hdr)
 		hdr->mcast_ctrl = *buf->dptr++;
 
 	if (hdr->nwk_frm_ctrl.src_rte) {
-		U8 relay_cnt;
+		U8 i, relay_cnt;
 
 		/*
-		 * The source route list is a variable list so we
-		 * need to calculate the size if its present. That
-		 * way, we know how much we need to increment the ptr
-		 * to get to the payload.
+		 * The source route subframe is a relay count, a relay
+		 * index, and a variable list of relays. We only keep as
+		 * many relays as we have room for, but we always skip
+		 * the whole list so that the dptr ends up at the payload.
 		 */
-		hdr->src_rte_subfrm = buf->dptr;
-		relay_cnt = *buf->dptr;
+		relay_cnt = *buf->dptr++;
+		hdr->relay_idx = *buf->dptr++;
+		hdr->relay_cnt = (relay_cnt > NWK_MAX_SRC_RTE_RELAYS) ?
+					NWK_MAX_SRC_RTE_RELAYS : relay_cnt;
+
+		for (i = 0; i < hdr->relay_cnt; i++)
+			hdr->relay_list[i] = *(U16 *)(buf->dptr + (i * sizeof(U16)));
 		buf->dptr += relay_cnt * sizeof(U16);
+	} else {
+		hdr->relay_cnt = 0;
 	}
 }
 
@@ -130,10 +137,48 @@ void nwk_parse_cmd(buffer_t *buf, nwk_cmd_t *cmd)
 		buf->dptr += sizeof(U16);
 		cmd->rrep.path_cost     = *buf->dptr++;
 		break;
+	case NWK_CMD_NWK_STATUS:
+		/* command was a network status */
+		cmd->status.status_code = *buf->dptr++;
+		cmd->status.dest_addr   = *(U16 *)buf->dptr;
+		buf->dptr += sizeof(U16);
+		break;
 	case NWK_CMD_LEAVE:
 		/* command was a leave request */
 		cmd->leave.cmd_opts     = *buf->dptr++;
 		break;
+	case NWK_CMD_RTE_REC:
+	{
+		U8 i, relay_cnt;
+
+		/* command was a route record. only keep what fits in the list. */
+		relay_cnt = *buf->dptr++;
+		cmd->rte_rec.relay_cnt = (relay_cnt > NWK_MAX_SRC_RTE_RELAYS) ?
+						NWK_MAX_SRC_RTE_RELAYS : relay_cnt;
+
+		for (i = 0; i < cmd->rte_rec.relay_cnt; i++)
+			cmd->rte_rec.relay_list[i] = *(U16 *)(buf->dptr + (i * sizeof(U16)));
+		buf->dptr += relay_cnt * sizeof(U16);
+		break;
+	}
+	case NWK_CMD_LINK_STATUS:
+	{
+		U8 i, cnt;
+
+		/* command was a link status. only keep what fits in the list. */
+		cmd->link_status.cmd_opts = *buf->dptr++;
+		cnt = cmd->link_status.cmd_opts & NWK_LINK_STATUS_CNT_MASK;
+		if (cnt > NWK_MAX_LINK_STATUS_ENTRIES)
+			cnt = NWK_MAX_LINK_STATUS_ENTRIES;
+
+		for (i = 0; i < cnt; i++)
+		{
+			cmd->link_status.nbor_addr[i] = *(U16 *)buf->dptr;
+			buf->dptr += sizeof(U16);
+			cmd->link_status.link_status[i] = *buf->dptr++;
+		}
+		break;
+	}
 	default:
 		break;
 	}
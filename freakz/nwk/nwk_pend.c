@@ -88,6 +88,26 @@ void nwk_pend_free(mem_ptr_t *mem_ptr)
 	}
 }
 
+/*
+ * Slow timer callback for a pending entry. On expiration, the pending entry
+ * and its buffer will be freed. No route was found in time so the
+ * originator gets told that it needs to look for another one.
+ */
+static void nwk_pend_expire(void *ptr)
+{
+	mem_ptr_t *mem_ptr = ptr;
+	nwk_hdr_t hdr;
+
+	memset(&hdr, 0, sizeof(nwk_hdr_t));
+	hdr.src_addr    = PEND_ENTRY(mem_ptr)->src_addr;
+	hdr.dest_addr   = PEND_ENTRY(mem_ptr)->dest_addr;
+	memcpy(&hdr.nwk_frm_ctrl, &PEND_ENTRY(mem_ptr)->frm_ctrl, sizeof(nwk_frm_ctrl_t));
+	nwk_status_rte_fail(&hdr, NWK_STATUS_NO_ROUTE_AVAIL);
+
+	buf_free(PEND_ENTRY(mem_ptr)->buf);
+	nwk_pend_free(mem_ptr);
+}
+
 /* Remove all entries from the pending list */
 void nwk_pend_clear()
 {
@@ -119,7 +139,8 @@ void nwk_pend_add_new(buffer_t *buf, nwk_hdr_t *hdr)
 		PEND_ENTRY(mem_ptr)->radius       = hdr->radius;
 		PEND_ENTRY(mem_ptr)->seq          = hdr->seq_num;
 		PEND_ENTRY(mem_ptr)->handle       = hdr->handle;
-		PEND_ENTRY(mem_ptr)->expiry       = NWK_PEND_TIMEOUT;
+		PEND_ENTRY(mem_ptr)->mcast_ctrl   = hdr->mcast_ctrl;
+		slow_tmr_set(&mem_ptr->tmr, NWK_PEND_TIMEOUT, nwk_pend_expire, mem_ptr);
 	}
 }
 
@@ -138,15 +159,18 @@ void nwk_pend_send_pending()
 		 * go through all of the entries in the pending list
 		 * and check if they can be forwarded.
 		 */
-		if (nwk_rte_tbl_rte_exists(PEND_ENTRY(mem_ptr)->dest_addr))
+		if (nwk_rte_tbl_find(PEND_ENTRY(mem_ptr)->dest_addr,
+				     PEND_ENTRY(mem_ptr)->frm_ctrl.mcast_flag) != NULL)
 		{
 			nwk_hdr_t hdr_out;
 
+			memset(&hdr_out, 0, sizeof(nwk_hdr_t));
 			hdr_out.src_addr    = PEND_ENTRY(mem_ptr)->src_addr;
 			hdr_out.dest_addr   = PEND_ENTRY(mem_ptr)->dest_addr;
 			hdr_out.radius      = PEND_ENTRY(mem_ptr)->radius;
 			hdr_out.handle      = PEND_ENTRY(mem_ptr)->handle;
 			hdr_out.seq_num     = PEND_ENTRY(mem_ptr)->seq;
+			hdr_out.mcast_ctrl  = PEND_ENTRY(mem_ptr)->mcast_ctrl;
 			memcpy(&hdr_out.nwk_frm_ctrl,
 				&PEND_ENTRY(mem_ptr)->frm_ctrl,
 				sizeof(nwk_frm_ctrl_t));
@@ -156,24 +180,3 @@ void nwk_pend_send_pending()
 		}
 	}
 }
-
-/*
- * Periodic function. This function gets called once per second and will
- * decrement the expiry in the pending queue entries. On expiration, the
- * pending entry and its buffer will be freed.
- */
-void nwk_pend_periodic()
-{
-	mem_ptr_t *mem_ptr;
-
-	for (mem_ptr = list_head(pend_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-	{
-		if (PEND_ENTRY(mem_ptr)->expiry == 0)
-		{
-			buf_free(PEND_ENTRY(mem_ptr)->buf);
-			nwk_pend_free(mem_ptr);
-		} else {
-			PEND_ENTRY(mem_ptr)->expiry--;
-		}
-	}
-}
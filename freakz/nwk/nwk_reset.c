@@ -54,6 +54,8 @@ void nwk_reset_req(bool cold_start)
 		slow_clock_stop();
 		nwk_sync_stop_tmr();
 		nwk_rte_mesh_stop_tmr();
+		nwk_link_status_stop_tmr();
+		nwk_brc_stop_tmr();
 		nwk_init();
 		slow_clock_init();
 	}
@@ -61,6 +63,7 @@ void nwk_reset_req(bool cold_start)
 	/* clear all the tables */
 	nwk_rte_disc_clear();
 	nwk_rte_tbl_clear();
+	nwk_rte_src_clear();
 	nwk_neighbor_tbl_clear();
 	nwk_pend_clear();
 	nwk_brc_clear();
@@ -62,130 +62,168 @@
 #include "freakz.h"
 
 /*
- * List head for the route discovery table. When a route request frame is
- * received during somebody's route discovery process, then we need to create
- * a discovery entry and keep it here. It contains info on the previous hop.
- * If we get a route reply before the discovery timeout, then we add this
- * discovery entry to the routing table and it ends up becoming a route. That is
- * unless we find another path with less of a path cost.
+ * The route discovery table. When a route request frame is received during
+ * somebody's route discovery process, then we need to create a discovery
+ * entry and keep it here. It contains info on the previous hop. If we get a
+ * route reply before the discovery timeout, then we add this discovery entry
+ * to the routing table and it ends up becoming a route. That is unless we
+ * find another path with less of a path cost.
+ *
+ * The table is a fixed pool so a flood of route requests can't eat up the
+ * heap. Every received rreq and rrep does a lookup, so the entries are also
+ * chained into hash buckets on the rreq ID and originator.
  */
-LIST(disc_tbl);
+static disc_entry_t disc_tbl[NWK_MAX_RTE_DISC_ENTRIES];
+
+/* Hash buckets for the discovery table */
+static disc_entry_t *disc_hash[NWK_RTE_DISC_HASH_SIZE];
 
 /* Init the route discovery table */
 void nwk_rte_disc_tbl_init()
 {
-	list_init(disc_tbl);
+	memset(disc_tbl, 0, sizeof(disc_tbl));
+	memset(disc_hash, 0, sizeof(disc_hash));
+}
+
+/* Hash the route request ID and originator into a bucket index */
+static U8 nwk_rte_disc_hash(U8 rreq_id, U16 src_addr)
+{
+	return (rreq_id ^ (U8)src_addr ^ (U8)(src_addr >> 8)) & (NWK_RTE_DISC_HASH_SIZE - 1);
 }
 
 /*
- * Find a free entry in the discovery entry pool and add
- * it to the discovery table.
+ * Timer callback for a discovery entry. Free the entry since it's
+ * expired. Also, if the rte table entry is not active, we will free it
+ * as well.
  */
-static mem_ptr_t *nwk_rte_disc_alloc()
+static void nwk_rte_disc_expire(void *ptr)
 {
-	mem_ptr_t *mem_ptr;
+	disc_entry_t *entry = ptr;
+	mem_ptr_t *rte_mem_ptr;
 
-	if ((mem_ptr = mem_heap_alloc(sizeof(disc_entry_t))) != NULL)
+	DBG_PRINT("NWK_RTE_DISC_EXPIRE: Freeing discovery entry - src addr = %02X\n.", entry->src_addr);
+	if ((rte_mem_ptr = nwk_rte_tbl_find(entry->dest_addr, entry->grp_id)) != NULL)
 	{
-		list_add(disc_tbl, mem_ptr);
+		// free the rte table entry if its not active.
+		if (RTE_ENTRY(rte_mem_ptr)->status != NWK_ACTIVE)
+			nwk_rte_tbl_free(rte_mem_ptr);
 	}
-	return mem_ptr;
-}
 
-/* Remove the discovery entry from the table and free it. */
-void nwk_rte_disc_free(mem_ptr_t *mem_ptr)
-{
-	if (mem_ptr)
-	{
-		list_remove(disc_tbl, mem_ptr);
-		mem_heap_free(mem_ptr);
-	}
+	nwk_rte_disc_free(entry);
 }
 
-/* Remove all entries from the route discovery table */
-void nwk_rte_disc_clear()
+/*
+ * Find a free entry in the discovery table. If the table is full, then the
+ * entry that's closest to expiring gets pushed out to make room. The newest
+ * discovery is the one most likely to still get a reply, and the oldest one
+ * would be gone soon anyways. The scan only covers the fixed pool so it's
+ * bounded even during a discovery storm.
+ */
+static disc_entry_t *nwk_rte_disc_alloc()
 {
-	mem_ptr_t *mem_ptr;
+	nwk_pcb_t *pcb = nwk_pcb_get();
+	disc_entry_t *oldest = NULL;
+	U8 i;
 
-	for (mem_ptr = list_chop(disc_tbl); mem_ptr != NULL; mem_ptr = list_chop(disc_tbl))
+	for (i=0; i<NWK_MAX_RTE_DISC_ENTRIES; i++)
 	{
-		nwk_rte_disc_free(mem_ptr);
+		if (!disc_tbl[i].alloc)
+			return &disc_tbl[i];
+
+		if (!oldest || ((clock_time_t)(disc_tbl[i].expiry - oldest->expiry) > ((clock_time_t)-1) / 2))
+			oldest = &disc_tbl[i];
 	}
+
+	DBG_PRINT("NWK_RTE_DISC_ALLOC: Table full. Evicting discovery entry - src addr = %02X.\n", oldest->src_addr);
+	pcb->disc_evicted++;
+	nwk_rte_disc_free(oldest);
+	return oldest;
 }
 
-/*
- * Find a discovery entry based on the route request ID and the source address.
- * This is used when a route reply arrives. The route reply contains the
- * original route request ID which is used to identify the discovery entry,
- * along with the source address.
- */
-mem_ptr_t *nwk_rte_disc_find(U8 rreq_id, U16 src_addr)
+/* Unlink the discovery entry from its hash bucket, stop its timer, and free it. */
+void nwk_rte_disc_free(disc_entry_t *entry)
 {
-	mem_ptr_t *mem_ptr;
+	disc_entry_t **pp;
+
+	if (!entry || !entry->alloc)
+		return;
 
-	for (mem_ptr = list_head(disc_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	for (pp = &disc_hash[nwk_rte_disc_hash(entry->rreq_id, entry->src_addr)]; *pp != NULL; pp = &(*pp)->next)
 	{
-		if ((DISC_ENTRY(mem_ptr)->rreq_id == rreq_id) && (DISC_ENTRY(mem_ptr)->src_addr == src_addr))
+		if (*pp == entry)
 		{
+			*pp = entry->next;
 			break;
 		}
 	}
-	return mem_ptr;
+	ctimer_stop(&entry->tmr);
+	entry->alloc = false;
 }
 
 /*
- * Add a new entry to the discovery table and fill it out with the specified
- * arguments.
+ * Restart the expiration timer on the discovery entry. Each entry has its
+ * own deadline so it goes away exactly NWK_RTE_DISC_TIME after the last
+ * time it was touched.
  */
-void nwk_rte_disc_add_new(U8 rreq_id, U16 src_addr, U16 sender_addr, U16 dest_addr, U8 cost)
+void nwk_rte_disc_refresh(disc_entry_t *entry)
+{
+	entry->expiry = clock_time() + NWK_RTE_DISC_TIME;
+	ctimer_set(&entry->tmr, NWK_RTE_DISC_TIME, nwk_rte_disc_expire, entry);
+}
+
+/* Remove all entries from the route discovery table */
+void nwk_rte_disc_clear()
 {
-	mem_ptr_t *mem_ptr;
+	U8 i;
 
-	if ((mem_ptr = nwk_rte_disc_alloc()) != NULL)
+	for (i=0; i<NWK_MAX_RTE_DISC_ENTRIES; i++)
 	{
-		DISC_ENTRY(mem_ptr)->rreq_id     = rreq_id;
-		DISC_ENTRY(mem_ptr)->sender_addr = sender_addr;
-		DISC_ENTRY(mem_ptr)->src_addr    = src_addr;
-		DISC_ENTRY(mem_ptr)->dest_addr   = dest_addr;
-		DISC_ENTRY(mem_ptr)->fwd_cost    = cost;
-		DISC_ENTRY(mem_ptr)->resid_cost  = 0xff;
-		DISC_ENTRY(mem_ptr)->expiry      = NWK_RTE_DISC_TIME;
+		nwk_rte_disc_free(&disc_tbl[i]);
 	}
 }
 
 /*
- * This is a periodic funciton that is called once per second by the slow clock
- * and decrements the expiry in the route discovery table.
+ * Find a discovery entry based on the route request ID and the source address.
+ * This is used when a route reply arrives. The route reply contains the
+ * original route request ID which is used to identify the discovery entry,
+ * along with the source address.
  */
-void nwk_rte_disc_periodic()
+disc_entry_t *nwk_rte_disc_find(U8 rreq_id, U16 src_addr)
 {
-	mem_ptr_t *rte_mem_ptr;
-	mem_ptr_t *disc_mem_ptr;
+	disc_entry_t *entry;
 
-	for (disc_mem_ptr = list_head(disc_tbl); disc_mem_ptr != NULL; disc_mem_ptr = disc_mem_ptr->next)
+	for (entry = disc_hash[nwk_rte_disc_hash(rreq_id, src_addr)]; entry != NULL; entry = entry->next)
 	{
-		if (DISC_ENTRY(disc_mem_ptr)->expiry == 0)
+		if ((entry->rreq_id == rreq_id) && (entry->src_addr == src_addr))
 		{
-			/*
-			 * free entry if its expired. also, if the
-			 * rte table entry is not active, we will
-			 * free it as well.
-			 */
-			DBG_PRINT("NWK_RTE_DISC_PERIODIC_TMR: Freeing discovery entry - src addr = %02X\n.",
-						 DISC_ENTRY(disc_mem_ptr)->src_addr);
-			if ((rte_mem_ptr = nwk_rte_tbl_find(DISC_ENTRY(disc_mem_ptr)->dest_addr)) != NULL)
-			{
-				// free the rte table entry if its not active.
-				if (RTE_ENTRY(rte_mem_ptr)->status != NWK_ACTIVE)
-					nwk_rte_tbl_free(rte_mem_ptr);
-			}
-
-			nwk_rte_disc_free(disc_mem_ptr);
-		} else {
-			/* decrement the expiry */
-			DISC_ENTRY(disc_mem_ptr)->expiry =
-					(DISC_ENTRY(disc_mem_ptr)->expiry > CLOCK_SECOND) ?
-					(DISC_ENTRY(disc_mem_ptr)->expiry - CLOCK_SECOND) : 0;
+			break;
 		}
 	}
+	return entry;
+}
+
+/*
+ * Add a new entry to the discovery table and fill it out with the specified
+ * arguments. grp_id is set for a multicast discovery so that the routing
+ * entry for the group gets cleaned up when the discovery expires.
+ */
+void nwk_rte_disc_add_new(U8 rreq_id, U16 src_addr, U16 sender_addr, U16 dest_addr, bool grp_id, U8 cost)
+{
+	disc_entry_t *entry;
+	U8 hash;
+
+	entry = nwk_rte_disc_alloc();
+	hash = nwk_rte_disc_hash(rreq_id, src_addr);
+
+	entry->alloc       = true;
+	entry->rreq_id     = rreq_id;
+	entry->sender_addr = sender_addr;
+	entry->src_addr    = src_addr;
+	entry->dest_addr   = dest_addr;
+	entry->grp_id      = grp_id;
+	entry->fwd_cost    = cost;
+	entry->resid_cost  = 0xff;
+	entry->next        = disc_hash[hash];
+	disc_hash[hash]    = entry;
+	nwk_rte_disc_refresh(entry);
 }
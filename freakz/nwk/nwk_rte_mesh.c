@@ -67,6 +67,20 @@
 LIST(rreq_list);
 /* Callback timer for route request. RREQ retried on timeout */
 static struct ctimer rreq_tmr;
+/* Callback timer for the broadcast jitter imposed on RREQ resends */
+static struct ctimer rreq_jitter_tmr;
+/* Callback timer for the periodic many-to-one route requests of a concentrator */
+static struct ctimer mto_tmr;
+
+/*
+ * Token bucket for route request broadcasts. Every route request that we
+ * originate, forward, or resend costs a token, and the tokens trickle back
+ * at one per NWK_RREQ_TOKEN_INTERVAL up to NWK_RREQ_TOKEN_BUCKET. This keeps
+ * a node from joining in on a broadcast storm, like the one that happens
+ * when a whole network starts up at once.
+ */
+static U8 rreq_tokens;
+static clock_time_t rreq_token_time;
 
 /*
  * Init the route request list. The route request list will be used when
@@ -75,9 +89,60 @@ static struct ctimer rreq_tmr;
 void nwk_rte_mesh_init()
 {
 	list_init(rreq_list);
+	rreq_tokens     = NWK_RREQ_TOKEN_BUCKET;
+	rreq_token_time = clock_time();
 	nwk_rte_mesh_periodic(NULL);
 }
 
+/*
+ * Take a token from the route request bucket. First credit the tokens that
+ * were earned since the last time. Returns false if the bucket is empty and
+ * the route request should be held back.
+ */
+static bool nwk_rte_mesh_take_token()
+{
+	nwk_pcb_t *pcb = nwk_pcb_get();
+	clock_time_t now = clock_time();
+	clock_time_t earned = (now - rreq_token_time) / NWK_RREQ_TOKEN_INTERVAL;
+
+	if ((rreq_tokens + earned) >= NWK_RREQ_TOKEN_BUCKET) {
+		rreq_tokens     = NWK_RREQ_TOKEN_BUCKET;
+		rreq_token_time = now;
+	} else {
+		rreq_tokens     += (U8)earned;
+		rreq_token_time += earned * NWK_RREQ_TOKEN_INTERVAL;
+	}
+
+	if (!rreq_tokens) {
+		pcb->rreq_rate_limited++;
+		return false;
+	}
+	rreq_tokens--;
+	return true;
+}
+
+/*
+ * Find the route request that this node is originating for the specified
+ * destination. Many-to-one route requests don't count since they aren't
+ * looking for anyone. A multicast route request is looking for a group ID
+ * so it only matches another multicast one.
+ */
+static mem_ptr_t *nwk_rte_mesh_rreq_find(U16 dest_addr, bool mcast)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	mem_ptr_t *mem_ptr;
+
+	for (mem_ptr = list_head(rreq_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	{
+		if ((RREQ_ENTRY(mem_ptr)->originator == nib->short_addr) &&
+		    (RREQ_ENTRY(mem_ptr)->cmd.rreq.dest_addr == dest_addr) &&
+		    !(RREQ_ENTRY(mem_ptr)->cmd.rreq.cmd_opts & NWK_RREQ_MTO_MASK) &&
+		    (((RREQ_ENTRY(mem_ptr)->cmd.rreq.cmd_opts & NWK_RREQ_MCAST) != 0) == mcast))
+			break;
+	}
+	return mem_ptr;
+}
+
 /* Find a free route request entry and add it to the route request list */
 static mem_ptr_t *nwk_rte_mesh_rreq_alloc()
 {
@@ -105,6 +170,8 @@ static void nwk_rte_mesh_rreq_free(mem_ptr_t *mem_ptr)
  * be generated from the specified command data struct argument. The header
  * will be generated by the rest of the arguments. We will also enter a route
  * request entry into the route request list so we can track this request's info.
+ * If the token bucket is empty, the entry still gets made and the frame goes
+ * out on one of the resends instead.
  */
 static void nwk_rte_mesh_send_rreq(nwk_cmd_t *cmd, U16 src_addr, U8 path_cost, U8 radius)
 {
@@ -115,10 +182,10 @@ static void nwk_rte_mesh_send_rreq(nwk_cmd_t *cmd, U16 src_addr, U8 path_cost, U
 
 	/* prepare route request */
 	cmd->cmd_frm_id     = NWK_CMD_RTE_REQ;
-	cmd->rreq.cmd_opts  = 0;
 	cmd->rreq.path_cost = path_cost;
 
 	/* prepare route request nwk frame header */
+	memset(&hdr, 0, sizeof(nwk_hdr_t));
 	hdr.nwk_frm_ctrl.frame_type = NWK_CMD_FRM;
 	hdr.nwk_frm_ctrl.disc_route = false;
 	hdr.src_addr                = src_addr;
@@ -136,9 +203,13 @@ static void nwk_rte_mesh_send_rreq(nwk_cmd_t *cmd, U16 src_addr, U8 path_cost, U
 		RREQ_ENTRY(mem_ptr)->radius        = radius;
 		RREQ_ENTRY(mem_ptr)->retries       = 0;
 		RREQ_ENTRY(mem_ptr)->expiry        = 1;
+		RREQ_ENTRY(mem_ptr)->jitter        = false;
 		memcpy(&RREQ_ENTRY(mem_ptr)->cmd, cmd, sizeof(nwk_cmd_t));
 	}
 
+	if (!nwk_rte_mesh_take_token())
+		return;
+
 	/* gen the nwk frame and send it out */
 	BUF_ALLOC(buf, TX);
 	nwk_gen_cmd(buf, cmd);
@@ -150,7 +221,7 @@ static void nwk_rte_mesh_send_rreq(nwk_cmd_t *cmd, U16 src_addr, U8 path_cost, U
  * Generate and send a route reply command frame. The command and header info
  * is generated from the information provided by the arguments.
  */
-static void nwk_rte_mesh_send_rrep(U8 rreq_id, U16 originator, U16 responder, U8 path_cost, U16 sender_addr)
+static void nwk_rte_mesh_send_rrep(U8 cmd_opts, U8 rreq_id, U16 originator, U16 responder, U8 path_cost, U16 sender_addr)
 {
 	nwk_nib_t *nib = nwk_nib_get();
 	nwk_hdr_t hdr;
@@ -158,12 +229,13 @@ static void nwk_rte_mesh_send_rrep(U8 rreq_id, U16 originator, U16 responder, U8
 	buffer_t *buf;
 
 	cmd.cmd_frm_id              = NWK_CMD_RTE_REP;
-	cmd.rrep.cmd_opts           = 0x00;
+	cmd.rrep.cmd_opts           = cmd_opts;
 	cmd.rrep.rreq_id            = rreq_id;
 	cmd.rrep.originator         = originator;
 	cmd.rrep.responder          = responder;
 	cmd.rrep.path_cost          = path_cost;
 
+	memset(&hdr, 0, sizeof(nwk_hdr_t));
 	hdr.nwk_frm_ctrl.frame_type = NWK_CMD_FRM;
 	hdr.nwk_frm_ctrl.disc_route = false;
 	hdr.src_addr                = nib->short_addr;
@@ -177,23 +249,46 @@ static void nwk_rte_mesh_send_rrep(U8 rreq_id, U16 originator, U16 responder, U8
 	nwk_fwd(buf, &hdr);
 }
 
+/*
+ * Add the cost of the link that the route command came in on to the path cost
+ * in the command. The path cost saturates instead of wrapping around.
+ */
+static U8 nwk_rte_mesh_add_cost(U8 path_cost, const nwk_hdr_t *hdr_in)
+{
+	U16 cost = (U16)path_cost +
+		   nwk_neighbor_tbl_get_link_cost(hdr_in->mac_hdr->src_addr.short_addr, hdr_in->lqi);
+
+	return (cost > 0xFF) ? 0xFF : (U8)cost;
+}
+
 /*
  * This function sets up a route discovery operation by initializing the discovery
  * info. Once the data is initialized, we will call the rreq handler which is
- * where the real route discovery starts.
+ * where the real route discovery starts. If we already have a discovery in
+ * flight for the destination, then the frame that got us here is already
+ * sitting in the pending queue and goes out with the others when that
+ * discovery finishes. There's no need for another flood. If mcast is set,
+ * the destination is a group ID and any member of the group can answer.
  */
-void nwk_rte_mesh_disc_start(U16 dest_addr)
+void nwk_rte_mesh_disc_start(U16 dest_addr, bool mcast)
 {
+	nwk_pcb_t *pcb = nwk_pcb_get();
 	nwk_nib_t *nib = nwk_nib_get();
 	nwk_hdr_t nwk_hdr;
 	mac_hdr_t mac_hdr;
 	nwk_cmd_t cmd;
 
+	if (nwk_rte_mesh_rreq_find(dest_addr, mcast) != NULL)
+	{
+		pcb->rreq_coalesced++;
+		return;
+	}
+
 	nwk_hdr.mac_hdr     = &mac_hdr;
 
 	cmd.rreq.rreq_id    = nib->rreq_id++;
 	cmd.rreq.dest_addr  = dest_addr;
-	cmd.rreq.cmd_opts   = 0;
+	cmd.rreq.cmd_opts   = mcast ? NWK_RREQ_MCAST : 0;
 	cmd.rreq.path_cost  = 0;
 
 	nwk_hdr.radius      = (U8)(nib->max_depth << 1);   // default radius = 2 * max depth
@@ -202,6 +297,45 @@ void nwk_rte_mesh_disc_start(U16 dest_addr)
 	nwk_rte_mesh_rreq_handler(&nwk_hdr, &cmd);
 }
 
+/*
+ * Handle a many-to-one route request from a concentrator. There is no route
+ * reply for these. Every router that hears one points its route to the
+ * concentrator at the neighbor that sent the best copy of it and then
+ * passes it on. If the concentrator keeps a route record table, the route
+ * gets marked so that a route record goes out ahead of the next data frame.
+ */
+static void nwk_rte_mesh_mto_handler(const nwk_hdr_t *hdr_in, nwk_cmd_t *cmd_in, U8 path_cost)
+{
+    nwk_nib_t *nib = nwk_nib_get();
+    mem_ptr_t *rte_mem_ptr;
+
+    if (hdr_in->src_addr != nib->short_addr)
+    {
+        if ((rte_mem_ptr = nwk_rte_tbl_find(hdr_in->src_addr, false)) == NULL)
+        {
+            nwk_rte_tbl_add_new(hdr_in->src_addr, false, NWK_ACTIVE);
+            rte_mem_ptr = nwk_rte_tbl_find(hdr_in->src_addr, false);
+        }
+
+        if (rte_mem_ptr)
+        {
+            RTE_ENTRY(rte_mem_ptr)->status       = NWK_ACTIVE;
+            RTE_ENTRY(rte_mem_ptr)->next_hop     = hdr_in->mac_hdr->src_addr.short_addr;
+            RTE_ENTRY(rte_mem_ptr)->many_to_one  = true;
+            RTE_ENTRY(rte_mem_ptr)->rte_rec_req  =
+                ((cmd_in->rreq.cmd_opts & NWK_RREQ_MTO_MASK) == NWK_RREQ_MTO_REC_TBL);
+        }
+
+        // the radius limits how far out the concentrator's routes reach
+        if (hdr_in->radius == 0)
+            return;
+        nwk_rte_mesh_send_rreq(cmd_in, hdr_in->src_addr, path_cost, hdr_in->radius - 1);
+        return;
+    }
+
+    nwk_rte_mesh_send_rreq(cmd_in, hdr_in->src_addr, path_cost, hdr_in->radius);
+}
+
 /*
  * Process an incoming route request and decide if it needs to be forwarded
  * or a route reply needs to be generated. This function will check the
@@ -219,28 +353,32 @@ void nwk_rte_mesh_rreq_handler(const nwk_hdr_t *hdr_in, nwk_cmd_t *cmd_in)
 {
     nwk_pcb_t *pcb = nwk_pcb_get();
     nwk_nib_t *nib = nwk_nib_get();
-    mem_ptr_t *disc_mem_ptr;
+    disc_entry_t *disc_entry;
     mem_ptr_t *rte_mem_ptr;
     U8 path_cost;
     address_t dest_addr;
+    bool mcast;
 
+    mcast                   = (cmd_in->rreq.cmd_opts & NWK_RREQ_MCAST) != 0;
     dest_addr.mode          = SHORT_ADDR;
     dest_addr.short_addr    = cmd_in->rreq.dest_addr;
 
-    // if we are originating the rreq, then set the path cost to zero. otherwise add the static path cost.
-    // later on, we need to figure out a better way to generate path costs.
-    path_cost = (hdr_in->src_addr != nib->short_addr) ? cmd_in->rreq.path_cost + NWK_STATIC_PATH_COST: cmd_in->rreq.path_cost;
+    // if we are originating the rreq, then set the path cost to zero. otherwise add the cost of the link
+    // that the rreq came in on.
+    path_cost = (hdr_in->src_addr != nib->short_addr) ?
+                nwk_rte_mesh_add_cost(cmd_in->rreq.path_cost, hdr_in) :
+                cmd_in->rreq.path_cost;
 
     // check if route discovery table entry exists.
-    if ((disc_mem_ptr = nwk_rte_disc_find(cmd_in->rreq.rreq_id, hdr_in->src_addr)) != NULL)
+    if ((disc_entry = nwk_rte_disc_find(cmd_in->rreq.rreq_id, hdr_in->src_addr)) != NULL)
     {
         // if the path cost is less than the fwd cost, then update the entry
-        if (path_cost < DISC_ENTRY(disc_mem_ptr)->fwd_cost)
+        if (path_cost < disc_entry->fwd_cost)
         {
             // If the path cost is less than the fwd cost, then replace the disc table disc_entry path
             // with this path.
-            DISC_ENTRY(disc_mem_ptr)->sender_addr  = hdr_in->mac_hdr->src_addr.short_addr;
-            DISC_ENTRY(disc_mem_ptr)->fwd_cost     = path_cost;
+            disc_entry->sender_addr  = hdr_in->mac_hdr->src_addr.short_addr;
+            disc_entry->fwd_cost     = path_cost;
         }
         else
         {
@@ -252,11 +390,18 @@ void nwk_rte_mesh_rreq_handler(const nwk_hdr_t *hdr_in, nwk_cmd_t *cmd_in)
     else
     {
         // add the new discovery entry to the discovery table
-        nwk_rte_disc_add_new(cmd_in->rreq.rreq_id, hdr_in->src_addr, hdr_in->mac_hdr->src_addr.short_addr, hdr_in->dest_addr, path_cost);
+        nwk_rte_disc_add_new(cmd_in->rreq.rreq_id, hdr_in->src_addr, hdr_in->mac_hdr->src_addr.short_addr, cmd_in->rreq.dest_addr, mcast, path_cost);
+    }
+
+    // many-to-one route requests don't look for a destination. they set up routes back to the concentrator.
+    if (cmd_in->rreq.cmd_opts & NWK_RREQ_MTO_MASK)
+    {
+        nwk_rte_mesh_mto_handler(hdr_in, cmd_in, path_cost);
+        return;
     }
 
     // get the route entry for this rreq if it exists. otherwise, create a new entry.
-    if ((rte_mem_ptr = nwk_rte_tbl_find(cmd_in->rreq.dest_addr)) != NULL)
+    if ((rte_mem_ptr = nwk_rte_tbl_find(cmd_in->rreq.dest_addr, mcast)) != NULL)
     {
         // if the route entry isn't active or active but requires validation, then change it to discovery underway.
         if ((RTE_ENTRY(rte_mem_ptr)->status != NWK_ACTIVE) && (RTE_ENTRY(rte_mem_ptr)->status != NWK_VALIDATION_UNDERWAY))
@@ -266,15 +411,18 @@ void nwk_rte_mesh_rreq_handler(const nwk_hdr_t *hdr_in, nwk_cmd_t *cmd_in)
     }
     else
     {
-        nwk_rte_tbl_add_new(cmd_in->rreq.dest_addr, NWK_DISCOVERY_UNDERWAY);
+        nwk_rte_tbl_add_new(cmd_in->rreq.dest_addr, mcast, NWK_DISCOVERY_UNDERWAY);
     }
 
     // now check to see if the route request destination was meant for us. If so, then prepare a route reply.
-    if ((cmd_in->rreq.dest_addr == nib->short_addr) || nwk_neighbor_tbl_addr_exists(&dest_addr))
+    // a multicast rreq is answered by any member of the group. we can't answer for our neighbors since we
+    // don't know their groups.
+    if (( mcast && nwk_mcast_is_member(cmd_in->rreq.dest_addr)) ||
+        (!mcast && ((cmd_in->rreq.dest_addr == nib->short_addr) || nwk_neighbor_tbl_addr_exists(&dest_addr))))
     {
         // send out the route reply
-        nwk_rte_mesh_send_rrep(cmd_in->rreq.rreq_id, hdr_in->src_addr, cmd_in->rreq.dest_addr,
-                               path_cost, hdr_in->mac_hdr->src_addr.short_addr);
+        nwk_rte_mesh_send_rrep(mcast ? NWK_RREP_MCAST : 0, cmd_in->rreq.rreq_id, hdr_in->src_addr,
+                               cmd_in->rreq.dest_addr, path_cost, hdr_in->mac_hdr->src_addr.short_addr);
     }
     else
     {
@@ -300,25 +448,27 @@ void nwk_rte_mesh_rrep_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in)
 {
 	nwk_pcb_t *pcb = nwk_pcb_get();
 	nwk_nib_t *nib = nwk_nib_get();
-	mem_ptr_t *disc_mem_ptr;
+	disc_entry_t *disc_entry;
 	mem_ptr_t *rte_mem_ptr;
 	U8 path_cost;
+	bool mcast;
 
-	disc_mem_ptr  = nwk_rte_disc_find(cmd_in->rrep.rreq_id, cmd_in->rrep.originator);
-	rte_mem_ptr   = nwk_rte_tbl_find(cmd_in->rrep.responder);
-	path_cost   = cmd_in->rrep.path_cost + NWK_STATIC_PATH_COST;
+	mcast         = (cmd_in->rrep.cmd_opts & NWK_RREP_MCAST) != 0;
+	disc_entry    = nwk_rte_disc_find(cmd_in->rrep.rreq_id, cmd_in->rrep.originator);
+	rte_mem_ptr   = nwk_rte_tbl_find(cmd_in->rrep.responder, mcast);
+	path_cost   = nwk_rte_mesh_add_cost(cmd_in->rrep.path_cost, hdr_in);
 
 	/*
 	 * if the rte entry or discovery entry doesn't exist or the path
 	 * cost is not less than the current resid cost, then drop the rrep.
 	 */
 	if ((!rte_mem_ptr) ||
-	    (!disc_mem_ptr) ||
-	    (path_cost >= DISC_ENTRY(disc_mem_ptr)->resid_cost))
+	    (!disc_entry) ||
+	    (path_cost >= disc_entry->resid_cost))
 	{
-		if (!rte_mem_ptr || !disc_mem_ptr) {
+		if (!rte_mem_ptr || !disc_entry) {
 			nwk_rte_tbl_free(rte_mem_ptr);
-			nwk_rte_disc_free(disc_mem_ptr);
+			nwk_rte_disc_free(disc_entry);
 		}
 		pcb->drop_rrep_frm++;
 		return;
@@ -330,8 +480,8 @@ void nwk_rte_mesh_rrep_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in)
 	 * entry. any time we update the next hop in the
 	 * rte entry, we need to reset the discovery entry's expiry
 	 */
-	DISC_ENTRY(disc_mem_ptr)->resid_cost  = path_cost;
-	DISC_ENTRY(disc_mem_ptr)->expiry      = NWK_RTE_DISC_TIME;
+	disc_entry->resid_cost  = path_cost;
+	nwk_rte_disc_refresh(disc_entry);
 	RTE_ENTRY(rte_mem_ptr)->next_hop     = hdr_in->mac_hdr->src_addr.short_addr;
 
 	/*
@@ -347,6 +497,12 @@ void nwk_rte_mesh_rrep_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in)
 	/* check if the rrep is meant for us */
 	if (cmd_in->rrep.originator == nib->short_addr)
 	{
+		/*
+		 * the route is up. retire our route request so it doesn't
+		 * keep flooding the network with resends.
+		 */
+		nwk_rte_mesh_rreq_free(nwk_rte_mesh_rreq_find(cmd_in->rrep.responder, mcast));
+
 		/* send out pending xfers */
 		nwk_pend_send_pending();
 		DBG_PRINT("\nNWK_RTE_MESH: Route established.\n");
@@ -354,10 +510,48 @@ void nwk_rte_mesh_rrep_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in)
 	}
 
 	/* forward the route reply */
-	nwk_rte_mesh_send_rrep(cmd_in->rrep.rreq_id,
+	nwk_rte_mesh_send_rrep(cmd_in->rrep.cmd_opts,
+			       cmd_in->rrep.rreq_id,
 			       cmd_in->rrep.originator,
 			       cmd_in->rrep.responder,
-	path_cost, DISC_ENTRY(disc_mem_ptr)->sender_addr);
+	path_cost, disc_entry->sender_addr);
+}
+
+/*
+ * Send out the route requests that were waiting for their jitter to run out.
+ * This is the callback for the rreq jitter timer. All entries that were marked
+ * while the timer was running get sent together.
+ */
+static void nwk_rte_mesh_jitter_expire(void *ptr)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	nwk_hdr_t hdr;
+	buffer_t *buf;
+	mem_ptr_t *mem_ptr;
+
+	for (mem_ptr = list_head(rreq_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	{
+		if (!RREQ_ENTRY(mem_ptr)->jitter)
+			continue;
+
+		RREQ_ENTRY(mem_ptr)->jitter = false;
+
+		if (!nwk_rte_mesh_take_token())
+			continue;
+
+		/* generate and send out the rreq */
+		memset(&hdr, 0, sizeof(nwk_hdr_t));
+		hdr.nwk_frm_ctrl.frame_type = NWK_CMD_FRM;
+		hdr.nwk_frm_ctrl.disc_route = false;
+		hdr.src_addr                = RREQ_ENTRY(mem_ptr)->originator;
+		hdr.dest_addr               = NWK_BROADCAST_ROUTERS_COORD;
+		hdr.radius                  = RREQ_ENTRY(mem_ptr)->radius;
+		hdr.seq_num                 = nib->seq_num++;
+
+		BUF_ALLOC(buf, TX);
+		nwk_gen_cmd(buf, &RREQ_ENTRY(mem_ptr)->cmd);
+		nwk_fwd(buf, &hdr);
+	}
 }
 
 /*
@@ -373,10 +567,6 @@ void nwk_rte_mesh_rrep_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in)
  */
 void nwk_rte_mesh_resend_rreq(mem_ptr_t *mem_ptr)
 {
-	nwk_nib_t *nib = nwk_nib_get();
-	nwk_hdr_t hdr;
-	buffer_t *buf;
-
 	if (mem_ptr)
 	{
 		RREQ_ENTRY(mem_ptr)->retries++;
@@ -389,22 +579,17 @@ void nwk_rte_mesh_resend_rreq(mem_ptr_t *mem_ptr)
 
 			/*
 			 * we need to re-send NWK_RREQ_RETRIES times with
-			 * a jitter imposed on the resend. do a busy wait
-			 * for the jitter.
+			 * a jitter imposed on the resend. mark the entry
+			 * and let the jitter timer send it out. if the
+			 * jitter timer is already running, the entry
+			 * goes out with the others when it expires.
 			 */
-			busy_wait(drvr_get_rand() % NWK_BRC_JITTER);
-
-			/* generate and send out the rreq */
-			hdr.nwk_frm_ctrl.frame_type = NWK_CMD_FRM;
-			hdr.nwk_frm_ctrl.disc_route = false;
-			hdr.src_addr                = RREQ_ENTRY(mem_ptr)->originator;
-			hdr.dest_addr               = NWK_BROADCAST_ROUTERS_COORD;
-			hdr.radius                  = RREQ_ENTRY(mem_ptr)->radius;
-			hdr.seq_num                 = nib->seq_num++;
-
-			BUF_ALLOC(buf, TX);
-			nwk_gen_cmd(buf, &RREQ_ENTRY(mem_ptr)->cmd);
-			nwk_fwd(buf, &hdr);
+			RREQ_ENTRY(mem_ptr)->jitter = true;
+			if (ctimer_expired(&rreq_jitter_tmr))
+			{
+				ctimer_set(&rreq_jitter_tmr, drvr_get_rand() % NWK_BRC_JITTER,
+					   nwk_rte_mesh_jitter_expire, NULL);
+			}
 			return;
 		}
 
@@ -433,8 +618,53 @@ void nwk_rte_mesh_periodic(void *ptr)
 	ctimer_set(&rreq_tmr, NWK_RREQ_RETRY_INTERVAL, nwk_rte_mesh_periodic, NULL);
 }
 
-/* Stop the route request periodic timer */
+/*
+ * Callback for the many-to-one timer. Send out the next many-to-one route
+ * request so that the routes to the concentrator stay fresh.
+ */
+static void nwk_rte_mesh_mto_periodic(void *ptr)
+{
+	nwk_rte_mesh_mto_start();
+}
+
+/*
+ * Start a many-to-one route discovery if we're a concentrator. The route
+ * request goes through the rreq handler like any other route discovery we
+ * originate. If the NIB has a discovery time, then the route request gets
+ * repeated at that interval.
+ */
+void nwk_rte_mesh_mto_start()
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	nwk_hdr_t nwk_hdr;
+	mac_hdr_t mac_hdr;
+	nwk_cmd_t cmd;
+
+	if (!nib->is_concentrator || (nib->dev_type == NWK_END_DEVICE))
+		return;
+
+	nwk_hdr.mac_hdr     = &mac_hdr;
+
+	cmd.rreq.rreq_id    = nib->rreq_id++;
+	cmd.rreq.dest_addr  = NWK_BROADCAST_ROUTERS_COORD;
+	cmd.rreq.cmd_opts   = NWK_RREQ_MTO_REC_TBL;
+	cmd.rreq.path_cost  = 0;
+
+	nwk_hdr.radius      = nib->concentrator_radius;
+	nwk_hdr.src_addr    = mac_hdr.src_addr.short_addr = nib->short_addr;
+
+	nwk_rte_mesh_rreq_handler(&nwk_hdr, &cmd);
+
+	if (nib->concentrator_disc_time)
+		ctimer_set(&mto_tmr, nib->concentrator_disc_time * CLOCK_SECOND, nwk_rte_mesh_mto_periodic, NULL);
+	else
+		ctimer_stop(&mto_tmr);
+}
+
+/* Stop the route request periodic, jitter, and many-to-one timers */
 void nwk_rte_mesh_stop_tmr()
 {
 	ctimer_stop(&rreq_tmr);
+	ctimer_stop(&rreq_jitter_tmr);
+	ctimer_stop(&mto_tmr);
 }
@@ -0,0 +1,292 @@
+/*******************************************************************
+    Copyright (C) 2009 FreakLabs
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+    4. This software is subject to the additional restrictions placed on the
+       Zigbee Specification's Terms of Use.
+
+    THIS SOFTWARE IS PROVIDED BY THE THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+
+    Originally written by Christopher Wang aka Akiba.
+    Please post support questions to the FreakLabs forum.
+
+*******************************************************************/
+/*!
+    \file nwk_rte_src.c
+    \ingroup nwk
+    \brief NWK many-to-one and source routing
+
+    This file implements the route record and source routing parts of
+    many-to-one routing. A concentrator (usually a gateway) broadcasts a
+    many-to-one route request which leaves a route back to it on every
+    router. When a device sends data to the concentrator over one of these
+    routes, it first sends a route record that collects the addresses of
+    the relays along the way. The concentrator keeps the relay list in its
+    source route table and uses it to source route frames back to the
+    device without any route discovery.
+
+    \note Only routers send route records. End devices go through their
+    parent, and the concentrator reaches them through the parent's tree
+    or mesh route.
+*/
+#include "freakz.h"
+
+/*
+ * List head for the source route table. Each entry holds the relay list
+ * that a route record collected on its way to this device. It is only
+ * filled in on a concentrator.
+ */
+LIST(src_rte_tbl);
+
+/* Init the source route table */
+void nwk_rte_src_init()
+{
+	list_init(src_rte_tbl);
+}
+
+/* Return the list head for the source route table */
+mem_ptr_t *nwk_rte_src_get_head()
+{
+	return list_head(src_rte_tbl);
+}
+
+/* Find a free entry from the heap and add it to the source route table */
+static mem_ptr_t *nwk_rte_src_alloc()
+{
+	mem_ptr_t *mem_ptr;
+
+	if ((mem_ptr = mem_heap_alloc(sizeof(src_rte_entry_t))) != NULL)
+	{
+		list_add(src_rte_tbl, mem_ptr);
+	}
+	return mem_ptr;
+}
+
+/* Remove the entry from the source route table and free it */
+static void nwk_rte_src_free(mem_ptr_t *mem_ptr)
+{
+	if (mem_ptr) {
+		list_remove(src_rte_tbl, mem_ptr);
+		mem_heap_free(mem_ptr);
+	}
+}
+
+/* Remove all entries from the source route table */
+void nwk_rte_src_clear()
+{
+	mem_ptr_t *mem_ptr;
+
+	for (mem_ptr = list_chop(src_rte_tbl); mem_ptr != NULL; mem_ptr = list_chop(src_rte_tbl))
+	{
+		nwk_rte_src_free(mem_ptr);
+	}
+}
+
+/* Find the source route entry for the specified destination address */
+mem_ptr_t *nwk_rte_src_find(U16 dest_addr)
+{
+	mem_ptr_t *mem_ptr;
+
+	for (mem_ptr = list_head(src_rte_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	{
+		if (SRC_RTE_ENTRY(mem_ptr)->dest_addr == dest_addr)
+			break;
+	}
+	return mem_ptr;
+}
+
+/*
+ * Add or update the source route for the specified destination. A newer
+ * route record always replaces the old relay list since it reflects the
+ * path that the concentrator's last many-to-one request set up.
+ */
+static void nwk_rte_src_add(U16 dest_addr, const nwk_cmd_rte_rec_t *rec)
+{
+	mem_ptr_t *mem_ptr;
+
+	if ((mem_ptr = nwk_rte_src_find(dest_addr)) == NULL)
+	{
+		if ((mem_ptr = nwk_rte_src_alloc()) == NULL)
+			return;
+		SRC_RTE_ENTRY(mem_ptr)->dest_addr = dest_addr;
+	}
+
+	SRC_RTE_ENTRY(mem_ptr)->relay_cnt = rec->relay_cnt;
+	memcpy(SRC_RTE_ENTRY(mem_ptr)->relay_list, rec->relay_list, rec->relay_cnt * sizeof(U16));
+}
+
+/*
+ * Generate and send a route record command frame. The header source is
+ * the originator of the record so that the concentrator knows who the
+ * relay list leads to.
+ */
+static void nwk_rte_src_tx_rec(U16 src_addr, U16 concentrator, U8 radius, const nwk_cmd_t *cmd)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	nwk_hdr_t hdr;
+	buffer_t *buf;
+
+	memset(&hdr, 0, sizeof(nwk_hdr_t));
+	hdr.nwk_frm_ctrl.frame_type = NWK_CMD_FRM;
+	hdr.nwk_frm_ctrl.disc_route = false;
+	hdr.src_addr                = src_addr;
+	hdr.dest_addr               = concentrator;
+	hdr.radius                  = radius;
+	hdr.seq_num                 = nib->seq_num++;
+
+	BUF_ALLOC(buf, TX);
+	nwk_gen_cmd(buf, cmd);
+	debug_dump_nwk_cmd((nwk_cmd_t *)cmd);
+	nwk_fwd(buf, &hdr);
+}
+
+/*
+ * Send a route record to the concentrator if the many-to-one route to it
+ * is asking for one. The request flag gets cleared first since the route
+ * record goes out through nwk_fwd and would otherwise come back here.
+ */
+void nwk_rte_src_send_rec(U16 concentrator)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	mem_ptr_t *mem_ptr;
+	nwk_cmd_t cmd;
+
+	if ((mem_ptr = nwk_rte_tbl_find(concentrator, false)) == NULL)
+		return;
+
+	if (!RTE_ENTRY(mem_ptr)->many_to_one || !RTE_ENTRY(mem_ptr)->rte_rec_req)
+		return;
+
+	RTE_ENTRY(mem_ptr)->rte_rec_req = false;
+
+	cmd.cmd_frm_id          = NWK_CMD_RTE_REC;
+	cmd.rte_rec.relay_cnt   = 0;
+	nwk_rte_src_tx_rec(nib->short_addr, concentrator, (U8)(nib->max_depth << 1), &cmd);
+}
+
+/*
+ * Handle an incoming route record. If we're the concentrator, then store
+ * the relay list in the source route table. Otherwise, add our address to
+ * the relay list and pass it on towards the concentrator.
+ */
+void nwk_rte_src_rec_handler(const nwk_hdr_t *hdr_in, nwk_cmd_t *cmd_in)
+{
+	nwk_pcb_t *pcb = nwk_pcb_get();
+	nwk_nib_t *nib = nwk_nib_get();
+
+	if (hdr_in->dest_addr == nib->short_addr)
+	{
+		if (nib->is_concentrator)
+			nwk_rte_src_add(hdr_in->src_addr, &cmd_in->rte_rec);
+		return;
+	}
+
+	/*
+	 * the relay list is full or the radius ran out. the concentrator
+	 * can't use a partial list so there's no point in sending it on.
+	 */
+	if ((cmd_in->rte_rec.relay_cnt >= NWK_MAX_SRC_RTE_RELAYS) || (hdr_in->radius == 0))
+	{
+		pcb->drop_rte_rec_frm++;
+		return;
+	}
+
+	cmd_in->rte_rec.relay_list[cmd_in->rte_rec.relay_cnt++] = nib->short_addr;
+	nwk_rte_src_tx_rec(hdr_in->src_addr, hdr_in->dest_addr, hdr_in->radius - 1, cmd_in);
+}
+
+/*
+ * Fill in the source route subframe for a frame that we're originating. The
+ * first hop is the last relay in the list, which is the one closest to us.
+ * Returns false if there's no source route to the destination. A route
+ * with no relays means the destination is one hop away.
+ */
+bool nwk_rte_src_set_hdr(nwk_hdr_t *hdr, U16 *next_hop)
+{
+	mem_ptr_t *mem_ptr;
+
+	if ((mem_ptr = nwk_rte_src_find(hdr->dest_addr)) == NULL)
+		return false;
+
+	if (SRC_RTE_ENTRY(mem_ptr)->relay_cnt == 0)
+	{
+		hdr->nwk_frm_ctrl.src_rte = false;
+		*next_hop = hdr->dest_addr;
+		return true;
+	}
+
+	hdr->nwk_frm_ctrl.src_rte   = true;
+	hdr->relay_cnt              = SRC_RTE_ENTRY(mem_ptr)->relay_cnt;
+	hdr->relay_idx              = hdr->relay_cnt - 1;
+	memcpy(hdr->relay_list, SRC_RTE_ENTRY(mem_ptr)->relay_list, hdr->relay_cnt * sizeof(U16));
+	*next_hop = hdr->relay_list[hdr->relay_idx];
+	return true;
+}
+
+/*
+ * Get the next hop for a source routed frame that we're relaying. The relay
+ * index points at us. If it's at the bottom of the list, we're the last relay
+ * and the next hop is the destination. Otherwise, move the index down to the
+ * next relay. Returns an invalid address if the subframe is bad.
+ */
+U16 nwk_rte_src_next_relay(nwk_hdr_t *hdr)
+{
+	if (hdr->relay_idx == 0)
+		return hdr->dest_addr;
+
+	if (hdr->relay_idx >= hdr->relay_cnt)
+		return INVALID_NWK_ADDR;
+
+	hdr->relay_idx--;
+	return hdr->relay_list[hdr->relay_idx];
+}
+
+/* Remove the source route for the specified destination address */
+void nwk_rte_src_rem(U16 dest_addr)
+{
+	nwk_rte_src_free(nwk_rte_src_find(dest_addr));
+}
+
+/*
+ * Remove the source routes whose first hop is the specified neighbor. The
+ * device will send a new route record once the next many-to-one route
+ * request goes out.
+ */
+void nwk_rte_src_rem_next_hop(U16 next_hop)
+{
+	mem_ptr_t *mem_ptr, *next;
+	U16 first_hop;
+
+	for (mem_ptr = list_head(src_rte_tbl); mem_ptr != NULL; mem_ptr = next)
+	{
+		next = mem_ptr->next;
+		first_hop = SRC_RTE_ENTRY(mem_ptr)->relay_cnt ?
+			    SRC_RTE_ENTRY(mem_ptr)->relay_list[SRC_RTE_ENTRY(mem_ptr)->relay_cnt - 1] :
+			    SRC_RTE_ENTRY(mem_ptr)->dest_addr;
+
+		if (first_hop == next_hop)
+			nwk_rte_src_free(mem_ptr);
+	}
+}
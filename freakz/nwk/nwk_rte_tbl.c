@@ -98,14 +98,19 @@ void nwk_rte_tbl_clear()
 	}
 }
 
-/* Find an entry with the specified destination network address */
-mem_ptr_t *nwk_rte_tbl_find(U16 dest_addr)
+/*
+ * Find an entry with the specified destination. Group IDs and network
+ * addresses share the same number space, so the caller needs to say which
+ * one it's looking for.
+ */
+mem_ptr_t *nwk_rte_tbl_find(U16 dest_addr, bool grp_id)
 {
 	mem_ptr_t *mem_ptr;
 
 	for (mem_ptr = list_head(rte_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
 	{
-		if (RTE_ENTRY(mem_ptr)->dest_addr == dest_addr)
+		if ((RTE_ENTRY(mem_ptr)->dest_addr == dest_addr) &&
+		    (RTE_ENTRY(mem_ptr)->grp_id == grp_id))
 			break;
 	}
 	return mem_ptr;
@@ -114,15 +119,15 @@ mem_ptr_t *nwk_rte_tbl_find(U16 dest_addr)
 /* Remove the destination address from the routing tables */
 void nwk_rte_tbl_rem(U16 addr)
 {
-	nwk_rte_tbl_free(nwk_rte_tbl_find(addr));
+	nwk_rte_tbl_free(nwk_rte_tbl_find(addr, false));
 }
 
 /* Get the next hop value from the routing table */
-U16 nwk_rte_tbl_get_next_hop(U16 dest_addr)
+U16 nwk_rte_tbl_get_next_hop(U16 dest_addr, bool grp_id)
 {
 	mem_ptr_t *mem_ptr;
 
-	if ((mem_ptr = nwk_rte_tbl_find(dest_addr)) != NULL)
+	if ((mem_ptr = nwk_rte_tbl_find(dest_addr, grp_id)) != NULL)
 	{
 		if ((RTE_ENTRY(mem_ptr)->status == NWK_ACTIVE) ||
 		    (RTE_ENTRY(mem_ptr)->status == NWK_VALIDATION_UNDERWAY))
@@ -142,7 +147,7 @@ U16 nwk_rte_tbl_get_next_hop(U16 dest_addr)
 /* Check if a route exists in the table */
 bool nwk_rte_tbl_rte_exists(U16 dest_addr)
 {
-	return (nwk_rte_tbl_find(dest_addr)) ? true : false;
+	return (nwk_rte_tbl_find(dest_addr, false)) ? true : false;
 }
 
 /*
@@ -150,18 +155,15 @@ bool nwk_rte_tbl_rte_exists(U16 dest_addr)
  * and status. First check to see if the entry already exists. If it does,
  * then just update the status. If not, then add it to the table.
  */
-void nwk_rte_tbl_add_new(U16 dest_addr, U8 status)
+void nwk_rte_tbl_add_new(U16 dest_addr, bool grp_id, U8 status)
 {
 	mem_ptr_t *mem_ptr;
 
 	/* first check to see if the destination exists */
-	for (mem_ptr = list_head(rte_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	if ((mem_ptr = nwk_rte_tbl_find(dest_addr, grp_id)) != NULL)
 	{
-		if (RTE_ENTRY(mem_ptr)->dest_addr == dest_addr)
-		{
-			RTE_ENTRY(mem_ptr)->status = status;
-			return;
-		}
+		RTE_ENTRY(mem_ptr)->status = status;
+		return;
 	}
 
 	/*
@@ -172,5 +174,26 @@ void nwk_rte_tbl_add_new(U16 dest_addr, U8 status)
 	{
 		RTE_ENTRY(mem_ptr)->dest_addr    = dest_addr;
 		RTE_ENTRY(mem_ptr)->status       = status;
+		RTE_ENTRY(mem_ptr)->many_to_one  = false;
+		RTE_ENTRY(mem_ptr)->rte_rec_req  = false;
+		RTE_ENTRY(mem_ptr)->grp_id       = grp_id;
+	}
+}
+
+/*
+ * The neighbor is gone or the link to it stopped working. Mark the routes
+ * that go through it inactive so that the next frame starts a new route
+ * discovery instead of getting sent into the void.
+ */
+void nwk_rte_tbl_invalidate_next_hop(U16 next_hop)
+{
+	mem_ptr_t *mem_ptr;
+
+	for (mem_ptr = list_head(rte_tbl); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+	{
+		if ((RTE_ENTRY(mem_ptr)->next_hop == next_hop) &&
+		    (RTE_ENTRY(mem_ptr)->status == NWK_ACTIVE ||
+		     RTE_ENTRY(mem_ptr)->status == NWK_VALIDATION_UNDERWAY))
+			RTE_ENTRY(mem_ptr)->status = NWK_INACTIVE;
 	}
 }
@@ -50,57 +50,71 @@
 /*******************************************************************/
 #include "freakz.h"
 
+/*
+ * Cskip values for each depth. The table is shifted up by one so that
+ * cskip_tbl[d + 1] holds Cskip(d). cskip_tbl[0] stands in for the parent
+ * of the coordinator, which owns the whole address space. With that,
+ * the tree routing math doesn't need a special case for the coordinator.
+ */
+static U16 cskip_tbl[NWK_MAX_TREE_DEPTH + 2];
+
 /**************************************************************************/
 /*!
-    Init the tree's cskip value to a default of 0xffff.
+    Fill out the cskip table from the max depth, max children, and max routers
+    in the NIB. This gets called at init, and again when forming or joining a
+    network in case the tree parameters were changed in between. Working up from
+    the bottom of the tree, each depth only needs the one below it:
+
+        Cskip(max_depth - 1)   = 1
+        Cskip(d - 1)           = (max_routers * Cskip(d)) + 1 + max_children - max_routers
+
+    This is the same as the closed form in the spec, but it doesn't need any
+    powers of max_routers.
 */
 /**************************************************************************/
-void nwk_rte_tree_init()
+void nwk_rte_tree_calc_cskip_tbl()
 {
     nwk_nib_t *nib = nwk_nib_get();
-    nib->cskip = 0xFFFF;
+    U8 depth;
+
+    memset(cskip_tbl, 0, sizeof(cskip_tbl));
+    cskip_tbl[0] = 0xFFFF;
+
+    depth = (nib->max_depth > NWK_MAX_TREE_DEPTH) ? NWK_MAX_TREE_DEPTH : nib->max_depth;
+    if (depth == 0)
+    {
+        return;
+    }
+
+    cskip_tbl[depth] = 1;
+    for (depth--; depth > 0; depth--)
+    {
+        cskip_tbl[depth] = (U16)((nib->max_routers * cskip_tbl[depth + 1]) +
+                                 1 + nib->max_children - nib->max_routers);
+    }
+    nib->cskip = nwk_rte_tree_calc_cskip(nib->depth);
+}
+
+/**************************************************************************/
+/*!
+    Init the cskip table with the default tree parameters.
+*/
+/**************************************************************************/
+void nwk_rte_tree_init()
+{
+    nwk_rte_tree_calc_cskip_tbl();
 }
 
 /**************************************************************************/
 /*!
-    Calculate the CSkip value based on the depth. This will be used in determining the address
+    Return the CSkip value for the depth. This will be used in determining the address
     of any joined device and also determining whether to route up or down in tree based routing.
-    This function should only be called once after nwk_formation. After that, we can just store the
-    value in a static variable so we never have to touch this again.
+    Devices at the max depth or deeper can't have children so their cskip is 0.
 */
 /**************************************************************************/
 U16 nwk_rte_tree_calc_cskip(U8 depth)
 {
-    U16 exp, temp;
-    S16 num, den;
-        U8 i;
-    nwk_nib_t *nib = nwk_nib_get();
-
-        exp = nib->max_depth - (depth + 1);
-
-        if (nib->max_routers == 1)
-        {
-                return (U16)(1 + (nib->max_children * exp));
-        }
-        else
-        {
-        if (depth < nib->max_depth)
-        {
-            // Init the value of temp to 1. This is the lowest value it can have.
-            // Then calculate the value of (max_routers^exp)
-            temp = 1;
-            for (i=0; i<exp; i++)
-            {
-                temp *= nib->max_routers;
-            }
-
-            // Need to be careful. There is a potential overflow if the value of max_children is large and temp is also large.
-            num = (S16)((1 + nib->max_children - nib->max_routers) - (nib->max_children * temp));
-            den = 1 - nib->max_routers;
-            return (U16)(num/den);
-        }
-        }
-    return 0;
+    return (depth < NWK_MAX_TREE_DEPTH) ? cskip_tbl[depth + 1] : 0;
 }
 
 /**************************************************************************/
@@ -139,88 +153,46 @@ U16 nwk_rte_tree_calc_ed_addr(U16 cskip, U8 num)
 
 /**************************************************************************/
 /*!
-    This is a helper function that will locate the next downstream hop in
-    the routing tree based on the destination address.
+Decides whether to route up or down the tree. If we route up, then we just
+return our parent. We route down if the dest is inside our address block:
+        - our_addr < dest_addr < (our_addr + cskip_parent)
+
+Going down, the end devices are at the end of the block so anything past the
+router sub-blocks is one of our end device children. Otherwise, the dest is
+somewhere below the child router whose sub-block it falls in:
+        - next_hop = our_addr + 1 + ((dest_addr - (our_addr + 1)) / cskip) * cskip
+
+There are no loops here since this gets used for every frame that doesn't
+have a neighbor or route table entry. A depth past what the cskip table
+covers can't be routed so INVALID_NWK_ADDR comes back.
 */
 /**************************************************************************/
-static U16 nwk_rte_tree_get_dwnstrm_rtr_addr(U16 dest_addr)
+U16 nwk_rte_tree_calc_next_hop(U16 dest)
 {
-    U8 i;
-    U16 lower_addr, upper_addr;
     nwk_nib_t *nib = nwk_nib_get();
-    address_t addr;
-
-    addr.mode       = SHORT_ADDR;
-    addr.short_addr = dest_addr;
+    U16 addr = nib->short_addr;
+    U16 cskip, cskip_parent;
 
-    // can we get an exact match for the child device?
-    if (nwk_neighbor_tbl_addr_exists(&addr))
+    if (nib->depth > NWK_MAX_TREE_DEPTH)
     {
-        return dest_addr;
+        return INVALID_NWK_ADDR;
     }
 
-    // no child exists. find the downstream rtr to send the frame to.
-    // to get the downstream router, we need to find a router whose
-    // address allocation contains the dest_addr. That means that dest_addr must
-    // lie between the upper and lower addresses in the rtr's addr allocation range.
-    for (i=0; i<nib->max_routers; i++)
-    {
-        lower_addr = (U16)((nib->cskip * i) + 1);
-        upper_addr = lower_addr + nib->cskip;
+    cskip = nwk_rte_tree_calc_cskip(nib->depth);
+    cskip_parent = cskip_tbl[nib->depth];
 
-        if ((dest_addr > lower_addr) && (dest_addr < upper_addr))
-        {
-            return lower_addr;
-        }
+    // not in our address block. send it up to our parent.
+    if ((dest <= addr) || ((U32)dest >= ((U32)addr + cskip_parent)))
+    {
+        return nwk_neighbor_tbl_get_parent();
     }
-    return INVALID_NWK_ADDR;
-}
 
-/**************************************************************************/
-/*!
-Decides whether to route up or down the tree. If we route up, then we just
-return the next parent that we find. If we route down, then we search for either
-a child with the exact address, or a router with an address that is in the address
-sub-block range:
-        - router_addr < dest_addr < (router_addr + cskip)
+    // one of our end devices
+    if ((U32)dest > ((U32)addr + ((U32)cskip * nib->max_routers)))
+    {
+        return dest;
+    }
 
-If it satisfies that criteria, then that means that the device will be somewhere
-down that branch of the network.
-*/
-/**************************************************************************/
-U16 nwk_rte_tree_calc_next_hop(U16 dest)
-{
-	U16 cskip_parent;
-	U16 dest_addr;
-	bool route_down;
-	nwk_nib_t *nib = nwk_nib_get();
-
-	/*
-	 * if cskip is uninitialized, then calculate the
-	 * value for this device and save it in the nib.
-	 */
-	if (nib->cskip == 0xFFFF) {
-		nib->cskip = nwk_rte_tree_calc_cskip(nib->depth);
-	}
-
-	/*
-	 * we need the depth one layer up to calculate the parent's
-	 * cskip value. if we're the coordinator, then we don't care
-	 * because we will route down no matter what. otherwise, we
-	 * use the parent's cskip value to calc whether to route up or down.
-	 */
-	cskip_parent = (nib->depth != 0) ? nwk_rte_tree_calc_cskip(nib->depth - 1) : 0;
-	route_down = ((dest > nib->short_addr) && (dest < (nib->short_addr + cskip_parent)));
-
-	/*
-	 * if we're the coordinator or we calculate that we need to
-	 * route down, then look for the child that will be our next
-	 * hop. otherwise, just send it to our parent.
-	 */
-	if ((nib->short_addr == 0) || route_down)
-		dest_addr = nwk_rte_tree_get_dwnstrm_rtr_addr(dest);
-	else
-		dest_addr = nwk_neighbor_tbl_get_parent();
-
-	return dest_addr;
+    // find the child router whose sub-block holds the dest
+    return (U16)(addr + 1 + (((dest - (addr + 1)) / cskip) * cskip));
 }
@@ -0,0 +1,197 @@
+/*******************************************************************
+    Copyright (C) 2009 FreakLabs
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+    4. This software is subject to the additional restrictions placed on the
+       Zigbee Specification's Terms of Use.
+
+    THIS SOFTWARE IS PROVIDED BY THE THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+
+    Originally written by Christopher Wang aka Akiba.
+    Please post support questions to the FreakLabs forum.
+
+*******************************************************************/
+/*!
+    \file nwk_status.c
+    \ingroup nwk
+    \brief NWK status and route repair
+
+    This file handles broken routes. When a router can't forward a data
+    frame, either because there's no route or because the next hop stopped
+    acking, it sends a network status command frame back to the originator.
+    The originator drops its route to the dest and starts a new route
+    discovery right away so that the next frame, usually an APS retry,
+    finds a working route.
+
+    If local repair is on, the router upstream of a broken link starts the
+    route discovery itself instead of reporting the error. Frames that
+    arrive while the discovery is going on wait in the pending list. If
+    no route turns up, the originator gets the network status when the
+    pending frame expires.
+*/
+#include "freakz.h"
+
+/*
+ * Generate and send a network status command frame to the specified
+ * address. The failed address is the destination that couldn't be reached.
+ */
+static void nwk_status_send(U16 dest_addr, U8 status_code, U16 failed_addr)
+{
+	nwk_pcb_t *pcb = nwk_pcb_get();
+	nwk_nib_t *nib = nwk_nib_get();
+	nwk_hdr_t hdr;
+	nwk_cmd_t cmd;
+	buffer_t *buf;
+
+	cmd.cmd_frm_id          = NWK_CMD_NWK_STATUS;
+	cmd.status.status_code  = status_code;
+	cmd.status.dest_addr    = failed_addr;
+
+	memset(&hdr, 0, sizeof(nwk_hdr_t));
+	hdr.nwk_frm_ctrl.frame_type = NWK_CMD_FRM;
+	hdr.nwk_frm_ctrl.disc_route = false;
+	hdr.src_addr                = nib->short_addr;
+	hdr.dest_addr               = dest_addr;
+	hdr.radius                  = (U8)(nib->max_depth << 1);
+	hdr.seq_num                 = nib->seq_num++;
+
+	DBG_PRINT("NWK_STATUS: Route to %04X failed. Reporting to %04X.\n", failed_addr, dest_addr);
+	pcb->nwk_status_tx++;
+
+	BUF_ALLOC(buf, TX);
+	nwk_gen_cmd(buf, &cmd);
+	debug_dump_nwk_cmd(&cmd);
+	nwk_fwd(buf, &hdr);
+}
+
+/*
+ * We couldn't route a frame. If it's a data frame that someone else
+ * originated, then let them know. Route errors for command frames and
+ * broadcasts aren't reported so we can't end up in a loop of them.
+ */
+void nwk_status_rte_fail(const nwk_hdr_t *hdr, U8 status_code)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+
+	if ((hdr->nwk_frm_ctrl.frame_type != NWK_DATA_FRM) ||
+	    hdr->nwk_frm_ctrl.mcast_flag ||
+	    ((hdr->dest_addr & NWK_BROADCAST_MASK) == NWK_BROADCAST_MASK) ||
+	    (hdr->src_addr == nib->short_addr))
+		return;
+
+	nwk_status_send(hdr->src_addr, status_code, hdr->dest_addr);
+}
+
+/*
+ * The next hop stopped acking our unicasts. Drop the routes that go
+ * through it. If the frame that failed was a data frame headed somewhere
+ * past the next hop, then either repair the route locally or report the
+ * error to the originator. The src addr is invalid for anything that
+ * isn't a data frame.
+ */
+void nwk_status_link_fail(U16 next_hop, U16 src_addr, U16 dest_addr)
+{
+	nwk_pcb_t *pcb = nwk_pcb_get();
+	nwk_nib_t *nib = nwk_nib_get();
+	mem_ptr_t *nbor_mem_ptr;
+	address_t addr;
+	U8 status_code;
+
+	pcb->link_fail++;
+	nwk_rte_tbl_invalidate_next_hop(next_hop);
+	nwk_rte_src_rem_next_hop(next_hop);
+
+	if (src_addr == INVALID_NWK_ADDR)
+		return;
+
+	/*
+	 * look for another way to the dest from here. if the neighbor was
+	 * the dest, then there's nothing past it to repair.
+	 */
+	if (nib->local_repair && (nib->dev_type != NWK_END_DEVICE) && (dest_addr != next_hop))
+	{
+		DBG_PRINT("NWK_STATUS: Link to %04X failed. Repairing route to %04X.\n", next_hop, dest_addr);
+		pcb->local_repair++;
+		nwk_rte_mesh_disc_start(dest_addr, false);
+		return;
+	}
+
+	if (src_addr == nib->short_addr)
+		return;
+
+	addr.mode       = SHORT_ADDR;
+	addr.short_addr = next_hop;
+	nbor_mem_ptr    = nwk_neighbor_tbl_get_entry(&addr);
+	status_code     = (nbor_mem_ptr &&
+			   ((NBOR_ENTRY(nbor_mem_ptr)->relationship == NWK_PARENT) ||
+			    (NBOR_ENTRY(nbor_mem_ptr)->relationship == NWK_CHILD))) ?
+			  NWK_STATUS_TREE_LINK_FAIL : NWK_STATUS_NON_TREE_LINK_FAIL;
+
+	nwk_status_send(src_addr, status_code, dest_addr);
+}
+
+/*
+ * Handle an incoming network status. If it's for us, then the route to
+ * the failed dest is broken somewhere along the way. Drop our route and
+ * source route to it and go find a new one before the next frame needs
+ * it. End devices leave routing to their parent. If the status isn't for
+ * us, then pass it on towards the originator.
+ */
+void nwk_status_handler(const nwk_hdr_t *hdr_in, const nwk_cmd_t *cmd_in)
+{
+	nwk_nib_t *nib = nwk_nib_get();
+	nwk_hdr_t hdr;
+	nwk_cmd_t cmd;
+	buffer_t *buf;
+
+	if (hdr_in->dest_addr == nib->short_addr)
+	{
+		DBG_PRINT("NWK_STATUS: Route to %04X reported broken by %04X. Status = %02X.\n",
+			  cmd_in->status.dest_addr, hdr_in->src_addr, cmd_in->status.status_code);
+
+		nwk_rte_tbl_rem(cmd_in->status.dest_addr);
+		nwk_rte_src_rem(cmd_in->status.dest_addr);
+
+		if (nib->dev_type != NWK_END_DEVICE)
+			nwk_rte_mesh_disc_start(cmd_in->status.dest_addr, false);
+		return;
+	}
+
+	if (hdr_in->radius == 0)
+		return;
+
+	memset(&hdr, 0, sizeof(nwk_hdr_t));
+	hdr.nwk_frm_ctrl.frame_type = NWK_CMD_FRM;
+	hdr.nwk_frm_ctrl.disc_route = false;
+	hdr.src_addr                = hdr_in->src_addr;
+	hdr.dest_addr               = hdr_in->dest_addr;
+	hdr.radius                  = hdr_in->radius - 1;
+	hdr.seq_num                 = hdr_in->seq_num;
+
+	memcpy(&cmd, cmd_in, sizeof(nwk_cmd_t));
+	BUF_ALLOC(buf, TX);
+	nwk_gen_cmd(buf, &cmd);
+	nwk_fwd(buf, &hdr);
+}
@@ -47,7 +47,6 @@
 #include "freakz.h"
 
 // test data ... change this later
-#define ZCL_BASIC_ATTRIB_LIST_SZ    13              ///< Basic attribute list size
 #define ZCL_VER_NUM                 0xA3            ///< Version number
 #define ZCL_APP_VER_NUM             0x55            ///< Application version number
 #define ZCL_STACK_VER_NUM           0x12            ///< Stack version number
@@ -121,16 +120,34 @@ typedef struct _zcl_basic_data_t
 
 /**************************************************************************/
 /*!
-
+    Basic cluster attribute definitions in ascending attribute ID order.
+    X(id, type, access, data struct, field)
 */
 /**************************************************************************/
-typedef struct _zcl_basic_attrib_list_t
+#define ZCL_BASIC_ATTRIBS(X) \
+    X(ZCL_BASIC_VER,        ZCL_TYPE_U8,            ZCL_ACCESS_READ_WRITE,  zcl_basic_data_t, zcl_ver)      \
+    X(ZCL_BASIC_APP_VER,    ZCL_TYPE_U8,            ZCL_ACCESS_READ_WRITE,  zcl_basic_data_t, app_ver)      \
+    X(ZCL_BASIC_STACK_VER,  ZCL_TYPE_U8,            ZCL_ACCESS_READ_WRITE,  zcl_basic_data_t, stack_ver)    \
+    X(ZCL_BASIC_HW_VER,     ZCL_TYPE_U8,            ZCL_ACCESS_READ_WRITE,  zcl_basic_data_t, hw_ver)       \
+    X(ZCL_BASIC_MANUF_NAME, ZCL_TYPE_CHAR_STRING,   ZCL_ACCESS_READ_ONLY,   zcl_basic_data_t, manuf_id)     \
+    X(ZCL_BASIC_MODEL_ID,   ZCL_TYPE_CHAR_STRING,   ZCL_ACCESS_READ_ONLY,   zcl_basic_data_t, model_id)     \
+    X(ZCL_BASIC_DATE_CODE,  ZCL_TYPE_CHAR_STRING,   ZCL_ACCESS_READ_ONLY,   zcl_basic_data_t, date_code)    \
+    X(ZCL_BASIC_PWR_SRC,    ZCL_TYPE_U8,            ZCL_ACCESS_READ_ONLY,   zcl_basic_data_t, pwr_src)      \
+    X(ZCL_BASIC_LOC_DESC,   ZCL_TYPE_CHAR_STRING,   ZCL_ACCESS_READ_WRITE,  zcl_basic_data_t, loc_desc)     \
+    X(ZCL_BASIC_PHYS_ENV,   ZCL_TYPE_U8,            ZCL_ACCESS_READ_WRITE,  zcl_basic_data_t, phys_env)     \
+    X(ZCL_BASIC_DEV_ENB,    ZCL_TYPE_BOOL,          ZCL_ACCESS_READ_WRITE,  zcl_basic_data_t, dev_enb)      \
+    X(ZCL_BASIC_ALARM_MSK,  ZCL_TYPE_U8,            ZCL_ACCESS_READ_WRITE,  zcl_basic_data_t, alarm_msk)
+
+/// Basic cluster attribute table indices
+typedef enum _zcl_basic_attrib_idx_t
 {
-    zcl_attrib_t list[ZCL_BASIC_ATTRIB_LIST_SZ];
-    zcl_basic_data_t data;
-} zcl_basic_attrib_list_t;
+    ZCL_BASIC_ATTRIBS(ZCL_ATTRIB_INDEX)
+    ZCL_BASIC_ATTRIB_CNT
+} zcl_basic_attrib_idx_t;
+
+extern const zcl_attrib_t zcl_basic_attrib_tbl[ZCL_BASIC_ATTRIB_CNT];
 
-void zcl_basic_init(zcl_basic_attrib_list_t *attrib_list);
-void zcl_basic_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr);
+void zcl_basic_init(zcl_basic_data_t *data);
+void zcl_basic_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr);
 
 #endif
@@ -43,19 +43,21 @@
 #include "freakz.h"
 #include "zcl_grp.h"
 
+/// Groups attribute table generated from the attribute definitions
+const zcl_attrib_t zcl_grp_attrib_tbl[ZCL_GRP_ATTRIB_CNT] =
+{
+    ZCL_GRP_ATTRIBS(ZCL_ATTRIB_ENTRY)
+};
+
 /**************************************************************************/
 /*!
 
 */
 /**************************************************************************/
-void zcl_grp_init(zcl_grp_attrib_list_t *attrib_list)
+void zcl_grp_init(zcl_grp_data_t *data)
 {
     // init the data
-    attrib_list->data.name_supp = ZCL_GRP_NAME_SUPPORT;
-
-    // init the attribs
-    zcl_set_attrib(&attrib_list->list[0], ZCL_GRP_ATTRIB_NAME_SUPPORT, ZCL_TYPE_8BITMAP, ZCL_ACCESS_READ_ONLY, &attrib_list->data.name_supp);
-    zcl_set_attrib(&attrib_list->list[1], ZCL_END_MARKER, 0, 0, NULL);
+    data->name_supp = ZCL_GRP_NAME_SUPPORT;
 }
 
 /**************************************************************************/
@@ -63,13 +65,14 @@ void zcl_grp_init(zcl_grp_attrib_list_t *attrib_list)
 
 */
 /**************************************************************************/
-void zcl_grp_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr)
+void zcl_grp_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
     zcl_attrib_t *attrib;
     U8 i, len, status, grp_cnt, grp_list_cnt, *data_ptr, *resp_ptr, *grp_id_list;
     U16 grp_id;
     zcl_hdr_t resp_hdr;
     mem_ptr_t *mem_ptr;
+    aps_grp_t *grp;
 
     // init the grp list cnt
     grp_list_cnt = 0;
@@ -131,14 +134,19 @@ void zcl_grp_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *cl
         // then that means that we need to match up the grp ids in the list with identical ids in our table.
         if (grp_cnt == 0)
         {
-            // there isn't a grp list. we just dump our whole grp table and send it out in the response.
-            for (mem_ptr = aps_grp_get_head(); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+            // there isn't a grp list. we just dump every group this endpoint is in and send it out in the response.
+            for (i=0; i<APS_GRP_TBL_SIZE; i++)
             {
+                if (((grp = aps_grp_get_entry(i)) == NULL) || !aps_grp_is_member(grp->id, ep))
+                {
+                    continue;
+                }
+
                 // if we hit the max list size, then don't add any more ids. we don't want to overflow
                 // the buffer.
                 if (grp_list_cnt < ZCL_GRP_MAX_LIST_SZ)
                 {
-                    *(U16 *)grp_id_list = GROUP_ENTRY(mem_ptr)->id;
+                    *(U16 *)grp_id_list = grp->id;
                     grp_id_list += sizeof(U16);
                     grp_list_cnt++;
                 }
@@ -155,20 +163,17 @@ void zcl_grp_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *cl
                 grp_id = *(U16 *)data_ptr;
                 data_ptr += sizeof(U16);
 
-                // look in the group table to see if the grp id exists
-                for (mem_ptr = aps_grp_get_head(); mem_ptr != NULL; mem_ptr = mem_ptr->next)
+                // look in the group table to see if this endpoint is in the grp
+                if (aps_grp_is_member(grp_id, ep))
                 {
-                    if (grp_id == GROUP_ENTRY(mem_ptr)->id)
+                    // limit the grp list size to prevent overflow
+                    if (grp_list_cnt < ZCL_GRP_MAX_LIST_SZ)
                     {
-                        // limit the grp list size to prevent overflow
-                        if (grp_list_cnt < ZCL_GRP_MAX_LIST_SZ)
-                        {
-                            // grp id exists in our table. add it to the grp id list in the response
-                            // and increment the grp list cnt
-                            *(U16 *)grp_id_list = grp_id;
-                            grp_id_list += sizeof(U16);
-                            grp_list_cnt++;
-                        }
+                        // grp id exists in our table. add it to the grp id list in the response
+                        // and increment the grp list cnt
+                        *(U16 *)grp_id_list = grp_id;
+                        grp_id_list += sizeof(U16);
+                        grp_list_cnt++;
                     }
                 }
             }
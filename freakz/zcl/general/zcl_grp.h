@@ -45,7 +45,6 @@
 
 #include "types.h"
 
-#define ZCL_GRP_ATTRIB_LIST_SZ  2
 #define ZCL_GRP_MAX_LIST_SZ     10
 #define ZCL_GRP_NAME_SUPPORT    0x00
 
@@ -85,13 +84,20 @@ typedef struct _zcl_grp_data_t
 
 /**************************************************************************/
 /*!
-
+    Groups attribute definitions in ascending attribute ID order.
+    X(id, type, access, data struct, field)
 */
 /**************************************************************************/
-typedef struct _zcl_grp_attrib_list_t
+#define ZCL_GRP_ATTRIBS(X) \
+    X(ZCL_GRP_ATTRIB_NAME_SUPPORT, ZCL_TYPE_8BITMAP, ZCL_ACCESS_READ_ONLY, zcl_grp_data_t, name_supp)
+
+/// Groups attribute table indices
+typedef enum _zcl_grp_attrib_idx_t
 {
-    zcl_attrib_t list[ZCL_GRP_ATTRIB_LIST_SZ];
-    zcl_grp_data_t data;
-} zcl_grp_attrib_list_t;
+    ZCL_GRP_ATTRIBS(ZCL_ATTRIB_INDEX)
+    ZCL_GRP_ATTRIB_CNT
+} zcl_grp_attrib_idx_t;
+
+extern const zcl_attrib_t zcl_grp_attrib_tbl[ZCL_GRP_ATTRIB_CNT];
 
 #endif
@@ -44,10 +44,17 @@
 #include "zcl.h"
 #include "zcl_id.h"
 
+/// Identify attribute table generated from the attribute definitions
+const zcl_attrib_t zcl_id_attrib_tbl[ZCL_ID_ATTRIB_CNT] =
+{
+    ZCL_ID_ATTRIBS(ZCL_ATTRIB_ENTRY)
+};
+
 // static prototypes
 static mem_ptr_t *zcl_id_tmr_alloc();
 static void zcl_id_tmr_free(mem_ptr_t *mem_ptr);
 static void zcl_id_tmr_add(U8 ep, U16 *time, void (*action_handler)(U8, void *));
+static void zcl_id_tmr_expire(void *ptr);
 
 /**************************************************************************/
 /*!
@@ -62,14 +69,10 @@ LIST(id_tmr_list);
 
 */
 /**************************************************************************/
-void zcl_id_init(zcl_id_attrib_list_t *attrib_list)
+void zcl_id_init(zcl_id_data_t *data)
 {
     // init the data values first
-    attrib_list->data.id_time = 0;
-
-    // init the attribute fields
-    zcl_set_attrib(&attrib_list->list[0], ZCL_ID_ATTRIB, ZCL_TYPE_U16, ZCL_ACCESS_READ_WRITE, &attrib_list->data.id_time);
-    zcl_set_attrib(&attrib_list->list[1], ZCL_END_MARKER, 0, 0, NULL);
+    data->id_time = 0;
 
     // init the timer list
     list_init(id_tmr_list);
@@ -109,16 +112,16 @@ static U8 zcl_id_gen_query_resp(U8 *resp, U16 timeout, zcl_hdr_t *hdr)
 
 */
 /**************************************************************************/
-void zcl_id_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr)
+void zcl_id_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
-    zcl_attrib_t *attrib;
+    zcl_id_data_t *attrib;
     U16 timeout;
     U8 *data;
 
     // have the data pointer point to the payload
     data = (hdr) ? hdr->payload : NULL;
 
-    if ((attrib = zcl_find_attrib(clust->attrib_list, ZCL_ID_ATTRIB)) == NULL)
+    if ((attrib = clust->data) == NULL)
     {
         if (!hdr->frm_ctrl.dis_def_resp)
         {
@@ -131,10 +134,10 @@ void zcl_id_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clu
     {
     case ZCL_ID_CMD_ID:
         // store the value of the identify timeout
-        *(U16 *)attrib->data = *(U16 *)data;
+        attrib->id_time = *(U16 *)data;
 
         // add an id timer entry to automatically count down the id time
-        zcl_id_tmr_add(ep, (U16 *)attrib->data, clust->action_handler);
+        zcl_id_tmr_add(ep, &attrib->id_time, clust->action_handler);
 
         if (clust->action_handler)
         {
@@ -149,7 +152,7 @@ void zcl_id_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clu
 
     case ZCL_ID_CMD_ID_QUERY:
         // return the value of the identify timeout
-        timeout = *(U16 *)attrib->data;
+        timeout = attrib->id_time;
         *resp_len = zcl_id_gen_query_resp(resp, timeout, hdr);
         break;
     }
@@ -220,6 +223,7 @@ static void zcl_id_tmr_add(U8 ep, U16 *time, void (*action_handler)(U8, void *))
         ZCL_ID_TMR(mem_ptr)->ep = ep;
         ZCL_ID_TMR(mem_ptr)->time = time;
         ZCL_ID_TMR(mem_ptr)->action_handler = action_handler;
+        slow_tmr_set(&mem_ptr->tmr, 1, zcl_id_tmr_expire, mem_ptr);
     }
 }
 
@@ -235,30 +239,32 @@ mem_ptr_t *zcl_id_get_head()
 
 /**************************************************************************/
 /*!
-
+    Slow timer callback for the identify timer. It fires once per second so
+    that the identify time attribute counts down in real time.
 */
 /**************************************************************************/
-void zcl_id_tmr_periodic()
+static void zcl_id_tmr_expire(void *ptr)
 {
-    mem_ptr_t *mem_ptr;
+    mem_ptr_t *mem_ptr = ptr;
     U16 time;
 
-    for (mem_ptr = list_head(id_tmr_list); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-    {
-        // de-reference the time value
-        time = *ZCL_ID_TMR(mem_ptr)->time;
+    // de-reference the time value
+    time = *ZCL_ID_TMR(mem_ptr)->time;
 
-        // check if the timeout occurred. if it didn't then decrement the time and update
-        // the id attribute
-        if (time == 0)
+    // check if the timeout occurred. if it didn't then decrement the time, update
+    // the id attribute, and wait for the next second.
+    if (time == 0)
+    {
+        if (ZCL_ID_TMR(mem_ptr)->action_handler)
         {
             ZCL_ID_TMR(mem_ptr)->action_handler(ZCL_ID_ACTION_ID_OFF, NULL);
-            zcl_id_tmr_free(mem_ptr);
-        }
-        else
-        {
-            time--;
-            *ZCL_ID_TMR(mem_ptr)->time = time;
         }
+        zcl_id_tmr_free(mem_ptr);
+    }
+    else
+    {
+        time--;
+        *ZCL_ID_TMR(mem_ptr)->time = time;
+        slow_tmr_set(&mem_ptr->tmr, 1, zcl_id_tmr_expire, mem_ptr);
     }
 }
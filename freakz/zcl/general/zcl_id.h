@@ -45,10 +45,6 @@
 
 #include "types.h"
 
-/*! attribute list size - this will be one larger than the actual list size
-    to hold the end marker
-*/
-#define ZCL_ID_ATTRIB_LIST_SZ   2
 #define ZCL_ID_TMR(m)   ((zcl_id_tmr_t *)MMEM_PTR(&m->mmem_ptr))      ///< De-reference the mem ptr and cast it as an zcl identify timer value
 
 /**************************************************************************/
@@ -79,15 +75,21 @@ typedef struct _zcl_id_data_t
 
 /**************************************************************************/
 /*!
-    This struct holds the actual attribute list as well as the attribute
-    data.
+    Identify attribute definitions in ascending attribute ID order.
+    X(id, type, access, data struct, field)
 */
 /**************************************************************************/
-typedef struct _zcl_id_attrib_list_t
+#define ZCL_ID_ATTRIBS(X) \
+    X(ZCL_ID_ATTRIB, ZCL_TYPE_U16, ZCL_ACCESS_READ_WRITE, zcl_id_data_t, id_time)
+
+/// Identify attribute table indices
+typedef enum _zcl_id_attrib_idx_t
 {
-    zcl_attrib_t    list[ZCL_ID_ATTRIB_LIST_SZ];
-    zcl_id_data_t   data;
-} zcl_id_attrib_list_t;
+    ZCL_ID_ATTRIBS(ZCL_ATTRIB_INDEX)
+    ZCL_ID_ATTRIB_CNT
+} zcl_id_attrib_idx_t;
+
+extern const zcl_attrib_t zcl_id_attrib_tbl[ZCL_ID_ATTRIB_CNT];
 
 /**************************************************************************/
 /*!
@@ -102,10 +104,9 @@ typedef struct _zcl_id_tmr_t
 } zcl_id_tmr_t;
 
 // prototypes
-void zcl_id_init(zcl_id_attrib_list_t *attrib_list);
+void zcl_id_init(zcl_id_data_t *data);
 mem_ptr_t *zcl_id_get_head();
 U8 zcl_id_gen_req(U8 *data, zcl_hdr_t *hdr, U16 timeout);
-void zcl_id_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr);
-void zcl_id_tmr_periodic();
+void zcl_id_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr);
 
 #endif
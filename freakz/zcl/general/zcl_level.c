@@ -43,6 +43,12 @@
 #include "freakz.h"
 #include "zcl_level.h"
 
+/// Level control attribute table generated from the attribute definitions
+const zcl_attrib_t zcl_level_attrib_tbl[ZCL_LEVEL_ATTRIB_CNT] =
+{
+    ZCL_LEVEL_ATTRIBS(ZCL_ATTRIB_ENTRY)
+};
+
 // function prototypes
 static mem_ptr_t *zcl_level_tmr_alloc();
 static void zcl_level_tmr_free(mem_ptr_t *mem_ptr);
@@ -63,16 +69,11 @@ static struct ctimer level_tmr;     // this is the timer for the slow clock
 
 */
 /**************************************************************************/
-void zcl_level_init(zcl_level_attrib_list_t *attrib_list)
+void zcl_level_init(zcl_level_data_t *data)
 {
     // init the attrib data values first
-    memset(&attrib_list->data, 0, sizeof(zcl_level_data_t));
-    attrib_list->data.on_level = 0xfe;
-
-    zcl_set_attrib(&attrib_list->list[0], ZCL_LEVEL_ATTRIB_CURR_LEVEL,          ZCL_TYPE_U8,    ZCL_ACCESS_READ_ONLY,   &attrib_list->data.curr_level);
-    zcl_set_attrib(&attrib_list->list[2], ZCL_LEVEL_ATTRIB_ON_OFF_TRANS_TIME,   ZCL_TYPE_U16,   ZCL_ACCESS_READ_WRITE,  &attrib_list->data.on_off_trans_time);
-    zcl_set_attrib(&attrib_list->list[3], ZCL_LEVEL_ATTRIB_ON_LEVEL,            ZCL_TYPE_U8,    ZCL_ACCESS_READ_WRITE,  &attrib_list->data.on_level);
-    zcl_set_attrib(&attrib_list->list[4], ZCL_END_MARKER, 0, 0, NULL);
+    memset(data, 0, sizeof(zcl_level_data_t));
+    data->on_level = 0xfe;
 
     list_init(level_tmr_list);
     zcl_level_tmr_periodic(NULL);
@@ -83,9 +84,9 @@ void zcl_level_init(zcl_level_attrib_list_t *attrib_list)
 
 */
 /**************************************************************************/
-void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr)
+void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
-    zcl_attrib_t *attrib;
+    zcl_level_data_t *attrib;
     U8 intv, curr_level, step, level, *resp_ptr, *data_ptr;
     U16 trans_time, rate, rem;
     bool with_on_off;
@@ -97,7 +98,7 @@ void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *
     with_on_off = false;
 
     // get the current level
-    if ((attrib = zcl_find_attrib(clust->attrib_list, ZCL_LEVEL_ATTRIB_CURR_LEVEL)) == NULL)
+    if ((attrib = clust->data) == NULL)
     {
         if (!hdr->frm_ctrl.dis_def_resp)
         {
@@ -105,7 +106,7 @@ void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *
         }
         return;
     }
-    curr_level = *(U8 *)attrib->data;
+    curr_level = attrib->curr_level;
 
     // if bit 2 is set, then that means we need to integrate the command with the on/off cluster.
     // so first we need to detect whether or not this is the case.
@@ -145,7 +146,7 @@ void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *
         rem = ((intv % trans_time) << 8) / trans_time;
 
         // add the new timer
-        zcl_level_tmr_add((U8 *)attrib->data, trans_time, step, rem, dir, with_on_off, clust->action_handler);
+        zcl_level_tmr_add(&attrib->curr_level, trans_time, step, rem, dir, with_on_off, clust->action_handler);
         break;
 
     case ZCL_LEVEL_CMD_MOVE:
@@ -159,7 +160,7 @@ void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *
         step = (rate < 10) ? 1 : rate/10;
 
         // add the new timer
-        zcl_level_tmr_add((U8 *)attrib->data, 0xffff, step, 0, dir, with_on_off, clust->action_handler);
+        zcl_level_tmr_add(&attrib->curr_level, 0xffff, step, 0, dir, with_on_off, clust->action_handler);
         break;
 
     case ZCL_LEVEL_CMD_STEP:
@@ -170,7 +171,7 @@ void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *
         data_ptr += sizeof(U16);
 
         // add the new timer
-        zcl_level_tmr_add((U8 *)attrib->data, trans_time, step, 0, dir, with_on_off, clust->action_handler);
+        zcl_level_tmr_add(&attrib->curr_level, trans_time, step, 0, dir, with_on_off, clust->action_handler);
         break;
 
     case ZCL_LEVEL_CMD_STOP:
@@ -45,7 +45,6 @@
 
 #include "types.h"
 
-#define ZCL_LEVEL_ATTRIB_LIST_SZ 5
 #define ZCL_LEVEL_TMR(m)   ((zcl_level_tmr_t *)MMEM_PTR(&m->mmem_ptr))      ///< De-reference the mem ptr and cast it as an zcl level timer value
 
 /**************************************************************************/
@@ -90,14 +89,23 @@ typedef struct zcl_level_data_t
 
 /**************************************************************************/
 /*!
-
+    Level control attribute definitions in ascending attribute ID order.
+    X(id, type, access, data struct, field)
 */
 /**************************************************************************/
-typedef struct _zcl_level_attrib_list_t
+#define ZCL_LEVEL_ATTRIBS(X) \
+    X(ZCL_LEVEL_ATTRIB_CURR_LEVEL,          ZCL_TYPE_U8,    ZCL_ACCESS_READ_ONLY,   zcl_level_data_t, curr_level)           \
+    X(ZCL_LEVEL_ATTRIB_ON_OFF_TRANS_TIME,   ZCL_TYPE_U16,   ZCL_ACCESS_READ_WRITE,  zcl_level_data_t, on_off_trans_time)    \
+    X(ZCL_LEVEL_ATTRIB_ON_LEVEL,            ZCL_TYPE_U8,    ZCL_ACCESS_READ_WRITE,  zcl_level_data_t, on_level)
+
+/// Level control attribute table indices
+typedef enum _zcl_level_attrib_idx_t
 {
-    zcl_attrib_t        list[ZCL_LEVEL_ATTRIB_LIST_SZ];
-    zcl_level_data_t    data;
-} zcl_level_attrib_list_t;
+    ZCL_LEVEL_ATTRIBS(ZCL_ATTRIB_INDEX)
+    ZCL_LEVEL_ATTRIB_CNT
+} zcl_level_attrib_idx_t;
+
+extern const zcl_attrib_t zcl_level_attrib_tbl[ZCL_LEVEL_ATTRIB_CNT];
 
 /**************************************************************************/
 /*!
@@ -166,9 +174,9 @@ typedef struct _zcl_level_req_t
 } zcl_level_req_t;
 
 // prototypes
-void zcl_level_init(zcl_level_attrib_list_t *attrib_list);
+void zcl_level_init(zcl_level_data_t *data);
 U8 zcl_level_gen_req(U8 *data, zcl_hdr_t *hdr, zcl_level_req_t *req);
-void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr);
+void zcl_level_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr);
 void zcl_level_tmr_add(U8 *level, U16 rem_time, U8 step, U8 rem, bool dir, bool on_off, void (*action_handler)(U8, void *));
 void zcl_level_tmr_periodic(void *ptr);
 #endif
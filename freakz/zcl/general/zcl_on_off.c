@@ -45,19 +45,21 @@
 #include "freakz.h"
 #include "zcl_on_off.h"
 
+/// On/Off attribute table generated from the attribute definitions
+const zcl_attrib_t zcl_on_off_attrib_tbl[ZCL_ON_OFF_ATTRIB_CNT] =
+{
+    ZCL_ON_OFF_ATTRIBS(ZCL_ATTRIB_ENTRY)
+};
+
 /**************************************************************************/
 /*!
         Init the on/off cluster.
 */
 /**************************************************************************/
-void zcl_on_off_init(zcl_on_off_attrib_list_t *attrib_list)
+void zcl_on_off_init(zcl_on_off_data_t *data)
 {
     // init the data
-    attrib_list->data.on_off = false;
-
-    // init the attribs
-    zcl_set_attrib(&attrib_list->list[0], ZCL_ON_OFF_ATTRIB, ZCL_TYPE_BOOL, ZCL_ACCESS_READ_WRITE, &attrib_list->data.on_off);
-    zcl_set_attrib(&attrib_list->list[1], ZCL_END_MARKER, 0, 0, NULL);
+    data->on_off = false;
 }
 
 /**************************************************************************/
@@ -68,15 +70,15 @@ void zcl_on_off_init(zcl_on_off_attrib_list_t *attrib_list)
         actions that is related to the status.
 */
 /**************************************************************************/
-void zcl_on_off_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr)
+void zcl_on_off_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
-    zcl_attrib_t *attrib;
+    zcl_on_off_data_t *data;
     U8 action;
     zcl_hdr_t resp_hdr;
     bool tmp;
 
-    // first, get the attribute
-    if ((attrib = zcl_find_attrib(clust->attrib_list, ZCL_ON_OFF_ATTRIB)) == NULL)
+    // first, get the attribute storage
+    if ((data = clust->data) == NULL)
     {
         return;
     }
@@ -84,14 +86,14 @@ void zcl_on_off_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t
     switch (hdr->cmd)
     {
     case ZCL_ON_OFF_CMD_OFF:
-            *(bool *)attrib->data = 0;
+            data->on_off = 0;
             break;
     case ZCL_ON_OFF_CMD_ON:
-            *(bool *)attrib->data = 1;
+            data->on_off = 1;
             break;
     case ZCL_ON_OFF_CMD_TOGGLE:
-            tmp = *(bool *)attrib->data;
-            *(bool *)attrib->data = tmp ? 0 : 1;
+            tmp = data->on_off;
+            data->on_off = tmp ? 0 : 1;
             break;
     }
 
@@ -48,8 +48,6 @@
 
 #include "types.h"
 
-#define ZCL_ON_OFF_ATTRIB_LIST_SZ 2
-
 /**************************************************************************/
 /*!
         On/Off enumerated values.
@@ -76,17 +74,24 @@ typedef struct _zcl_on_off_data_t
 
 /**************************************************************************/
 /*!
-
+        On/Off attribute definitions in ascending attribute ID order.
+        X(id, type, access, data struct, field)
 */
 /**************************************************************************/
-typedef struct _zcl_on_off_attrib_list_t
+#define ZCL_ON_OFF_ATTRIBS(X) \
+    X(ZCL_ON_OFF_ATTRIB, ZCL_TYPE_BOOL, ZCL_ACCESS_READ_WRITE, zcl_on_off_data_t, on_off)
+
+/// On/Off attribute table indices
+typedef enum _zcl_on_off_attrib_idx_t
 {
-    zcl_attrib_t list[ZCL_ON_OFF_ATTRIB_LIST_SZ];
-    zcl_on_off_data_t data;
-} zcl_on_off_attrib_list_t;
+    ZCL_ON_OFF_ATTRIBS(ZCL_ATTRIB_INDEX)
+    ZCL_ON_OFF_ATTRIB_CNT
+} zcl_on_off_attrib_idx_t;
+
+extern const zcl_attrib_t zcl_on_off_attrib_tbl[ZCL_ON_OFF_ATTRIB_CNT];
 
-void zcl_on_off_init(zcl_on_off_attrib_list_t *attrib_list);
-void zcl_on_off_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr);
+void zcl_on_off_init(zcl_on_off_data_t *data);
+void zcl_on_off_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr);
 U8 zcl_on_off_gen_req(U8 *data, zcl_hdr_t *hdr);
 
 #endif
@@ -45,25 +45,22 @@
 
 LIST(scene_tbl);
 
+/// Scenes attribute table generated from the attribute definitions
+const zcl_attrib_t zcl_scenes_attrib_tbl[ZCL_SCENES_ATTRIB_CNT] =
+{
+    ZCL_SCENES_ATTRIBS(ZCL_ATTRIB_ENTRY)
+};
+
 /**************************************************************************/
 /*!
 
 */
 /**************************************************************************/
-void zcl_scenes_init(zcl_scenes_attrib_list_t *attrib_list)
+void zcl_scenes_init(zcl_scenes_data_t *data)
 {
     // init the data values
-    memset(&attrib_list->data, 0, sizeof(zcl_scenes_data_t));
-    attrib_list->data.name_supp = ZCL_SCENES_NAME_SUPPORT;
-
-    // init the attribute fields
-    zcl_set_attrib(&attrib_list->list[0], ZCL_SCENES_ATTRIB_SCENE_COUNT,    ZCL_TYPE_U8,        ZCL_ACCESS_READ_ONLY, &attrib_list->data.scene_cnt);
-    zcl_set_attrib(&attrib_list->list[1], ZCL_SCENES_ATTRIB_CURR_SCENE,     ZCL_TYPE_U8,        ZCL_ACCESS_READ_ONLY, &attrib_list->data.curr_scene);
-    zcl_set_attrib(&attrib_list->list[2], ZCL_SCENES_ATTRIB_CURR_GROUP,     ZCL_TYPE_U16,       ZCL_ACCESS_READ_ONLY, &attrib_list->data.curr_grp);
-    zcl_set_attrib(&attrib_list->list[3], ZCL_SCENES_ATTRIB_SCENE_VALID,    ZCL_TYPE_BOOL,      ZCL_ACCESS_READ_ONLY, &attrib_list->data.scene_valid);
-    zcl_set_attrib(&attrib_list->list[4], ZCL_SCENES_ATTRIB_NAME_SUPP,      ZCL_TYPE_8BITMAP,   ZCL_ACCESS_READ_ONLY, &attrib_list->data.name_supp);
-    zcl_set_attrib(&attrib_list->list[5], ZCL_SCENES_ATTRIB_LAST_CONFIG_BY, ZCL_TYPE_IEEE_ADDR, ZCL_ACCESS_READ_ONLY, &attrib_list->data.last_cfg_by);
-    zcl_set_attrib(&attrib_list->list[6], ZCL_END_MARKER,                   0,                  0,                    NULL);
+    memset(data, 0, sizeof(zcl_scenes_data_t));
+    data->name_supp = ZCL_SCENES_NAME_SUPPORT;
 
     // init the table
     list_init(scene_tbl);
@@ -200,7 +197,7 @@ static U8 zcl_scenes_tbl_clear(U16 grp_id)
 
 */
 /**************************************************************************/
-void zcl_scenes_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, zcl_clust_t *clust, zcl_hdr_t *hdr)
+void zcl_scenes_rx_handler(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
     U8 status, scene_cnt, len, *data_ptr, *resp_ptr, *list_ptr;
     zcl_scenes_entry_t entry;
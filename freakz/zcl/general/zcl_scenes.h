@@ -45,7 +45,6 @@
 
 #include "types.h"
 
-#define ZCL_SCENES_ATTRIB_LIST_SZ       7
 #define ZCL_SCENES_NAME_MAX_LEN         16
 #define ZCL_SCENES_EXT_MAX_LEN          13
 #define ZCL_SCENES_NAME_SUPPORT         0x80
@@ -102,14 +101,26 @@ typedef struct _zcl_scenes_data_t
 
 /**************************************************************************/
 /*!
-
+    Scenes attribute definitions in ascending attribute ID order.
+    X(id, type, access, data struct, field)
 */
 /**************************************************************************/
-typedef struct _zcl_scenes_attrib_list_t
+#define ZCL_SCENES_ATTRIBS(X) \
+    X(ZCL_SCENES_ATTRIB_SCENE_COUNT,    ZCL_TYPE_U8,        ZCL_ACCESS_READ_ONLY, zcl_scenes_data_t, scene_cnt)    \
+    X(ZCL_SCENES_ATTRIB_CURR_SCENE,     ZCL_TYPE_U8,        ZCL_ACCESS_READ_ONLY, zcl_scenes_data_t, curr_scene)   \
+    X(ZCL_SCENES_ATTRIB_CURR_GROUP,     ZCL_TYPE_U16,       ZCL_ACCESS_READ_ONLY, zcl_scenes_data_t, curr_grp)     \
+    X(ZCL_SCENES_ATTRIB_SCENE_VALID,    ZCL_TYPE_BOOL,      ZCL_ACCESS_READ_ONLY, zcl_scenes_data_t, scene_valid)  \
+    X(ZCL_SCENES_ATTRIB_NAME_SUPP,      ZCL_TYPE_8BITMAP,   ZCL_ACCESS_READ_ONLY, zcl_scenes_data_t, name_supp)    \
+    X(ZCL_SCENES_ATTRIB_LAST_CONFIG_BY, ZCL_TYPE_IEEE_ADDR, ZCL_ACCESS_READ_ONLY, zcl_scenes_data_t, last_cfg_by)
+
+/// Scenes attribute table indices
+typedef enum _zcl_scenes_attrib_idx_t
 {
-    zcl_attrib_t list[ZCL_SCENES_ATTRIB_LIST_SZ];
-    zcl_scenes_data_t data;
-} zcl_scenes_attrib_list_t;
+    ZCL_SCENES_ATTRIBS(ZCL_ATTRIB_INDEX)
+    ZCL_SCENES_ATTRIB_CNT
+} zcl_scenes_attrib_idx_t;
+
+extern const zcl_attrib_t zcl_scenes_attrib_tbl[ZCL_SCENES_ATTRIB_CNT];
 
 /**************************************************************************/
 /*!
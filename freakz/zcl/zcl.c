@@ -73,21 +73,34 @@ U8 zcl_get_seq_num()
 
 /**************************************************************************/
 /*!
-        Used to find the attribute from a list of attributes based on the
-        attribute ID.
+        Used to find the attribute in a cluster's attribute table based on the
+        attribute ID. The table is generated sorted by attribute ID so this is a
+        binary search.
 */
 /**************************************************************************/
-zcl_attrib_t *zcl_find_attrib(zcl_attrib_t *attrib_list, U16 attrib_id)
+const zcl_attrib_t *zcl_find_attrib(const zcl_clust_t *clust, U16 attrib_id)
 {
-    U8 i;
+    U8 lo, hi, mid;
 
-    if (attrib_list)
+    if (clust && clust->attrib_list)
     {
-        for (i=0; attrib_list[i].id != ZCL_END_MARKER; i++)
+        lo = 0;
+        hi = clust->attrib_cnt;
+        while (lo < hi)
         {
-            if (attrib_list[i].id == attrib_id)
+            mid = (lo + hi) >> 1;
+            if (clust->attrib_list[mid].id == attrib_id)
             {
-                return &attrib_list[i];
+                return &clust->attrib_list[mid];
+            }
+
+            if (clust->attrib_list[mid].id < attrib_id)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
             }
         }
     }
@@ -96,20 +109,33 @@ zcl_attrib_t *zcl_find_attrib(zcl_attrib_t *attrib_list, U16 attrib_id)
 
 /**************************************************************************/
 /*!
-        Used to find a cluster from a list of clusters based on the cluster ID.
+        Used to find a cluster from a cluster table based on the cluster ID.
+        The table needs to be sorted by cluster ID.
 */
 /**************************************************************************/
-zcl_clust_t *zcl_find_clust(zcl_clust_t **clust_list, U16 clust_id)
+const zcl_clust_t *zcl_find_clust(const zcl_clust_t *clust_tbl, U8 clust_cnt, U16 clust_id)
 {
-    U8 i;
+    U8 lo, hi, mid;
 
-    if (clust_list)
+    if (clust_tbl)
     {
-        for (i=0; clust_list[i]->clust_id != ZCL_END_MARKER; i++)
+        lo = 0;
+        hi = clust_cnt;
+        while (lo < hi)
         {
-            if (clust_list[i]->clust_id == clust_id)
+            mid = (lo + hi) >> 1;
+            if (clust_tbl[mid].clust_id == clust_id)
+            {
+                return &clust_tbl[mid];
+            }
+
+            if (clust_tbl[mid].clust_id < clust_id)
+            {
+                lo = mid + 1;
+            }
+            else
             {
-                return clust_list[i];
+                hi = mid;
             }
         }
     }
@@ -118,47 +144,69 @@ zcl_clust_t *zcl_find_clust(zcl_clust_t **clust_list, U16 clust_id)
 
 /**************************************************************************/
 /*!
-        Decodes the attribute size and returns the size in bytes. This will
-        be used when calculating the length of the following attribute value for
-        either decoding of a ZCL frame or generating a ZCL response.
+        Decodes the size of a value of the given data type as it appears over
+        the air. This is only needed for values that don't come from an attribute
+        table, ie: the values in an incoming frame or in a client request.
 */
 /**************************************************************************/
-U8 zcl_get_attrib_size(zcl_attrib_t *attrib)
+U8 zcl_get_type_size(U8 type, const U8 *data)
 {
-    switch (attrib->type)
+    switch (type)
     {
     case ZCL_TYPE_8BIT:
+    case ZCL_TYPE_8BITMAP:
     case ZCL_TYPE_U8:
         return sizeof(U8);
 
     case ZCL_TYPE_16BIT:
+    case ZCL_TYPE_16BITMAP:
     case ZCL_TYPE_U16:
         return sizeof(U16);
 
     case ZCL_TYPE_32BIT:
+    case ZCL_TYPE_32BITMAP:
     case ZCL_TYPE_U32:
         return sizeof(U32);
 
     case ZCL_TYPE_BOOL:
         return sizeof(bool);
 
+    case ZCL_TYPE_IEEE_ADDR:
+        return sizeof(U64);
+
     case ZCL_TYPE_CHAR_STRING:
         // the first byte of the string attrib has the size. so we need
         // to return the value of the first byte + 1 to account for using
         // a byte to hold the string size
-        return ((*(U8 *)attrib->data) + 1);
+        return (data) ? (*data + 1) : 0xff;
     default:
         return 0xff;
     }
 }
 
+/**************************************************************************/
+/*!
+        Returns the size in bytes of the attribute's current value. The size
+        comes precomputed from the attribute table, except for strings where
+        it depends on the length byte at the start of the value.
+*/
+/**************************************************************************/
+U8 zcl_get_attrib_size(const zcl_clust_t *clust, const zcl_attrib_t *attrib)
+{
+    if (attrib->type == ZCL_TYPE_CHAR_STRING)
+    {
+        return *ZCL_ATTRIB_DATA(clust, attrib) + 1;
+    }
+    return attrib->size;
+}
+
 /**************************************************************************/
 /*!
     Check if there is space in the response frame for the current attribute.
         The max length is based on the max application payload size.
 */
 /**************************************************************************/
-static bool zcl_attrib_check_space_avail(zcl_attrib_t *attrib, U8 resp_len)
+static bool zcl_attrib_check_space_avail(const zcl_clust_t *clust, const zcl_attrib_t *attrib, U8 resp_len)
 {
     U8 size;
 
@@ -166,7 +214,7 @@ static bool zcl_attrib_check_space_avail(zcl_attrib_t *attrib, U8 resp_len)
     {
         // need to add an extra 4 bytes to the size because we need to send the attrib id
         // type, and status
-        size = zcl_get_attrib_size(attrib);
+        size = zcl_get_attrib_size(clust, attrib);
         return ((resp_len + size + 4) < ZCL_MAX_PAYLOAD_SIZE);
     }
     return false;
@@ -188,36 +236,6 @@ void zcl_set_string_attrib(U8 *attrib_data, U8 *val, U8 max_sz)
     }
 }
 
-/**************************************************************************/
-/*!
-
-*/
-/**************************************************************************/
-void zcl_set_clust(zcl_clust_t *clust, U8 ep, U16 clust_id, zcl_attrib_t *attrib_list,
-                   void (*rx_handler)(U8 *, U8 *, U16, U8, struct _zcl_clust_t *, zcl_hdr_t *),
-                   void (*action_handler)(U8, void *))
-{
-    clust->ep               = ep;
-    clust->clust_id         = clust_id;
-    clust->attrib_list      = attrib_list;
-    clust->rx_handler       = rx_handler;
-    clust->action_handler   = action_handler;
-}
-
-/**************************************************************************/
-/*!
-
-*/
-/**************************************************************************/
-void zcl_set_attrib(zcl_attrib_t *attrib, U16 id, U8 type, U8 access, void *data)
-{
-    attrib->id        = id;
-    attrib->type      = type;
-    attrib->access    = access;
-    attrib->data      = data;
-    attrib->rpt       = NULL;
-}
-
 /**************************************************************************/
 /*!
         This function implements the ZCL read attribute foundation command.
@@ -228,12 +246,12 @@ void zcl_set_attrib(zcl_attrib_t *attrib, U16 id, U8 type, U8 access, void *data
     TODO: Rewrite this function to make it more concise
 */
 /**************************************************************************/
-static U8 zcl_cmd_read_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *clust, zcl_hdr_t *hdr)
+static U8 zcl_cmd_read_attrib(U8 *resp, U16 src_addr, U8 src_ep, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
-    U8 i, str_len, len, status, *resp_ptr, *data_ptr;
+    U8 i, size, len, status, *resp_ptr, *data_ptr;
     U16 attrib_id;
     zcl_hdr_t hdr_out;
-    zcl_attrib_t *attrib = NULL;
+    const zcl_attrib_t *attrib = NULL;
 
     // save the original position so we can calculate the amount of data we wrote
     resp_ptr = resp;
@@ -260,14 +278,14 @@ static U8 zcl_cmd_read_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *cl
         data_ptr += sizeof(U16);
 
         // get attrib from attrib list
-        if ((attrib = zcl_find_attrib(clust->attrib_list, attrib_id)) == NULL)
+        if ((attrib = zcl_find_attrib(clust, attrib_id)) == NULL)
         {
             status = ZCL_STATUS_UNSUP_ATTRIB;
         }
         else
         {
             // check to make sure there is enough space in the frame to include the attribute
-            if (!zcl_attrib_check_space_avail(attrib, resp_ptr - resp))
+            if (!zcl_attrib_check_space_avail(clust, attrib, resp_ptr - resp))
             {
                 status = ZCL_STATUS_INSUFF_SPACE;
             }
@@ -289,34 +307,12 @@ static U8 zcl_cmd_read_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *cl
             continue;
         }
 
+        // the attrib value is copied straight out of the storage block. strings
+        // carry their length in the first byte so they go out as-is too.
         *resp_ptr++ = attrib->type;
-        switch (attrib->type)
-        {
-        case ZCL_TYPE_U8:
-            *resp_ptr++ = *(U8 *)attrib->data;
-            break;
-
-        case ZCL_TYPE_U16:
-            *(U16 *)resp_ptr = *(U16 *)attrib->data;
-            resp_ptr += sizeof(U16);
-            break;
-
-        case ZCL_TYPE_U32:
-            *(U32 *)resp_ptr = *(U32 *)attrib->data;
-            resp_ptr += sizeof(U32);
-            break;
-
-        case ZCL_TYPE_BOOL:
-            *(U8 *)resp_ptr++ = *(U8 *)attrib->data;
-            break;
-
-        case ZCL_TYPE_CHAR_STRING:
-            // string length is contained in the first byte of data. So add 1 to str_len
-            str_len = (*(U8 *)attrib->data) + 1;
-            memcpy(resp_ptr, (U8 *)attrib->data, str_len);
-            resp_ptr += str_len;
-            break;
-        }
+        size = zcl_get_attrib_size(clust, attrib);
+        memcpy(resp_ptr, ZCL_ATTRIB_DATA(clust, attrib), size);
+        resp_ptr += size;
     }
 
     // return the length of the response
@@ -330,11 +326,11 @@ static U8 zcl_cmd_read_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *cl
         of attributes and will return a response based on the write status.
 */
 /**************************************************************************/
-static U8 zcl_cmd_write_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *clust, zcl_hdr_t *hdr)
+static U8 zcl_cmd_write_attrib(U8 *resp, U16 src_addr, U8 src_ep, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
     U8 size, len, type, *data_ptr, status, *resp_ptr;
     U16 attrib_id;
-    zcl_attrib_t *attrib;
+    const zcl_attrib_t *attrib;
     zcl_hdr_t hdr_out;
 
     // init the data and response pointers
@@ -358,28 +354,41 @@ static U8 zcl_cmd_write_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *c
 
         attrib_id = *(U16 *)data_ptr;
         data_ptr += sizeof(U16);
+        type = *data_ptr++;
+
+        // get the size of the value in the frame so that we can skip over it
+        // if the attribute can't be written
+        if ((size = zcl_get_type_size(type, data_ptr)) == 0xff)
+        {
+            // unknown type. there's no way to find the next record so end the frame here.
+            *resp_ptr++         = ZCL_STATUS_INVALID_TYPE;
+            *(U16 *)resp_ptr    = attrib_id;
+            resp_ptr += sizeof(U16);
+            break;
+        }
 
         // find attribute
-        if ((attrib = zcl_find_attrib(clust->attrib_list, attrib_id)) == NULL)
+        if ((attrib = zcl_find_attrib(clust, attrib_id)) == NULL)
         {
             status = ZCL_STATUS_UNSUP_ATTRIB;
-            type = ZCL_TYPE_INVALID;
         }
         else
         {
             // check that the type matches the type on the attribute
-            type = *(U8 *)data_ptr++;
             if (type != attrib->type)
             {
                 status = ZCL_STATUS_INVALID_TYPE;
             }
-
-            if (attrib->access == ZCL_ACCESS_READ_ONLY)
+            else if (attrib->access == ZCL_ACCESS_READ_ONLY)
             {
                 status = ZCL_STATUS_READ_ONLY;
             }
+            else if (size > attrib->size)
+            {
+                status = ZCL_STATUS_INVALID_VALUE;
+            }
 
-            if (!zcl_attrib_check_space_avail(attrib, resp_ptr - resp))
+            if (!zcl_attrib_check_space_avail(clust, attrib, resp_ptr - resp))
             {
                 status = ZCL_STATUS_INSUFF_SPACE;
             }
@@ -398,42 +407,14 @@ static U8 zcl_cmd_write_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *c
         }
         else if (status != ZCL_STATUS_SUCCESS)
         {
-            continue;
-        }
-
-        // update the attrib value. if the attrib was not found, then
-        // don't update, but move the data pointer along to the next attrib to be udpated.
-        switch (type)
-        {
-        case ZCL_TYPE_U8:
-            *(U8 *)attrib->data = *data_ptr++;
-            break;
-
-        case ZCL_TYPE_U16:
-            *(U16 *)attrib->data = *(U16 *)data_ptr;
-            data_ptr += sizeof(U16);
-            break;
-
-        case ZCL_TYPE_U32:
-            *(U32 *)attrib->data = *(U32 *)data_ptr;
-            data_ptr += sizeof(U32);
-            break;
-
-        case ZCL_TYPE_BOOL:
-            *(bool *)attrib->data = *(bool *)data_ptr++;
-            break;
-
-        case ZCL_TYPE_CHAR_STRING:
-            // byte 0 is the length of the string
-            size = *(U8 *)data_ptr++;
-
-            // start the copy from byte 1
-            memcpy(attrib->data, data_ptr, size);
             data_ptr += size;
-            break;
-        default:
             continue;
         }
+
+        // update the attrib value. the value in the frame has the same layout as
+        // the storage so it gets copied straight in, including the length byte of strings.
+        memcpy(ZCL_ATTRIB_DATA(clust, attrib), data_ptr, size);
+        data_ptr += size;
     }
 
     // add the len to the response buffer and move the data pointer to the beginning of the data
@@ -450,11 +431,11 @@ static U8 zcl_cmd_write_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *c
     discovered.
 */
 /**************************************************************************/
-static U8 zcl_cmd_disc_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *clust, zcl_hdr_t *hdr)
+static U8 zcl_cmd_disc_attrib(U8 *resp, U16 src_addr, U8 src_ep, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
-    U8 i, len, max_attribs, *data_ptr, *resp_ptr, *disc_comp_field;
+    U8 i, idx, len, max_attribs, *data_ptr, *resp_ptr, *disc_comp_field;
     U16 attrib_id;
-    zcl_attrib_t *attrib;
+    const zcl_attrib_t *attrib;
     zcl_hdr_t hdr_out;
 
     // init the data and response pointers
@@ -481,8 +462,11 @@ static U8 zcl_cmd_disc_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *cl
     disc_comp_field = resp_ptr++;
     *disc_comp_field = ZCL_STATUS_DISC_COMPLETE;
 
-    // iterate through each requested attrib
-    for (i=0; i<max_attribs; i++)
+    // the attrib table is sorted so skip to the first attrib at or after the start
+    // attrib id and then walk the table from there.
+    for (idx=0; (idx < clust->attrib_cnt) && (clust->attrib_list[idx].id < attrib_id); idx++);
+
+    for (i=0; (i<max_attribs) && (idx < clust->attrib_cnt); i++, idx++)
     {
         if ((resp_ptr - resp) >= (ZCL_MAX_PAYLOAD_SIZE - 3))
         {
@@ -492,13 +476,10 @@ static U8 zcl_cmd_disc_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *cl
             break;
         }
 
-        if ((attrib = zcl_find_attrib(clust->attrib_list, attrib_id)) != NULL)
-        {
-            *(U16 *)resp_ptr = attrib->id;
-            resp_ptr += sizeof(U16);
-            *resp_ptr++ = attrib->type;
-        }
-        attrib_id++;
+        attrib = &clust->attrib_list[idx];
+        *(U16 *)resp_ptr = attrib->id;
+        resp_ptr += sizeof(U16);
+        *resp_ptr++ = attrib->type;
     }
     return (resp_ptr - resp);
 }
@@ -508,18 +489,18 @@ static U8 zcl_cmd_disc_attrib(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *cl
         This function configures a reporting entry. Reporting entries are used
         to report on an attribute value at specified time intervals. Multiple
         attributes can be configured for reporting. All attributes that are
-        configured to report their status will go into a reporting table that is
-        checked once every second and their expiry is decremented. When the expiry
-        goes to zero, a reporting frame will be generated. Only one attribute is reported
+        configured to report their status will go into a reporting table and get
+        a slow timer set to the reporting interval. When the timer expires, a
+        reporting frame will be generated. Only one attribute is reported
         per report frame.
 */
 /**************************************************************************/
-static U8 zcl_cmd_cfg_rpt(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *clust, U16 prof_id, zcl_hdr_t *hdr)
+static U8 zcl_cmd_cfg_rpt(U8 *resp, U16 src_addr, U8 src_ep, const zcl_clust_t *clust, U16 prof_id, zcl_hdr_t *hdr)
 {
     U8 *data_ptr, *resp_ptr, dir, type, len, status;
     U16 attrib_id, max_intv, min_intv;
     U32 change = 0;
-    zcl_attrib_t *attrib;
+    const zcl_attrib_t *attrib;
     zcl_hdr_t hdr_out;
 
     data_ptr = hdr->payload;
@@ -541,7 +522,7 @@ static U8 zcl_cmd_cfg_rpt(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *clust,
         attrib_id   = *(U16 *)data_ptr;
         data_ptr += sizeof(U16);
 
-        if ((attrib = zcl_find_attrib(clust->attrib_list, attrib_id)) == NULL)
+        if ((attrib = zcl_find_attrib(clust, attrib_id)) == NULL)
         {
             // we can't figure out how to recover from a nonexistent attribute because the size of the change field
             // is dependent on the attribute's type.
@@ -556,7 +537,7 @@ static U8 zcl_cmd_cfg_rpt(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *clust,
             if (attrib)
             {
                 // move the data pointer up by the proper amount of bytes and then restart the loop
-                len = zcl_get_attrib_size(attrib);
+                len = zcl_get_attrib_size(clust, attrib);
                 data_ptr += len + 2;
 
                 // fill out the resp payload
@@ -609,7 +590,7 @@ static U8 zcl_cmd_cfg_rpt(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *clust,
 
         if (attrib)
         {
-            status = zcl_rpt_add(src_addr, src_ep, clust->clust_id, attrib, prof_id, max_intv, change);
+            status = zcl_rpt_add(src_addr, src_ep, clust, attrib, prof_id, max_intv, change);
         }
 
         *resp_ptr++ = status;
@@ -630,7 +611,7 @@ static U8 zcl_cmd_cfg_rpt(U8 *resp, U16 src_addr, U8 src_ep, zcl_clust_t *clust,
         handling.
 */
 /**************************************************************************/
-void zcl_cmd_handler(U8 *resp, U8 *resp_len, U16 src_addr, U8 src_ep, U16 prof_id, zcl_clust_t *clust, zcl_hdr_t *hdr)
+void zcl_cmd_handler(U8 *resp, U8 *resp_len, U16 src_addr, U8 src_ep, U16 prof_id, const zcl_clust_t *clust, zcl_hdr_t *hdr)
 {
     // make sure that the buffers and clusters are present
     if ((clust == NULL) || (hdr == NULL))
@@ -46,6 +46,7 @@
 #ifndef ZCL_H
 #define ZCL_H
 
+#include <stddef.h>
 #include "types.h"
 
 #define ZCL_END_MARKER          0xffff          ///< Used to define the end of a list or table.
@@ -58,6 +59,23 @@
 // mem pointer macros
 #define ZCL_RPT(m)        ((zcl_rpt_entry_t *)MMEM_PTR(&m->mmem_ptr))   ///< De-reference the mem ptr and cast it as a zcl report entry
 
+/*!
+    Attribute table generators. Each cluster declares its attributes once as an
+    X-macro list of X(id, type, access, data struct, field) records, in ascending
+    attribute ID order. ZCL_ATTRIB_ENTRY expands a record into a const table entry
+    with the size and offset of the field precomputed, and ZCL_ATTRIB_INDEX expands
+    it into an index enumeration so the table size is known at compile time.
+*/
+#define ZCL_ATTRIB_ENTRY(id, type, access, data_t, field)   {id, type, access, sizeof(((data_t *)0)->field), offsetof(data_t, field)},
+#define ZCL_ATTRIB_INDEX(id, type, access, data_t, field)   id##_IDX,
+
+/// Pointer to the value of an attribute inside the cluster's attribute storage block
+#define ZCL_ATTRIB_DATA(clust, attrib)  ((U8 *)(clust)->data + (attrib)->offset)
+
+/// Fill out a cluster table entry. The attribute table must be an array so its size can be taken.
+#define ZCL_CLUST_ENTRY(ep, clust_id, attrib_tbl, data, rx_handler, action_handler) \
+    {ep, clust_id, attrib_tbl, sizeof(attrib_tbl)/sizeof(zcl_attrib_t), data, rx_handler, action_handler}
+
 /**************************************************************************/
 /*!
         Enumeration of the ZCL frame fields.
@@ -190,9 +208,11 @@ typedef enum _zcl_status_enum_t
 
 /**************************************************************************/
 /*!
-        ZCL attribute structure. Contains all fields to address the attribute.
-        Also, contains an optional field in case the attribute is set to
-        report.
+        ZCL attribute structure. These are generated at compile time into const
+        tables sorted by attribute ID, one table per cluster type. The attribute
+        value itself lives in the cluster's storage block at the given offset.
+        The size is the storage size of the value, which for strings is the
+        maximum size including the length byte.
 */
 /**************************************************************************/
 typedef struct _zcl_attrib_t
@@ -200,10 +220,23 @@ typedef struct _zcl_attrib_t
     U16         id;             ///< Attrib ID
     U8          type;           ///< Attrib data type
     U8          access;         ///< Attrib data access privileges
-    void        *data;          ///< Ptr to data
-    mem_ptr_t   *rpt;           ///< Placeholder in case this attrib requires a report
+    U8          size;           ///< Storage size of the attrib value
+    U16         offset;         ///< Offset of the attrib value in the storage block
 } zcl_attrib_t;
 
+/**************************************************************************/
+/*!
+        ZCL attribute value. This is used on the client side to hold the
+        attribute IDs and values that will go out in a write attributes request.
+*/
+/**************************************************************************/
+typedef struct _zcl_attrib_val_t
+{
+    U16         id;             ///< Attrib ID
+    U8          type;           ///< Attrib data type
+    void        *data;          ///< Ptr to data
+} zcl_attrib_val_t;
+
 /**************************************************************************/
 /*!
         ZCL frame control field.
@@ -240,16 +273,21 @@ typedef struct _zcl_hdr_t
         for incoming frames addressed to that cluster. The action handler is
         for further actions on that cluster which can be defined by the user:
         ie: Set a GPIO to turn on or off a light.
+
+        Clusters are meant to be declared in a const table sorted by cluster ID
+        using ZCL_CLUST_ENTRY so that they can be looked up with a binary search.
 */
 /**************************************************************************/
 typedef struct _zcl_clust_t
 {
-    U8 ep;                      ///< Endpoint that cluster belongs to
-    U16 clust_id;               ///< Cluster ID
-    zcl_attrib_t *attrib_list;  ///< Cluster attribute list
+    U8 ep;                              ///< Endpoint that cluster belongs to
+    U16 clust_id;                       ///< Cluster ID
+    const zcl_attrib_t *attrib_list;    ///< Cluster attribute table, sorted by attrib ID
+    U8 attrib_cnt;                      ///< Number of entries in the attribute table
+    void *data;                         ///< Attribute storage block
 
     /// Cluster rx handler callback. All frames targeting this cluster will go here to get processed
-    void (*rx_handler)(U8 *resp, U8 *resp_len, U16 addr, U8 ep, struct _zcl_clust_t *clust, zcl_hdr_t *hdr);
+    void (*rx_handler)(U8 *resp, U8 *resp_len, U16 addr, U8 ep, const struct _zcl_clust_t *clust, zcl_hdr_t *hdr);
 
     /// Cluster action handler. After going to the rx handler, any application specific actions can be defined
     /// in the action handler
@@ -285,17 +323,17 @@ typedef struct _zcl_disc_attrib_rep_t
         ZCL Report entry
         This is the structure that goes into the ZCL reporting table. Multiple
         attributes can be set to report at different time intervals. All reports
-        will end up as entries in the reporting table which is scanned once per
-        second for any pending attribs that need reporting.
+        will end up as entries in the reporting table and each entry runs its
+        own slow timer to send out its reports.
 */
 /**************************************************************************/
 typedef struct _zcl_rpt_entry_t
 {
     U16                     timeout;        ///< Max timeout value of the report
-    U16                     expiry;         ///< Current value of the expiration. When 0, a report will be sent
     bool                    rpt_needed;     ///< Flag to indicate that a report is needed
     U32                     change;         ///< Min change required to report attribute
-    zcl_attrib_t            *attrib;        ///< Pointer to the attribute that will be reported
+    const zcl_attrib_t      *attrib;        ///< Pointer to the attribute that will be reported
+    U8                      *data;          ///< Pointer to the value of the attribute
     U16                     addr;           ///< The destination addr of the report
     U8                      ep;             ///< The destination endpoint of the report
     U16                     clust;          ///< The destination cluster ID
@@ -305,28 +343,26 @@ typedef struct _zcl_rpt_entry_t
 // ZCL prototypes
 void zcl_init();
 U8 zcl_get_seq_num();
-zcl_attrib_t *zcl_find_attrib(zcl_attrib_t *attrib_list, U16 attrib_id);
-zcl_clust_t *zcl_find_clust(zcl_clust_t **clust_list, U16 clust_id);
-U8 zcl_get_attrib_size(zcl_attrib_t *attrib);
-void zcl_cmd_handler(U8 *resp, U8 *resp_len, U16 src_addr, U8 src_ep, U16 prof_id, zcl_clust_t *clust, zcl_hdr_t *hdr);
+const zcl_attrib_t *zcl_find_attrib(const zcl_clust_t *clust, U16 attrib_id);
+const zcl_clust_t *zcl_find_clust(const zcl_clust_t *clust_tbl, U8 clust_cnt, U16 clust_id);
+U8 zcl_get_type_size(U8 type, const U8 *data);
+U8 zcl_get_attrib_size(const zcl_clust_t *clust, const zcl_attrib_t *attrib);
+void zcl_cmd_handler(U8 *resp, U8 *resp_len, U16 src_addr, U8 src_ep, U16 prof_id, const zcl_clust_t *clust, zcl_hdr_t *hdr);
 void zcl_set_string_attrib(U8 *attrib_data, U8 *val, U8 max_sz);
-void zcl_set_clust(zcl_clust_t *clust, U8 ep, U16 clust_id, zcl_attrib_t *attrib_list, void (*rx_handler)(U8 *, U8 *, U16, U8, struct _zcl_clust_t *, zcl_hdr_t *), void (*action_handler)(U8, void *));
-void zcl_set_attrib(zcl_attrib_t *attrib, U16 id, U8 type, U8 access, void *data);
 void zcl_parse_hdr(U8 *data, U8 len, zcl_hdr_t *hdr);
 
 // zcl_gen
 U8 zcl_gen_fcf(zcl_hdr_t *hdr);
 U8 zcl_gen_hdr(U8 *data, zcl_hdr_t *hdr);
 U8 zcl_gen_read_attrib(U8 *data, zcl_hdr_t *hdr, U16 *attrib_list, U8 attrib_num);
-U8 zcl_gen_write_attrib(U8 *data,zcl_hdr_t *hdr, zcl_attrib_t *attrib_list, U8 attrib_num);
+U8 zcl_gen_write_attrib(U8 *data,zcl_hdr_t *hdr, zcl_attrib_val_t *attrib_list, U8 attrib_num);
 U8 zcl_gen_disc_attrib(U8 *data, zcl_hdr_t *hdr, U16 start_attrib, U8 attrib_num);
-U8 zcl_gen_config_rpt(U8 *data, zcl_hdr_t *hdr, zcl_clust_t *clust, U16 attrib_id, U16 min_intv, U16 max_intv, U32 change);
+U8 zcl_gen_config_rpt(U8 *data, zcl_hdr_t *hdr, const zcl_clust_t *clust, U16 attrib_id, U16 min_intv, U16 max_intv, U32 change);
 U8 zcl_gen_def_resp(U8 *resp, U8 status, zcl_hdr_t *hdr);
 
 // zcl_rpt
 void zcl_rpt_init();
-U8 zcl_rpt_add(U16 src_addr, U8 src_ep, U16 clust_id, zcl_attrib_t *attrib, U16 prof_id, U16 timeout, U32 change);
-U8 zcl_rpt_remove(U16 src_addr, U8 src_ep, U16 clust, zcl_attrib_t *attrib);
-void zcl_rpt_periodic();
+U8 zcl_rpt_add(U16 src_addr, U8 src_ep, const zcl_clust_t *clust, const zcl_attrib_t *attrib, U16 prof_id, U16 timeout, U32 change);
+U8 zcl_rpt_remove(U16 src_addr, U8 src_ep, U16 clust_id, const zcl_attrib_t *attrib);
 
 #endif // ZCL_H
@@ -127,10 +127,10 @@ U8 zcl_gen_read_attrib(U8 *data, zcl_hdr_t *hdr, U16 *attrib_list, U8 attrib_num
         as well as the value to write.
 */
 /**************************************************************************/
-U8 zcl_gen_write_attrib(U8 *data, zcl_hdr_t *hdr, zcl_attrib_t *attrib_list, U8 attrib_num)
+U8 zcl_gen_write_attrib(U8 *data, zcl_hdr_t *hdr, zcl_attrib_val_t *attrib_list, U8 attrib_num)
 {
     U8 i, len, attrib_len, *data_ptr;
-    zcl_attrib_t *attrib;
+    zcl_attrib_val_t *attrib;
 
     // gen the zcl frame header
     len = zcl_gen_hdr(data, hdr);
@@ -146,7 +146,7 @@ U8 zcl_gen_write_attrib(U8 *data, zcl_hdr_t *hdr, zcl_attrib_t *attrib_list, U8
         *data_ptr++ = attrib->type;
 
         // get the len of the attribute and then copy it into the data ptr
-        attrib_len = zcl_get_attrib_size(attrib);
+        attrib_len = zcl_get_type_size(attrib->type, attrib->data);
         memcpy(data_ptr, attrib->data, attrib_len);
         data_ptr += attrib_len;
     }
@@ -189,16 +189,16 @@ U8 zcl_gen_disc_attrib(U8 *data, zcl_hdr_t *hdr, U16 start_attrib, U8 attrib_num
         if the value changed or not.
 */
 /**************************************************************************/
-U8 zcl_gen_config_rpt(U8 *data, zcl_hdr_t *hdr, zcl_clust_t *clust, U16 attrib_id, U16 min_intv, U16 max_intv, U32 change)
+U8 zcl_gen_config_rpt(U8 *data, zcl_hdr_t *hdr, const zcl_clust_t *clust, U16 attrib_id, U16 min_intv, U16 max_intv, U32 change)
 {
     U8 len, *data_ptr;
-    zcl_attrib_t *attrib;
+    const zcl_attrib_t *attrib;
 
     // gen the zcl frm hdr
     len = zcl_gen_hdr(data, hdr);
     data_ptr = data + len;
 
-    if ((attrib = zcl_find_attrib(clust->attrib_list, attrib_id)) == NULL)
+    if ((attrib = zcl_find_attrib(clust, attrib_id)) == NULL)
     {
         return 0;
     }
@@ -40,10 +40,9 @@
 
     This file contains functions to implement the Zigbee Cluster Library
     reporting feature. The reporting entries get put into a reporting table.
-        The table gets polled once per second by the slow clock and each entry's
-        expiry gets decremented. If an entry has an expiry of zero, and it's report
-        flag is triggered, a report frame will get sent. Only one attribute per frame
-        is currently supported.
+        Each entry runs a slow timer with the report's timeout. When the timer
+        expires and the entry's report flag is triggered, a report frame will get
+        sent. Only one attribute per frame is currently supported.
 */
 /**************************************************************************/
 #include "freakz.h"
@@ -52,12 +51,14 @@
 /**************************************************************************/
 /*!
     List head for the ZCL attribute reporting table. All reports are configured
-    as an entry and put inside this table. It will get called by the slow
-    clock once per second and any attributes that need processing will be handled.
+    as an entry and put inside this table.
 */
 /**************************************************************************/
 LIST(zcl_rpt);
 
+// static prototypes
+static void zcl_rpt_expire(void *ptr);
+
 /**************************************************************************/
 /*!
         Initialize the reporting table.
@@ -86,17 +87,13 @@ static mem_ptr_t *zcl_rpt_alloc()
 
 /**************************************************************************/
 /*!
-        Free the reporting entry and remove it from the table. It will also remove
-        the entry from the attribute.
+        Free the reporting entry and remove it from the table.
 */
 /**************************************************************************/
 static void zcl_rpt_free(mem_ptr_t *mem_ptr)
 {
     if (mem_ptr)
     {
-        // Nullify the report pointer in the attrib
-        ZCL_RPT(mem_ptr)->attrib->rpt = NULL;
-
         // free the mem pointer
         list_remove(zcl_rpt, mem_ptr);
         mem_heap_free(mem_ptr);
@@ -109,7 +106,7 @@ static void zcl_rpt_free(mem_ptr_t *mem_ptr)
         return a memory handle containing the entry.
 */
 /**************************************************************************/
-static mem_ptr_t *zcl_rpt_find(U16 src_addr, U8 ep, U16 clust, zcl_attrib_t *attrib)
+static mem_ptr_t *zcl_rpt_find(U16 src_addr, U8 ep, U16 clust, const zcl_attrib_t *attrib)
 {
     mem_ptr_t *mem_ptr;
 
@@ -133,14 +130,14 @@ static mem_ptr_t *zcl_rpt_find(U16 src_addr, U8 ep, U16 clust, zcl_attrib_t *att
         the entry and then fill out the entry with the necessary parameters.
 */
 /**************************************************************************/
-U8 zcl_rpt_add(U16 src_addr, U8 src_ep, U16 clust_id, zcl_attrib_t *attrib, U16 prof_id, U16 timeout, U32 change)
+U8 zcl_rpt_add(U16 src_addr, U8 src_ep, const zcl_clust_t *clust, const zcl_attrib_t *attrib, U16 prof_id, U16 timeout, U32 change)
 {
     mem_ptr_t *mem_ptr = NULL;
 
     // if the timeout value is 0xffff, then we will just free the report since
     // that means that the value will not be reported. Also, return if there is no
     // attrib
-    if (!attrib)
+    if (!clust || !attrib)
     {
         return ZCL_STATUS_UNSUP_ATTRIB;
     }
@@ -150,7 +147,7 @@ U8 zcl_rpt_add(U16 src_addr, U8 src_ep, U16 clust_id, zcl_attrib_t *attrib, U16
         return ZCL_STATUS_SUCCESS;
     }
 
-    if ((mem_ptr = zcl_rpt_find(src_addr, src_ep, clust_id, attrib)) == NULL)
+    if ((mem_ptr = zcl_rpt_find(src_addr, src_ep, clust->clust_id, attrib)) == NULL)
     {
         if ((mem_ptr = zcl_rpt_alloc()) == NULL)
         {
@@ -161,16 +158,14 @@ U8 zcl_rpt_add(U16 src_addr, U8 src_ep, U16 clust_id, zcl_attrib_t *attrib, U16
     // fill out the report entry
     ZCL_RPT(mem_ptr)->addr          = src_addr;
     ZCL_RPT(mem_ptr)->ep            = src_ep;
-    ZCL_RPT(mem_ptr)->clust         = clust_id;
+    ZCL_RPT(mem_ptr)->clust         = clust->clust_id;
     ZCL_RPT(mem_ptr)->attrib        = attrib;
+    ZCL_RPT(mem_ptr)->data          = ZCL_ATTRIB_DATA(clust, attrib);
     ZCL_RPT(mem_ptr)->prof_id       = prof_id;
     ZCL_RPT(mem_ptr)->timeout       = timeout;
-    ZCL_RPT(mem_ptr)->expiry        = timeout;
     ZCL_RPT(mem_ptr)->rpt_needed    = false;
     ZCL_RPT(mem_ptr)->change        = change;
-
-    // add a reference to the attribute to point to this entry
-    attrib->rpt                     = mem_ptr;
+    slow_tmr_set(&mem_ptr->tmr, timeout, zcl_rpt_expire, mem_ptr);
     return ZCL_STATUS_SUCCESS;
 }
 
@@ -180,7 +175,7 @@ U8 zcl_rpt_add(U16 src_addr, U8 src_ep, U16 clust_id, zcl_attrib_t *attrib, U16
         particular entry and then free it.
 */
 /**************************************************************************/
-U8 zcl_rpt_remove(U16 src_addr, U8 src_ep, U16 clust, zcl_attrib_t *attrib)
+U8 zcl_rpt_remove(U16 src_addr, U8 src_ep, U16 clust, const zcl_attrib_t *attrib)
 {
     mem_ptr_t *mem_ptr;
 
@@ -200,16 +195,17 @@ U8 zcl_rpt_remove(U16 src_addr, U8 src_ep, U16 clust, zcl_attrib_t *attrib)
 /**************************************************************************/
 static void zcl_rpt_send_rpt(mem_ptr_t *mem_ptr)
 {
-    U8 ep, len, *rpt_ptr, rpt[ZCL_MAX_RPT_SZ];
+    U8 ep, len, *data, *rpt_ptr, rpt[ZCL_MAX_RPT_SZ];
     U16 addr, clust, prof_id;
     U32 change;
     zcl_hdr_t hdr;
     bool rpt_needed;
-    zcl_attrib_t *attrib;
+    const zcl_attrib_t *attrib;
 
     change      = ZCL_RPT(mem_ptr)->change;
     rpt_needed  = ZCL_RPT(mem_ptr)->rpt_needed;
     attrib      = ZCL_RPT(mem_ptr)->attrib;
+    data        = ZCL_RPT(mem_ptr)->data;
     ep          = ZCL_RPT(mem_ptr)->ep;
     addr        = ZCL_RPT(mem_ptr)->addr;
     clust       = ZCL_RPT(mem_ptr)->clust;
@@ -238,28 +234,13 @@ static void zcl_rpt_send_rpt(mem_ptr_t *mem_ptr)
     rpt_ptr += sizeof(U16);
     *rpt_ptr++ = attrib->type;
 
-    switch (attrib->type)
+    // only fixed size attribs are reported. their size comes straight from the attrib table.
+    if ((attrib->type == ZCL_TYPE_CHAR_STRING) || ((rpt_ptr - rpt) + attrib->size > ZCL_MAX_RPT_SZ))
     {
-    case ZCL_TYPE_BOOL:
-    case ZCL_TYPE_8BIT:
-    case ZCL_TYPE_U8:
-        *rpt_ptr++ = *(U8 *)attrib->data;
-        break;
-
-    case ZCL_TYPE_16BIT:
-    case ZCL_TYPE_U16:
-        *(U16 *)rpt_ptr = *(U16 *)attrib->data;
-        rpt_ptr += sizeof(U16);
-        break;
-
-    case ZCL_TYPE_32BIT:
-    case ZCL_TYPE_U32:
-        *(U32 *)rpt_ptr = *(U32 *)attrib->data;
-        rpt_ptr += sizeof(U32);
-        break;
-    default:
         return;
     }
+    memcpy(rpt_ptr, data, attrib->size);
+    rpt_ptr += attrib->size;
     len = rpt_ptr - rpt;
 
     af_tx(rpt, len, ep, addr, ep, clust, prof_id, APS_DEST_ADDR_16_EP_PRESENT, 0, 6, af_handle_get());
@@ -267,30 +248,15 @@ static void zcl_rpt_send_rpt(mem_ptr_t *mem_ptr)
 
 /**************************************************************************/
 /*!
-    This is a periodic function that is called by the slow clock once per second.
-    When called, it will decrement the expiry. If the expiry is zero, then it
-    will send a report containing that attribute.
+    This is the slow timer callback for a reporting entry. When called, it will
+    send a report containing that attribute and then restart the timer for the
+    next report.
 */
 /**************************************************************************/
-void zcl_rpt_periodic()
+static void zcl_rpt_expire(void *ptr)
 {
-    mem_ptr_t *mem_ptr;
-
-    // scroll through list and decrement the expiry.
-    for (mem_ptr = list_head(zcl_rpt); mem_ptr != NULL; mem_ptr = mem_ptr->next)
-    {
-        if (ZCL_RPT(mem_ptr)->expiry == 0)
-        {
-            // expiry is zero. send a report.
-            zcl_rpt_send_rpt(mem_ptr);
+    mem_ptr_t *mem_ptr = ptr;
 
-            // reset the expiry
-            ZCL_RPT(mem_ptr)->expiry = ZCL_RPT(mem_ptr)->timeout;
-        }
-        else
-        {
-            // just decrement the expiry
-            ZCL_RPT(mem_ptr)->expiry--;
-        }
-    }
+    zcl_rpt_send_rpt(mem_ptr);
+    slow_tmr_set(&mem_ptr->tmr, ZCL_RPT(mem_ptr)->timeout, zcl_rpt_expire, mem_ptr);
 }
@@ -132,15 +132,24 @@ void zdo_init()
 {
 	zdo_cb = NULL;
 	aps_aib_t *aib = aps_aib_get();
+	U8 status;
+
 	zdo_cfg_init();
 	aib->seq = (U8)drvr_get_rand();
 	memset(&pcb, 0, sizeof(zdo_pcb_t));
-	af_ep_add(ZDO_EP,
-		  zdo_simple_desc,
-		  AF_BASE_SIMPLE_DESC_SIZE,
-		  false,
-		  zdo_rx_handler,
-		  zdo_conf_handler);
+	status = af_ep_add(ZDO_EP,
+			   zdo_simple_desc,
+			   AF_BASE_SIMPLE_DESC_SIZE,
+			   false,
+			   zdo_rx_handler,
+			   zdo_conf_handler);
+
+	/* nothing on the ZDO endpoint works without this */
+	if (status != AF_SUCCESS)
+	{
+		DBG_PRINT("ZDO_INIT: Couldn't register the ZDO endpoint. Status %02X.\n", status);
+		assert(0);
+	}
 
 	zdo_bind_mgr_init();
 }
@@ -753,6 +753,7 @@ void zdo_nwk_start();
 void nwk_disc_conf(U8 status, mem_ptr_t *mem_ptr);
 void nwk_join_conf(U8 status, U16 nwk_addr, U64 ext_pan_id, U8 channel);
 void nwk_form_conf(U8 status);
+void nwk_ed_scan_conf(U8 status, U8 *energy_list);
 void nwk_leave_conf(address_t *addr, U8 status);
 void nwk_leave_ind(address_t *addr, bool rejoin);
 void nwk_join_ind(U64 ext_addr, U16 nwk_addr);
@@ -766,7 +767,6 @@ void zdo_nwk_disc_resp_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 cl
 void zdo_nwk_update_resp_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clust);
 void zdo_nwk_leave_resp_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clust);
 void zdo_nwk_leave_req_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clust);
-void zdo_nwk_mgr_periodic();
 
 // zdo_cfg
 void zdo_cfg_init();
@@ -163,7 +163,7 @@ void zdo_disc_simple_desc_req_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep,
 {
 	U8 handle, size, *resp, resp_data[MAX_APS_PAYLOAD];
 	nwk_nib_t *nib = nwk_nib_get();
-	mem_ptr_t *mem_ptr;
+	ep_entry_t *ep;
 	zdo_req_t req;
 
 	/* parse the request */
@@ -185,12 +185,12 @@ void zdo_disc_simple_desc_req_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep,
 			return;
 		}
 
-		if ((mem_ptr = af_ep_find(req.type.simple_desc.ep)) != NULL)
+		if ((ep = af_ep_find(req.type.simple_desc.ep)) != NULL)
 		{
 			*resp++ = AF_SUCCESS;
-			*resp++ = EP_ENTRY(mem_ptr)->simple_desc_size;
-			memcpy(resp, EP_ENTRY(mem_ptr)->simple_desc, EP_ENTRY(mem_ptr)->simple_desc_size);
-			resp    += EP_ENTRY(mem_ptr)->simple_desc_size;
+			*resp++ = ep->simple_desc_size;
+			memcpy(resp, ep->simple_desc, ep->simple_desc_size);
+			resp    += ep->simple_desc_size;
 		} else {
 			/* endpoint does not exist on this device */
 			*resp++ = AF_NOT_ACTIVE;
@@ -49,11 +49,29 @@
 
 static mem_ptr_t *rmt_disc_mem_ptr;     ///< Remote nwk discovery mem pointer instantiation
 static bool rmt_nwk_disc;               ///< Remote nwk discovery flag
-static U8 rmt_nwk_disc_expiry;          ///< Remote nwk timeout value
+static slow_tmr_t rmt_nwk_disc_tmr;     ///< Remote nwk timeout timer
 static U8 leave_req_status;             ///< Leave request status
 
+/*
+ * Energy scan requested by a NWK update request. The scan runs in the
+ * background so the response is built up here as each scan confirm comes in.
+ */
+static struct
+{
+	bool	active;                         ///< Energy scan in progress
+	U16	src_addr;                       ///< Address of the requester
+	U8	seq;                            ///< Sequence number of the request
+	U8	scan_cnt;                       ///< Number of scans left to do
+	U8	list_cnt;                       ///< Number of energy values in the response
+	U32	channel_mask;                   ///< Channels to scan
+	U8	duration;                       ///< Scan duration for each channel
+	U8	resp_data[MAX_APS_PAYLOAD];     ///< Response that is being built up
+} ed_scan;
+
 /* static prototypes */
 static void nwk_disc_send_resp(U8 status);
+static void zdo_nwk_update_send_resp(U8 *resp_data, U8 *resp, U8 list_cnt, U8 seq, U8 status, U32 channel_mask, U16 src_addr);
+static void zdo_nwk_mgr_rmt_disc_expire(void *ptr);
 
 /*
  * This should be the first function called and will initiate the start procedure
@@ -68,7 +86,7 @@ void zdo_nwk_start()
 	DBG_PRINT("ZDO_START\n");
 	rmt_nwk_disc = false;
 	rmt_disc_mem_ptr = NULL;
-	rmt_nwk_disc_expiry = 0;
+	slow_tmr_stop(&rmt_nwk_disc_tmr);
 
 	/* reset the device first */
 	nwk_reset_req(true);
@@ -84,19 +102,32 @@ void zdo_nwk_start()
 }
 
 /*
- * This is a slow clock countdown timer to make sure that we clear the
+ * This is a slow clock timer callback to make sure that we clear the
  * contents of any scan and reset the nwk disc state.
  */
-void zdo_nwk_mgr_periodic()
+static void zdo_nwk_mgr_rmt_disc_expire(void *ptr)
 {
-	if (rmt_nwk_disc) {
-		if (rmt_nwk_disc_expiry == 0) {
-			rmt_nwk_disc = false;
-			rmt_disc_mem_ptr = NULL;
-		} else {
-			rmt_nwk_disc_expiry--;
-		}
-	}
+	rmt_nwk_disc = false;
+	rmt_disc_mem_ptr = NULL;
+}
+
+/*
+ * Score a candidate parent. Link quality carries the most weight since a weak
+ * link to the parent hurts every frame we send. Each level of depth costs
+ * ZIGBEE_JOIN_DEPTH_WEIGHT because a deeper parent means longer tree routes
+ * and a smaller address block to hand out to our own children. The beacon
+ * only has a capacity flag per device type so a parent that still takes both
+ * routers and end devices gets a small bonus for having more headroom.
+ */
+static U16 zdo_nwk_score(pan_descr_t *desc)
+{
+	U16 score;
+
+	score = desc->link_quality;
+	score += (U16)(NWK_MAX_TREE_DEPTH - desc->depth) * ZIGBEE_JOIN_DEPTH_WEIGHT;
+	if (desc->rtr_cap && desc->end_dev_cap)
+		score += ZIGBEE_JOIN_CAP_BONUS;
+	return score;
 }
 
 /*
@@ -111,6 +142,11 @@ void zdo_nwk_mgr_periodic()
  * - It is permitting joining
  * - The protocol version matches this device's version
  * - The Zigbee stack profile matches this device's profile (ie: Zigbee vs Zigbee Pro)
+ *
+ * Out of the descriptors that pass, the one with the best score is joined. Ties
+ * go to the one found first. If the join fails, the descriptor is no longer a
+ * potential parent and this function gets called again from the join confirm
+ * so the next best candidate gets tried.
  */
 static bool zdo_nwk_select()
 {
@@ -118,16 +154,13 @@ static bool zdo_nwk_select()
 	nwk_nib_t *nib = nwk_nib_get();
 	zdo_pcb_t *pcb = zdo_pcb_get();
 	nwk_join_req_t args;
-	mem_ptr_t *mem_ptr;
+	mem_ptr_t *mem_ptr, *best = NULL;
+	U16 score, best_score = 0;
 	bool capacity           = false;
 	bool permit_join        = false;
 	bool prot_ver_match     = false;
 	bool stack_prof_match   = false;
 
-	/*
-	 * currently, we will join the first network we find that
-	 * fits our join criteria
-	 */
 	for (mem_ptr = pcb->descr_list; mem_ptr != NULL; mem_ptr = mem_ptr->next)
 	{
 		/*
@@ -158,19 +191,34 @@ static bool zdo_nwk_select()
 				    prot_ver_match &&
 				    stack_prof_match)
 				{
-					args.desc        = pcb->curr_descr = mem_ptr;
-					args.ext_pan_id  = SCAN_ENTRY(mem_ptr)->ext_pan_id;
-					args.join_as_rtr = (nib->dev_type == NWK_ROUTER);
-					args.rejoin_nwk  = (aib->use_ext_pan_id == 0) ?
-							   NWK_JOIN_NORMAL :
-							   NWK_JOIN_REJOIN;
-					nwk_join_req(&args);
-					return true;
+					score = zdo_nwk_score(SCAN_ENTRY(mem_ptr));
+					if (!best || (score > best_score))
+					{
+						best = mem_ptr;
+						best_score = score;
+					}
 				}
 			}
 		}
 	}
-	return false;
+
+	if (!best)
+		return false;
+
+	DBG_PRINT("ZDO_NWK_SELECT: Joining %04X. Depth %d, LQI %02X, score %d.\n",
+		  SCAN_ENTRY(best)->coord_addr.short_addr,
+		  SCAN_ENTRY(best)->depth,
+		  SCAN_ENTRY(best)->link_quality,
+		  best_score);
+
+	args.desc        = pcb->curr_descr = best;
+	args.ext_pan_id  = SCAN_ENTRY(best)->ext_pan_id;
+	args.join_as_rtr = (nib->dev_type == NWK_ROUTER);
+	args.rejoin_nwk  = (aib->use_ext_pan_id == 0) ?
+			   NWK_JOIN_NORMAL :
+			   NWK_JOIN_REJOIN;
+	nwk_join_req(&args);
+	return true;
 }
 
 /*
@@ -386,7 +434,7 @@ void zdo_nwk_disc_req_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clu
 	RMT_DISC(rmt_disc_mem_ptr)->seq = req.seq;
 	RMT_DISC(rmt_disc_mem_ptr)->src_addr = src_addr;
 	rmt_nwk_disc = true;
-	rmt_nwk_disc_expiry = ZDO_RMT_NWK_DISC_TIMEOUT;
+	slow_tmr_set(&rmt_nwk_disc_tmr, ZDO_RMT_NWK_DISC_TIMEOUT, zdo_nwk_mgr_rmt_disc_expire, NULL);
 
 	nwk_disc_req(req.type.nwk_disc.scan_channels, req.type.nwk_disc.scan_duration);
 }
@@ -451,10 +499,11 @@ void nwk_disc_send_resp(U8 status)
 	       af_handle_get());
 
 	/*
-	 * if we've finished the operation, set the expiry to zero
-	 * and let it clean things up for us.
+	 * if we've finished the operation, expire the timer on the next
+	 * tick and let it clean things up for us.
 	 */
-	rmt_nwk_disc_expiry = (i == mac_scan_get_entry_cnt()) ? 0 : rmt_nwk_disc_expiry;
+	if (i == mac_scan_get_entry_cnt())
+		slow_tmr_set(&rmt_nwk_disc_tmr, 0, zdo_nwk_mgr_rmt_disc_expire, NULL);
 }
 
 /*
@@ -598,6 +647,84 @@ void zdo_nwk_permit_join_req_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep,
 	zdo_tx(resp_data, 2, src_addr, NWK_PERMIT_JOIN_RESP_CLUST, 0, af_handle_get());
 }
 
+/*
+ * Send out the NWK update response. The energy list has already been written
+ * into the response buffer starting after the header and resp points to the
+ * end of it. This function fills in the header and sends it.
+ */
+static void zdo_nwk_update_send_resp(U8 *resp_data, U8 *resp, U8 list_cnt, U8 seq, U8 status, U32 channel_mask, U16 src_addr)
+{
+	U8 size, *resp_info;
+	mac_pcb_t *pcb = mac_pcb_get();
+
+	resp_info = resp_data;
+	*resp_info++ = seq;
+	*resp_info++ = status;                   // status
+	*(U32 *)resp_info = channel_mask;       // scanned channels
+	resp_info += sizeof(U32);
+	*(U16 *)resp_info = pcb->total_xmit;    // total transmissions
+	resp_info += sizeof(U16);
+	*(U16 *)resp_info = pcb->total_fail;    // total transmission failures
+	resp_info += sizeof(U16);
+	*resp_info++ = list_cnt;                // total values in energy list
+
+	size = resp - resp_data;
+	zdo_tx(resp_data, size, src_addr, NWK_UPDATE_RESP_CLUST, 0, af_handle_get());
+}
+
+/*
+ * Confirm that an energy scan requested by a NWK update request has finished.
+ * The results from the scan get added to the response. If more scans were
+ * requested, the next one gets started. Otherwise the response is sent.
+ */
+void nwk_ed_scan_conf(U8 status, U8 *energy_list)
+{
+	U8 i, *resp;
+
+	if (!ed_scan.active)
+		return;
+
+	if (status == MAC_SUCCESS)
+	{
+		/* seq + the resp hdr = 11 bytes */
+		resp = ed_scan.resp_data + 11 + ed_scan.list_cnt;
+
+		/*
+		 * we need to parse the energy list and return the
+		 * results of the energy scan
+		 */
+		for (i = 0; i < MAC_MAX_CHANNELS; i++)
+		{
+			/*
+			 * go through the channel mask and return the
+			 * results of the channels we scanned. don't add any
+			 * more entries to the list if we're at the max size
+			 * of the payload
+			 */
+			if (((1UL << (i + MAC_PHY_CHANNEL_OFFSET)) & ed_scan.channel_mask) &&
+			    (ed_scan.list_cnt < (MAX_APS_PAYLOAD - 11)))
+			{
+				*resp++ = energy_list[i];
+				ed_scan.list_cnt++;
+			}
+		}
+
+		/* start the next scan if there are any left */
+		if (--ed_scan.scan_cnt > 0)
+		{
+			status = mac_scan_energy(ed_scan.channel_mask, ed_scan.duration);
+			if (status == MAC_SUCCESS)
+				return;
+		}
+	}
+
+	ed_scan.active = false;
+	zdo_nwk_update_send_resp(ed_scan.resp_data, ed_scan.resp_data + 11 + ed_scan.list_cnt,
+				 ed_scan.list_cnt, ed_scan.seq,
+				 (status == MAC_SUCCESS) ? AF_SUCCESS : status,
+				 ed_scan.channel_mask, ed_scan.src_addr);
+}
+
 /*
  * The NWK update request handler will parse the NWK update request and
  * issue the corresponding command. The NWK update request has three different
@@ -605,22 +732,17 @@ void zdo_nwk_permit_join_req_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep,
  * - Request a channel change (freq agility)
  * - Request a change in the channel mask and nwk manager
  * - Request an energy scan
+ *
+ * The energy scan runs in the background and the response gets sent from
+ * nwk_ed_scan_conf when all the requested scans are finished.
  */
 void zdo_nwk_update_req_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 clust)
 {
-	U8 i, j, status, list_cnt, size, *resp_info, *resp, resp_data[MAX_APS_PAYLOAD];
-	mac_pcb_t *pcb = mac_pcb_get();
-	mac_pib_t *pib = mac_pib_get();
+	U8 i, status, resp_data[11];
 	zdo_req_t req;
 
 	zdo_parse_req(src_addr, data, clust, &req);
 
-	/* set the response pointers */
-	resp_info = resp_data;
-	/* seq + the resp hdr = 11 bytes */
-	resp = resp_data + 11;
-	list_cnt = 0;
-
 	/*
 	 * a broadcast transmission signifies that some
 	 * event occurred on the network
@@ -653,70 +775,39 @@ void zdo_nwk_update_req_handler(U8 *data, U8 len, U16 src_addr, U8 src_ep, U16 c
 		nib->nwk_mngr = req.type.nwk_update.nwk_mngr_addr;
 		return;
 	} else if (req.type.nwk_update.scan_duration <= 0x5) {
-		/* save off the channel that we're using */
-		U8 channel = pib->curr_channel;
+		/* drop the request if we're still busy with the last one */
+		if (ed_scan.active)
+			return;
 
 		/*
 		 * an energy scan was requested. we need to
-		 * perform it for as many times as was requested
-		 */
-		pcb->channel_mask = req.type.nwk_update.scan_channels;
-		pcb->duration = req.type.nwk_update.scan_duration;
-
-		/*
-		 * handle the energy scans. we will scan as many
-		 * times as in the scan cnt field of the request
+		 * perform it for as many times as was requested.
+		 * the MAC restores our channel after each scan.
+		 * if the MAC is busy with another scan, then the
+		 * request gets turned away with its status.
 		 */
-		for (i=0; i<req.type.nwk_update.scan_cnt; i++)
+		status = AF_SUCCESS;
+		if (req.type.nwk_update.scan_cnt > 0)
 		{
-			mac_scan_energy();
-
-			/*
-			 * we need to parse the energy list and return the
-			 * results of the energy scan
-			 */
-			for (j = 0; j < MAC_MAX_CHANNELS; j++)
-			{
-				/*
-				 * go through the channel mask and return the
-				 * results of the channels we scanned
-				 */
-				if ((1 << (j + MAC_PHY_CHANNEL_OFFSET)) & pcb->channel_mask)
-				{
-					/*
-					 * don't add any more entries to the list if we're at
-					 * the max size of the payload
-					 */
-					if (list_cnt < (MAX_APS_PAYLOAD - 11))
-					{
-						/*
-						 * if we scanned the channel, then add the result
-						 * in the energy list
-						 */
-						*resp++ = pcb->energy_list[j];
-						list_cnt++;
-					}
-				}
-			}
+			ed_scan.active          = true;
+			ed_scan.src_addr        = src_addr;
+			ed_scan.seq             = req.seq;
+			ed_scan.scan_cnt        = req.type.nwk_update.scan_cnt;
+			ed_scan.list_cnt        = 0;
+			ed_scan.channel_mask    = req.type.nwk_update.scan_channels;
+			ed_scan.duration        = req.type.nwk_update.scan_duration;
+
+			status = mac_scan_energy(ed_scan.channel_mask, ed_scan.duration);
+			if (status == MAC_SUCCESS)
+				return;
+			ed_scan.active = false;
 		}
-		mac_set_channel(channel);
-		status = AF_SUCCESS;
+		zdo_nwk_update_send_resp(resp_data, resp_data + 11, 0, req.seq, status,
+					 req.type.nwk_update.scan_channels, src_addr);
 	} else {
-		status = AF_NOT_SUPPORTED;
+		zdo_nwk_update_send_resp(resp_data, resp_data + 11, 0, req.seq, AF_NOT_SUPPORTED,
+					 req.type.nwk_update.scan_channels, src_addr);
 	}
-
-	*resp_info++ = req.seq;
-	*resp_info++ = status;                   // status
-	*(U32 *)resp_info = pcb->channel_mask;  // scanned channels
-	resp_info += sizeof(U32);
-	*(U16 *)resp_info = pcb->total_xmit;    // total transmissions
-	resp_info += sizeof(U16);
-	*(U16 *)resp_info = pcb->total_fail;    // total transmission failures
-	resp_info += sizeof(U16);
-	*resp_info++ = list_cnt;                // total values in energy list
-
-	size = resp - resp_data;
-	zdo_tx(resp_data, size, src_addr, NWK_UPDATE_RESP_CLUST, 0, af_handle_get());
 }
 
 /* Handle the LQI response. This will need to be user defined */
@@ -49,44 +49,78 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+/*
+ * The timer list is kept sorted by expiration time with the timer that
+ * expires first at the head. That way the next expiration is always the
+ * head of the list and expired timers can be taken off the front without
+ * rescanning the rest of the list.
+ */
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
+/*
+ * Wrap safe check if time a comes before time b. The difference is taken
+ * modulo the size of clock_time_t so it works as long as the two times are
+ * less than half the clock range apart.
+ */
+#define TIME_BEFORE(a, b) ((clock_time_t)((a) - (b)) > ((clock_time_t)-1) / 2)
+
 PROCESS(etimer_process, "Event timer");
 
-static void update_time(void)
+static clock_time_t expiration(struct etimer *t)
 {
-	clock_time_t tdist;
-	clock_time_t now;
-	struct etimer *t;
+	return t->timer.start + t->timer.interval;
+}
 
+static void update_time(void)
+{
 	if (timerlist == NULL) {
 		next_expiration = 0;
 		/* 当没有时钟事件时(timerlist == NULL),
 		 * 所以next_expiration也就是为0, 也就是下一个事件的时间为0
 		 */
 	} else {
-		now = clock_time();
-		/* 获取当前的时间 */
-		t = timerlist;
-		/* Must calculate distance to next time into account due to wraps */
-		tdist = t->timer.start + t->timer.interval - now;
-		/* 计算第一个时钟事件与下一个时间之间的间隔距离 */
-		for(t = t->next; t != NULL; t = t->next) {
-			if(t->timer.start + t->timer.interval - now < tdist) {
-				tdist = t->timer.start + t->timer.interval - now;
-			}
-		/* 计算所有的时钟事件的间隔, 并且选择最小的时间间隔的时钟事件 */
+		/* The head of the sorted list is the next timer to expire */
+		next_expiration = expiration(timerlist);
+	}
+}
+
+/*
+ * Insert the timer into the list in order of expiration. Timers with the
+ * same expiration time are kept in the order that they were added.
+ */
+static void insert_timer(struct etimer *timer)
+{
+	struct etimer **tp;
+	clock_time_t exp = expiration(timer);
+
+	for(tp = &timerlist; *tp != NULL; tp = &(*tp)->next) {
+		if(TIME_BEFORE(exp, expiration(*tp))) {
+			break;
 		}
+	}
+	timer->next = *tp;
+	*tp = timer;
+}
 
-		next_expiration = now + tdist;
-		/* now + tdist = t->timer.start + t->timer.interval也就是下一个到期的时钟事件 */
+/* Take the timer out of the list. Returns 0 if it wasn't on the list. */
+static int remove_timer(struct etimer *timer)
+{
+	struct etimer **tp;
+
+	for(tp = &timerlist; *tp != NULL; tp = &(*tp)->next) {
+		if(*tp == timer) {
+			*tp = timer->next;
+			timer->next = NULL;
+			return 1;
+		}
 	}
+	return 0;
 }
 
 PROCESS_THREAD(etimer_process, ev, data)
 {
-	struct etimer *t, *u;
+	struct etimer *t, **tp;
 
 	PROCESS_BEGIN();
 
@@ -98,65 +132,44 @@ PROCESS_THREAD(etimer_process, ev, data)
 		if(ev == PROCESS_EVENT_EXITED) {
 			struct process *p = data;
 
-			while(timerlist != NULL && timerlist->p == p) {
-				timerlist = timerlist->next;
-				/* 如果timerlist有时间线程事件并且第一个时间事件
-				 * 的线程是对应退出的线程, 那么删除该事件 */
-			}
-
-			if(timerlist != NULL) {
-				t = timerlist;
-				while(t->next != NULL) {
-					if(t->next->p == p) {
-						t->next = t->next->next;
-					} else
-						t = t->next;
+			/* 删除所有属于退出线程的时钟事件, 链表的顺序保持不变 */
+			for(tp = &timerlist; *tp != NULL;) {
+				if((*tp)->p == p) {
+					t = *tp;
+					*tp = t->next;
+					t->next = NULL;
+				} else {
+					tp = &(*tp)->next;
 				}
-				/* 如果timerlist不为NULL, 那么继续查找下一个时钟事件,直到最后一个为止 */
 			}
+			update_time();
 			continue;
 			/* 接着继续执行下一个循环 */
 		} else if(ev != PROCESS_EVENT_POLL) {
 			continue;
 		}
 		/* 如果不是PROCESS_EVENT_POLL, 则略过,执行下次循环 */
-again:
-		u = NULL;
-
-		for(t = timerlist; t != NULL; t = t->next) {
-			if(timer_expired(&t->timer)) {
-				/* 检测timer事件是否到期 */
-				if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
-					/* 如果时间到了, 就发送PROCESS_EVENT_TIMER时间 */
-					/* Reset the process ID of the event timer, to signal that the
-					 * etimer has expired. This is later checked in the
-					 * etimer_expired() function. */
-					t->p = PROCESS_NONE;
-					if(u != NULL) {
-						u->next = t->next;
-					} else {
-						timerlist = t->next;
-					}
-					/* 如果t不是时间事件中的第一个事件(即u不为NULL),
-					 * 则要把链表重新链接起来 */
-					t->next = NULL;
-					/* 删除该事件的next指针*/
-					update_time();
-					goto again;
-					/* 重新计算事件的到期时间, 然后继续执行下一个到期的事件.
-					 * 这边一个很重要的事件:
-					 * 当重新计算的时候又有时钟事件到期, 则会先执行时钟事件,
-					 * 这边很容易会被时钟事件占用太长时间而其他线程却得不到
-					 * 执行. 但是这边很可能认为时钟事件的优先级最高的事件
-					 */
-				} else {
-					etimer_request_poll();
-				}
-			/* 如果发送的时钟事件返回不是PROCESS_ERR_OK, 即操作不成功, 则请求poll */
+
+		/*
+		 * The list is sorted so the expired timers are all at the head.
+		 * Stop at the first one that hasn't expired yet.
+		 */
+		while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+			t = timerlist;
+			if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+				/* Reset the process ID of the event timer, to signal that the
+				 * etimer has expired. This is later checked in the
+				 * etimer_expired() function. */
+				t->p = PROCESS_NONE;
+				timerlist = t->next;
+				t->next = NULL;
+			} else {
+				/* 如果发送的时钟事件返回不是PROCESS_ERR_OK, 即操作不成功, 则请求poll */
+				etimer_request_poll();
+				break;
 			}
-		u = t;
 		}
-
+		update_time();
 	}
 
 	PROCESS_END();
@@ -169,25 +182,15 @@ void etimer_request_poll(void)
 
 static void add_timer(struct etimer *timer)
 {
-	struct etimer *t;
-
 	etimer_request_poll();
 	/* 设置时钟事件为POLL, 让其优先执行 */
 	if(timer->p != PROCESS_NONE) {
-		for(t = timerlist; t != NULL; t = t->next) {
-			if(t == timer) {
-				/* Timer already on list, bail out. */
-				timer->p = PROCESS_CURRENT();
-				update_time();
-				return;
-			}
-		}
+		/* Timer may already be on the list. Take it off so that it can
+		 * be put back in the right place for its new expiration time. */
+		remove_timer(timer);
 	}
-	/* 检测timer是否已经在时钟事件链表中了, 如果已经存在, 则更新时钟戳 */
-	/* Timer not on list. */
 	timer->p = PROCESS_CURRENT();
-	timer->next = timerlist;
-	timerlist = timer;
+	insert_timer(timer);
 
 	update_time();
 }
@@ -213,6 +216,10 @@ void etimer_restart(struct etimer *et)
 void etimer_adjust(struct etimer *et, int timediff)
 {
 	et->timer.start += timediff;
+	/* The expiration time moved so the timer needs to be re-sorted */
+	if(remove_timer(et)) {
+		insert_timer(et);
+	}
 	update_time();
 }
 
@@ -223,7 +230,7 @@ int etimer_expired(struct etimer *et)
 
 clock_time_t etimer_expiration_time(struct etimer *et)
 {
-	return et->timer.start + et->timer.interval;
+	return expiration(et);
 }
 
 clock_time_t etimer_start_time(struct etimer *et)
@@ -243,25 +250,8 @@ clock_time_t etimer_next_expiration_time(void)
 
 void etimer_stop(struct etimer *et)
 {
-	struct etimer *t;
-
-	/* First check if et is the first event timer on the list. */
-	if(et == timerlist) {
-		timerlist = timerlist->next;
+	if(remove_timer(et)) {
 		update_time();
-	} else {
-		/* Else walk through the list and try to find the item before the
-		et timer. */
-		for(t = timerlist; t != NULL && t->next != et; t = t->next);
-
-		if(t != NULL) {
-			/* We've found the item before the event timer that we are about
-			 * to remove. We point the items next pointer to the event after
-			 * the removed item. */
-			t->next = et->next;
-
-			update_time();
-		}
 	}
 
 	/* Remove the next pointer from the item to be removed. */
@@ -44,8 +44,16 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
+
+#if PROCESS_CONF_DYNAMIC_EVENTS
+#include <stdlib.h>
+#endif
+#if PROCESS_CONF_PROFILE && !defined(PROCESS_CONF_PROFILE_NOW)
+#include <time.h>
+#endif
 #include "sys/arg.h"
 
 #define DEBUG 0
@@ -64,19 +72,45 @@ struct process *process_current = NULL;
 static process_event_t lastevent;
 
 /*
- * Structure used for keeping the queue of active events.
+ * Index of an event slot. The dynamic queue can grow past what fits in
+ * a process_num_events_t.
+ */
+#if PROCESS_CONF_DYNAMIC_EVENTS
+typedef unsigned int event_index_t;
+#else
+typedef process_num_events_t event_index_t;
+#endif
+
+#define EVENT_NONE ((event_index_t)-1)
+
+/*
+ * Structure used for keeping the queue of active events. The slots are
+ * linked by index into a free list and one FIFO per priority lane. Using
+ * indices instead of pointers lets the dynamic queue be reallocated.
  */
 struct event_data {
 	process_event_t ev;
 	process_data_t data;
 	struct process *p;
+	event_index_t next;
+#if PROCESS_CONF_PROFILE
+	unsigned long posted_at;
+#endif
 };
 
-static process_num_events_t nevents, fevent;
-static struct event_data events[PROCESS_CONF_NUMEVENTS];
+struct event_lane {
+	event_index_t head;
+	event_index_t tail;
+};
+
+static event_index_t nevents, free_event;
+static struct event_lane lanes[PROCESS_NUM_PRIOS];
+static struct process_stats stats;
 
-#if PROCESS_CONF_STATS
-process_num_events_t process_maxevents;
+#if PROCESS_CONF_DYNAMIC_EVENTS
+static struct event_data *events;
+#else
+static struct event_data events[PROCESS_CONF_NUMEVENTS];
 #endif
 
 static volatile unsigned char poll_requested;
@@ -87,6 +121,72 @@ static volatile unsigned char poll_requested;
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
 
+#if PROCESS_CONF_PROFILE
+#ifdef PROCESS_CONF_PROFILE_NOW
+#define profile_now() PROCESS_CONF_PROFILE_NOW()
+#else
+static unsigned long profile_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long)ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+#endif
+
+/*
+ * Time the next dispatch was queued at. Set by do_poll() and do_event()
+ * right before they call the process. Synchronous calls have no wait.
+ */
+static unsigned long dispatch_queued_at;
+static unsigned char dispatch_queued;
+
+static unsigned char profile_bucket(unsigned long usec)
+{
+	unsigned char i;
+
+	for(i = 0; usec && i < PROCESS_PROFILE_BUCKETS - 1; i++) {
+		usec >>= 1;
+	}
+	return i;
+}
+
+static void profile_wait(struct process_profile *prof, unsigned long wait)
+{
+	prof->wait_total += wait;
+	if(wait > prof->wait_max) {
+		prof->wait_max = wait;
+	}
+	prof->wait_hist[profile_bucket(wait)]++;
+}
+
+static void profile_run(struct process_profile *prof, unsigned long run)
+{
+	prof->dispatches++;
+	prof->run_total += run;
+	if(run > prof->run_max) {
+		prof->run_max = run;
+	}
+	if(run > PROCESS_CONF_PROFILE_SLOW) {
+		prof->slow++;
+	}
+	prof->run_hist[profile_bucket(run)]++;
+}
+
+void process_profile_reset(void)
+{
+	struct process *p;
+	unsigned long poll_at;
+
+	/* keep the time of a pending poll so its wait still comes out right */
+	for(p = process_list; p != NULL; p = p->next) {
+		poll_at = p->prof.poll_at;
+		memset(&p->prof, 0, sizeof(p->prof));
+		p->prof.poll_at = poll_at;
+	}
+}
+#endif /* PROCESS_CONF_PROFILE */
+
 process_event_t process_alloc_event(void)
 {
 	return lastevent++;
@@ -178,6 +278,12 @@ static void exit_process(struct process *p, struct process *fromprocess)
 static void call_process(struct process *p, process_event_t ev, process_data_t data)
 {
 	int ret;
+#if PROCESS_CONF_PROFILE
+	unsigned long start, queued_at = dispatch_queued_at;
+	unsigned char queued = dispatch_queued;
+
+	dispatch_queued = 0;
+#endif
 
 #if DEBUG
 	if(p->state == PROCESS_STATE_CALLED)
@@ -188,7 +294,16 @@ static void call_process(struct process *p, process_event_t ev, process_data_t d
 		PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
 		process_current = p;
 		p->state = PROCESS_STATE_CALLED;
+#if PROCESS_CONF_PROFILE
+		start = profile_now();
+		if(queued) {
+			profile_wait(&p->prof, start - queued_at);
+		}
+		ret = p->thread(&p->pt, ev, data);
+		profile_run(&p->prof, profile_now() - start);
+#else
 		ret = p->thread(&p->pt, ev, data);
+#endif
 		if(ret == PT_EXITED ||
 		   ret == PT_ENDED ||
 		   ev == PROCESS_EVENT_EXIT) {
@@ -204,18 +319,77 @@ void process_exit(struct process *p)
 	exit_process(p, PROCESS_CURRENT());
 }
 
+/*
+ * Put the slots from first up to the capacity on the free list.
+ */
+static void free_events(event_index_t first)
+{
+	event_index_t i;
+
+	for(i = first; i < stats.capacity; i++) {
+		events[i].next = (i + 1 < stats.capacity) ? i + 1 : free_event;
+	}
+	if(first < stats.capacity) {
+		free_event = first;
+	}
+}
+
+#if PROCESS_CONF_DYNAMIC_EVENTS
+/*
+ * Double the number of event slots. Returns 0 if the memory
+ * couldn't be allocated.
+ */
+static int grow_events(void)
+{
+	struct event_data *p;
+	unsigned int old, capacity;
+
+	old = stats.capacity;
+	capacity = old ? old * 2 : PROCESS_CONF_NUMEVENTS;
+	if(capacity >= EVENT_NONE) {
+		return 0;
+	}
+
+	p = realloc(events, capacity * sizeof(struct event_data));
+	if(p == NULL) {
+		return 0;
+	}
+
+	events = p;
+	stats.capacity = capacity;
+	free_events(old);
+	return 1;
+}
+#endif /* PROCESS_CONF_DYNAMIC_EVENTS */
+
 void process_init(void)
 {
+	unsigned char i;
+
 	lastevent = PROCESS_EVENT_MAX;
 
-	nevents = fevent = 0;
-#if PROCESS_CONF_STATS
-	process_maxevents = 0;
-#endif /* PROCESS_CONF_STATS */
+	nevents = 0;
+	free_event = EVENT_NONE;
+	for(i = 0; i < PROCESS_NUM_PRIOS; i++) {
+		lanes[i].head = lanes[i].tail = EVENT_NONE;
+	}
+
+	memset(&stats, 0, sizeof(stats));
+#if PROCESS_CONF_DYNAMIC_EVENTS
+	grow_events();
+#else
+	stats.capacity = PROCESS_CONF_NUMEVENTS;
+	free_events(0);
+#endif
 
 	process_current = process_list = NULL;
 }
 
+const struct process_stats *process_get_stats(void)
+{
+	return &stats;
+}
+
 /*
  * Call each process' poll handler.
  */
@@ -229,6 +403,10 @@ static void do_poll(void)
 		if(p->needspoll) {
 			p->state = PROCESS_STATE_RUNNING;
 			p->needspoll = 0;
+#if PROCESS_CONF_PROFILE
+			dispatch_queued_at = p->prof.poll_at;
+			dispatch_queued = 1;
+#endif
 			call_process(p, PROCESS_EVENT_POLL, NULL);
 		}
 	}
@@ -244,6 +422,9 @@ static void do_event(void)
 	static process_data_t data;
 	static struct process *receiver;
 	static struct process *p;
+#if PROCESS_CONF_PROFILE
+	static unsigned long posted_at;
+#endif
 
 	/*
 	 * If there are any events in the queue, take the first one and walk
@@ -254,16 +435,32 @@ static void do_event(void)
 	 */
 
 	if(nevents > 0) {
+		static event_index_t i;
+		static unsigned char prio;
+
+		/* Take the event from the highest priority lane that has one. */
+		for(prio = 0; lanes[prio].head == EVENT_NONE; prio++);
+		i = lanes[prio].head;
+
 		/* There are events that we should deliver. */
-		ev = events[fevent].ev;
+		ev = events[i].ev;
 
-		data = events[fevent].data;
-		receiver = events[fevent].p;
+		data = events[i].data;
+		receiver = events[i].p;
+#if PROCESS_CONF_PROFILE
+		posted_at = events[i].posted_at;
+#endif
 
-		/* Since we have seen the new event, we move pointer upwards
-		and decrese the number of events. */
-		fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+		/* Since we have seen the new event, we take it off the lane,
+		give the slot back and decrese the number of events. */
+		lanes[prio].head = events[i].next;
+		if(lanes[prio].head == EVENT_NONE) {
+			lanes[prio].tail = EVENT_NONE;
+		}
+		events[i].next = free_event;
+		free_event = i;
 		--nevents;
+		--stats.depth[prio];
 
 		/* If this is a broadcast event, we deliver it to all events, in
 		order of their priority. */
@@ -276,6 +473,10 @@ static void do_event(void)
 				if(poll_requested)
 					do_poll();
 
+#if PROCESS_CONF_PROFILE
+				dispatch_queued_at = posted_at;
+				dispatch_queued = 1;
+#endif
 				call_process(p, ev, data);
 			}
 		} else {
@@ -291,6 +492,10 @@ static void do_event(void)
 			if(ev == PROCESS_EVENT_INIT)
 				receiver->state = PROCESS_STATE_RUNNING;
 
+#if PROCESS_CONF_PROFILE
+			dispatch_queued_at = posted_at;
+			dispatch_queued = 1;
+#endif
 			/* Make sure that the process actually is running. */
 			call_process(receiver, ev, data);
 		}
@@ -316,7 +521,13 @@ int process_nevents(void)
 
 int process_post(struct process *p, process_event_t ev, process_data_t data)
 {
-	static process_num_events_t snum;
+	return process_post_prio(p, ev, data, PROCESS_PRIO_NORMAL);
+}
+
+int process_post_prio(struct process *p, process_event_t ev, process_data_t data,
+		      unsigned char prio)
+{
+	event_index_t snum;
 
 	if(PROCESS_CURRENT() == NULL) {
 		PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -327,7 +538,18 @@ int process_post(struct process *p, process_event_t ev, process_data_t data)
 		p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
 	}
 
-	if(nevents == PROCESS_CONF_NUMEVENTS) {
+	if(prio >= PROCESS_NUM_PRIOS) {
+		prio = PROCESS_PRIO_LOW;
+	}
+
+#if PROCESS_CONF_DYNAMIC_EVENTS
+	if(free_event == EVENT_NONE) {
+		grow_events();
+	}
+#endif /* PROCESS_CONF_DYNAMIC_EVENTS */
+
+	if(free_event == EVENT_NONE) {
+		++stats.overflows;
 #if DEBUG
 		if(p == PROCESS_BROADCAST) {
 			printf("soft panic: event queue is full when broadcast event %d was \
@@ -340,17 +562,29 @@ int process_post(struct process *p, process_event_t ev, process_data_t data)
 		return PROCESS_ERR_FULL;
 	}
 
-	snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
+	snum = free_event;
+	free_event = events[snum].next;
 	events[snum].ev = ev;
 	events[snum].data = data;
 	events[snum].p = p;
+	events[snum].next = EVENT_NONE;
+#if PROCESS_CONF_PROFILE
+	events[snum].posted_at = profile_now();
+#endif
+
+	/* Add it to the tail of its lane */
+	if(lanes[prio].tail == EVENT_NONE) {
+		lanes[prio].head = snum;
+	} else {
+		events[lanes[prio].tail].next = snum;
+	}
+	lanes[prio].tail = snum;
 	++nevents;
 
-#if PROCESS_CONF_STATS
-	if(nevents > process_maxevents) {
-		process_maxevents = nevents;
+	++stats.posted[prio];
+	if(++stats.depth[prio] > stats.max_depth[prio]) {
+		stats.max_depth[prio] = stats.depth[prio];
 	}
-#endif /* PROCESS_CONF_STATS */
 
 	return PROCESS_ERR_OK;
 }
@@ -368,6 +602,11 @@ void process_poll(struct process *p)
 	if(p != NULL) {
 		if(p->state == PROCESS_STATE_RUNNING ||
 		   p->state == PROCESS_STATE_CALLED) {
+#if PROCESS_CONF_PROFILE
+			if(!p->needspoll) {
+				p->prof.poll_at = profile_now();
+			}
+#endif
 			p->needspoll = 1;
 			poll_requested = 1;
 		}
@@ -88,6 +88,84 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * If set, the event queue is allocated from the heap and doubles in
+ * size when it fills up instead of refusing the event. Meant for native
+ * builds where memory isn't tight.
+ */
+#ifndef PROCESS_CONF_DYNAMIC_EVENTS
+#define PROCESS_CONF_DYNAMIC_EVENTS 0
+#endif /* PROCESS_CONF_DYNAMIC_EVENTS */
+
+/*
+ * If set, each process keeps a profile of how often it gets dispatched,
+ * how long its handler runs and how long its events wait in the queue.
+ * The times come from PROCESS_CONF_PROFILE_NOW(), which returns a
+ * running count of microseconds. It defaults to clock_gettime().
+ */
+#ifndef PROCESS_CONF_PROFILE
+#define PROCESS_CONF_PROFILE 0
+#endif /* PROCESS_CONF_PROFILE */
+
+/*
+ * A dispatch that runs longer than this many microseconds is counted
+ * as slow in the profile.
+ */
+#ifndef PROCESS_CONF_PROFILE_SLOW
+#define PROCESS_CONF_PROFILE_SLOW 1000
+#endif /* PROCESS_CONF_PROFILE_SLOW */
+
+/**
+ * \name Event priorities
+ *
+ * Posted events are kept in one FIFO per priority. All pending events
+ * of a higher priority are delivered before any event of a lower one.
+ * The lanes share the same pool of event slots.
+ * @{
+ */
+#define PROCESS_PRIO_HIGH     0   /**< Radio RX and ACK processing */
+#define PROCESS_PRIO_NORMAL   1   /**< Timers and the protocol stack */
+#define PROCESS_PRIO_LOW      2   /**< Application and debug events */
+#define PROCESS_NUM_PRIOS     3
+/** @} */
+
+/**
+ * Event queue statistics. The depth is the number of events that are
+ * currently waiting in each lane. Overflows count the events that were
+ * refused because no slot was free.
+ */
+struct process_stats {
+  unsigned long posted[PROCESS_NUM_PRIOS];
+  unsigned int depth[PROCESS_NUM_PRIOS];
+  unsigned int max_depth[PROCESS_NUM_PRIOS];
+  unsigned long overflows;
+  unsigned int capacity;
+};
+
+/**
+ * Number of histogram buckets in a process profile. Bucket 0 holds
+ * times under 1 us and bucket n holds times from 2^(n-1) up to 2^n us.
+ * The last bucket also takes everything longer.
+ */
+#define PROCESS_PROFILE_BUCKETS 16
+
+/**
+ * Per process profile. All times are in microseconds. The wait time
+ * runs from when the event was posted, or the poll requested, until
+ * the handler gets called.
+ */
+struct process_profile {
+  unsigned long dispatches;
+  unsigned long slow;
+  unsigned long long run_total;
+  unsigned long run_max;
+  unsigned long long wait_total;
+  unsigned long wait_max;
+  unsigned long run_hist[PROCESS_PROFILE_BUCKETS];
+  unsigned long wait_hist[PROCESS_PROFILE_BUCKETS];
+  unsigned long poll_at;
+};
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -435,6 +513,9 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_CONF_PROFILE
+  struct process_profile prof;
+#endif
 };
 
 /**
@@ -476,6 +557,35 @@ CCIF void process_start(struct process *p, const char *arg);
  */
 CCIF int process_post(struct process *p, process_event_t ev, void* data);
 
+/**
+ * Post an asynchronous event with a priority.
+ *
+ * This works like process_post() but the event goes into the lane of
+ * the given priority. process_post() uses PROCESS_PRIO_NORMAL.
+ *
+ * \param prio One of PROCESS_PRIO_HIGH, PROCESS_PRIO_NORMAL or
+ * PROCESS_PRIO_LOW.
+ *
+ * \retval PROCESS_ERR_OK The event could be posted.
+ *
+ * \retval PROCESS_ERR_FULL The event queue was full and the event could
+ * not be posted.
+ */
+CCIF int process_post_prio(struct process *p, process_event_t ev, void* data,
+			   unsigned char prio);
+
+/**
+ * Get the event queue statistics.
+ */
+const struct process_stats *process_get_stats(void);
+
+#if PROCESS_CONF_PROFILE
+/**
+ * Clear the profiles of all running processes.
+ */
+void process_profile_reset(void);
+#endif
+
 /**
  * Post a synchronous event to a process.
  *
@@ -66,6 +66,18 @@ typedef unsigned long clock_time_t;
 
 #define CLOCK_CONF_SECOND 1000
 
+/* Let the event queue grow instead of dropping events */
+#define PROCESS_CONF_DYNAMIC_EVENTS 1
+
+/*
+ * Profile the scheduler. Off by default since every event dispatch pays for
+ * it. Build with PROFILE=1 to turn it on. "prof" in the test app dumps the
+ * results.
+ */
+#ifndef PROCESS_CONF_PROFILE
+#define PROCESS_CONF_PROFILE 0
+#endif
+
 #define LOG_CONF_ENABLED 1
 
 /* Not part of C99 but actually present */
@@ -34,15 +34,101 @@
  */
 
 #include <stdio.h>
-#include <sys/select.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include "contiki.h"
 #include "freakz.h"
 
 PROCINIT(&etimer_process);
 
+/*
+ * Descriptors that the main loop sleeps on. The timerfd is armed for the
+ * next etimer expiration and the eventfd gets kicked by the input threads
+ * whenever they hand something to the stack.
+ */
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static int wakeup_fd = -1;
+
+/*
+ * Wake up the main loop. This is safe to call from any thread and should
+ * be called after posting an event or polling a process from outside of
+ * the main loop.
+ */
+void contiki_main_wakeup(void)
+{
+	uint64_t one = 1;
+
+	if (write(wakeup_fd, &one, sizeof(one)) == -1)
+		perror("contiki_main_wakeup");
+}
+
+/* Create the epoll set with the timerfd and the wakeup eventfd in it */
+static void contiki_main_fd_init(void)
+{
+	struct epoll_event ev;
+
+	if ((epoll_fd = epoll_create1(0)) == -1)
+		perror("epoll_create1");
+	if ((timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) == -1)
+		perror("timerfd_create");
+	if ((wakeup_fd = eventfd(0, EFD_NONBLOCK)) == -1)
+		perror("eventfd");
+
+	ev.events = EPOLLIN;
+	ev.data.fd = timer_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) == -1)
+		perror("epoll_ctl timerfd");
+
+	ev.events = EPOLLIN;
+	ev.data.fd = wakeup_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev) == -1)
+		perror("epoll_ctl eventfd");
+}
+
+/*
+ * Arm the timerfd for the next etimer expiration. If no etimers are
+ * pending, the timerfd gets disarmed and we only wake up on input. Returns
+ * 0 if the next etimer has already expired.
+ */
+static int contiki_main_arm_timer(void)
+{
+	struct itimerspec its = {{0, 0}, {0, 0}};
+	clock_time_t now, dist;
+
+	if (etimer_pending()) {
+		now = clock_time();
+		dist = etimer_next_expiration_time() - now;
+
+		/* already expired, or so close that it wrapped */
+		if ((dist == 0) || (dist > ((clock_time_t)-1) / 2))
+			return 0;
+
+		its.it_value.tv_sec = dist / CLOCK_SECOND;
+		its.it_value.tv_nsec = (dist % CLOCK_SECOND) * (1000000000 / CLOCK_SECOND);
+	}
+
+	if (timerfd_settime(timer_fd, 0, &its, NULL) == -1)
+		perror("timerfd_settime");
+	return 1;
+}
+
+/* Clear out any pending counts on the descriptors that woke us up */
+static void contiki_main_drain(int fd)
+{
+	uint64_t cnt;
+
+	while (read(fd, &cnt, sizeof(cnt)) > 0)
+		;
+}
+
 int contiki_main(void)
 {
-	struct timeval tv;
+	struct epoll_event evs[2];
+	int i, n;
 
 	process_init();
 	procinit_init();
@@ -53,37 +139,32 @@ int contiki_main(void)
 
 	printf("Contiki initiated, now starting process scheduling\n");
 
+	contiki_main_fd_init();
 	freakz_init();
 
+#if (TEST_SIM == 1)
+	sim_cmd_init();
+#endif
+
+	/*
+	 * Run the processes until there's nothing left to do and then block
+	 * until either the next etimer expires or an input thread wakes us up.
+	 * An idle node just sits in epoll_wait instead of spinning.
+	 */
 	while(1)
 	{
-		process_run();
-		tv.tv_sec = 0;
-		tv.tv_usec = 1;
-		/*
-		 * int select(int n,
-		 *	      fd_set *readfds,
-		 *	      fd_set *writefds,
-		 *	      fd_set *exceptfds,
-		 *	      struct timeval *timeout);
-		 *
-		 * select() wait the change of the file.
-		 * n: the max file describe + 1
-		 * readfds, writefds and exceptfds is the set of the file,
-		 *
-		 * struct timeval *timeout是select的超时时间, 这个参数至关重要,
-		 * 它可以使select处于三种状态:
-		 * 第一. 若将NULL以形参传入, 即不传入时间结构, 就是将select置于阻塞状态,
-		 * 一定等到监视文件描述符集合中某个文件描述符发生变化为止;
-		 *
-		 * 第二. 若将时间值设为0秒0毫秒, 就变成一个纯粹的非阻塞函数,
-		 * 不管文件描述符是否有变化, 都立刻返回继续执行, 文件无变化返回0,
-		 * 有变化返回一个正值;
-		 *
-		 * 第三. timeout的值大于0, 这就是等待的超时时间, 即select在timeout时间内阻塞,
-		 * 超时时间之内有事件到来就返回了, 否则在超时后不管怎样一定返回, 返回值同上述
-		 */
-		select(0, NULL, NULL, NULL, &tv);
+		if (process_run() > 0)
+			continue;
+
+		if (!contiki_main_arm_timer()) {
+			etimer_request_poll();
+			continue;
+		}
+
+		n = epoll_wait(epoll_fd, evs, sizeof(evs) / sizeof(evs[0]), -1);
+		for (i = 0; i < n; i++)
+			contiki_main_drain(evs[i].data.fd);
+
 		etimer_request_poll();
 	}
 
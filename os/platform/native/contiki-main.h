@@ -28,6 +28,7 @@
 #define CONTIKI_MAIN_H
 
 int contiki_main(void);
+void contiki_main_wakeup(void);
 
 #endif
 
@@ -80,7 +80,10 @@ void test_raven_init()
     zdo_reg_cb(&test_raven_cb);
 
     // register the endpoint with the ZDO
-    af_ep_add(TEST_EP, test_raven_simple_desc, AF_BASE_SIMPLE_DESC_SIZE + 4, false, test_raven_rx_handler, test_raven_conf_handler);
+    if (af_ep_add(TEST_EP, test_raven_simple_desc, AF_BASE_SIMPLE_DESC_SIZE + 4, false, test_raven_rx_handler, test_raven_conf_handler) != AF_SUCCESS)
+    {
+        DBG_PRINT("TEST_RAVEN_INIT: Couldn't register the test endpoint.\n");
+    }
 
     // init the associated devices list
     list_init(assoc_list);
@@ -62,15 +62,21 @@ extern int errno;
 static sim_node_t node;             // node struct that holds info related to node communications
 static struct pipe_t pp;                   // public pipe used to initially communicate with sim shell
 static char cmd[BUFSIZE];
+static sim_ring_t cmd_ring;                // commands from the cmd_in thread to the main loop
 FILE *fp;
 FILE *fout;
 
+/* Process that hands the shell commands to the test app on the main loop */
+PROCESS(sim_cmd_process, "Sim Command Process");
+
 /* Threads to handle the pipe communications */
 
 /*
  * This thread is used to monitor the data_in pipe for
  * incoming frames. Threads should only call reentrant
- * functions or else bad things can happen.
+ * functions or else bad things can happen. The frames are
+ * handed to the driver through its rx ring and the stack
+ * picks them up from the main loop.
  */
 static void *sim_data_in_thread(void *dummy)
 {
@@ -82,11 +88,18 @@ static void *sim_data_in_thread(void *dummy)
 			perror("sim_data_in_thread");
 
 		/*
-		 * write the received data into the input buffer
-		 * of the stack and trigger the isr
+		 * write the received data into the rx ring of
+		 * the driver, trigger the isr, and wake up the
+		 * main loop so it can process it. if the ring
+		 * is full, wait for the main loop to catch up.
 		 */
-		drvr_write_rx_buf((U8 *)msg, msg[0]);
+		while (!drvr_write_rx_buf((U8 *)msg, msg[0])) {
+			drvr_rx_isr();
+			contiki_main_wakeup();
+			usleep(100);
+		}
 		drvr_rx_isr();
+		contiki_main_wakeup();
 	}
 	return NULL;
 }
@@ -94,20 +107,60 @@ static void *sim_data_in_thread(void *dummy)
 /*
  * This thread is used to monitor the cmd_in pipe for incoming
  * commands issued from the simulator shell. When the commands
- * appear, it will save them in a static variable and post an
- * event to the zdo cmd process with a pointer to the cmd string.
+ * appear, they get copied into the command ring and the sim
+ * command process hands them to the test app on the main loop.
  */
 static void *sim_cmd_in_thread(void *dummy)
 {
+	U8 len;
+
 	while (1)
 	{
 		if (read(node.cmd_in.pipe, cmd, sizeof(cmd)) == -1)
 			perror("sim_cmd_in_thread");
-		test_app_parse(cmd);
+
+		len = strnlen(cmd, sizeof(cmd) - 1) + 1;
+		while (!sim_ring_put(&cmd_ring, (U8 *)cmd, len)) {
+			process_poll(&sim_cmd_process);
+			contiki_main_wakeup();
+			usleep(100);
+		}
+		process_poll(&sim_cmd_process);
+		contiki_main_wakeup();
 	}
 	return NULL;
 }
 
+/*
+ * Hand the commands from the cmd ring to the test app. Commands that
+ * came in before the process was started are picked up on the first
+ * pass.
+ */
+PROCESS_THREAD(sim_cmd_process, ev, data)
+{
+	U8 *cmd_data, len;
+
+	PROCESS_BEGIN();
+
+	while (1) {
+		while ((cmd_data = sim_ring_peek(&cmd_ring, &len)) != NULL)
+		{
+			cmd_data[len - 1] = '\0';
+			test_app_parse((char *)cmd_data);
+			sim_ring_release(&cmd_ring);
+		}
+		PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+	}
+
+	PROCESS_END();
+}
+
+/* Start the process that takes the shell commands. Called once the scheduler is up. */
+void sim_cmd_init()
+{
+	process_start(&sim_cmd_process, NULL);
+}
+
 /* Send the tx to the data_out pipe */
 void sim_pipe_data_out(U8 *data, U8 len)
 {
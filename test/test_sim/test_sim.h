@@ -73,4 +73,5 @@ typedef struct _sim_node_t
 void sim_pipe_data_out(U8 *data, U8 len);
 void sim_pipe_cmd_out(U8 *data, U8 len);
 sim_node_t *node_get();
+void sim_cmd_init();
 #endif
@@ -0,0 +1,292 @@
+/*******************************************************************
+    Copyright (C) 2009 FreakLabs
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in the
+       documentation and/or other materials provided with the distribution.
+    3. Neither the name of the the copyright holder nor the names of its contributors
+       may be used to endorse or promote products derived from this software
+       without specific prior written permission.
+    4. This software is subject to the additional restrictions placed on the
+       Zigbee Specification's Terms of Use.
+
+    THIS SOFTWARE IS PROVIDED BY THE THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+    OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+    SUCH DAMAGE.
+
+    Originally written by Christopher Wang aka Akiba.
+    Please post support questions to the FreakLabs forum.
+
+*******************************************************************/
+/*******************************************************************
+    Author: Christopher Wang
+
+    Title: Tree routing check
+
+    Description:
+    Host check for the tree routing math in nwk_rte_tree.c. For every
+    tree shape in range, it builds the whole tree with the spec Cskip
+    formula. Then every router in the tree routes to every other node.
+    The closed form next hop is compared against the old lookup, which
+    loops over the child router sub-blocks and searches the neighbor
+    table. It also times both of them on the largest tree.
+*******************************************************************/
+#include <stdio.h>
+#include <time.h>
+#include "freakz.h"
+
+#define MAX_NODES       4096
+#define MAX_DEPTH       5
+#define MAX_ROUTERS     4
+#define MAX_CHILDREN    6
+
+typedef struct
+{
+	U16 addr;
+	U16 parent;
+	U8 depth;
+	bool rtr;
+} node_t;
+
+static nwk_nib_t nib;
+static U16 parent_addr;
+static node_t nodes[MAX_NODES];
+static U16 node_cnt;
+
+/* stubs for the parts of the nwk that nwk_rte_tree.c calls */
+nwk_nib_t *nwk_nib_get()
+{
+	return &nib;
+}
+
+U16 nwk_neighbor_tbl_get_parent()
+{
+	return parent_addr;
+}
+
+/* Cskip straight from the spec formula, the way it used to be calculated */
+static U16 ref_cskip(U8 depth)
+{
+	S32 temp = 1;
+	U8 i, exp;
+
+	if (depth >= nib.max_depth)
+		return 0;
+
+	exp = nib.max_depth - (depth + 1);
+	if (nib.max_routers == 1)
+		return (U16)(1 + (nib.max_children * exp));
+
+	for (i = 0; i < exp; i++)
+		temp *= nib.max_routers;
+
+	return (U16)(((1 + nib.max_children - nib.max_routers) - (nib.max_children * temp)) /
+		     (1 - nib.max_routers));
+}
+
+/* the old lookup's neighbor table check. these are our children in the tree. */
+static bool ref_is_child(U16 addr, U16 cskip, U16 dest)
+{
+	U16 i;
+
+	for (i = 0; (i < nib.max_routers) && cskip; i++)
+	{
+		if (dest == (U16)(addr + 1 + (i * cskip)))
+			return true;
+	}
+
+	for (i = 1; (i <= nib.max_children - nib.max_routers) && cskip; i++)
+	{
+		if (dest == (U16)(addr + (cskip * nib.max_routers) + i))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * The old lookup. Route down if the dest is inside our block, then either
+ * hit a child in the neighbor table or loop over the child router sub-blocks
+ * to find the one that holds the dest.
+ */
+static U16 ref_next_hop(U16 dest)
+{
+	U16 addr = nib.short_addr;
+	U16 cskip, cskip_parent, lower, upper;
+	U8 i;
+
+	cskip = ref_cskip(nib.depth);
+	cskip_parent = (nib.depth != 0) ? ref_cskip(nib.depth - 1) : 0;
+
+	if ((addr != 0) && !((dest > addr) && (dest < (addr + cskip_parent))))
+		return parent_addr;
+
+	if (ref_is_child(addr, cskip, dest))
+		return dest;
+
+	for (i = 0; i < nib.max_routers; i++)
+	{
+		lower = (U16)(addr + 1 + (cskip * i));
+		upper = lower + cskip;
+
+		if ((dest > lower) && (dest < upper))
+			return lower;
+	}
+	return INVALID_NWK_ADDR;
+}
+
+/* Add a node and all of its descendants to the tree */
+static void build(U16 addr, U16 parent, U8 depth, bool rtr)
+{
+	U16 cskip;
+	U8 i;
+
+	if (node_cnt >= MAX_NODES)
+	{
+		printf("Tree too big for the node table\n");
+		exit(1);
+	}
+
+	nodes[node_cnt].addr    = addr;
+	nodes[node_cnt].parent  = parent;
+	nodes[node_cnt].depth   = depth;
+	nodes[node_cnt].rtr     = rtr;
+	node_cnt++;
+
+	if (!rtr || ((cskip = ref_cskip(depth)) == 0))
+		return;
+
+	for (i = 0; i < nib.max_routers; i++)
+		build(addr + 1 + (i * cskip), addr, depth + 1, true);
+
+	for (i = 1; i <= (nib.max_children - nib.max_routers); i++)
+		build(addr + (cskip * nib.max_routers) + i, addr, depth + 1, false);
+}
+
+/* Put the nib in the place of the router at this node */
+static void become(const node_t *self)
+{
+	nib.short_addr  = self->addr;
+	nib.depth       = self->depth;
+	parent_addr     = (self->addr == 0) ? INVALID_NWK_ADDR : self->parent;
+}
+
+/* Check the cskip table and every router to every node. Returns the number of mismatches. */
+static U32 check()
+{
+	U32 errs = 0;
+	U16 i, j, hop, ref;
+	U8 d;
+
+	node_cnt = 0;
+	build(0, INVALID_NWK_ADDR, 0, true);
+	nib.depth = 0;
+	nwk_rte_tree_calc_cskip_tbl();
+
+	for (d = 0; d <= nib.max_depth; d++)
+	{
+		if (nwk_rte_tree_calc_cskip(d) != ref_cskip(d))
+		{
+			printf("Lm %d Rm %d Cm %d: cskip(%d) = %d, expected %d\n",
+			       nib.max_depth, nib.max_routers, nib.max_children, d,
+			       nwk_rte_tree_calc_cskip(d), ref_cskip(d));
+			errs++;
+		}
+	}
+
+	for (i = 0; i < node_cnt; i++)
+	{
+		if (!nodes[i].rtr)
+			continue;
+
+		become(&nodes[i]);
+		for (j = 0; j < node_cnt; j++)
+		{
+			if (i == j)
+				continue;
+
+			hop = nwk_rte_tree_calc_next_hop(nodes[j].addr);
+			ref = ref_next_hop(nodes[j].addr);
+			if (hop != ref)
+			{
+				if (errs < 10)
+					printf("Lm %d Rm %d Cm %d: %04X at depth %d to %04X. next hop %04X, expected %04X\n",
+					       nib.max_depth, nib.max_routers, nib.max_children,
+					       nodes[i].addr, nodes[i].depth, nodes[j].addr, hop, ref);
+				errs++;
+			}
+		}
+	}
+	return errs;
+}
+
+/* Time one next hop function over every router to every node in the current tree */
+static double bench(U16 (*next_hop)(U16), U32 *calls)
+{
+	volatile U16 sink;
+	clock_t start;
+	U16 i, j;
+	U8 rep;
+
+	*calls = 0;
+	start = clock();
+	for (rep = 0; rep < 20; rep++)
+	{
+		for (i = 0; i < node_cnt; i++)
+		{
+			if (!nodes[i].rtr)
+				continue;
+
+			become(&nodes[i]);
+			for (j = 0; j < node_cnt; j++)
+			{
+				sink = next_hop(nodes[j].addr);
+				(*calls)++;
+			}
+		}
+	}
+	(void)sink;
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main()
+{
+	U32 errs = 0, trees = 0, calls;
+	double t_new, t_old;
+
+	for (nib.max_depth = 1; nib.max_depth <= MAX_DEPTH; nib.max_depth++)
+	{
+		for (nib.max_routers = 1; nib.max_routers <= MAX_ROUTERS; nib.max_routers++)
+		{
+			for (nib.max_children = nib.max_routers; nib.max_children <= MAX_CHILDREN; nib.max_children++)
+			{
+				errs += check();
+				trees++;
+			}
+		}
+	}
+	printf("Checked %d trees, %d mismatches.\n", trees, errs);
+
+	/* the last tree is the largest one */
+	t_new = bench(nwk_rte_tree_calc_next_hop, &calls);
+	t_old = bench(ref_next_hop, &calls);
+	printf("Lm %d Rm %d Cm %d, %d nodes, %d calls: closed form %.1f ns/call, old lookup %.1f ns/call.\n",
+	       MAX_DEPTH, MAX_ROUTERS, MAX_CHILDREN, node_cnt, calls,
+	       (t_new * 1e9) / calls, (t_old * 1e9) / calls);
+
+	return errs ? 1 : 0;
+}